@@ -239,34 +239,49 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
+        if (cacheFullInput)
+        {//everything is already demeaned in memory, so use the cache-blocked version
+            vector<int> outIndices, otherIndices;
+            for (int i = 0; i < numRows; ++i)
+            {
+                if (i >= startrow && i < endrow)
+                {
+                    outIndices.push_back(i);
+                } else {
+                    otherIndices.push_back(i);
+                }
             }
-            for (int j = startrow; j < endrow; ++j)
+            correlateTiled(outIndices, otherIndices, outRows, fisherZ);
+        } else {
+            int curRow = 0;//because we can't trust the order threads hit the critical section
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int i = 0; i < numRows; ++i)
             {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
+                float movingRrs;
+                int myrow;
+                const float* movingRow;
+#pragma omp critical
+                {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
+                    myrow = curRow;//so, manually force it to read sequentially
+                    ++curRow;
+                    movingRow = getRow(myrow, movingRrs);
+                }
+                for (int j = startrow; j < endrow; ++j)
                 {
-                    if (j >= myrow)//if so, only compute one half, and store both places
+                    if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
                     {
+                        if (j >= myrow)//if so, only compute one half, and store both places
+                        {
+                            float cacheRrs;
+                            const float* cacheRow = getRow(j, cacheRrs, true);
+                            outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
+                            outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
+                        }
+                    } else {
                         float cacheRrs;
                         const float* cacheRow = getRow(j, cacheRrs, true);
                         outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
                     }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
                 }
             }
         }
@@ -428,33 +443,47 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             }
             indexReverse[ciftiIndexList[i].first] = i;
         }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
+        if (cacheFullInput)
         {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
+            vector<int> outIndices, otherIndices;
+            for (int i = startrow; i < endrow; ++i)
+            {
+                outIndices.push_back(ciftiIndexList[i].first);
             }
-            for (int j = startrow; j < endrow; ++j)
+            for (int i = 0; i < numRows; ++i)
             {
-                if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
+                if (indexReverse[i] == -1) otherIndices.push_back(i);
+            }
+            correlateTiled(outIndices, otherIndices, outRows, fisherZ);
+        } else {
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int i = 0; i < numRows; ++i)
+            {
+                float movingRrs;
+                int myrow;
+                const float* movingRow;
+#pragma omp critical
+                {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
+                    myrow = curRow;//so, manually force it to read sequentially
+                    ++curRow;
+                    movingRow = getRow(myrow, movingRrs);
+                }
+                for (int j = startrow; j < endrow; ++j)
                 {
-                    if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
+                    if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
                     {
+                        if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
+                        {
+                            float cacheRrs;
+                            const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
+                            outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
+                            outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
+                        }
+                    } else {
                         float cacheRrs;
                         const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
                         outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
                     }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
                 }
             }
         }
@@ -518,16 +547,31 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
 }
 
 float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+{
+    bool sameRow = (row1 == row2);
+    double accum = 0.0;
+    if (!sameRow || m_covariance)
+    {
+        if (m_weightedMode)
+        {
+            accum = dsdot(row1, row2, (int)m_weightIndexes.size());//because we compacted the data in the row to not include any zero weights
+        } else {
+            accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
+        }
+    }
+    return finishCorrelation(accum, rrs1, rrs2, fisherZ, sameRow);
+}
+
+float AlgorithmCiftiCorrelation::finishCorrelation(const double& accum, const float& rrs1, const float& rrs2, const bool& fisherZ, const bool& sameRow)
 {
     double r;
-    if (row1 == row2 && !m_covariance)
+    if (sameRow && !m_covariance)
     {
         r = 1.0;//short circuit for same row
     } else {
         if (m_weightedMode)
         {
-            int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-            double accum = dsdot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
+            int numWeights = (int)m_weightIndexes.size();
             if (m_covariance)
             {
                 if (m_binaryWeights)
@@ -537,10 +581,9 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
                     r = accum / rrs1;//NOTE: will equal rrs2 as it only depends on weights, and is not square root
                 }
             } else {
-                r = accum / (rrs1 * rrs2);//as do these
+                r = accum / (rrs1 * rrs2);//these have already had the weighted row means subtracted out, and weights applied
             }
         } else {
-            double accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
             if (m_covariance)
             {
                 r = accum / m_numCols;
@@ -564,6 +607,104 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
     return r;
 }
 
+namespace
+{
+    const int TILE_ROWS = 32;//rows per side of a tile, 32x32 double accumulators is 8KiB
+    const int TILE_COLS = 128;//row segment length per inner pass, so the 2 * 32 segments of a tile (32KiB) stay in L1 while every pair is computed
+}
+
+//SYRK-like blocked version for when all rows are demeaned in the cache: the output rows (outIndices) against themselves form a symmetric block,
+//so only the upper triangle of tiles is computed and mirrored, while the tiles against the remaining rows (otherIndices) are computed in full
+//outRows[i] is the output row for outIndices[i], indexed by cifti row
+void AlgorithmCiftiCorrelation::correlateTiled(const vector<int>& outIndices, const vector<int>& otherIndices, vector<CaretArray<float> >& outRows, const bool& fisherZ)
+{
+    CaretAssert(outRows.size() == outIndices.size());
+    int numOut = (int)outIndices.size(), numOther = (int)otherIndices.size();
+    int rowLength = (m_weightedMode ? (int)m_weightIndexes.size() : m_numCols);
+    vector<const float*> outPtrs(numOut), otherPtrs(numOther);
+    vector<float> outRrs(numOut), otherRrs(numOther);
+    for (int i = 0; i < numOut; ++i)
+    {
+        outPtrs[i] = getRow(outIndices[i], outRrs[i], true);
+    }
+    for (int i = 0; i < numOther; ++i)
+    {
+        otherPtrs[i] = getRow(otherIndices[i], otherRrs[i], true);
+    }
+    int numOutTiles = (numOut + TILE_ROWS - 1) / TILE_ROWS, numOtherTiles = (numOther + TILE_ROWS - 1) / TILE_ROWS;
+    vector<pair<int, int> > jobs;//second >= numOutTiles means a tile of otherIndices
+    for (int i = 0; i < numOutTiles; ++i)
+    {
+        for (int j = i; j < numOutTiles; ++j)
+        {
+            jobs.push_back(make_pair(i, j));
+        }
+        for (int j = 0; j < numOtherTiles; ++j)
+        {
+            jobs.push_back(make_pair(i, numOutTiles + j));
+        }
+    }
+    int numJobs = (int)jobs.size();
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int job = 0; job < numJobs; ++job)
+    {
+        double accum[TILE_ROWS][TILE_ROWS];
+        int iStart = jobs[job].first * TILE_ROWS, iEnd = min(iStart + TILE_ROWS, numOut);
+        bool symmetric = (jobs[job].second < numOutTiles);
+        int jStart, jEnd;
+        const float* const* movingPtrs;
+        const float* movingRrs;
+        const int* movingIndices;
+        if (symmetric)
+        {
+            jStart = jobs[job].second * TILE_ROWS;
+            jEnd = min(jStart + TILE_ROWS, numOut);
+            movingPtrs = outPtrs.data();
+            movingRrs = outRrs.data();
+            movingIndices = outIndices.data();
+        } else {
+            jStart = (jobs[job].second - numOutTiles) * TILE_ROWS;
+            jEnd = min(jStart + TILE_ROWS, numOther);
+            movingPtrs = otherPtrs.data();
+            movingRrs = otherRrs.data();
+            movingIndices = otherIndices.data();
+        }
+        bool diagonal = symmetric && (jStart == iStart);//on diagonal tiles, only do the upper triangle
+        for (int i = iStart; i < iEnd; ++i)
+        {
+            for (int j = jStart; j < jEnd; ++j)
+            {
+                accum[i - iStart][j - jStart] = 0.0;
+            }
+        }
+        for (int k = 0; k < rowLength; k += TILE_COLS)
+        {
+            int kLength = min(TILE_COLS, rowLength - k);
+            for (int i = iStart; i < iEnd; ++i)
+            {
+                const float* rowSegment = outPtrs[i] + k;
+                for (int j = (diagonal ? i : jStart); j < jEnd; ++j)
+                {
+                    accum[i - iStart][j - jStart] += dsdot(rowSegment, movingPtrs[j] + k, kLength);
+                }
+            }
+        }
+        for (int i = iStart; i < iEnd; ++i)
+        {
+            for (int j = (diagonal ? i : jStart); j < jEnd; ++j)
+            {
+                bool sameRow = (outIndices[i] == movingIndices[j]);
+                float result = finishCorrelation(accum[i - iStart][j - jStart], outRrs[i], movingRrs[j], fisherZ, sameRow);
+                outRows[i][movingIndices[j]] = result;
+                if (symmetric)
+                {
+                    outRows[j][outIndices[i]] = result;
+                }
+            }
+        }
+    }
+}
+
 void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>* weights, const bool& noDemean, const bool& covariance)
 {
     m_noDemean = noDemean;
@@ -62,6 +62,8 @@ namespace caret {
         const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
         float* getTempRow();
         float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        float finishCorrelation(const double& accum, const float& rrs1, const float& rrs2, const bool& fisherZ, const bool& sameRow);
+        void correlateTiled(const std::vector<int>& outIndices, const std::vector<int>& otherIndices, std::vector<CaretArray<float> >& outRows, const bool& fisherZ);
         void init(const CiftiFile* input, const std::vector<float>* weights, const bool& noDemean, const bool& covariance);
         int numRowsForMem(const float& memLimitGB, bool& cacheFullInput);
     protected:
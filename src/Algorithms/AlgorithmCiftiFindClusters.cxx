@@ -26,10 +26,14 @@
 #include "AlgorithmMetricFindClusters.h"
 #include "AlgorithmVolumeFindClusters.h"
 #include "CiftiFile.h"
+#include "CiftiStructureView.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -277,14 +281,41 @@ AlgorithmCiftiFindClusters::AlgorithmCiftiFindClusters(ProgressObject* myProgObj
             default:
                 break;
         }
-        MetricFile myMetric, myRoi, myMetricOut;
-        AlgorithmCiftiSeparate(NULL, myCifti, myDir, surfaceList[whichStruct], &myMetric, &myRoi);
+        CiftiStructureView inView(myCifti, myDir, surfaceList[whichStruct]);//process the structure in place, rather than separating it into a metric and replacing it afterwards
+        CiftiStructureView outView(myCiftiOut, myDir, surfaceList[whichStruct]);
+        int64_t numNodes = inView.getSurfaceNumberOfNodes(), numMaps = inView.getNumberOfMaps();
+        vector<float> nodeData(numNodes);
+        MetricFile myRoi;
+        myRoi.setNumberOfNodesAndColumns(numNodes, 1);
+        myRoi.setStructure(surfaceList[whichStruct]);
         if (roiCifti != NULL)
         {//due to above testing, we know the structure mask is the same, so just overwrite the ROI from the mask
-            AlgorithmCiftiSeparate(NULL, roiCifti, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct], &myRoi);
+            CiftiStructureView roiView(roiCifti, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct]);
+            roiView.getSurfaceNodeData(0, nodeData.data());
+        } else {
+            inView.getSurfaceRoi(nodeData.data());
+        }
+        myRoi.setValuesForColumn(0, nodeData.data());
+        //only a block of maps goes through the metric algorithm at a time, so memory stays bounded on long series
+        int64_t blockMaps = max((int64_t)1, min(numMaps, CiftiStructureView::DEFAULT_BUFFER_BYTES / (int64_t)(numNodes * sizeof(float))));
+        for (int64_t firstMap = 0; firstMap < numMaps; firstMap += blockMaps)
+        {
+            int64_t thisBlock = min(blockMaps, numMaps - firstMap);
+            MetricFile myMetric, myMetricOut;
+            myMetric.setNumberOfNodesAndColumns(numNodes, thisBlock);
+            myMetric.setStructure(surfaceList[whichStruct]);
+            for (int64_t i = 0; i < thisBlock; ++i)
+            {
+                inView.getSurfaceNodeData(firstMap + i, nodeData.data());
+                myMetric.setValuesForColumn(i, nodeData.data());
+            }
+            AlgorithmMetricFindClusters(NULL, mySurf, &myMetric, surfThresh, surfSize, &myMetricOut, lessThan, &myRoi, myAreas, -1, markVal, &markVal, surfSizeRatio, surfDistCutoff);
+            for (int64_t i = 0; i < thisBlock; ++i)
+            {
+                outView.setSurfaceNodeData(firstMap + i, myMetricOut.getValuePointerForColumn(i));
+            }
         }
-        AlgorithmMetricFindClusters(NULL, mySurf, &myMetric, surfThresh, surfSize, &myMetricOut, lessThan, &myRoi, myAreas, -1, markVal, &markVal, surfSizeRatio, surfDistCutoff);
-        AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetricOut);
+        outView.flush();
     }
     if (mergedVol)
     {
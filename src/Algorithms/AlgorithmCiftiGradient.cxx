@@ -28,7 +28,10 @@
 #include "SurfaceFile.h"
 #include "AlgorithmCiftiSeparate.h"
 #include "AlgorithmCiftiReplaceStructure.h"
+#include "CaretPointer.h"
+#include "CiftiStructureView.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -271,37 +274,73 @@ AlgorithmCiftiGradient::AlgorithmCiftiGradient(ProgressObject* myProgObj, const
             default:
                 break;
         }
-        MetricFile myMetric, myRoi, myMetricOut, vectorsOut, *vectorPtr = NULL;
-        if (ciftiVectorsOut != NULL) vectorPtr = &vectorsOut;
-        AlgorithmCiftiSeparate(NULL, myCifti, myDir, surfaceList[whichStruct], &myMetric, &myRoi);
-        AlgorithmMetricGradient(NULL, mySurf, &myMetric, &myMetricOut, vectorPtr, surfKern, &myRoi, false, -1, myAreas);
+        CiftiStructureView inView(myCifti, myDir, surfaceList[whichStruct]);//process the structure in place, rather than separating it into a metric and replacing it afterwards
+        int64_t numNodes = inView.getSurfaceNumberOfNodes(), numMaps = inView.getNumberOfMaps();
+        vector<float> nodeData(numNodes);
+        MetricFile myRoi;
+        myRoi.setNumberOfNodesAndColumns(numNodes, 1);
+        myRoi.setStructure(surfaceList[whichStruct]);
+        inView.getSurfaceRoi(nodeData.data());
+        myRoi.setValuesForColumn(0, nodeData.data());
+        //only a block of maps goes through the metric algorithm at a time, so memory stays bounded on long series
+        int64_t blockMaps = max((int64_t)1, min(numMaps, CiftiStructureView::DEFAULT_BUFFER_BYTES / (int64_t)(numNodes * sizeof(float))));
+        vector<double> accum;
+        if (outputAverage) accum.resize(numNodes, 0.0);//use double for numerical stability
+        CaretPointer<CiftiStructureView> outView, vecView;
         if (outputAverage)
         {
-            int numNodes = myMetricOut.getNumberOfNodes(), numCols = myMetricOut.getNumberOfColumns();
-            vector<double> accum(numNodes, 0.0);//use double for numerical stability
-            for (int i = 0; i < numCols; ++i)
+            outView.grabNew(new CiftiStructureView(myCiftiOut, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct]));//average always outputs a dscalar, so always along column
+        } else {
+            outView.grabNew(new CiftiStructureView(myCiftiOut, myDir, surfaceList[whichStruct]));
+            if (ciftiVectorsOut != NULL)
+            {//is always a dscalar, so always use column
+                vecView.grabNew(new CiftiStructureView(ciftiVectorsOut, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct]));
+            }
+        }
+        for (int64_t firstMap = 0; firstMap < numMaps; firstMap += blockMaps)
+        {
+            int64_t thisBlock = min(blockMaps, numMaps - firstMap);
+            MetricFile myMetric, myMetricOut, vectorsOut, *vectorPtr = NULL;
+            if (ciftiVectorsOut != NULL) vectorPtr = &vectorsOut;
+            myMetric.setNumberOfNodesAndColumns(numNodes, thisBlock);
+            myMetric.setStructure(surfaceList[whichStruct]);
+            for (int64_t i = 0; i < thisBlock; ++i)
+            {
+                inView.getSurfaceNodeData(firstMap + i, nodeData.data());
+                myMetric.setValuesForColumn(i, nodeData.data());
+            }
+            AlgorithmMetricGradient(NULL, mySurf, &myMetric, &myMetricOut, vectorPtr, surfKern, &myRoi, false, -1, myAreas);
+            for (int64_t i = 0; i < thisBlock; ++i)
             {
                 const float* column = myMetricOut.getValuePointerForColumn(i);
-                for (int j = 0; j < numNodes; ++j)
+                if (outputAverage)
                 {
-                    accum[j] += column[j];
+                    for (int64_t j = 0; j < numNodes; ++j)
+                    {
+                        accum[j] += column[j];
+                    }
+                } else {
+                    outView->setSurfaceNodeData(firstMap + i, column);
+                    if (ciftiVectorsOut != NULL)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            vecView->setSurfaceNodeData((firstMap + i) * 3 + k, vectorsOut.getValuePointerForColumn(i * 3 + k));
+                        }
+                    }
                 }
             }
-            vector<float> temparray(numNodes);//copy result into float array so it can be put into a metric, and then into cifti (yes, really)
-            for (int i = 0; i < numNodes; ++i)
+        }
+        if (outputAverage)
+        {
+            for (int64_t j = 0; j < numNodes; ++j)
             {
-                temparray[i] = (float)(accum[i] / numCols);
-            }
-            myMetricOut.setNumberOfNodesAndColumns(numNodes, 1);
-            myMetricOut.setValuesForColumn(0, temparray.data());
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct], &myMetricOut);//average always outputs a dscalar, so always along column
-        } else {
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetricOut);
-            if (ciftiVectorsOut != NULL)
-            {//is always a dscalar, so always use column
-                AlgorithmCiftiReplaceStructure(NULL, ciftiVectorsOut, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct], &vectorsOut);
+                nodeData[j] = (float)(accum[j] / numMaps);
             }
+            outView->setSurfaceNodeData(0, nodeData.data());
         }
+        outView->flush();
+        if (vecView != NULL) vecView->flush();
     }
     for (int whichStruct = 0; whichStruct < (int)volumeList.size(); ++whichStruct)
     {
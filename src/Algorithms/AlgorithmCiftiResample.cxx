@@ -36,6 +36,7 @@
 #include "SurfaceResamplingHelper.h"
 #include "VolumeFile.h"
 #include "VolumePaddingHelper.h"
+#include "VolumeResamplePlan.h"
 #include "WarpfieldFile.h"
 
 #include <algorithm>
@@ -502,6 +503,7 @@ namespace
     {//a place to stuff anything that can be precomputed or reused for applying to the same structure in multiple maps
         SurfaceResamplingHelper surfResamp;
         VolumePaddingHelper volPadding;
+        CaretPointer<VolumeResamplePlan> volPlan;
         const SurfaceFile* curSphere, *newSphere;
         MetricFile tempMetric1, tempMetric2, surfDilateRoi;
         LabelFile tempLabel1, tempLabel2;
@@ -815,7 +817,11 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                     AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
                     toResample = myCache.tempVol3;
                 }
-                AlgorithmVolumeWarpfieldResample(NULL, toResample, warpfield, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
+                if (myCache.volPlan == NULL)
+                {//every row uses the same volume geometry, so map the output voxels only once
+                    myCache.volPlan.grabNew(new VolumeResamplePlan(toResample->getVolumeSpace(), warpfield, myCache.refDims, myCache.refSform, myVolMethod));
+                }
+                myCache.volPlan->resample(toResample, myCache.tempVol2);
                 for (int j = 0; j < outMapSize; ++j)
                 {
                     outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
@@ -934,7 +940,11 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                     AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
                     toResample = myCache.tempVol3;
                 }
-                AlgorithmVolumeAffineResample(NULL, toResample, affine, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
+                if (myCache.volPlan == NULL)
+                {//every row uses the same volume geometry, so map the output voxels only once
+                    myCache.volPlan.grabNew(new VolumeResamplePlan(toResample->getVolumeSpace(), affine, myCache.refDims, myCache.refSform, myVolMethod));
+                }
+                myCache.volPlan->resample(toResample, myCache.tempVol2);
                 for (int j = 0; j < outMapSize; ++j)
                 {
                     outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
@@ -20,7 +20,6 @@
 
 #include "AlgorithmCiftiSmoothing.h"
 #include "AlgorithmException.h"
-#include "AlgorithmMetricSmoothing.h"
 #include "AlgorithmVolumeSmoothing.h"
 #include "CiftiFile.h"
 #include "MetricFile.h"
@@ -28,6 +27,10 @@
 #include "SurfaceFile.h"
 #include "AlgorithmCiftiSeparate.h"
 #include "AlgorithmCiftiReplaceStructure.h"
+#include "CiftiStructureView.h"
+#include "MetricSmoothingObject.h"
+
+#include <algorithm>
 
 using namespace caret;
 using namespace std;
@@ -84,7 +87,9 @@ OperationParameters* AlgorithmCiftiSmoothing::getParameters()
         "for the reduction of structure in a group average surface.  It is better to smooth the data on individuals before averaging, when feasible.\n\n" +
         "The -fix-zeros-* options will treat values of zero as lack of data, and not use that value when generating the smoothed values, but will fill zeros with extrapolated values.  " +
         "The ROI should have a brain models mapping along columns, exactly matching the mapping of the chosen direction in the input file.  " +
-        "Data outside the ROI is ignored."
+        "Data outside the ROI is ignored.\n\n" +
+        "When smoothing many files on the same surfaces, the surface smoothing kernels can be computed once with -surface-smoothing-kernels, " +
+        "and loaded by adding the global option '-smoothing-kernel-cache <directory>' to this command."
     );
     return ret;
 }
@@ -247,19 +252,55 @@ AlgorithmCiftiSmoothing::AlgorithmCiftiSmoothing(ProgressObject* myProgObj, cons
             default:
                 break;
         }
-        MetricFile myMetric, myRoi, myMetricOut;
-        AlgorithmCiftiSeparate(NULL, myCifti, myDir, surfaceList[whichStruct], &myMetric, &myRoi);
+        CiftiStructureView inView(myCifti, myDir, surfaceList[whichStruct]);//process the structure in place, rather than separating it into a metric and replacing it afterwards
+        CiftiStructureView outView(myCiftiOut, myDir, surfaceList[whichStruct]);
+        int64_t numNodes = inView.getSurfaceNumberOfNodes(), numMaps = inView.getNumberOfMaps();
         if (surfKern > 0.0f)
         {
+            vector<float> roiData(numNodes);
             if (roiCifti != NULL)
             {//due to above testing, we know the structure mask is the same, so just overwrite the ROI from the mask
-                AlgorithmCiftiSeparate(NULL, roiCifti, CiftiXMLOld::ALONG_COLUMN, surfaceList[whichStruct], &myRoi);
+                CiftiStructureView roiView(roiCifti, CiftiXML::ALONG_COLUMN, surfaceList[whichStruct]);
+                roiView.getSurfaceNodeData(0, roiData.data());
+            } else {
+                inView.getSurfaceRoi(roiData.data());
+            }
+            MetricFile myRoi;//the smoothing weights need the roi as a metric, but it is only one column
+            myRoi.setNumberOfNodesAndColumns(numNodes, 1);
+            myRoi.setStructure(surfaceList[whichStruct]);
+            myRoi.setValuesForColumn(0, roiData.data());
+            const float* areaData = NULL;
+            if (myAreas != NULL) areaData = myAreas->getValuePointerForColumn(0);
+            MetricSmoothingObject mySmoothObj(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData);
+            const int64_t MAP_BLOCK = 64;//smoothing many maps together reads the kernels once per panel of maps, rather than once per map
+            int64_t blockMaps = min(MAP_BLOCK, numMaps);
+            vector<vector<float> > nodeIn(blockMaps, vector<float>(numNodes)), nodeOut(blockMaps, vector<float>(numNodes));
+            for (int64_t firstMap = 0; firstMap < numMaps; firstMap += MAP_BLOCK)
+            {
+                int64_t thisBlock = min(MAP_BLOCK, numMaps - firstMap);
+                vector<const float*> columnsIn(thisBlock);
+                vector<float*> columnsOut(thisBlock);
+                for (int64_t i = 0; i < thisBlock; ++i)
+                {
+                    inView.getSurfaceNodeData(firstMap + i, nodeIn[i].data());
+                    columnsIn[i] = nodeIn[i].data();
+                    columnsOut[i] = nodeOut[i].data();
+                }
+                mySmoothObj.smoothColumns(columnsIn, columnsOut, roiData.data(), fixZerosSurf);
+                for (int64_t i = 0; i < thisBlock; ++i)
+                {
+                    outView.setSurfaceNodeData(firstMap + i, nodeOut[i].data());
+                }
             }
-            AlgorithmMetricSmoothing(NULL, mySurf, &myMetric, surfKern, &myMetricOut, &myRoi, false, fixZerosSurf, -1, myAreas);
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetricOut);
         } else {
-            AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, surfaceList[whichStruct], &myMetric);
+            vector<float> elements(inView.getNumberOfElements());
+            for (int64_t map = 0; map < numMaps; ++map)
+            {
+                inView.getElements(map, elements.data());
+                outView.setElements(map, elements.data());
+            }
         }
+        outView.flush();
     }
     if (mergedVolume)
     {
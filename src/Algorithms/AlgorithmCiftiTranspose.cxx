@@ -20,11 +20,117 @@
 
 #include "AlgorithmCiftiTranspose.h"
 #include "AlgorithmException.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <cstring>
+
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    void seekTemp(QTemporaryFile& tempFile, const int64_t& position)
+    {
+        if (!tempFile.seek(position))
+        {
+            throw AlgorithmException("failed to seek in temporary file '" + tempFile.fileName() + "'");
+        }
+    }
+    
+    void writeTemp(QTemporaryFile& tempFile, const float* data, const int64_t& count)
+    {
+        const int64_t numBytes = count * sizeof(float);
+        if (tempFile.write((const char*)data, numBytes) != numBytes)
+        {
+            throw AlgorithmException("failed to write to temporary file '" + tempFile.fileName() + "', check free disk space");
+        }
+    }
+    
+    void readTemp(QTemporaryFile& tempFile, float* data, const int64_t& count)
+    {
+        const int64_t numBytes = count * sizeof(float);
+        if (tempFile.read((char*)data, numBytes) != numBytes)
+        {
+            throw AlgorithmException("failed to read from temporary file '" + tempFile.fileName() + "'");
+        }
+    }
+    
+    //two pass external-memory transpose, each pass reads and writes the data once, sequentially in large pieces
+    //pass 1 reads strips of input rows and writes each strip's transposed tiles into a temporary file, grouped by output row block
+    //pass 2 reads each output row block's tiles contiguously from the temporary file and writes the output rows in order
+    void blockedTranspose(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& memLimitBytes)
+    {
+        const int64_t numInRows = ciftiIn->getNumberOfRows(), inRowLength = ciftiIn->getNumberOfColumns();//output rows are inRowLength, output row length is numInRows
+        //half the limit goes to the strip or output block, the rest to the tile scratch
+        int64_t stripRows = memLimitBytes / 2 / (inRowLength * sizeof(float));
+        stripRows = max(int64_t(1), min(stripRows, numInRows));
+        int64_t blockRows = memLimitBytes / 2 / (numInRows * sizeof(float));
+        blockRows = max(int64_t(1), min(blockRows, inRowLength));
+        AString tempTemplate;
+        if (ciftiOut->getFileName() != "")
+        {
+            tempTemplate = ciftiOut->getFileName() + ".XXXXXX.tmp";//next to the output, as /tmp is often too small
+        } else {
+            tempTemplate = QDir::tempPath() + "/wb_cifti_transpose.XXXXXX.tmp";
+        }
+        QTemporaryFile tempFile(tempTemplate);
+        if (!tempFile.open())
+        {
+            throw AlgorithmException("failed to create temporary file '" + tempTemplate + "': " + tempFile.errorString());
+        }
+        vector<float> strip(stripRows * inRowLength), tile(stripRows * blockRows);
+        for (int64_t stripStart = 0; stripStart < numInRows; stripStart += stripRows)
+        {
+            const int64_t stripHeight = min(stripRows, numInRows - stripStart);
+            for (int64_t i = 0; i < stripHeight; ++i)
+            {
+                ciftiIn->getRow(strip.data() + i * inRowLength, stripStart + i);
+            }
+            for (int64_t blockStart = 0; blockStart < inRowLength; blockStart += blockRows)
+            {
+                const int64_t blockHeight = min(blockRows, inRowLength - blockStart);
+#pragma omp CARET_PARFOR schedule(dynamic)
+                for (int64_t j = 0; j < blockHeight; ++j)
+                {
+                    float* tileRow = tile.data() + j * stripHeight;
+                    const float* stripCol = strip.data() + blockStart + j;
+                    for (int64_t i = 0; i < stripHeight; ++i)
+                    {
+                        tileRow[i] = stripCol[i * inRowLength];
+                    }
+                }
+                seekTemp(tempFile, (blockStart * numInRows + blockHeight * stripStart) * sizeof(float));
+                writeTemp(tempFile, tile.data(), blockHeight * stripHeight);
+            }
+        }
+        strip = vector<float>();//release before allocating the output block
+        vector<float> block(blockRows * numInRows);
+        for (int64_t blockStart = 0; blockStart < inRowLength; blockStart += blockRows)
+        {
+            const int64_t blockHeight = min(blockRows, inRowLength - blockStart);
+            seekTemp(tempFile, blockStart * numInRows * sizeof(float));
+            for (int64_t stripStart = 0; stripStart < numInRows; stripStart += stripRows)
+            {
+                const int64_t stripHeight = min(stripRows, numInRows - stripStart);
+                readTemp(tempFile, tile.data(), blockHeight * stripHeight);
+                for (int64_t j = 0; j < blockHeight; ++j)
+                {
+                    memcpy(block.data() + j * numInRows + stripStart, tile.data() + j * stripHeight, stripHeight * sizeof(float));
+                }
+            }
+            for (int64_t j = 0; j < blockHeight; ++j)
+            {
+                ciftiOut->setRow(block.data() + j * numInRows, blockStart + j);
+            }
+        }
+    }
+}
+
 AString AlgorithmCiftiTranspose::getCommandSwitch()
 {
     return "-cifti-transpose";
@@ -47,7 +153,10 @@ OperationParameters* AlgorithmCiftiTranspose::getParameters()
     
     ret->setHelpText(
         AString("The input must be a 2-dimensional cifti file.  ") +
-        "The output is a cifti file where every row in the input is a column in the output."
+        "The output is a cifti file where every row in the input is a column in the output.\n\n" +
+        "When -mem-limit is too small to hold the entire output and the input is read from disk, the transpose is done in tiles through a temporary file " +
+        "next to the output file, which needs as much free disk space as the output file.  " +
+        "This reads the input once, rather than once per chunk of output rows that fits in the limit."
     );
     return ret;
 }
@@ -87,9 +196,17 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
     int numCacheRows = colSize;
     if (memLimitGB >= 0.0f)
     {
-        numCacheRows = memLimitGB * 1024 * 1024 * 1024 / outRowBytes;
-        if (numCacheRows < 1) numCacheRows = 1;
-        if (numCacheRows > colSize) numCacheRows = colSize;
+        int64_t memLimitBytes = memLimitGB * 1024 * 1024 * 1024;
+        if (memLimitBytes / outRowBytes < colSize)
+        {
+            if (!ciftiIn->isInMemory())
+            {//multiple passes over an on-disk input are slow, use the temporary file instead
+                blockedTranspose(ciftiIn, ciftiOut, memLimitBytes);
+                return;
+            }
+            numCacheRows = memLimitBytes / outRowBytes;
+            if (numCacheRows < 1) numCacheRows = 1;
+        }
     }
     vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
     vector<float> scratchInRow(colSize);
@@ -274,14 +274,30 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
 #pragma omp CARET_PAR
     {
         CaretPointer<SignedDistanceHelper> myDist = mySurf->getSignedDistanceHelper();
-        int numExact = (int)exactVoxelList.size();
+        const int BLOCK_SIZE = 64;//voxels in the list are in index order, so blocks of them are spatially coherent, which lets the helper reuse the previous closest triangle
+        int numExact = (int)exactVoxelList.size() / 3;
+        int numBlocks = (numExact + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        vector<float> blockCoords(BLOCK_SIZE * 3), blockDists(BLOCK_SIZE);
         Vector3D thisCoord;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < numExact; i += 3)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            myVolOut->indexToSpace(exactVoxelList.data() + i, thisCoord);
-            myVolOut->setValue(myDist->dist(thisCoord, myWinding), exactVoxelList.data() + i);
-            volMarked[myVolOut->getIndex(exactVoxelList.data() + i)] |= 22;//set marked to have valid value (positive and negative), and frozen
+            int start = block * BLOCK_SIZE;
+            int blockCount = min(BLOCK_SIZE, numExact - start);
+            for (int i = 0; i < blockCount; ++i)
+            {
+                myVolOut->indexToSpace(exactVoxelList.data() + (start + i) * 3, thisCoord);
+                blockCoords[i * 3] = thisCoord[0];
+                blockCoords[i * 3 + 1] = thisCoord[1];
+                blockCoords[i * 3 + 2] = thisCoord[2];
+            }
+            myDist->dist(blockCoords.data(), blockCount, blockDists.data(), myWinding);
+            for (int i = 0; i < blockCount; ++i)
+            {
+                const int64_t* thisVoxel = exactVoxelList.data() + (start + i) * 3;
+                myVolOut->setValue(blockDists[i], thisVoxel);
+                volMarked[myVolOut->getIndex(thisVoxel)] |= 22;//set marked to have valid value (positive and negative), and frozen
+            }
         }
     }
     myProgress.reportProgress(markweight + exactweight);
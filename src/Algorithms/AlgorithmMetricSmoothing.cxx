@@ -95,7 +95,10 @@ OperationParameters* AlgorithmMetricSmoothing::getParameters()
         "The GEO_GAUSS_AREA method is the default because it is usually the correct choice.  " +
         "GEO_GAUSS_EQUAL may be the correct choice when the sum of vertex values is more meaningful then the surface integral (sum of values .* areas), " +
         "for instance when smoothing vertex areas (the sum is the total surface area, while the surface integral is the sum of squares of the vertex areas).  " +
-        "The GEO_GAUSS method is not recommended, it exists mainly to replicate methods of studies done with caret5's geodesic smoothing."
+        "The GEO_GAUSS method is not recommended, it exists mainly to replicate methods of studies done with caret5's geodesic smoothing.\n\n" +
+        
+        "When smoothing many files on the same surface with the same settings, the smoothing kernels can be computed once with -surface-smoothing-kernels, " +
+        "and loaded by adding the global option '-smoothing-kernel-cache <directory>' to this command."
     );
     return ret;
 }
@@ -203,16 +206,21 @@ AlgorithmMetricSmoothing::AlgorithmMetricSmoothing(ProgressObject* myProgObj, co
         myMetricOut->setStructure(mySurf->getStructure());
         for (int32_t col = 0; col < numCols; ++col)
         {
-            myProgress.setTask("Smoothing Column " + AString::number(col));
             myMetricOut->setColumnName(col, myMetric->getColumnName(col) + ", smooth " + AString::number(myKernel));
             *(myMetricOut->getPaletteColorMapping(col)) = *(myMetric->getPaletteColorMapping(col));//copy the palette settings
-            if (myRoi != NULL && matchRoiColumns)
+        }
+        if (myRoi != NULL && matchRoiColumns)
+        {
+            for (int32_t col = 0; col < numCols; ++col)
             {
+                myProgress.setTask("Smoothing Column " + AString::number(col));
                 mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, col, fixZeros);
-            } else {
-                mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, 0, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
             }
-            myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
+        } else {//same roi for every column, so smooth many columns per pass over the kernels
+            myProgress.setTask("Smoothing Columns");
+            mySmoothObj->smoothMetric(myMetric, myMetricOut, myRoi, fixZeros);
+            myProgress.reportProgress(precomputeWeightWork + 1.0f);
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
@@ -26,16 +26,85 @@
 #include "CaretHeap.h"
 #include "CaretOMP.h"
 #include "MetricFile.h"
+#include "SignFlipPermutations.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <set>
 #include <vector>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{//hidden namespace just to make sure things don't collide
+    struct Cluster
+    {
+        double accumVal, totalArea;
+        vector<int> members;
+        float lastVal;
+        bool first;
+        Cluster()
+        {
+            first = true;
+            accumVal = 0.0;
+            totalArea = 0.0;
+        }
+        void addMember(const int& node, const float& val, const float& area, const float& param_e, const float& param_h)
+        {
+            update(val, param_e, param_h);
+            members.push_back(node);
+            totalArea += area;
+        }
+        void update(const float& bottomVal, const float& param_e, const float& param_h)
+        {
+            if (first)
+            {
+                lastVal = bottomVal;
+                first = false;
+            } else {
+                if (bottomVal != lastVal)//skip computing if there is no difference
+                {
+                    CaretAssert(bottomVal < lastVal);
+                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+                    double newSlice = pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
+                    accumVal += newSlice;
+                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
+                }
+            }
+        }
+    };
+    
+    int allocCluster(vector<Cluster>& clusterList, set<int>& deadClusters)
+    {
+        if (deadClusters.empty())
+        {
+            clusterList.push_back(Cluster());
+            return (int)(clusterList.size() - 1);
+        } else {
+            set<int>::iterator iter = deadClusters.begin();
+            int ret = *iter;
+            deadClusters.erase(iter);
+            clusterList[ret] = Cluster();//reinitialize
+            return ret;
+        }
+    }
+}
+
+struct AlgorithmMetricTFCE::Scratch
+{
+    vector<int> membership;//only the vertices of the clusters are reset after each use
+    vector<Cluster> clusterList;
+    set<int> deadClusters;//to allow reallocation without changing indices
+    CaretSimpleMaxHeap<int, float> nodeHeap;
+    vector<double> accum;
+    vector<float> negData;
+    Scratch(const int& numNodes) : membership(numNodes, -1), accum(numNodes), negData(numNodes) { }
+};
+
 AString AlgorithmMetricTFCE::getCommandSwitch()
 {
     return "-metric-tfce";
@@ -72,6 +141,16 @@ OperationParameters* AlgorithmMetricTFCE::getParameters()
     OptionalParameter* corrAreaOpt = ret->createOptionalParameter(8, "-corrected-areas", "vertex areas to use instead of computing them from the surface");
     corrAreaOpt->addMetricParameter(1, "area-metric", "the corrected vertex areas, as a metric");
     
+    OptionalParameter* permOpt = ret->createOptionalParameter(9, "-permutation-test", "treat the columns as subjects, and do a sign-flipping permutation test of their mean");
+    permOpt->addIntegerParameter(1, "num-perms", "number of permutations, including the unflipped data");
+    permOpt->addMetricOutputParameter(2, "p-out", "output - the familywise error corrected p-values");
+    OptionalParameter* flipFileOpt = permOpt->createOptionalParameter(3, "-flip-file", "use specified sign flips instead of random ones");
+    flipFileOpt->addStringParameter(1, "flip-file", "text file with one line per permutation, each containing a 1 or -1 for every column");
+    OptionalParameter* seedOpt = permOpt->createOptionalParameter(4, "-seed", "seed the random sign flips (default 0)");
+    seedOpt->addIntegerParameter(1, "seed", "the seed value");
+    OptionalParameter* nullOutOpt = permOpt->createOptionalParameter(5, "-null-out", "save the null distribution");
+    nullOutOpt->addStringParameter(1, "null-file", "output - text file to write the maximum absolute TFCE value of each permutation to");
+    
     ret->setHelpText(
         AString("Threshold-free cluster enhancement is a method to increase the relative value of regions that would form clusters in a standard thresholding test.  ") +
         "This is accomplished by evaluating the integral of:\n\n" +
@@ -80,6 +159,11 @@ OperationParameters* AlgorithmMetricTFCE::getParameters()
         "Negative values are similarly enhanced by negating the data, running the same process, and negating the result.\n\n" +
         "When using -presmooth with -corrected-areas, note that it is an approximate correction within the smoothing algorithm (the TFCE correction is exact).  " +
         "Doing smoothing on individual surfaces before averaging/TFCE is preferred, when possible, in order to better tie the smoothing kernel size to the original feature size.\n\n" +
+        "The -permutation-test option treats each column as one subject, and the output is TFCE applied to the one-sample t-statistic across columns.  " +
+        "The same is then done for each permutation, where a random subset of the columns is negated, and the maximum absolute TFCE value of each permutation forms the null distribution.  " +
+        "The p-value of each vertex is the fraction of permutations whose maximum is at least as large as the absolute value of its TFCE output.  " +
+        "The random flips always use the unflipped data as the first permutation, a file given with -flip-file is used as is, and must contain exactly <num-perms> permutations.  " +
+        "The -column option may not be used with -permutation-test.\n\n" +
         "The TFCE method is explained in: Smith SM, Nichols TE., \"Threshold-free cluster enhancement: addressing problems of smoothing, threshold dependence and localisation in cluster inference.\" Neuroimage. 2009 Jan 1;44(1):83-98. PMID: 18501637"
     );
     return ret;
@@ -126,6 +210,46 @@ void AlgorithmMetricTFCE::useParameters(OperationParameters* myParams, ProgressO
     {
         corrAreaMetric = corrAreaOpt->getMetric(1);
     }
+    OptionalParameter* permOpt = myParams->getOptionalParameter(9);
+    if (permOpt->m_present)
+    {
+        if (columnSelect->m_present) throw AlgorithmException("-column may not be used with -permutation-test");
+        int numPerms = (int)permOpt->getInteger(1);
+        if (numPerms < 1) throw AlgorithmException("number of permutations must be positive");
+        MetricFile* myPValueOut = permOpt->getOutputMetric(2);
+        CaretPointer<SignFlipPermutations> myPerms;
+        OptionalParameter* flipFileOpt = permOpt->getOptionalParameter(3);
+        try
+        {
+            if (flipFileOpt->m_present)
+            {
+                myPerms.grabNew(new SignFlipPermutations(flipFileOpt->getString(1), myMetric->getNumberOfColumns()));
+                if (myPerms->getNumberOfPermutations() != numPerms) throw AlgorithmException("flip file contains " + AString::number(myPerms->getNumberOfPermutations()) + " permutations, but num-perms is " + AString::number(numPerms));
+            } else {
+                uint32_t seed = 0;
+                OptionalParameter* seedOpt = permOpt->getOptionalParameter(4);
+                if (seedOpt->m_present) seed = (uint32_t)seedOpt->getInteger(1);
+                myPerms.grabNew(new SignFlipPermutations(myMetric->getNumberOfColumns(), numPerms, seed));
+            }
+        } catch (AlgorithmException&) {
+            throw;
+        } catch (CaretException& e) {
+            throw AlgorithmException(e.whatString());
+        }
+        vector<float> nullDist;
+        AlgorithmMetricTFCE(myProgObj, mySurf, myMetric, myMetricOut, myPValueOut, *myPerms, &nullDist, presmooth, myRoi, param_e, param_h, corrAreaMetric);
+        OptionalParameter* nullOutOpt = permOpt->getOptionalParameter(5);
+        if (nullOutOpt->m_present)
+        {
+            ofstream nullFile(nullOutOpt->getString(1).toLocal8Bit().constData());
+            if (!nullFile) throw AlgorithmException("failed to open null distribution file '" + nullOutOpt->getString(1) + "' for writing");
+            for (int i = 0; i < (int)nullDist.size(); ++i)
+            {
+                nullFile << nullDist[i] << "\n";
+            }
+        }
+        return;
+    }
     AlgorithmMetricTFCE(myProgObj, mySurf, myMetric, myMetricOut, presmooth, myRoi, param_e, param_h, columnNum, corrAreaMetric);
 }
 
@@ -159,13 +283,15 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
         int numCols = myMetric->getNumberOfColumns();
         myMetricOut->setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), numCols);
         myMetricOut->setStructure(mySurf->getStructure());
+        CaretPointer<TopologyHelper> myHelper = mySurf->getTopologyHelper();
 #pragma omp CARET_PAR
         {
             vector<float> outcol(mySurf->getNumberOfNodes(), 0.0f);
+            Scratch myScratch(mySurf->getNumberOfNodes());
 #pragma omp CARET_FOR
             for (int col = 0; col < numCols; ++col)
             {
-                processColumn(mySurf, toUse->getValuePointerForColumn(col), outcol.data(), roiData, param_e, param_h, areaData);
+                processColumn(myHelper, toUse->getValuePointerForColumn(col), outcol.data(), roiData, param_e, param_h, areaData, myScratch);
                 myMetricOut->setValuesForColumn(col, outcol.data());
                 myMetricOut->setMapName(col, myMetric->getMapName(col));
             }
@@ -183,102 +309,130 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
         myMetricOut->setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
         myMetricOut->setStructure(mySurf->getStructure());
         vector<float> outcol(mySurf->getNumberOfNodes(), 0.0f);
-        processColumn(mySurf, toUse->getValuePointerForColumn(useCol), outcol.data(), roiData, param_e, param_h, areaData);
+        Scratch myScratch(mySurf->getNumberOfNodes());
+        processColumn(mySurf->getTopologyHelper(), toUse->getValuePointerForColumn(useCol), outcol.data(), roiData, param_e, param_h, areaData, myScratch);
         myMetricOut->setValuesForColumn(0, outcol.data());
         myMetricOut->setMapName(0, myMetric->getMapName(columnNum));
     }
 }
 
-void AlgorithmMetricTFCE::processColumn(const SurfaceFile* mySurf, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData)
+AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, MetricFile* myMetricOut, MetricFile* myPValueOut,
+                                         const SignFlipPermutations& myPerms, vector<float>* nullOut, const float& presmooth, const MetricFile* myRoi,
+                                         const float& param_e, const float& param_h, const MetricFile* corrAreaMetric) : AbstractAlgorithm(myProgObj)
 {
+    LevelProgress myProgress(myProgObj);
     int numNodes = mySurf->getNumberOfNodes();
-    vector<double> accum(numNodes, 0.0);
-    CaretPointer<TopologyHelper> myHelper = mySurf->getTopologyHelper();
-    tfce_pos(myHelper, colData, accum.data(), roiData, param_e, param_h, areaData);
-    vector<float> negData(numNodes);
-    for (int i = 0; i < numNodes; ++i)
+    if (numNodes != myMetric->getNumberOfNodes()) throw AlgorithmException("metric and surface have different number of vertices");
+    if (myRoi != NULL && numNodes != myRoi->getNumberOfNodes()) throw AlgorithmException("roi metric and surface have different number of vertices");
+    if (corrAreaMetric != NULL && numNodes != corrAreaMetric->getNumberOfNodes()) throw AlgorithmException("corrected area metric and surface have different number of vertices");
+    int numCols = myMetric->getNumberOfColumns();
+    if (myPerms.getNumberOfSubjects() != numCols) throw AlgorithmException("permutations have a different number of subjects than the metric has columns");
+    const float* roiData = NULL, *areaData = NULL;
+    vector<float> surfAreaData;
+    if (corrAreaMetric == NULL)
     {
-        negData[i] = -colData[i];
+        mySurf->computeNodeAreas(surfAreaData);
+        areaData = surfAreaData.data();
+    } else {
+        areaData = corrAreaMetric->getValuePointerForColumn(0);
     }
-    tfce_pos(myHelper, negData.data(), accum.data(), roiData, param_e, param_h, areaData);//negatives and positives don't overlap, so reuse the accum array
-    for (int i = 0; i < numNodes; ++i)
+    if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(0);
+    const MetricFile* toUse = myMetric;
+    MetricFile postSmooth;
+    if (presmooth > 0.0f)
+    {//smoothing is linear, so smoothing before flipping is the same as smoothing every permutation
+        AlgorithmMetricSmoothing(NULL, mySurf, myMetric, presmooth, &postSmooth, myRoi, false, false, -1, corrAreaMetric);
+        toUse = &postSmooth;
+    }
+    vector<const float*> subjectData(numCols);
+    for (int i = 0; i < numCols; ++i)
     {
-        if (roiData == NULL || roiData[i] > 0.0f)
+        subjectData[i] = toUse->getValuePointerForColumn(i);
+    }
+    CaretPointer<TopologyHelper> myHelper = mySurf->getTopologyHelper();//neighbor lists are only read, so all threads share one
+    vector<float> observed(numNodes);
+    int numPerms = myPerms.getNumberOfPermutations();
+    vector<float> nullDist(numPerms);
+#pragma omp CARET_PAR
+    {
+        Scratch myScratch(numNodes);
+        vector<float> tstat(numNodes), enhanced(numNodes);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int perm = -1; perm < numPerms; ++perm)//-1 is the unflipped data, for the real output
         {
-            if (colData[i] < 0.0f)
+            myPerms.oneSampleT(subjectData, numNodes, perm, tstat.data());
+            if (perm == -1)
             {
-                outData[i] = (float)-accum[i];
+                processColumn(myHelper, tstat.data(), observed.data(), roiData, param_e, param_h, areaData, myScratch);
             } else {
-                outData[i] = (float)accum[i];
+                processColumn(myHelper, tstat.data(), enhanced.data(), roiData, param_e, param_h, areaData, myScratch);
+                float maxVal = 0.0f;//outside the roi is zeroed, so no need to test it
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    maxVal = max(maxVal, abs(enhanced[i]));
+                }
+                nullDist[perm] = maxVal;
             }
-        } else {
-            outData[i] = 0.0f;
         }
     }
-}
-
-namespace
-{//hidden namespace just to make sure things don't collide
-    struct Cluster
+    myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
+    myMetricOut->setStructure(mySurf->getStructure());
+    myMetricOut->setValuesForColumn(0, observed.data());
+    myMetricOut->setMapName(0, "TFCE of one-sample t");
+    if (nullOut != NULL) *nullOut = nullDist;
+    sort(nullDist.begin(), nullDist.end());
+    vector<float> pvals(numNodes, 1.0f);
+    for (int i = 0; i < numNodes; ++i)
     {
-        double accumVal, totalArea;
-        vector<int> members;
-        float lastVal;
-        bool first;
-        Cluster()
-        {
-            first = true;
-            accumVal = 0.0;
-            totalArea = 0.0;
-        }
-        void addMember(const int& node, const float& val, const float& area, const float& param_e, const float& param_h)
+        if (roiData == NULL || roiData[i] > 0.0f)
         {
-            update(val, param_e, param_h);
-            members.push_back(node);
-            totalArea += area;
+            pvals[i] = SignFlipPermutations::correctedPValue(nullDist, observed[i]);
         }
-        void update(const float& bottomVal, const float& param_e, const float& param_h)
+    }
+    myPValueOut->setNumberOfNodesAndColumns(numNodes, 1);
+    myPValueOut->setStructure(mySurf->getStructure());
+    myPValueOut->setValuesForColumn(0, pvals.data());
+    myPValueOut->setMapName(0, "corrected p, " + AString::number(numPerms) + " permutations");
+}
+
+void AlgorithmMetricTFCE::processColumn(const TopologyHelper* myHelper, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h,
+                                        const float* areaData, Scratch& scratch)
+{
+    int numNodes = myHelper->getNumberOfNodes();
+    vector<double>& accum = scratch.accum;
+    accum.assign(numNodes, 0.0);
+    tfce_pos(myHelper, colData, accum.data(), roiData, param_e, param_h, areaData, scratch);
+    vector<float>& negData = scratch.negData;
+    for (int i = 0; i < numNodes; ++i)
+    {
+        negData[i] = -colData[i];
+    }
+    tfce_pos(myHelper, negData.data(), accum.data(), roiData, param_e, param_h, areaData, scratch);//negatives and positives don't overlap, so reuse the accum array
+    for (int i = 0; i < numNodes; ++i)
+    {
+        if (roiData == NULL || roiData[i] > 0.0f)
         {
-            if (first)
+            if (colData[i] < 0.0f)
             {
-                lastVal = bottomVal;
-                first = false;
+                outData[i] = (float)-accum[i];
             } else {
-                if (bottomVal != lastVal)//skip computing if there is no difference
-                {
-                    CaretAssert(bottomVal < lastVal);
-                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
-                    double newSlice = pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
-                    accumVal += newSlice;
-                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
-                }
+                outData[i] = (float)accum[i];
             }
-        }
-    };
-    
-    int allocCluster(vector<Cluster>& clusterList, set<int>& deadClusters)
-    {
-        if (deadClusters.empty())
-        {
-            clusterList.push_back(Cluster());
-            return (int)(clusterList.size() - 1);
         } else {
-            set<int>::iterator iter = deadClusters.begin();
-            int ret = *iter;
-            deadClusters.erase(iter);
-            clusterList[ret] = Cluster();//reinitialize
-            return ret;
+            outData[i] = 0.0f;
         }
     }
 }
 
-void AlgorithmMetricTFCE::tfce_pos(TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData)
+void AlgorithmMetricTFCE::tfce_pos(const TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h,
+                                   const float* areaData, Scratch& scratch)
 {
     int numNodes = myHelper->getNumberOfNodes();
-    vector<int> membership(numNodes, -1);//int is enough as long as numNodes is fine as an int, for obvious reasons
-    vector<Cluster> clusterList;
-    set<int> deadClusters;//to allow reallocation without changing indices
-    CaretSimpleMaxHeap<int, float> nodeHeap;
+    vector<int>& membership = scratch.membership;//int is enough as long as numNodes is fine as an int, for obvious reasons
+    vector<Cluster>& clusterList = scratch.clusterList;
+    set<int>& deadClusters = scratch.deadClusters;//to allow reallocation without changing indices
+    CaretSimpleMaxHeap<int, float>& nodeHeap = scratch.nodeHeap;
+    CaretAssert((int)membership.size() == numNodes);
     for (int i = 0; i < numNodes; ++i)
     {
         if ((roiData == NULL || roiData[i] > 0.0f) && colData[i] > 0.0f)
@@ -368,8 +522,11 @@ void AlgorithmMetricTFCE::tfce_pos(TopologyHelper* myHelper, const float* colDat
         for (int j = 0; j < numMembers; ++j)
         {
             accumData[thisCluster.members[j]] += thisCluster.accumVal;//add the resulting slice to all members - their stored data contains the offset between the cluster peak and their corect value
+            membership[thisCluster.members[j]] = -1;//live clusters contain every vertex that was used, so this resets the scratch membership
         }
     }
+    clusterList.clear();
+    deadClusters.clear();
 }
 
 float AlgorithmMetricTFCE::getAlgorithmInternalWeight()
@@ -23,21 +23,29 @@
 
 #include "AbstractAlgorithm.h"
 
+#include <vector>
+
 namespace caret {
     
+    class SignFlipPermutations;
     class TopologyHelper;
     
     class AlgorithmMetricTFCE : public AbstractAlgorithm
     {
+        struct Scratch;//per-thread reusable memory, so permutations don't reallocate
         AlgorithmMetricTFCE();
-        void processColumn(const SurfaceFile* mySurf, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData);
-        void tfce_pos(TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData);
+        void processColumn(const TopologyHelper* myHelper, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData, Scratch& scratch);
+        void tfce_pos(const TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData, Scratch& scratch);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmMetricTFCE(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, MetricFile* myMetricOut, const float& presmooth = 0.0f,
                             const MetricFile* myRoi = NULL, const float& param_e = 1.0f, const float& param_h = 2.0f, const int& columnNum = -1, const MetricFile* corrAreaMetric = NULL);
+        ///permutation test treating columns as subjects, output is TFCE of the one-sample t-statistic, nullOut gets the max statistic of each permutation
+        AlgorithmMetricTFCE(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, MetricFile* myMetricOut, MetricFile* myPValueOut,
+                            const SignFlipPermutations& myPerms, std::vector<float>* nullOut = NULL, const float& presmooth = 0.0f, const MetricFile* myRoi = NULL,
+                            const float& param_e = 1.0f, const float& param_h = 2.0f, const MetricFile* corrAreaMetric = NULL);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
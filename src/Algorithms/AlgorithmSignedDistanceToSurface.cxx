@@ -24,6 +24,9 @@
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -95,10 +98,20 @@ AlgorithmSignedDistanceToSurface::AlgorithmSignedDistanceToSurface(ProgressObjec
 #pragma omp CARET_PAR
     {
         CaretPointer<SignedDistanceHelper> myHelp = levelSetSurf->getSignedDistanceHelper();
+        const int BLOCK_SIZE = 64;//neighboring node indices are usually close in space, so the previous closest triangle is a good starting bound
+        int numBlocks = (numNodes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const float* coordData = testSurf->getCoordinateData();
+        vector<float> blockDists(BLOCK_SIZE);
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            myMetricOut->setValue(i, 0, myHelp->dist(testSurf->getCoordinate(i), myWinding));
+            int start = block * BLOCK_SIZE;
+            int blockCount = min(BLOCK_SIZE, numNodes - start);
+            myHelp->dist(coordData + start * 3, blockCount, blockDists.data(), myWinding);
+            for (int i = 0; i < blockCount; ++i)
+            {
+                myMetricOut->setValue(start + i, 0, blockDists[i]);
+            }
         }
     }
 }
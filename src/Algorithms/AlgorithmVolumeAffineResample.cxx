@@ -24,6 +24,7 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "NiftiIO.h"
+#include "VolumeResamplePlan.h"
 #include "Vector3D.h"
 
 using namespace caret;
@@ -107,65 +108,21 @@ AlgorithmVolumeAffineResample::AlgorithmVolumeAffineResample(ProgressObject* myP
     int64_t affRows, affColumns;
     myAffine.getDimensions(affRows, affColumns);
     if (affRows < 3 || affRows > 4 || affColumns != 4) throw AlgorithmException("input matrix is not an affine matrix");
-    vector<int64_t> outDims = inVol->getOriginalDimensions();
-    if (outDims.size() < 3) throw AlgorithmException("input must have 3 spatial dimensions");
-    outDims[0] = refDims[0];
-    outDims[1] = refDims[1];
-    outDims[2] = refDims[2];
-    int64_t numMaps = inVol->getNumberOfMaps(), numComponents = inVol->getNumberOfComponents();
-    outVol->reinitialize(outDims, refSform, numComponents, inVol->getType());
-    FloatMatrix targetToSource = myAffine;
-    targetToSource.resize(4, 4);
-    targetToSource[3][0] = 0.0f;
-    targetToSource[3][1] = 0.0f;
-    targetToSource[3][2] = 0.0f;
-    targetToSource[3][3] = 1.0f;
-    targetToSource = targetToSource.inverse();
-    Vector3D xvec, yvec, zvec, offset;
-    xvec[0] = targetToSource[0][0]; xvec[1] = targetToSource[1][0]; xvec[2] = targetToSource[2][0];
-    yvec[0] = targetToSource[0][1]; yvec[1] = targetToSource[1][1]; yvec[2] = targetToSource[2][1];
-    zvec[0] = targetToSource[0][2]; zvec[1] = targetToSource[1][2]; zvec[2] = targetToSource[2][2];
-    offset[0] = targetToSource[0][3]; offset[1] = targetToSource[1][3]; offset[2] = targetToSource[2][3];
+    if (inVol->getOriginalDimensions().size() < 3) throw AlgorithmException("input must have 3 spatial dimensions");
+    int64_t numMaps = inVol->getNumberOfMaps();
+    if (inVol->isMappedWithLabelTable() && myMethod != VolumeFile::ENCLOSING_VOXEL)
+    {
+        CaretLogWarning("using interpolation type other than ENCLOSING_VOXEL on a label volume");
+    }
+    VolumeResamplePlan myPlan(inVol->getVolumeSpace(), myAffine, refDims, refSform, myMethod);//maps every output voxel once, rather than once per frame
+    myPlan.resample(inVol, outVol);
     if (inVol->isMappedWithLabelTable())
     {
-        if (myMethod != VolumeFile::ENCLOSING_VOXEL)
-        {
-            CaretLogWarning("using interpolation type other than ENCLOSING_VOXEL on a label volume");
-        }
         for (int64_t i = 0; i < numMaps; ++i)
         {
             *(outVol->getMapLabelTable(i)) = *(inVol->getMapLabelTable(i));
         }
     }
-    for (int64_t c = 0; c < numComponents; ++c)
-    {
-        for (int64_t b = 0; b < numMaps; ++b)
-        {
-            if (myMethod == VolumeFile::CUBIC)
-            {
-                inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
-            }
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t k = 0; k < outDims[2]; ++k)
-            {
-                for (int64_t j = 0; j < outDims[1]; ++j)
-                {
-                    for (int64_t i = 0; i < outDims[0]; ++i)
-                    {
-                        Vector3D outCoord, inCoord;
-                        outVol->indexToSpace(i, j, k, outCoord);
-                        inCoord = xvec * outCoord[0] + yvec * outCoord[1] + zvec * outCoord[2] + offset;
-                        float interpVal = inVol->interpolateValue(inCoord, myMethod, NULL, b, c);
-                        outVol->setValue(interpVal, i, j, k, b, c);
-                    }
-                }
-            }
-            if (myMethod == VolumeFile::CUBIC)
-            {
-                inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
-            }
-        }
-    }
 }
 
 float AlgorithmVolumeAffineResample::getAlgorithmInternalWeight()
@@ -25,6 +25,7 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CaretAssert.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -33,6 +34,327 @@ using namespace std;
 //makes the program issue warning only once per launch, prevents repeated calls by other algorithms from spamming
 bool AlgorithmVolumeSmoothing::haveWarned = false;
 
+namespace
+{//hidden namespace just to make sure things don't collide
+    ///1-dimensional gaussian along one axis of an orthogonal volume
+    struct AxisKernel
+    {
+        int range;
+        vector<float> weights;//2 * range + 1 weights, centered on the voxel
+    };
+    
+    ///gaussian weighted sum of a frame, without dividing by the sum of weights, by three 1-dimensional passes, voxels outside the volume count as zero
+    ///ONLY for orthogonal volumes (axes are perpendicular, not necessarily aligned with x, y, z, and not necessarily equal spacing)
+    ///each pass runs its innermost loop over contiguous memory with no bounds checks, so it can be vectorized across voxels
+    void separableWeightedSum(const float* in, float* out, float* middle, const vector<int64_t>& myDims, const AxisKernel kernels[3])
+    {
+        const int64_t rowSize = myDims[0], planeSize = myDims[0] * myDims[1];
+        const int irange = kernels[0].range, jrange = kernels[1].range, krange = kernels[2].range;
+        const float* iweights = kernels[0].weights.data();
+        const float* jweights = kernels[1].weights.data();
+        const float* kweights = kernels[2].weights.data();
+#pragma omp CARET_PAR
+        {
+            vector<float> paddedRow(rowSize + 2 * irange, 0.0f), sliceSums(planeSize);//the padding stays zero, that is what removes the bounds checks along i
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t k = 0; k < myDims[2]; ++k)
+            {
+                for (int64_t j = 0; j < myDims[1]; ++j)//smooth along i
+                {
+                    const float* inRow = in + k * planeSize + j * rowSize;
+                    float* outRow = sliceSums.data() + j * rowSize;
+                    for (int64_t i = 0; i < rowSize; ++i)
+                    {
+                        paddedRow[i + irange] = inRow[i];
+                        outRow[i] = 0.0f;
+                    }
+                    for (int ikern = 0; ikern < 2 * irange + 1; ++ikern)
+                    {
+                        const float weight = iweights[ikern];
+                        const float* shifted = paddedRow.data() + ikern;
+                        for (int64_t i = 0; i < rowSize; ++i)
+                        {
+                            outRow[i] += weight * shifted[i];
+                        }
+                    }
+                }
+                for (int64_t j = 0; j < myDims[1]; ++j)//now j, all rows of the slice at once, so bounds only need checking per row
+                {
+                    float* outRow = middle + k * planeSize + j * rowSize;
+                    for (int64_t i = 0; i < rowSize; ++i)
+                    {
+                        outRow[i] = 0.0f;
+                    }
+                    int64_t jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
+                    if (jmin < 0) jmin = 0;
+                    if (jmax > myDims[1]) jmax = myDims[1];
+                    for (int64_t jkern = jmin; jkern < jmax; ++jkern)
+                    {
+                        const float weight = jweights[jkern - j + jrange];
+                        const float* inRow = sliceSums.data() + jkern * rowSize;
+                        for (int64_t i = 0; i < rowSize; ++i)
+                        {
+                            outRow[i] += weight * inRow[i];
+                        }
+                    }
+                }
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t k = 0; k < myDims[2]; ++k)//and finally k, a whole slice at a time
+        {
+            float* outPlane = out + k * planeSize;
+            for (int64_t v = 0; v < planeSize; ++v)
+            {
+                outPlane[v] = 0.0f;
+            }
+            int64_t kmin = k - krange, kmax = k + krange + 1;
+            if (kmin < 0) kmin = 0;
+            if (kmax > myDims[2]) kmax = myDims[2];
+            for (int64_t kkern = kmin; kkern < kmax; ++kkern)
+            {
+                const float weight = kweights[kkern - k + krange];
+                const float* inPlane = middle + kkern * planeSize;
+                for (int64_t v = 0; v < planeSize; ++v)
+                {
+                    outPlane[v] += weight * inPlane[v];
+                }
+            }
+        }
+    }
+    
+    ///smooth frames of an orthogonal volume, values that are outside the roi or are zero with fixZeros are left out of both the values and the weights
+    void smoothFramesSeparable(const VolumeFile* inVol, const VolumeFile* roiVol, VolumeFile* outVol, const int64_t& firstMap, const int64_t& numMaps,
+                               const AxisKernel kernels[3], const bool& fixZeros, LevelProgress& myProgress)
+    {
+        vector<int64_t> myDims;
+        inVol->getDimensions(myDims);
+        const int64_t frameSize = myDims[0] * myDims[1] * myDims[2], numComponents = myDims[4], numFrames = numMaps * numComponents;
+        vector<int64_t> boxMin(3, 0), boxDims(3);//nothing outside the bounding box of the roi is used or output, so only smooth inside it
+        boxDims[0] = myDims[0]; boxDims[1] = myDims[1]; boxDims[2] = myDims[2];
+        vector<float> boxRoi;
+        if (roiVol != NULL)
+        {
+            const float* roiFrame = roiVol->getFrame();
+            int64_t boxMax[3] = { -1, -1, -1 };
+            boxMin[0] = myDims[0]; boxMin[1] = myDims[1]; boxMin[2] = myDims[2];
+            for (int64_t k = 0; k < myDims[2]; ++k)
+            {
+                for (int64_t j = 0; j < myDims[1]; ++j)
+                {
+                    for (int64_t i = 0; i < myDims[0]; ++i)
+                    {
+                        if (roiFrame[(k * myDims[1] + j) * myDims[0] + i] > 0.0f)
+                        {
+                            if (i < boxMin[0]) boxMin[0] = i;
+                            if (i > boxMax[0]) boxMax[0] = i;
+                            if (j < boxMin[1]) boxMin[1] = j;
+                            if (j > boxMax[1]) boxMax[1] = j;
+                            if (k < boxMin[2]) boxMin[2] = k;
+                            if (k > boxMax[2]) boxMax[2] = k;
+                        }
+                    }
+                }
+            }
+            if (boxMax[0] < 0)
+            {//empty roi, output is all zeros
+                vector<float> zeros(frameSize, 0.0f);
+                for (int64_t frame = 0; frame < numFrames; ++frame)
+                {
+                    outVol->setFrame(zeros.data(), frame / numComponents, frame % numComponents);
+                }
+                return;
+            }
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                boxDims[axis] = boxMax[axis] - boxMin[axis] + 1;
+            }
+            boxRoi.resize(boxDims[0] * boxDims[1] * boxDims[2]);
+            for (int64_t k = 0; k < boxDims[2]; ++k)
+            {
+                for (int64_t j = 0; j < boxDims[1]; ++j)
+                {
+                    const float* roiRow = roiFrame + ((k + boxMin[2]) * myDims[1] + j + boxMin[1]) * myDims[0] + boxMin[0];
+                    float* boxRow = boxRoi.data() + (k * boxDims[1] + j) * boxDims[0];
+                    for (int64_t i = 0; i < boxDims[0]; ++i)
+                    {
+                        boxRow[i] = (roiRow[i] > 0.0f) ? 1.0f : 0.0f;
+                    }
+                }
+            }
+        }
+        const int64_t boxSize = boxDims[0] * boxDims[1] * boxDims[2];
+        vector<float> weightSums;//without fixZeros, which voxels are used doesn't depend on the frame, so the weight sums only need computing once
+        if (!fixZeros)
+        {
+            vector<float> middle(boxSize);
+            weightSums.resize(boxSize);
+            if (roiVol != NULL)
+            {
+                separableWeightedSum(boxRoi.data(), weightSums.data(), middle.data(), boxDims, kernels);
+            } else {
+                vector<float> ones(boxSize, 1.0f);
+                separableWeightedSum(ones.data(), weightSums.data(), middle.data(), boxDims, kernels);
+            }
+        }
+        const float* roiData = NULL;
+        if (roiVol != NULL) roiData = boxRoi.data();
+        int64_t framesDone = 0;
+        bool parallelFrames = false;
+        int frameThreads = 1;
+#ifdef CARET_OMP
+        {//with enough frames, give each thread whole frames, the parallel loops inside then run single threaded
+            //but each thread needs its own box-sized buffers, so limit how many frames are in flight to keep peak memory bounded
+            const int64_t FRAME_SCRATCH_BYTES = 1024 * 1024 * 1024;
+            int64_t perThreadBytes = (3 + (fixZeros ? 2 : 0)) * boxSize * sizeof(float);
+            if (boxSize != frameSize) perThreadBytes += frameSize * sizeof(float);
+            frameThreads = (int)min((int64_t)omp_get_max_threads(), max((int64_t)1, FRAME_SCRATCH_BYTES / perThreadBytes));
+            parallelFrames = (frameThreads > 1 && numFrames >= frameThreads);//otherwise, parallelize within each frame instead
+        }
+#endif
+#pragma omp CARET_PAR if (parallelFrames) num_threads(frameThreads)
+        {
+            vector<float> values(boxSize), middle(boxSize), smoothed(boxSize), used, usedSums, outFrame;
+            if (fixZeros)
+            {
+                used.resize(boxSize);
+                usedSums.resize(boxSize);
+            }
+            if (boxSize != frameSize)
+            {
+                outFrame.resize(frameSize, 0.0f);//outside the box stays zero
+            }
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t frame = 0; frame < numFrames; ++frame)
+            {
+                const int64_t map = frame / numComponents, component = frame % numComponents;
+                const float* inFrame = inVol->getFrame(firstMap + map, component);
+#pragma omp CARET_PARFOR
+                for (int64_t k = 0; k < boxDims[2]; ++k)
+                {//zero the unused values instead of testing them in the kernel loops
+                    for (int64_t j = 0; j < boxDims[1]; ++j)
+                    {
+                        const float* inRow = inFrame + ((k + boxMin[2]) * myDims[1] + j + boxMin[1]) * myDims[0] + boxMin[0];
+                        const int64_t boxRow = (k * boxDims[1] + j) * boxDims[0];
+                        for (int64_t i = 0; i < boxDims[0]; ++i)
+                        {
+                            bool useVoxel = (roiData == NULL || roiData[boxRow + i] > 0.0f) && (!fixZeros || inRow[i] != 0.0f);
+                            values[boxRow + i] = useVoxel ? inRow[i] : 0.0f;
+                            if (fixZeros) used[boxRow + i] = useVoxel ? 1.0f : 0.0f;
+                        }
+                    }
+                }
+                separableWeightedSum(values.data(), smoothed.data(), middle.data(), boxDims, kernels);
+                const float* frameWeights = weightSums.data();
+                if (fixZeros)
+                {
+                    separableWeightedSum(used.data(), usedSums.data(), middle.data(), boxDims, kernels);
+                    frameWeights = usedSums.data();
+                }
+#pragma omp CARET_PARFOR
+                for (int64_t v = 0; v < boxSize; ++v)
+                {
+                    if ((roiData == NULL || roiData[v] > 0.0f) && frameWeights[v] != 0.0f)
+                    {
+                        smoothed[v] /= frameWeights[v];//dividing only now gives the weighted sum of the weighted sums of the weighted sums, divided by the same of the weights
+                    } else {
+                        smoothed[v] = 0.0f;
+                    }
+                }
+                const float* result = smoothed.data();
+                if (boxSize != frameSize)
+                {
+                    for (int64_t k = 0; k < boxDims[2]; ++k)
+                    {
+                        for (int64_t j = 0; j < boxDims[1]; ++j)
+                        {
+                            float* outRow = outFrame.data() + ((k + boxMin[2]) * myDims[1] + j + boxMin[1]) * myDims[0] + boxMin[0];
+                            const float* boxRow = smoothed.data() + (k * boxDims[1] + j) * boxDims[0];
+                            for (int64_t i = 0; i < boxDims[0]; ++i)
+                            {
+                                outRow[i] = boxRow[i];
+                            }
+                        }
+                    }
+                    result = outFrame.data();
+                }
+#pragma omp critical
+                {
+                    outVol->setFrame(result, map, component);
+                    ++framesDone;
+                    myProgress.reportProgress(((float)framesDone) / numFrames);
+                }
+            }
+        }
+    }
+    
+    ///one nonzero weight of a non-orthogonal kernel
+    struct KernelOffset
+    {
+        int di, dj, dk;
+        float weight;
+    };
+    
+    ///gaussian smoothing of one frame with a full 3D kernel, for volumes whose axes aren't orthogonal
+    void smoothFrameNonOrth(const float* inFrame, const vector<int64_t>& myDims, float* outFrame, const float* roiFrame, const vector<KernelOffset>& offsets,
+                            const int& irange, const int& jrange, const int& krange, const bool& fixZeros)
+    {
+        const int64_t numOffsets = (int64_t)offsets.size();
+        vector<int64_t> indexOffsets(numOffsets);
+        for (int64_t n = 0; n < numOffsets; ++n)
+        {
+            indexOffsets[n] = (offsets[n].dk * myDims[1] + offsets[n].dj) * myDims[0] + offsets[n].di;
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)
+        {
+            for (int j = 0; j < myDims[1]; ++j)
+            {
+                for (int i = 0; i < myDims[0]; ++i)
+                {
+                    int64_t curInd = (k * myDims[1] + j) * myDims[0] + i;
+                    if (roiFrame == NULL || roiFrame[curInd] > 0.0f)
+                    {
+                        float sum = 0.0f, weightsum = 0.0f;
+                        if (i >= irange && i + irange < myDims[0] && j >= jrange && j + jrange < myDims[1] && k >= krange && k + krange < myDims[2])
+                        {//kernel box is entirely inside the volume, so skip the bounds checks
+                            for (int64_t n = 0; n < numOffsets; ++n)
+                            {
+                                int64_t thisIndex = curInd + indexOffsets[n];
+                                if ((roiFrame == NULL || roiFrame[thisIndex] > 0.0f) && (!fixZeros || inFrame[thisIndex] != 0.0f))
+                                {
+                                    weightsum += offsets[n].weight;
+                                    sum += offsets[n].weight * inFrame[thisIndex];
+                                }
+                            }
+                        } else {
+                            for (int64_t n = 0; n < numOffsets; ++n)
+                            {
+                                int ikern = i + offsets[n].di, jkern = j + offsets[n].dj, kkern = k + offsets[n].dk;
+                                if (ikern < 0 || ikern >= myDims[0] || jkern < 0 || jkern >= myDims[1] || kkern < 0 || kkern >= myDims[2]) continue;
+                                int64_t thisIndex = curInd + indexOffsets[n];
+                                if ((roiFrame == NULL || roiFrame[thisIndex] > 0.0f) && (!fixZeros || inFrame[thisIndex] != 0.0f))
+                                {
+                                    weightsum += offsets[n].weight;
+                                    sum += offsets[n].weight * inFrame[thisIndex];
+                                }
+                            }
+                        }
+                        if (weightsum != 0.0f)
+                        {
+                            outFrame[curInd] = sum / weightsum;
+                        } else {
+                            outFrame[curInd] = 0.0f;
+                        }
+                    } else {
+                        outFrame[curInd] = 0.0f;
+                    }
+                }
+            }
+        }
+    }
+}
+
 AString AlgorithmVolumeSmoothing::getCommandSwitch()
 {
     return "-volume-smoothing";
@@ -116,88 +438,43 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     {
         throw AlgorithmException("kernel too small");
     }
-    CaretArray<float> scratchFrame(myDims[0] * myDims[1] * myDims[2]);//it could be faster to preinitialize with zeros, then generate a usable voxels list if there is a small ROI...
     float kernBox = kernel * 3.0f;
     vector<vector<float> > volSpace = inVol->getSform();
     Vector3D ivec, jvec, kvec, origin, ijorth, jkorth, kiorth;
     ivec[0] = volSpace[0][0]; jvec[0] = volSpace[0][1]; kvec[0] = volSpace[0][2]; origin[0] = volSpace[0][3];
     ivec[1] = volSpace[1][0]; jvec[1] = volSpace[1][1]; kvec[1] = volSpace[1][2]; origin[1] = volSpace[1][3];
     ivec[2] = volSpace[2][0]; jvec[2] = volSpace[2][1]; kvec[2] = volSpace[2][2]; origin[2] = volSpace[2][3];
+    vector<int64_t> outDims = inVol->getOriginalDimensions();
+    int64_t firstMap = 0, numMaps = myDims[3];
+    if (subvol != -1)
+    {
+        outDims.resize(3);
+        firstMap = subvol;
+        numMaps = 1;
+    }
+    outVol->reinitialize(outDims, volSpace, myDims[4]);
+    for (int64_t s = 0; s < numMaps; ++s)
+    {
+        outVol->setMapName(s, inVol->getMapName(firstMap + s) + ", smooth " + AString::number(kernel));
+    }
     const float ORTH_TOLERANCE = 0.001f;//tolerate this much deviation from orthogonal (dot product divided by product of lengths) to use orthogonal assumptions to smooth
     if (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE)
     {//if our axes are orthogonal, optimize by doing three 1-dimensional smoothings for O(voxels * (ki + kj + kk)) instead of O(voxels * (ki * kj * kk))
-        CaretArray<float> scratchFrame2(myDims[0] * myDims[1] * myDims[2]), scratchWeights(myDims[0] * myDims[1] * myDims[2]), scratchWeights2(myDims[0] * myDims[1] * myDims[2]), scratchFrame3;
-        if (roiVol != NULL)
-        {
-            scratchFrame3 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
-        }
-        float ispace = ivec.length(), jspace = jvec.length(), kspace = kvec.length();
-        int irange = (int)floor(kernBox / ispace);
-        int jrange = (int)floor(kernBox / jspace);
-        int krange = (int)floor(kernBox / kspace);
-        if (irange < 1) irange = 1;//don't underflow
-        if (jrange < 1) jrange = 1;
-        if (krange < 1) krange = 1;
-        int isize = irange * 2 + 1;//and construct a precomputed kernel in the box
-        int jsize = jrange * 2 + 1;
-        int ksize = krange * 2 + 1;
-        CaretArray<float> iweights(isize), jweights(jsize), kweights(ksize);
-        for (int i = 0; i < isize; ++i)
+        float spacing[3] = { ivec.length(), jvec.length(), kvec.length() };
+        AxisKernel kernels[3];
+        for (int axis = 0; axis < 3; ++axis)
         {
-            float tempf = ispace * (i - irange) / kernel;
-            iweights[i] = exp(-tempf * tempf / 2.0f);
-        }
-        for (int j = 0; j < jsize; ++j)
-        {
-            float tempf = jspace * (j - jrange) / kernel;
-            jweights[j] = exp(-tempf * tempf / 2.0f);
-        }
-        for (int k = 0; k < ksize; ++k)
-        {
-            float tempf = kspace * (k - krange) / kernel;
-            kweights[k] = exp(-tempf * tempf / 2.0f);
-        }
-        if (subvol == -1)
-        {
-            vector<int64_t> origDims = inVol->getOriginalDimensions();
-            outVol->reinitialize(origDims, volSpace, myDims[4]);
-            vector<int> lists[3];
-            for (int s = 0; s < myDims[3]; ++s)
-            {
-                outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    const float* inFrame = inVol->getFrame(s, c);
-                    if (roiVol == NULL)
-                    {
-                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                    } else {
-                        smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                    }
-                    outVol->setFrame(scratchFrame, s, c);
-                }
-            }
-        } else {
-            vector<int64_t> origDims = inVol->getOriginalDimensions(), newDims;
-            newDims.resize(3);
-            newDims[0] = origDims[0];
-            newDims[1] = origDims[1];
-            newDims[2] = origDims[2];
-            outVol->reinitialize(newDims, volSpace, myDims[4]);
-            vector<int> lists[3];
-            outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
-            for (int c = 0; c < myDims[4]; ++c)
+            int range = (int)floor(kernBox / spacing[axis]);
+            if (range < 1) range = 1;//don't underflow
+            kernels[axis].range = range;
+            kernels[axis].weights.resize(range * 2 + 1);//and construct a precomputed kernel in the box
+            for (int t = 0; t < range * 2 + 1; ++t)
             {
-                const float* inFrame = inVol->getFrame(subvol, c);
-                if (roiVol == NULL)
-                {
-                    smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                } else {
-                    smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                }
-                outVol->setFrame(scratchFrame, 0, c);
+                float tempf = spacing[axis] * (t - range) / kernel;
+                kernels[axis].weights[t] = exp(-tempf * tempf / 2.0f);
             }
         }
+        smoothFramesSeparable(inVol, roiVol, outVol, firstMap, numMaps, kernels, fixZeros, myProgress);
     } else {
         if (!haveWarned)
         {
@@ -213,428 +490,44 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
         if (irange < 1) irange = 1;//don't underflow
         if (jrange < 1) jrange = 1;
         if (krange < 1) krange = 1;
-        int isize = irange * 2 + 1;//and construct a precomputed kernel in the box
-        int jsize = jrange * 2 + 1;
-        int ksize = krange * 2 + 1;
-        CaretArray<float**> weights(ksize);//so I don't need to explicitly delete[] if I throw
-        CaretArray<float*> weights2(ksize * jsize);//construct flat arrays and index them into 3D
-        CaretArray<float> weights3(ksize * jsize * isize);//index i comes last because that is linear for volume frames
+        vector<KernelOffset> offsets;//only the nonzero weights in the box, in memory order
         Vector3D kscratch, jscratch, iscratch;
-        for (int k = 0; k < ksize; ++k)
+        for (int k = -krange; k <= krange; ++k)
         {
-            kscratch = kvec * (k - krange);
-            weights[k] = weights2 + k * jsize;
-            for (int j = 0; j < jsize; ++j)
+            kscratch = kvec * k;
+            for (int j = -jrange; j <= jrange; ++j)
             {
-                jscratch = kscratch + jvec * (j - jrange);
-                weights[k][j] = weights3 + ((k * jsize) + j) * isize;
-                for (int i = 0; i < isize; ++i)
+                jscratch = kscratch + jvec * j;
+                for (int i = -irange; i <= irange; ++i)
                 {
-                    iscratch = jscratch + ivec * (i - irange);
+                    iscratch = jscratch + ivec * i;
                     float tempf = iscratch.length();
-                    if (tempf > kernBox)
-                    {
-                        weights[k][j][i] = 0.0f;//test for zero to avoid some multiplies/adds, cheaper or cleaner than checking bounds on indexes from an index list
-                    } else {
-                        weights[k][j][i] = exp(-tempf * tempf / kernel / kernel / 2.0f);//optimization here isn't critical
-                    }
-                }
-            }
-        }
-        if (subvol == -1)
-        {
-            vector<int64_t> origDims = inVol->getOriginalDimensions();
-            outVol->reinitialize(origDims, volSpace, myDims[4]);
-            for (int s = 0; s < myDims[3]; ++s)
-            {
-                outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    const float* inFrame = inVol->getFrame(s, c);
-                    smoothFrameNonOrth(inFrame, myDims, scratchFrame, inVol, roiVol, weights, irange, jrange, krange, fixZeros);
-                    outVol->setFrame(scratchFrame, s, c);
-                }
-            }
-        } else {
-            vector<int64_t> origDims = inVol->getOriginalDimensions(), newDims;
-            newDims.resize(3);
-            newDims[0] = origDims[0];
-            newDims[1] = origDims[1];
-            newDims[2] = origDims[2];
-            outVol->reinitialize(newDims, volSpace, myDims[4]);
-            outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
-            for (int c = 0; c < myDims[4]; ++c)
-            {
-                const float* inFrame = inVol->getFrame(subvol, c);
-                smoothFrameNonOrth(inFrame, myDims, scratchFrame, inVol, roiVol, weights, irange, jrange, krange, fixZeros);
-                outVol->setFrame(scratchFrame, 0, c);
-            }
-        }
-    }
-}
-
-void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, const VolumeFile* inVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights, int irange, int jrange, int krange, const bool& fixZeros)
-{//this function should ONLY get invoked when the volume is orthogonal (axes are perpendicular, not necessarily aligned with x, y, z, and not necessarily equal spacing)
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
-    {
-        for (int j = 0; j < myDims[1]; ++j)
-        {
-            for (int i = 0; i < myDims[0]; ++i)
-            {
-                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                if (imin < 0) imin = 0;
-                if (imax > myDims[0]) imax = myDims[0];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(0, j, k, 0);//extra 0 on a default parameter is to prevent int->pointer vs int->int64 conversion ambiguity
-                int64_t curInd = baseInd + i;
-                for (int ikern = imin; ikern < imax; ++ikern)
-                {
-                    int64_t thisIndex = baseInd + ikern;
-                    if ((!fixZeros || inFrame[thisIndex] != 0.0f))
-                    {
-                        float weight = iweights[ikern - i + irange];
-                        weightsum += weight;
-                        sum += weight * inFrame[thisIndex];
-                    }
-                }
-                scratchWeights[curInd] = weightsum;
-                scratchFrame[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
-            }
-        }
-    }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//now j
-    {
-        for (int i = 0; i < myDims[0]; ++i)
-        {
-            for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
-            {
-                int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-                if (jmin < 0) jmin = 0;
-                if (jmax > myDims[1]) jmax = myDims[1];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(i, 0, k);
-                int64_t curInd = baseInd + j * myDims[0];
-                for (int jkern = jmin; jkern < jmax; ++jkern)
-                {
-                    int64_t thisIndex = baseInd + jkern * myDims[0];
-                    float weight = jweights[jkern - j + jrange];
-                    weightsum += weight * scratchWeights[thisIndex];
-                    sum += weight * scratchFrame[thisIndex];
-                }
-                scratchWeights2[curInd] = weightsum;
-                scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
-            }
-        }
-    }
-//somehow this loop set is helped by collapsing the two outers, while the other two are not helped by it
-//however, we need to upgrade our windows compiler before we can use "collapse"
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int j = 0; j < myDims[1]; ++j)//and finally k
-    {
-        for (int i = 0; i < myDims[0]; ++i)
-        {
-            for (int k = 0; k < myDims[2]; ++k)//ditto
-            {
-                int64_t baseInd = inVol->getIndex(i, j, 0);
-                int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-                int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-                if (kmin < 0) kmin = 0;
-                if (kmax > myDims[2]) kmax = myDims[2];
-                float sum = 0.0f, weightsum = 0.0f;
-                for (int kkern = kmin; kkern < kmax; ++kkern)
-                {
-                    int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];
-                    float weight = kweights[kkern - k + krange];
-                    weightsum += weight * scratchWeights2[thisIndex];
-                    sum += weight * scratchFrame2[thisIndex];
-                }
-                if (weightsum != 0.0f)
-                {
-                    scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-                } else {
-                    scratchFrame[curInd] = 0.0f;
-                }
-            }
-        }
-    }
-}
-
-void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchFrame3,
-                                              CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, vector<int> lists[3],
-                                              const VolumeFile* inVol, const VolumeFile* roiVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
-                                              int irange, int jrange, int krange, const bool& fixZeros)
-{//optimized for orthogonal, plus lists of voxels for ROI smoothing
-    if (lists[0].size() == 0)
-    {//this is our first time into this function, we must populate the lists
-        const float* roiFrame = roiVol->getFrame();
-        CaretArray<int> markROI(myDims[0] * myDims[1] * myDims[2], 0);//need a temporary array to sort out ROI zeros from -fix-zeros zeros
-#pragma omp CARET_PARFOR
-        for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
-        {
-            for (int j = 0; j < myDims[1]; ++j)
-            {
-                for (int i = 0; i < myDims[0]; ++i)//don't test whether intermediate voxel is insode ROI, or we lose some data
-                {
-                    int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                    if (imin < 0) imin = 0;
-                    if (imax > myDims[0]) imax = myDims[0];
-                    float sum = 0.0f, weightsum = 0.0f;
-                    int64_t baseInd = inVol->getIndex(0, j, k, 0);
-                    int64_t curInd = baseInd + i;
-                    bool used = false;
-                    for (int ikern = imin; ikern < imax; ++ikern)
+                    if (tempf <= kernBox)//the corners of the box are outside the sphere, leave them out rather than testing them for every voxel
                     {
-                        int64_t thisIndex = baseInd + ikern;
-                        if (roiFrame[thisIndex] > 0.0f)//only test source and final voxels for being in ROI
-                        {
-                            if (!used)//keep a list of voxels whose i-kernel intersects the ROI
-                            {
-                                used = true;
-                                markROI[curInd] = 1;
-#pragma omp critical
-                                {
-                                    lists[0].push_back(i);
-                                    lists[0].push_back(j);
-                                    lists[0].push_back(k);
-                                }
-                            }
-                            if (!fixZeros || inFrame[thisIndex] != 0.0f)
-                            {
-                                float weight = iweights[ikern - i + irange];
-                                weightsum += weight;
-                                sum += weight * inFrame[thisIndex];
-                            }
-                        }
+                        KernelOffset thisOffset;
+                        thisOffset.di = i;
+                        thisOffset.dj = j;
+                        thisOffset.dk = k;
+                        thisOffset.weight = exp(-tempf * tempf / kernel / kernel / 2.0f);//optimization here isn't critical
+                        offsets.push_back(thisOffset);
                     }
-                    scratchWeights[curInd] = weightsum;
-                    scratchFrame3[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
                 }
             }
         }
-#pragma omp CARET_PARFOR
-        for (int k = 0; k < myDims[2]; ++k)//now j
-        {
-            for (int i = 0; i < myDims[0]; ++i)
-            {
-                for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
-                {
-                    int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-                    if (jmin < 0) jmin = 0;
-                    if (jmax > myDims[1]) jmax = myDims[1];
-                    float sum = 0.0f, weightsum = 0.0f;
-                    int64_t baseInd = inVol->getIndex(i, 0, k);
-                    int64_t curInd = baseInd + j * myDims[0];
-                    bool used = false;
-                    for (int jkern = jmin; jkern < jmax; ++jkern)
-                    {
-                        int64_t thisIndex = baseInd + jkern * myDims[0];//DO NOT test for this source voxel being outside ROI, or you will skip good data
-                        if ((markROI[thisIndex] & 1) == 1)
-                        {//skip voxels whose i-kernels don't touch the ROI, they will always have 0/0
-                            if (!used)
-                            {
-                                used = true;
-                                markROI[curInd] |= 2;//bitwise so i can track all 3 lists separately in one array
-#pragma omp critical
-                                {
-                                    lists[1].push_back(i);
-                                    lists[1].push_back(j);
-                                    lists[1].push_back(k);
-                                }
-                            }
-                            float weight = jweights[jkern - j + jrange];
-                            weightsum += weight * scratchWeights[thisIndex];
-                            sum += weight * scratchFrame3[thisIndex];
-                        }
-                    }
-                    scratchWeights2[curInd] = weightsum;
-                    scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
-                }
-            }
-        }
-#pragma omp CARET_PARFOR
-        for (int j = 0; j < myDims[1]; ++j)//and finally k
-        {
-            for (int i = 0; i < myDims[0]; ++i)
-            {
-                for (int k = 0; k < myDims[2]; ++k)//ditto
-                {
-                    int64_t baseInd = inVol->getIndex(i, j, 0);
-                    int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-                    if (roiFrame[curInd] > 0.0f)
-                    {
-#pragma omp critical
-                        {
-                            lists[2].push_back(i);//third list is a little different, since we don't output stuff outside the ROI, we can drop the voxels that "grew" from the ROI
-                            lists[2].push_back(j);//we do need to calculate those grown voxels, though, since we use some of them within the k-kernel
-                            lists[2].push_back(k);
-                        }
-                        int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-                        if (kmin < 0) kmin = 0;
-                        if (kmax > myDims[2]) kmax = myDims[2];
-                        float sum = 0.0f, weightsum = 0.0f;
-                        for (int kkern = kmin; kkern < kmax; ++kkern)
-                        {
-                            int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];//ditto
-                            float weight = kweights[kkern - k + krange];
-                            weightsum += weight * scratchWeights2[thisIndex];
-                            sum += weight * scratchFrame2[thisIndex];
-                        }
-                        if (weightsum != 0.0f)
-                        {
-                            scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-                        } else {
-                            scratchFrame[curInd] = 0.0f;
-                        }
-                    } else {
-                        scratchFrame[curInd] = 0.0f;
-                    }
-                }
-            }
-        }
-        if (lists[0].size() == 0)
-        {
-            lists[0].push_back(-1);//to keep it from scanning the ROI again when the ROI has no voxels, slightly hacky
-        }
-    } else {//lists already made, use them
-        const float* roiFrame = roiVol->getFrame();
-        int64_t ibasesize = (int64_t)lists[0].size();
-        if (ibasesize < 3) return;//handle the case of empty ROI here (ibasesize will be 1)
-        int64_t jbasesize = (int64_t)lists[1].size();
-        int64_t kbasesize = (int64_t)lists[2].size();
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int ibase = 0; ibase < ibasesize; ibase += 3)
-        {
-            int i = lists[0][ibase];
-            int j = lists[0][ibase + 1];
-            int k = lists[0][ibase + 2];
-            int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-            if (imin < 0) imin = 0;
-            if (imax > myDims[0]) imax = myDims[0];
-            float sum = 0.0f, weightsum = 0.0f;
-            int64_t baseInd = inVol->getIndex(0, j, k, 0);
-            int64_t curInd = baseInd + i;
-            for (int ikern = imin; ikern < imax; ++ikern)
-            {
-                int64_t thisIndex = baseInd + ikern;
-                if (roiFrame[thisIndex] > 0.0f && (!fixZeros || inFrame[thisIndex] != 0.0f))
-                {
-                    float weight = iweights[ikern - i + irange];
-                    weightsum += weight;
-                    sum += weight * inFrame[thisIndex];
-                }
-            }
-            scratchWeights[curInd] = weightsum;
-            scratchFrame3[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int jbase = 0; jbase < jbasesize; jbase += 3)
+        const float* roiFrame = NULL;
+        if (roiVol != NULL)
         {
-            int i = lists[1][jbase];
-            int j = lists[1][jbase + 1];
-            int k = lists[1][jbase + 2];
-            int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-            if (jmin < 0) jmin = 0;
-            if (jmax > myDims[1]) jmax = myDims[1];
-            float sum = 0.0f, weightsum = 0.0f;
-            int64_t baseInd = inVol->getIndex(i, 0, k);
-            int64_t curInd = baseInd + j * myDims[0];
-            for (int jkern = jmin; jkern < jmax; ++jkern)
-            {
-                int64_t thisIndex = baseInd + jkern * myDims[0];//DO NOT test for this source voxel having zero data, or it will skip good data
-                float weight = jweights[jkern - j + jrange];
-                weightsum += weight * scratchWeights[thisIndex];
-                sum += weight * scratchFrame3[thisIndex];
-            }
-            scratchWeights2[curInd] = weightsum;
-            scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
+            roiFrame = roiVol->getFrame();
         }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int kbase = 0; kbase < kbasesize; kbase += 3)
-        {
-            int i = lists[2][kbase];
-            int j = lists[2][kbase + 1];
-            int k = lists[2][kbase + 2];
-            int64_t baseInd = inVol->getIndex(i, j, 0);
-            int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-            int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-            if (kmin < 0) kmin = 0;
-            if (kmax > myDims[2]) kmax = myDims[2];
-            float sum = 0.0f, weightsum = 0.0f;
-            for (int kkern = kmin; kkern < kmax; ++kkern)
-            {
-                int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];//ditto
-                float weight = kweights[kkern - k + krange];
-                weightsum += weight * scratchWeights2[thisIndex];
-                sum += weight * scratchFrame2[thisIndex];
-            }
-            if (weightsum != 0.0f)
-            {
-                scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-            } else {
-                scratchFrame[curInd] = 0.0f;
-            }
-        }//the frame should be zeroed outside the ROI already due to the first time through
-    }
-}
-
-void AlgorithmVolumeSmoothing::smoothFrameNonOrth(const float* inFrame, const vector<int64_t>& myDims, CaretArray<float>& scratchFrame, const VolumeFile* inVol, const VolumeFile* roiVol, const CaretArray<float**>& weights, const int& irange, const int& jrange, const int& krange, const bool& fixZeros)
-{
-    const float* roiFrame = NULL;
-    if (roiVol != NULL)
-    {
-        roiFrame = roiVol->getFrame();
-    }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)
-    {
-        for (int j = 0; j < myDims[1]; ++j)
+        vector<float> scratchFrame(myDims[0] * myDims[1] * myDims[2]);
+        for (int64_t s = 0; s < numMaps; ++s)
         {
-            for (int i = 0; i < myDims[0]; ++i)
+            for (int c = 0; c < myDims[4]; ++c)
             {
-                if (roiVol == NULL || roiVol->getValue(i, j, k) > 0.0f)
-                {
-                    int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                    if (imin < 0) imin = 0;
-                    if (imax > myDims[0]) imax = myDims[0];
-                    int jmin = j - jrange, jmax = j + jrange + 1;
-                    if (jmin < 0) jmin = 0;
-                    if (jmax > myDims[1]) jmax = myDims[1];
-                    int kmin = k - krange, kmax = k + krange + 1;
-                    if (kmin < 0) kmin = 0;
-                    if (kmax > myDims[2]) kmax = myDims[2];
-                    float sum = 0.0f, weightsum = 0.0f;
-                    for (int kkern = kmin; kkern < kmax; ++kkern)
-                    {
-                        int64_t kindpart = kkern * myDims[1];
-                        int kkernpart = kkern - k + krange;
-                        for (int jkern = jmin; jkern < jmax; ++jkern)
-                        {
-                            int64_t jindpart = (kindpart + jkern) * myDims[0];
-                            int jkernpart = jkern - j + jrange;
-                            for (int ikern = imin; ikern < imax; ++ikern)
-                            {
-                                int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
-                                float weight = weights[kkernpart][jkernpart][ikern - i + irange];
-                                if (weight != 0.0f && (roiVol == NULL || roiFrame[thisIndex] > 0.0f) && (!fixZeros || inFrame[thisIndex] != 0.0f))
-                                {
-                                    weightsum += weight;
-                                    sum += weight * inFrame[thisIndex];
-                                }
-                            }
-                        }
-                    }
-                    if (weightsum != 0.0f)
-                    {
-                        scratchFrame[inVol->getIndex(i, j, k)] = sum / weightsum;
-                    } else {
-                        scratchFrame[inVol->getIndex(i, j, k)] = 0.0f;
-                    }
-                } else {
-                    scratchFrame[inVol->getIndex(i, j, k)] = 0.0f;
-                }
+                smoothFrameNonOrth(inVol->getFrame(firstMap + s, c), myDims, scratchFrame.data(), roiFrame, offsets, irange, jrange, krange, fixZeros);
+                outVol->setFrame(scratchFrame.data(), s, c);
             }
+            myProgress.reportProgress(((float)s + 1) / numMaps);
         }
     }
 }
@@ -25,16 +25,84 @@
 #include "CaretAssert.h"
 #include "CaretHeap.h"
 #include "CaretOMP.h"
+#include "SignFlipPermutations.h"
 #include "VolumeFile.h"
 #include "VoxelIJK.h"
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <set>
 #include <vector>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{//hidden namespace just to make sure things don't collide
+    struct Cluster
+    {
+        double accumVal, totalVolume;
+        vector<VoxelIJK> members;
+        float lastVal;
+        bool first;
+        Cluster()
+        {
+            first = true;
+            accumVal = 0.0;
+            totalVolume = 0.0;
+        }
+        void addMember(const VoxelIJK& voxel, const float& val, const float& voxel_volume, const float& param_e, const float& param_h)
+        {
+            update(val, param_e, param_h);
+            members.push_back(voxel);
+            totalVolume += voxel_volume;
+        }
+        void update(const float& bottomVal, const float& param_e, const float& param_h)
+        {
+            if (first)
+            {
+                lastVal = bottomVal;
+                first = false;
+            } else {
+                if (bottomVal != lastVal)//skip computing if there is no difference
+                {
+                    CaretAssert(bottomVal < lastVal);
+                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+                    double newSlice = pow(totalVolume, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
+                    accumVal += newSlice;
+                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
+                }
+            }
+        }
+    };
+    
+    int64_t allocCluster(vector<Cluster>& clusterList, set<int64_t>& deadClusters)
+    {
+        if (deadClusters.empty())
+        {
+            clusterList.push_back(Cluster());
+            return (int64_t)(clusterList.size() - 1);
+        } else {
+            set<int64_t>::iterator iter = deadClusters.begin();
+            int64_t ret = *iter;
+            deadClusters.erase(iter);
+            clusterList[ret] = Cluster();//reinitialize
+            return ret;
+        }
+    }
+}
+
+struct AlgorithmVolumeTFCE::Scratch
+{
+    vector<int64_t> membership;//only the voxels of the clusters are reset after each use
+    vector<Cluster> clusterList;
+    set<int64_t> deadClusters;//to allow reallocation without changing indices
+    CaretSimpleMaxHeap<VoxelIJK, float> voxelHeap;
+    vector<double> accum;
+    Scratch(const int64_t& frameSize) : membership(frameSize, -1), accum(frameSize) { }
+};
+
 AString AlgorithmVolumeTFCE::getCommandSwitch()
 {
     return "-volume-tfce";
@@ -66,12 +134,27 @@ OperationParameters* AlgorithmVolumeTFCE::getParameters()
     OptionalParameter* subvolSelect = ret->createOptionalParameter(6, "-subvolume", "select a single subvolume");
     subvolSelect->addStringParameter(1, "subvolume", "the subvolume number or name");
     
+    OptionalParameter* permOpt = ret->createOptionalParameter(7, "-permutation-test", "treat the subvolumes as subjects, and do a sign-flipping permutation test of their mean");
+    permOpt->addIntegerParameter(1, "num-perms", "number of permutations, including the unflipped data");
+    permOpt->addVolumeOutputParameter(2, "p-out", "output - the familywise error corrected p-values");
+    OptionalParameter* flipFileOpt = permOpt->createOptionalParameter(3, "-flip-file", "use specified sign flips instead of random ones");
+    flipFileOpt->addStringParameter(1, "flip-file", "text file with one line per permutation, each containing a 1 or -1 for every subvolume");
+    OptionalParameter* seedOpt = permOpt->createOptionalParameter(4, "-seed", "seed the random sign flips (default 0)");
+    seedOpt->addIntegerParameter(1, "seed", "the seed value");
+    OptionalParameter* nullOutOpt = permOpt->createOptionalParameter(5, "-null-out", "save the null distribution");
+    nullOutOpt->addStringParameter(1, "null-file", "output - text file to write the maximum absolute TFCE value of each permutation to");
+    
     ret->setHelpText(
         AString("Threshold-free cluster enhancement is a method to increase the relative value of regions that would form clusters in a standard thresholding test.  ") +
         "This is accomplished by evaluating the integral of:\n\n" +
         "e(h, p)^E * h^H * dh\n\n" +
         "at each vertex p, where h ranges from 0 to the maximum value in the data, and e(h, p) is the extent of the cluster containing vertex p at threshold h.  " +
         "Negative values are similarly enhanced by negating the data, running the same process, and negating the result.\n\n" +
+        "The -permutation-test option treats each subvolume as one subject, and the output is TFCE applied to the one-sample t-statistic across subvolumes.  " +
+        "The same is then done for each permutation, where a random subset of the subvolumes is negated, and the maximum absolute TFCE value of each permutation forms the null distribution.  " +
+        "The p-value of each voxel is the fraction of permutations whose maximum is at least as large as the absolute value of its TFCE output.  " +
+        "The random flips always use the unflipped data as the first permutation, a file given with -flip-file is used as is, and must contain exactly <num-perms> permutations.  " +
+        "The -subvolume option may not be used with -permutation-test.\n\n" +
         "This method is explained in: Smith SM, Nichols TE., \"Threshold-free cluster enhancement: addressing problems of smoothing, threshold dependence and localisation in cluster inference.\" Neuroimage. 2009 Jan 1;44(1):83-98. PMID: 18501637"
     );
     return ret;
@@ -111,6 +194,46 @@ void AlgorithmVolumeTFCE::useParameters(OperationParameters* myParams, ProgressO
             throw AlgorithmException("invalid subvolume specified");
         }
     }
+    OptionalParameter* permOpt = myParams->getOptionalParameter(7);
+    if (permOpt->m_present)
+    {
+        if (subvolSelect->m_present) throw AlgorithmException("-subvolume may not be used with -permutation-test");
+        int numPerms = (int)permOpt->getInteger(1);
+        if (numPerms < 1) throw AlgorithmException("number of permutations must be positive");
+        VolumeFile* myPValueOut = permOpt->getOutputVolume(2);
+        CaretPointer<SignFlipPermutations> myPerms;
+        OptionalParameter* flipFileOpt = permOpt->getOptionalParameter(3);
+        try
+        {
+            if (flipFileOpt->m_present)
+            {
+                myPerms.grabNew(new SignFlipPermutations(flipFileOpt->getString(1), myVol->getNumberOfMaps()));
+                if (myPerms->getNumberOfPermutations() != numPerms) throw AlgorithmException("flip file contains " + AString::number(myPerms->getNumberOfPermutations()) + " permutations, but num-perms is " + AString::number(numPerms));
+            } else {
+                uint32_t seed = 0;
+                OptionalParameter* seedOpt = permOpt->getOptionalParameter(4);
+                if (seedOpt->m_present) seed = (uint32_t)seedOpt->getInteger(1);
+                myPerms.grabNew(new SignFlipPermutations(myVol->getNumberOfMaps(), numPerms, seed));
+            }
+        } catch (AlgorithmException&) {
+            throw;
+        } catch (CaretException& e) {
+            throw AlgorithmException(e.whatString());
+        }
+        vector<float> nullDist;
+        AlgorithmVolumeTFCE(myProgObj, myVol, myVolOut, myPValueOut, *myPerms, &nullDist, presmooth, myRoi, param_e, param_h);
+        OptionalParameter* nullOutOpt = permOpt->getOptionalParameter(5);
+        if (nullOutOpt->m_present)
+        {
+            ofstream nullFile(nullOutOpt->getString(1).toLocal8Bit().constData());
+            if (!nullFile) throw AlgorithmException("failed to open null distribution file '" + nullOutOpt->getString(1) + "' for writing");
+            for (int i = 0; i < (int)nullDist.size(); ++i)
+            {
+                nullFile << nullDist[i] << "\n";
+            }
+        }
+        return;
+    }
     AlgorithmVolumeTFCE(myProgObj, myVol, myVolOut, presmooth, myRoi, param_e, param_h, subvolNum);
 }
 
@@ -136,12 +259,13 @@ AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const Volume
 #pragma omp CARET_PAR
         {
             vector<float> outframe(dims[0] * dims[1] * dims[2]);
+            Scratch myScratch(dims[0] * dims[1] * dims[2]);
 #pragma omp CARET_FOR
             for (int64_t b = 0; b < dims[3]; ++b)
             {
                 for (int64_t c = 0; c < dims[4]; ++c)
                 {
-                    processFrame(toUse, b, c, outframe.data(), roiFrame, param_e, param_h);
+                    processFrame(toUse, toUse->getFrame(b, c), outframe.data(), roiFrame, param_e, param_h, myScratch);
                     myVolOut->setFrame(outframe.data(), b, c);
                 }
             }
@@ -160,100 +284,115 @@ AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const Volume
             useFrame = 0;
         }
         vector<float> outframe(dims[0] * dims[1] * dims[2]);
+        Scratch myScratch(dims[0] * dims[1] * dims[2]);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
-            processFrame(toUse, useFrame, c, outframe.data(), roiFrame, param_e, param_h);
+            processFrame(toUse, toUse->getFrame(useFrame, c), outframe.data(), roiFrame, param_e, param_h, myScratch);
             myVolOut->setFrame(outframe.data(), 0, c);
         }
     }
 }
 
-void AlgorithmVolumeTFCE::processFrame(const VolumeFile* inVol, const int64_t& b, const int64_t& c, float* outData, const float* roiData, const float& param_e, const float& param_h)
+AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const VolumeFile* myVol, VolumeFile* myVolOut, VolumeFile* myPValueOut, const SignFlipPermutations& myPerms,
+                                         vector<float>* nullOut, const float& presmooth, const VolumeFile* myRoi, const float& param_e, const float& param_h) : AbstractAlgorithm(myProgObj)
 {
-    vector<int64_t> dims = inVol->getDimensions();
-    int64_t frameSize = dims[0] * dims[1] * dims[2];
-    vector<double> accum(frameSize, 0.0);
-    tfce(inVol, b, c, accum.data(), roiData, param_e, param_h, false);//don't negate - positives
-    tfce(inVol, b, c, accum.data(), roiData, param_e, param_h, true);//negate - negatives - NOTE: output is still positive!!!
-    const float* inData = inVol->getFrame(b, c);
-    for (int64_t i = 0; i < frameSize; ++i)
+    LevelProgress myProgress(myProgObj);
+    if (myRoi != NULL && !myVol->getVolumeSpace().matches(myRoi->getVolumeSpace())) throw AlgorithmException("roi volume has different volume space than input");
+    if (myVol->getNumberOfComponents() != 1) throw AlgorithmException("permutation testing does not support multi-component volumes");
+    int numSubjects = (int)myVol->getNumberOfMaps();
+    if (myPerms.getNumberOfSubjects() != numSubjects) throw AlgorithmException("permutations have a different number of subjects than the volume has subvolumes");
+    vector<int64_t> dims = myVol->getDimensions();
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    const float* roiFrame = NULL;
+    if (myRoi != NULL) roiFrame = myRoi->getFrame();
+    const VolumeFile* toUse = myVol;
+    VolumeFile smoothed;
+    if (presmooth > 0.0f)
+    {//smoothing is linear, so smoothing before flipping is the same as smoothing every permutation
+        AlgorithmVolumeSmoothing(NULL, myVol, presmooth, &smoothed, myRoi);
+        toUse = &smoothed;
+    }
+    vector<const float*> subjectData(numSubjects);
+    for (int i = 0; i < numSubjects; ++i)
     {
-        if (inData[i] > 0.0f)//negate the results from negative inputs
-        {
-            outData[i] = accum[i];
-        } else {//the areas outside the roi will have zeros, so we don't have to worry about them
-            outData[i] = -accum[i];
-        }
+        subjectData[i] = toUse->getFrame(i);
     }
-}
-
-namespace
-{//hidden namespace just to make sure things don't collide
-    struct Cluster
+    vector<float> observed(frameSize);
+    int numPerms = myPerms.getNumberOfPermutations();
+    vector<float> nullDist(numPerms);
+#pragma omp CARET_PAR
     {
-        double accumVal, totalVolume;
-        vector<VoxelIJK> members;
-        float lastVal;
-        bool first;
-        Cluster()
-        {
-            first = true;
-            accumVal = 0.0;
-            totalVolume = 0.0;
-        }
-        void addMember(const VoxelIJK& voxel, const float& val, const float& voxel_volume, const float& param_e, const float& param_h)
+        Scratch myScratch(frameSize);
+        vector<float> tstat(frameSize), enhanced(frameSize);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int perm = -1; perm < numPerms; ++perm)//-1 is the unflipped data, for the real output
         {
-            update(val, param_e, param_h);
-            members.push_back(voxel);
-            totalVolume += voxel_volume;
-        }
-        void update(const float& bottomVal, const float& param_e, const float& param_h)
-        {
-            if (first)
+            myPerms.oneSampleT(subjectData, frameSize, perm, tstat.data());
+            if (perm == -1)
             {
-                lastVal = bottomVal;
-                first = false;
+                processFrame(toUse, tstat.data(), observed.data(), roiFrame, param_e, param_h, myScratch);
             } else {
-                if (bottomVal != lastVal)//skip computing if there is no difference
+                processFrame(toUse, tstat.data(), enhanced.data(), roiFrame, param_e, param_h, myScratch);
+                float maxVal = 0.0f;//outside the roi is zero, so no need to test it
+                for (int64_t i = 0; i < frameSize; ++i)
                 {
-                    CaretAssert(bottomVal < lastVal);
-                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
-                    double newSlice = pow(totalVolume, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
-                    accumVal += newSlice;
-                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
+                    maxVal = max(maxVal, abs(enhanced[i]));
                 }
+                nullDist[perm] = maxVal;
             }
         }
-    };
-    
-    int64_t allocCluster(vector<Cluster>& clusterList, set<int64_t>& deadClusters)
+    }
+    vector<int64_t> outDims = dims;
+    outDims.resize(3);
+    myVolOut->reinitialize(outDims, myVol->getSform());
+    myVolOut->setFrame(observed.data());
+    myVolOut->setMapName(0, "TFCE of one-sample t");
+    if (nullOut != NULL) *nullOut = nullDist;
+    sort(nullDist.begin(), nullDist.end());
+    vector<float> pvals(frameSize, 1.0f);
+    for (int64_t i = 0; i < frameSize; ++i)
     {
-        if (deadClusters.empty())
+        if (roiFrame == NULL || roiFrame[i] > 0.0f)
         {
-            clusterList.push_back(Cluster());
-            return (int64_t)(clusterList.size() - 1);
-        } else {
-            set<int64_t>::iterator iter = deadClusters.begin();
-            int64_t ret = *iter;
-            deadClusters.erase(iter);
-            clusterList[ret] = Cluster();//reinitialize
-            return ret;
+            pvals[i] = SignFlipPermutations::correctedPValue(nullDist, observed[i]);
+        }
+    }
+    myPValueOut->reinitialize(outDims, myVol->getSform());
+    myPValueOut->setFrame(pvals.data());
+    myPValueOut->setMapName(0, "corrected p, " + AString::number(numPerms) + " permutations");
+}
+
+void AlgorithmVolumeTFCE::processFrame(const VolumeFile* inVol, const float* frameData, float* outData, const float* roiData, const float& param_e, const float& param_h, Scratch& scratch)
+{
+    vector<int64_t> dims = inVol->getDimensions();
+    int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<double>& accum = scratch.accum;
+    accum.assign(frameSize, 0.0);
+    tfce(inVol, frameData, accum.data(), roiData, param_e, param_h, false, scratch);//don't negate - positives
+    tfce(inVol, frameData, accum.data(), roiData, param_e, param_h, true, scratch);//negate - negatives - NOTE: output is still positive!!!
+    for (int64_t i = 0; i < frameSize; ++i)
+    {
+        if (frameData[i] > 0.0f)//negate the results from negative inputs
+        {
+            outData[i] = accum[i];
+        } else {//the areas outside the roi will have zeros, so we don't have to worry about them
+            outData[i] = -accum[i];
         }
     }
 }
 
-void AlgorithmVolumeTFCE::tfce(const VolumeFile* inVol, const int64_t& b, const int64_t& c, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate)
+void AlgorithmVolumeTFCE::tfce(const VolumeFile* inVol, const float* frameData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate,
+                               Scratch& scratch)
 {
     vector<int64_t> dims = inVol->getDimensions();
     Vector3D ivec, jvec, kvec, origin;//compute the volume of a voxel so different resolutions have comparable values - as if it matters, but hey
     inVol->getVolumeSpace().getSpacingVectors(ivec, jvec, kvec, origin);//who knows, maybe we'll have distortion correction in volume someday
     float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
-    const int64_t frameSize = dims[0] * dims[1] * dims[2];
-    const float* frameData = inVol->getFrame(b, c);
-    vector<int64_t> membership(frameSize, -1);//use int64_t just in case we get an absurd number of clusters
-    vector<Cluster> clusterList;
-    set<int64_t> deadClusters;//to allow reallocation without changing indices
-    CaretSimpleMaxHeap<VoxelIJK, float> voxelHeap;
+    vector<int64_t>& membership = scratch.membership;//use int64_t just in case we get an absurd number of clusters
+    vector<Cluster>& clusterList = scratch.clusterList;
+    set<int64_t>& deadClusters = scratch.deadClusters;//to allow reallocation without changing indices
+    CaretSimpleMaxHeap<VoxelIJK, float>& voxelHeap = scratch.voxelHeap;
+    CaretAssert((int64_t)membership.size() == dims[0] * dims[1] * dims[2]);
     for (int64_t i = 0; i < dims[0]; ++i)
     {
         for (int64_t j = 0; j < dims[1]; ++j)
@@ -372,9 +511,13 @@ void AlgorithmVolumeTFCE::tfce(const VolumeFile* inVol, const int64_t& b, const
         int numMembers = (int)thisCluster.members.size();
         for (int j = 0; j < numMembers; ++j)
         {
-            accumData[inVol->getIndex(thisCluster.members[j].m_ijk)] += thisCluster.accumVal;//add the resulting slice to all members - their stored data contains the offset between the cluster peak and their corect value
+            int64_t memberIndex = inVol->getIndex(thisCluster.members[j].m_ijk);
+            accumData[memberIndex] += thisCluster.accumVal;//add the resulting slice to all members - their stored data contains the offset between the cluster peak and their corect value
+            membership[memberIndex] = -1;//live clusters contain every voxel that was used, so this resets the scratch membership
         }
     }
+    clusterList.clear();
+    deadClusters.clear();
 }
 
 float AlgorithmVolumeTFCE::getAlgorithmInternalWeight()
@@ -23,19 +23,27 @@
 
 #include "AbstractAlgorithm.h"
 
+#include <vector>
+
 namespace caret {
     
+    class SignFlipPermutations;
+    
     class AlgorithmVolumeTFCE : public AbstractAlgorithm
     {
+        struct Scratch;//per-thread reusable memory, so permutations don't reallocate
         AlgorithmVolumeTFCE();
-        void processFrame(const VolumeFile* inVol, const int64_t& b, const int64_t& c, float* outData, const float* roiData, const float& param_e, const float& param_h);
-        void tfce(const VolumeFile* inVol, const int64_t& b, const int64_t& c, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate);
+        void processFrame(const VolumeFile* inVol, const float* frameData, float* outData, const float* roiData, const float& param_e, const float& param_h, Scratch& scratch);
+        void tfce(const VolumeFile* inVol, const float* frameData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate, Scratch& scratch);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmVolumeTFCE(ProgressObject* myProgObj, const VolumeFile* myVol, VolumeFile* myVolOut, const float& presmooth = 0.0f, const VolumeFile* myRoi = NULL,
                             const float& param_e = 0.5f, const float& param_h = 2.0f, const int64_t& subvolNum = -1);
+        ///permutation test treating subvolumes as subjects, output is TFCE of the one-sample t-statistic, nullOut gets the max statistic of each permutation
+        AlgorithmVolumeTFCE(ProgressObject* myProgObj, const VolumeFile* myVol, VolumeFile* myVolOut, VolumeFile* myPValueOut, const SignFlipPermutations& myPerms,
+                            std::vector<float>* nullOut = NULL, const float& presmooth = 0.0f, const VolumeFile* myRoi = NULL, const float& param_e = 0.5f, const float& param_h = 2.0f);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
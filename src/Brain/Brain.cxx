@@ -55,6 +55,7 @@
 #include "CiftiParcelSeriesFile.h"
 #include "CiftiParcelScalarFile.h"
 #include "CiftiScalarDataSeriesFile.h"
+#include "DataFileConcurrentReader.h"
 #include "DisplayPropertiesAnnotation.h"
 #include "DisplayPropertiesBorders.h"
 #include "DisplayPropertiesFiberOrientation.h"
@@ -5295,6 +5296,169 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
     return caretDataFileRead;
 }
 
+/**
+ * Create a new, empty data file that may be read by a
+ * DataFileConcurrentReader.  Only types of files that are read
+ * independently of other files (their reading does not use other
+ * loaded files such as the palette file) are read concurrently.
+ *
+ * @param dataFileType
+ *    Type of data file.
+ * @param dataFileName
+ *    Absolute name of data file.
+ * @return
+ *    New data file or NULL if the file should be read with readDataFile()
+ *    because of its type, because it is on the network, or because it does
+ *    not exist (so that the error is reported by readDataFile()).
+ */
+CaretDataFile*
+Brain::newDataFileForConcurrentReading(const DataFileTypeEnum::Enum dataFileType,
+                                       const AString& dataFileName) const
+{
+    if (DataFile::isFileOnNetwork(dataFileName)) {
+        return NULL;
+    }
+    FileInformation fileInfo(dataFileName);
+    if ( ! fileInfo.exists()) {
+        return NULL;
+    }
+    
+    CaretDataFile* caretDataFile = NULL;
+    
+    switch (dataFileType) {
+        case DataFileTypeEnum::ANNOTATION:
+            break;
+        case DataFileTypeEnum::BORDER:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+            caretDataFile = new CiftiConnectivityMatrixDenseFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            caretDataFile = new CiftiBrainordinateLabelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+            caretDataFile = new CiftiConnectivityMatrixDenseParcelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            caretDataFile = new CiftiBrainordinateScalarFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            caretDataFile = new CiftiBrainordinateDataSeriesFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+            caretDataFile = new CiftiConnectivityMatrixParcelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+            caretDataFile = new CiftiConnectivityMatrixParcelDenseFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+            caretDataFile = new CiftiParcelLabelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            caretDataFile = new CiftiParcelScalarFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            caretDataFile = new CiftiParcelSeriesFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+            break;
+        case DataFileTypeEnum::FOCI:
+            break;
+        case DataFileTypeEnum::IMAGE:
+            break;
+        case DataFileTypeEnum::LABEL:
+            caretDataFile = new LabelFile();
+            break;
+        case DataFileTypeEnum::METRIC:
+            caretDataFile = new MetricFile();
+            break;
+        case DataFileTypeEnum::PALETTE:
+            break;
+        case DataFileTypeEnum::RGBA:
+            caretDataFile = new RgbaFile();
+            break;
+        case DataFileTypeEnum::SCENE:
+            break;
+        case DataFileTypeEnum::SPECIFICATION:
+            break;
+        case DataFileTypeEnum::SURFACE:
+            caretDataFile = new Surface();
+            break;
+        case DataFileTypeEnum::UNKNOWN:
+            break;
+        case DataFileTypeEnum::VOLUME:
+            caretDataFile = new VolumeFile();
+            break;
+    }
+    
+    return caretDataFile;
+}
+
+/**
+ * Take a file that was read by a DataFileConcurrentReader and add it
+ * to the brain.  Performs the same validation as readDataFile().
+ *
+ * @param concurrentReader
+ *    Reader that read the file, the file must have finished reading.
+ * @param fileIndex
+ *    Index of the file in the reader.
+ * @param dataFileType
+ *    Type of data file.
+ * @param structure
+ *    Struture of file (used if not invalid)
+ * @param dataFileName
+ *    Absolute name of data file.
+ * @throws DataFileException
+ *    If there was an error reading or adding the file.
+ * @return
+ *    Pointer to file that was added.
+ */
+CaretDataFile*
+Brain::addConcurrentlyReadDataFile(DataFileConcurrentReader& concurrentReader,
+                                   const int32_t fileIndex,
+                                   const DataFileTypeEnum::Enum dataFileType,
+                                   const StructureEnum::Enum structure,
+                                   const AString& dataFileName)
+{
+    AString errorMessage;
+    CaretDataFile* caretDataFile = concurrentReader.takeFile(fileIndex,
+                                                             errorMessage);
+    if (caretDataFile == NULL) {
+        throw DataFileException(errorMessage);
+    }
+    
+    try {
+        /*
+         * Validation of CIFTI files is only performed by the
+         * "addReadOrReload" methods when they read the file and must
+         * be performed after files that precede it are added.
+         */
+        const CiftiMappableDataFile* ciftiMapFile = dynamic_cast<const CiftiMappableDataFile*>(caretDataFile);
+        if (ciftiMapFile != NULL) {
+            validateCiftiMappableDataFile(ciftiMapFile);
+        }
+        
+        addReadOrReloadDataFile(FILE_MODE_ADD,
+                                caretDataFile,
+                                dataFileType,
+                                structure,
+                                dataFileName,
+                                false);
+    }
+    catch (const DataFileException& dfe) {
+        delete caretDataFile;
+        throw dfe;
+    }
+    
+    return caretDataFile;
+}
+
 /**
  * Processing performed after adding or removing a data file.
  */
@@ -5357,6 +5521,17 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                                        "Starting to read selected files");
     EventManager::get()->sendEvent(progressUpdate.getPointer());
 
+    /*
+     * Files that do not depend upon other files are read concurrently
+     * by threads.  All files, and any errors, are added to the brain
+     * in this thread and in the same order as if the files were
+     * read sequentially.
+     */
+    std::vector<const SpecFileDataFile*> filesToLoad;
+    std::vector<DataFileTypeEnum::Enum> filesToLoadTypes;
+    std::vector<int32_t> filesToLoadReaderIndices;
+    DataFileConcurrentReader concurrentReader;
+    
     /*
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
@@ -5376,42 +5551,87 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* dataFileInfo = group->getFileInformation(iFile);
             if (dataFileInfo->isLoadingSelected()) {
-                const AString filename = dataFileInfo->getFileName();
-                const StructureEnum::Enum structure = dataFileInfo->getStructure();
-
-                /*
-                 * Send event indicating progress of file reading
-                 */
-                FileInformation fileInfo(dataFileInfo->getFileName());
-                progressUpdate.setProgress(fileReadCounter,
-                                           ("Reading "
-                                            + fileInfo.getFileName()));
-                EventManager::get()->sendEvent(progressUpdate.getPointer());
+                int32_t readerIndex = -1;
+                const AString absoluteFileName = convertFilePathNameToAbsolutePathName(dataFileInfo->getFileName());
+                CaretDataFile* caretDataFile = newDataFileForConcurrentReading(dataFileType,
+                                                                               absoluteFileName);
+                if (caretDataFile != NULL) {
+                    readerIndex = concurrentReader.addFile(caretDataFile,
+                                                           absoluteFileName);
+                }
                 
+                filesToLoad.push_back(dataFileInfo);
+                filesToLoadTypes.push_back(dataFileType);
+                filesToLoadReaderIndices.push_back(readerIndex);
+            }
+        }
+    }
+    
+    concurrentReader.startReading();
+    
+    const int32_t numFilesToLoad = static_cast<int32_t>(filesToLoad.size());
+    for (int32_t iLoad = 0; iLoad < numFilesToLoad; iLoad++) {
+        const SpecFileDataFile* dataFileInfo = filesToLoad[iLoad];
+        const DataFileTypeEnum::Enum dataFileType = filesToLoadTypes[iLoad];
+        const int32_t readerIndex = filesToLoadReaderIndices[iLoad];
+        const AString filename = dataFileInfo->getFileName();
+        const StructureEnum::Enum structure = dataFileInfo->getStructure();
+        
+        /*
+         * Send event indicating progress of file reading
+         */
+        FileInformation fileInfo(dataFileInfo->getFileName());
+        progressUpdate.setProgress(fileReadCounter,
+                                   ("Reading "
+                                    + fileInfo.getFileName()));
+        EventManager::get()->sendEvent(progressUpdate.getPointer());
+        
+        /*
+         * If user cancelled, reset brain and get out!
+         */
+        if (progressUpdate.isCancelled()) {
+            concurrentReader.cancel();
+            resetBrain();
+            return;
+        }
+        
+        try {
+            if (readerIndex >= 0) {
                 /*
-                 * If user cancelled, reset brain and get out!
+                 * Keep the progress dialog responsive while
+                 * waiting for the file to finish reading
                  */
-                if (progressUpdate.isCancelled()) {
-                    resetBrain();
-                    return;
-                }
-                
-                try {
-                    readDataFile(dataFileType,
-                                 structure,
-                                 filename,
-                                 false);
-                }
-                catch (const DataFileException& e) {
-                    if (errorMessage.isEmpty() == false) {
-                        errorMessage += "\n";
+                while ( ! concurrentReader.waitForFile(readerIndex,
+                                                       100)) {
+                    EventManager::get()->sendEvent(progressUpdate.getPointer());
+                    if (progressUpdate.isCancelled()) {
+                        concurrentReader.cancel();
+                        resetBrain();
+                        return;
                     }
-                    errorMessage += e.whatString();
                 }
                 
-                fileReadCounter++;
+                addConcurrentlyReadDataFile(concurrentReader,
+                                            readerIndex,
+                                            dataFileType,
+                                            structure,
+                                            convertFilePathNameToAbsolutePathName(filename));
+            }
+            else {
+                readDataFile(dataFileType,
+                             structure,
+                             filename,
+                             false);
+            }
+        }
+        catch (const DataFileException& e) {
+            if (errorMessage.isEmpty() == false) {
+                errorMessage += "\n";
             }
+            errorMessage += e.whatString();
         }
+        
+        fileReadCounter++;
     }
     
     m_specFile->clearModified();
@@ -5631,8 +5851,17 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     
     
     /*
-     * Load new files and add existing files that were previously loaded.
+     * Find the new files to load.  Files that do not depend upon other
+     * files are read concurrently by threads.  All files, and any errors,
+     * are added to the brain in this thread and in the same order as if
+     * the files were read sequentially.
      */
+    std::vector<const SpecFileDataFile*> filesToLoad;
+    std::vector<DataFileTypeEnum::Enum> filesToLoadTypes;
+    std::vector<AString> filesToLoadNames;
+    std::vector<int32_t> filesToLoadReaderIndices;
+    DataFileConcurrentReader concurrentReader;
+    
     const int32_t numFileGroups = specFileToLoad->getNumberOfDataFileTypeGroups();
     for (int32_t ig = 0; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = specFileToLoad->getDataFileTypeGroupByIndex(ig);
@@ -5641,65 +5870,119 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
             if (fileInfo->isLoadingSelected()) {
-                try {
-                    
-                    AString filename = fileInfo->getFileName();
-                    
-                    std::map<const SpecFileDataFile*, CaretDataFile*>::iterator specToFileIter = specFilesEntryToNonModifiedFile.find(fileInfo);
-                    if (specToFileIter != specFilesEntryToNonModifiedFile.end()) {
-                        const QString msg = ("Adding previous file "
-                                             + FileInformation(filename).getFileName());
-                        progressEvent.setProgressMessage(msg);
-                        EventManager::get()->sendEvent(progressEvent.getPointer());
-                        if (progressEvent.isCancelled()) {
-                            resetBrain(keepSceneFiles,
-                                       keepSpecFile);
-                            return;
+                AString filename = fileInfo->getFileName();
+                int32_t readerIndex = -1;
+                
+                if (specFilesEntryToNonModifiedFile.find(fileInfo) == specFilesEntryToNonModifiedFile.end()) {
+                    if (sceneFileOnNetwork) {
+                        if (DataFile::isFileOnNetwork(filename) == false) {
+                            const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
+                            if (lastSlashIndex >= 0) {
+                                const AString newName = (sceneFileName.left(lastSlashIndex)
+                                                         + "/"
+                                                         + filename);
+                                filename = newName;
+                            }
                         }
-                        
-                        CaretDataFile* caretDataFile = specToFileIter->second;
-                        addReadOrReloadDataFile(FILE_MODE_ADD,
-                                                caretDataFile,
-                                                caretDataFile->getDataFileType(),
-                                                caretDataFile->getStructure(),
-                                                filename,
-                                                false);
                     }
-                    else {
-                        const StructureEnum::Enum structure = fileInfo->getStructure();
-                        
-                        const QString msg = ("Loading "
-                                             + FileInformation(filename).getFileName());
-                        progressEvent.setProgressMessage(msg);
+                    
+                    const AString absoluteFileName = convertFilePathNameToAbsolutePathName(filename);
+                    CaretDataFile* caretDataFile = newDataFileForConcurrentReading(dataFileType,
+                                                                                   absoluteFileName);
+                    if (caretDataFile != NULL) {
+                        readerIndex = concurrentReader.addFile(caretDataFile,
+                                                               absoluteFileName);
+                    }
+                }
+                
+                filesToLoad.push_back(fileInfo);
+                filesToLoadTypes.push_back(dataFileType);
+                filesToLoadNames.push_back(filename);
+                filesToLoadReaderIndices.push_back(readerIndex);
+            }
+        }
+    }
+    
+    concurrentReader.startReading();
+    
+    /*
+     * Load new files and add existing files that were previously loaded.
+     */
+    const int32_t numFilesToLoad = static_cast<int32_t>(filesToLoad.size());
+    for (int32_t iLoad = 0; iLoad < numFilesToLoad; iLoad++) {
+        const SpecFileDataFile* fileInfo = filesToLoad[iLoad];
+        const DataFileTypeEnum::Enum dataFileType = filesToLoadTypes[iLoad];
+        const AString& filename = filesToLoadNames[iLoad];
+        const int32_t readerIndex = filesToLoadReaderIndices[iLoad];
+        try {
+            std::map<const SpecFileDataFile*, CaretDataFile*>::iterator specToFileIter = specFilesEntryToNonModifiedFile.find(fileInfo);
+            if (specToFileIter != specFilesEntryToNonModifiedFile.end()) {
+                const QString msg = ("Adding previous file "
+                                     + FileInformation(filename).getFileName());
+                progressEvent.setProgressMessage(msg);
+                EventManager::get()->sendEvent(progressEvent.getPointer());
+                if (progressEvent.isCancelled()) {
+                    concurrentReader.cancel();
+                    resetBrain(keepSceneFiles,
+                               keepSpecFile);
+                    return;
+                }
+                
+                CaretDataFile* caretDataFile = specToFileIter->second;
+                addReadOrReloadDataFile(FILE_MODE_ADD,
+                                        caretDataFile,
+                                        caretDataFile->getDataFileType(),
+                                        caretDataFile->getStructure(),
+                                        filename,
+                                        false);
+            }
+            else {
+                const StructureEnum::Enum structure = fileInfo->getStructure();
+                
+                const QString msg = ("Loading "
+                                     + FileInformation(filename).getFileName());
+                progressEvent.setProgressMessage(msg);
+                EventManager::get()->sendEvent(progressEvent.getPointer());
+                if (progressEvent.isCancelled()) {
+                    concurrentReader.cancel();
+                    resetBrain(keepSceneFiles,
+                               keepSpecFile);
+                    return;
+                }
+                
+                if (readerIndex >= 0) {
+                    /*
+                     * Keep the progress dialog responsive while
+                     * waiting for the file to finish reading
+                     */
+                    while ( ! concurrentReader.waitForFile(readerIndex,
+                                                           100)) {
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            concurrentReader.cancel();
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
                         }
-                        
-                        if (sceneFileOnNetwork) {
-                            if (DataFile::isFileOnNetwork(filename) == false) {
-                                const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
-                                if (lastSlashIndex >= 0) {
-                                    const AString newName = (sceneFileName.left(lastSlashIndex)
-                                                             + "/"
-                                                             + filename);
-                                    filename = newName;
-                                }
-                            }
-                        }
-                        readDataFile(dataFileType,
-                                     structure,
-                                     filename,
-                                     false);
                     }
+                    
+                    addConcurrentlyReadDataFile(concurrentReader,
+                                                readerIndex,
+                                                dataFileType,
+                                                structure,
+                                                convertFilePathNameToAbsolutePathName(filename));
                 }
-                catch (const DataFileException& e) {
-                    sceneAttributes->addToErrorMessage(e.whatString());
+                else {
+                    readDataFile(dataFileType,
+                                 structure,
+                                 filename,
+                                 false);
                 }
             }
         }
+        catch (const DataFileException& e) {
+            sceneAttributes->addToErrorMessage(e.whatString());
+        }
     }
     
     m_isSpecFileBeingRead = false;
@@ -66,6 +66,7 @@ namespace caret {
     class CiftiParcelSeriesFile;
     class CiftiParcelScalarFile;
     class CiftiScalarDataSeriesFile;
+    class DataFileConcurrentReader;
     class DisplayProperties;
     class DisplayPropertiesAnnotation;
     class DisplayPropertiesBorders;
@@ -487,6 +488,15 @@ namespace caret {
                           const AString& dataFileName,
                           const bool markDataFileAsModified);
         
+        CaretDataFile* newDataFileForConcurrentReading(const DataFileTypeEnum::Enum dataFileType,
+                                                       const AString& dataFileName) const;
+        
+        CaretDataFile* addConcurrentlyReadDataFile(DataFileConcurrentReader& concurrentReader,
+                                                   const int32_t fileIndex,
+                                                   const DataFileTypeEnum::Enum dataFileType,
+                                                   const StructureEnum::Enum structure,
+                                                   const AString& dataFileName);
+        
         void createModelChartTwo();
         
         /**
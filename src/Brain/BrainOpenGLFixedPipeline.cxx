@@ -47,12 +47,14 @@
 #include "BrainOpenGLPrimitiveDrawing.h"
 #include "BrainOpenGLVolumeObliqueSliceDrawing.h"
 #include "BrainOpenGLVolumeSliceDrawing.h"
+#include "BrainOpenGLVolumeSliceTextureCache.h"
 #include "BrainOpenGLShapeCone.h"
 #include "BrainOpenGLShapeCube.h"
 #include "BrainOpenGLShapeCylinder.h"
 #include "BrainOpenGLShapeRing.h"
 #include "BrainOpenGLShapeRingOutline.h"
 #include "BrainOpenGLShapeSphere.h"
+#include "BrainOpenGLSurfaceBuffers.h"
 #include "BrainOpenGLViewportContent.h"
 #include "BrainStructure.h"
 #include "BrowserTabContent.h"
@@ -166,6 +168,7 @@ BrainOpenGLFixedPipeline::BrainOpenGLFixedPipeline(BrainOpenGLTextRenderInterfac
     this->initializeMembersBrainOpenGL();
     this->colorIdentification   = new IdentificationWithColor();
     m_annotationDrawing.grabNew(new BrainOpenGLAnnotationDrawingFixedPipeline(this));
+    m_volumeSliceTextureCache.grabNew(new BrainOpenGLVolumeSliceTextureCache());
     
     m_shapeSphere = NULL;
     m_shapeCone   = NULL;
@@ -2341,6 +2344,11 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
 
 /**
  * Draw a surface triangles with vertex arrays.
+ *
+ * When drawing with vertex buffers, the surface's geometry and 
+ * coloring are kept in buffers owned by the surface and only 
+ * sent to OpenGL when they change.
+ *
  * @param surface
  *    Surface that is drawn.
  * @param nodeColoringRGBA
@@ -2350,6 +2358,21 @@ void
 BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* surface,
                                                                const float* nodeColoringRGBA)
 {
+#ifdef BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    if (BrainOpenGL::getBestDrawingMode() == BrainOpenGL::DRAW_MODE_VERTEX_BUFFERS) {
+        if (nodeColoringRGBA == NULL) {
+            glColor3fv(m_backgroundColorFloat);
+        }
+        
+        BrainOpenGLSurfaceBuffers* surfaceBuffers = surface->getOpenGLBuffers();
+        if (surfaceBuffers->drawTriangles(getContextSharingGroupPointer(),
+                                          surface,
+                                          nodeColoringRGBA)) {
+            return;
+        }
+    }
+#endif // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    
     glEnableClientState(GL_VERTEX_ARRAY);
     if (nodeColoringRGBA != NULL) {
         glEnableClientState(GL_COLOR_ARRAY);
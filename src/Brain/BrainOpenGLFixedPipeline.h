@@ -53,6 +53,7 @@ namespace caret {
     class BrainOpenGLShapeRing;
     class BrainOpenGLShapeRingOutline;
     class BrainOpenGLShapeSphere;
+    class BrainOpenGLVolumeSliceTextureCache;
     class BrainOpenGLViewportContent;
     class BrowserTabContent;
     class CaretMappableDataFile;
@@ -616,6 +617,9 @@ namespace caret {
         
         CaretPointer<BrainOpenGLAnnotationDrawingFixedPipeline> m_annotationDrawing;
         
+        /** Textures of volume slices, kept between redraws */
+        CaretPointer<BrainOpenGLVolumeSliceTextureCache> m_volumeSliceTextureCache;
+        
         std::vector<AnnotationColorBar*> m_annotationColorBarsForDrawing;
         
         /** Some graphics using annotations for some elements so user can select and edit them */
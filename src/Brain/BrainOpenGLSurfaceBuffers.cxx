@@ -0,0 +1,322 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __BRAIN_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+#include "BrainOpenGLSurfaceBuffers.h"
+#undef __BRAIN_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "EventGraphicsOpenGLCreateBufferObject.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLBufferObject.h"
+#include "Surface.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::BrainOpenGLSurfaceBuffers
+ * \brief OpenGL buffers containing a surface's geometry and coloring.
+ * \ingroup Brain
+ *
+ * Coordinates, normal vectors, and triangles are loaded into buffers
+ * on the graphics card and only loaded again when the surface's
+ * geometry changes.  Each node coloring (a surface has coloring
+ * for each tab and type of model) is loaded into its own buffer
+ * that is only loaded again when that tab's coloring changes.
+ * So, drawing an unchanged surface (such as when rotating) does not
+ * transfer any vertex data to the graphics card.
+ *
+ * Buffers are kept separately for each OpenGL context in which the
+ * surface is drawn, and are deleted within their OpenGL context by
+ * the GraphicsOpenGLBufferObject destructor.
+ */
+
+/**
+ * Constructor.
+ */
+BrainOpenGLSurfaceBuffers::BrainOpenGLSurfaceBuffers()
+: CaretObject()
+{
+}
+
+/**
+ * Destructor.
+ */
+BrainOpenGLSurfaceBuffers::~BrainOpenGLSurfaceBuffers()
+{
+    m_contextBuffers.clear();
+}
+
+/**
+ * Constructor for buffers in one context, nothing is loaded.
+ */
+BrainOpenGLSurfaceBuffers::ContextBuffers::ContextBuffers()
+{
+    m_numberOfTriangles      = 0;
+    m_geometryChangedCounter = -1;
+}
+
+/**
+ * Draw the surface's triangles using the buffers, loading
+ * any buffers that are not valid.  The caller sets up
+ * lighting, polygon mode, etc.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context (or its sharing group),
+ *     buffers are kept for each context.
+ * @param surface
+ *     Surface that is drawn, must be the surface that owns these buffers.
+ * @param nodeColoringRGBA
+ *     RGBA coloring for the nodes, from the surface's node coloring for
+ *     a tab.  If NULL, the current OpenGL color is used for all nodes.
+ * @return
+ *     True if the surface was drawn, false if buffers could not
+ *     be created in which case the caller must draw the surface
+ *     without buffers.
+ */
+bool
+BrainOpenGLSurfaceBuffers::drawTriangles(void* openglContextPointer,
+                                         const Surface* surface,
+                                         const float* nodeColoringRGBA)
+{
+    CaretAssert(surface);
+    CaretAssert(surface->getOpenGLBuffers() == this);
+
+    if ((surface->getNumberOfNodes() <= 0)
+        || (surface->getNumberOfTriangles() <= 0)) {
+        return true;
+    }
+
+    ContextBuffers& contextBuffers = m_contextBuffers[openglContextPointer];
+
+    if (contextBuffers.m_geometryChangedCounter != surface->getGeometryChangedCounter()) {
+        if ( ! loadGeometry(contextBuffers,
+                            surface)) {
+            m_contextBuffers.erase(openglContextPointer);
+            return false;
+        }
+    }
+
+    GLuint colorBufferName = 0;
+    if (nodeColoringRGBA != NULL) {
+        colorBufferName = getColorBuffer(contextBuffers,
+                                         surface,
+                                         nodeColoringRGBA);
+        if (colorBufferName == 0) {
+            return false;
+        }
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 contextBuffers.m_coordinateBufferObject->getBufferObjectName());
+    glVertexPointer(3,
+                    GL_FLOAT,
+                    0,
+                    (GLvoid*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 contextBuffers.m_normalVectorBufferObject->getBufferObjectName());
+    glNormalPointer(GL_FLOAT,
+                    0,
+                    (GLvoid*)0);
+
+    if (colorBufferName > 0) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     colorBufferName);
+        glColorPointer(4,
+                       GL_FLOAT,
+                       0,
+                       (GLvoid*)0);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 contextBuffers.m_triangleBufferObject->getBufferObjectName());
+    glDrawElements(GL_TRIANGLES,
+                   (3 * contextBuffers.m_numberOfTriangles),
+                   GL_UNSIGNED_INT,
+                   (GLvoid*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+    return true;
+}
+
+/**
+ * Load the coordinates, normal vectors, and triangles into their
+ * buffers, creating the buffers if needed.
+ *
+ * @param contextBuffers
+ *     Buffers for the active context.
+ * @param surface
+ *     Surface whose geometry is loaded.
+ * @return
+ *     True if the geometry was loaded, else false.
+ */
+bool
+BrainOpenGLSurfaceBuffers::loadGeometry(ContextBuffers& contextBuffers,
+                                        const Surface* surface)
+{
+    if (contextBuffers.m_coordinateBufferObject == NULL) {
+        contextBuffers.m_coordinateBufferObject.grabNew(createBufferObject());
+        contextBuffers.m_normalVectorBufferObject.grabNew(createBufferObject());
+        contextBuffers.m_triangleBufferObject.grabNew(createBufferObject());
+    }
+    if ((contextBuffers.m_coordinateBufferObject == NULL)
+        || (contextBuffers.m_normalVectorBufferObject == NULL)
+        || (contextBuffers.m_triangleBufferObject == NULL)) {
+        return false;
+    }
+
+    const int32_t numberOfNodes = surface->getNumberOfNodes();
+    contextBuffers.m_numberOfTriangles = surface->getNumberOfTriangles();
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 contextBuffers.m_coordinateBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 numberOfNodes * 3 * sizeof(GLfloat),
+                 surface->getCoordinate(0),
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 contextBuffers.m_normalVectorBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 numberOfNodes * 3 * sizeof(GLfloat),
+                 surface->getNormalVector(0),
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 contextBuffers.m_triangleBufferObject->getBufferObjectName());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 contextBuffers.m_numberOfTriangles * 3 * sizeof(GLuint),
+                 surface->getTriangle(0),
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    contextBuffers.m_geometryChangedCounter = surface->getGeometryChangedCounter();
+
+    return true;
+}
+
+/**
+ * Get the buffer containing the given node coloring, loading the
+ * coloring into a buffer if the coloring's tab has changed.
+ *
+ * @param contextBuffers
+ *     Buffers for the active context.
+ * @param surface
+ *     Surface that is drawn.
+ * @param nodeColoringRGBA
+ *     RGBA coloring for the nodes.
+ * @return
+ *     OpenGL name of buffer containing the coloring or zero if
+ *     a buffer could not be created.
+ */
+GLuint
+BrainOpenGLSurfaceBuffers::getColorBuffer(ContextBuffers& contextBuffers,
+                                          const Surface* surface,
+                                          const float* nodeColoringRGBA)
+{
+    const int64_t coloringCounter = surface->getNodeColoringChangedCounter(nodeColoringRGBA);
+
+    std::map<const float*, ColorBuffer>::iterator colorIter = contextBuffers.m_colorBuffers.find(nodeColoringRGBA);
+    if (colorIter != contextBuffers.m_colorBuffers.end()) {
+        if (colorIter->second.m_nodeColoringChangedCounter == coloringCounter) {
+            return colorIter->second.m_bufferObject->getBufferObjectName();
+        }
+    }
+
+    /*
+     * This tab's coloring has changed since its buffer was loaded.  Remove
+     * the buffers of any other tabs whose coloring has also changed, since
+     * their coloring memory may have been freed; buffers for coloring that
+     * is still used are loaded again when drawn.  Buffers of tabs whose
+     * coloring has not changed are kept.
+     */
+    std::map<const float*, ColorBuffer>::iterator iter = contextBuffers.m_colorBuffers.begin();
+    while (iter != contextBuffers.m_colorBuffers.end()) {
+        if ((iter->first != nodeColoringRGBA)
+            && (iter->second.m_nodeColoringChangedCounter != surface->getNodeColoringChangedCounter(iter->first))) {
+            contextBuffers.m_colorBuffers.erase(iter++);
+        }
+        else {
+            ++iter;
+        }
+    }
+
+    ColorBuffer& colorBuffer = contextBuffers.m_colorBuffers[nodeColoringRGBA];
+    if (colorBuffer.m_bufferObject == NULL) {
+        colorBuffer.m_bufferObject.grabNew(createBufferObject());
+        if (colorBuffer.m_bufferObject == NULL) {
+            contextBuffers.m_colorBuffers.erase(nodeColoringRGBA);
+            return 0;
+        }
+    }
+    colorBuffer.m_nodeColoringChangedCounter = coloringCounter;
+
+    const GLuint bufferName = colorBuffer.m_bufferObject->getBufferObjectName();
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 bufferName);
+    glBufferData(GL_ARRAY_BUFFER,
+                 surface->getNumberOfNodes() * 4 * sizeof(GLfloat),
+                 nodeColoringRGBA,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    return bufferName;
+}
+
+/**
+ * @return A new OpenGL buffer object or NULL if it could not be created.
+ */
+GraphicsOpenGLBufferObject*
+BrainOpenGLSurfaceBuffers::createBufferObject()
+{
+    EventGraphicsOpenGLCreateBufferObject createEvent;
+    EventManager::get()->sendEvent(createEvent.getPointer());
+    GraphicsOpenGLBufferObject* bufferObject = createEvent.getOpenGLBufferObject();
+    if (bufferObject == NULL) {
+        CaretLogSevere("Failed to create OpenGL buffer for surface: "
+                       + createEvent.getErrorMessage());
+    }
+
+    return bufferObject;
+}
+
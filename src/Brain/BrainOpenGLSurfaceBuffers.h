@@ -0,0 +1,109 @@
+#ifndef __BRAIN_OPEN_G_L_SURFACE_BUFFERS_H__
+#define __BRAIN_OPEN_G_L_SURFACE_BUFFERS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <map>
+#include <stdint.h>
+
+#include "CaretObject.h"
+#include "CaretOpenGLInclude.h"
+#include "CaretPointer.h"
+
+namespace caret {
+
+    class GraphicsOpenGLBufferObject;
+    class Surface;
+
+    class BrainOpenGLSurfaceBuffers : public CaretObject {
+
+    public:
+        BrainOpenGLSurfaceBuffers();
+
+        virtual ~BrainOpenGLSurfaceBuffers();
+
+        bool drawTriangles(void* openglContextPointer,
+                           const Surface* surface,
+                           const float* nodeColoringRGBA);
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        /** Buffer containing node coloring and the coloring counter when it was loaded */
+        struct ColorBuffer {
+            CaretPointer<GraphicsOpenGLBufferObject> m_bufferObject;
+
+            int64_t m_nodeColoringChangedCounter;
+        };
+
+        /** Buffers created in one OpenGL context */
+        struct ContextBuffers {
+            ContextBuffers();
+
+            CaretPointer<GraphicsOpenGLBufferObject> m_coordinateBufferObject;
+
+            CaretPointer<GraphicsOpenGLBufferObject> m_normalVectorBufferObject;
+
+            CaretPointer<GraphicsOpenGLBufferObject> m_triangleBufferObject;
+
+            /** Number of triangles in the triangle buffer */
+            int32_t m_numberOfTriangles;
+
+            /** Surface's geometry counter when geometry was loaded */
+            int64_t m_geometryChangedCounter;
+
+            /**
+             * Coloring buffers keyed by the surface's coloring (one for each
+             * tab and type of model) since a surface may be drawn in many tabs.
+             */
+            std::map<const float*, ColorBuffer> m_colorBuffers;
+        };
+
+        BrainOpenGLSurfaceBuffers(const BrainOpenGLSurfaceBuffers&);
+
+        BrainOpenGLSurfaceBuffers& operator=(const BrainOpenGLSurfaceBuffers&);
+
+        static bool loadGeometry(ContextBuffers& contextBuffers,
+                                 const Surface* surface);
+
+        static GLuint getColorBuffer(ContextBuffers& contextBuffers,
+                                     const Surface* surface,
+                                     const float* nodeColoringRGBA);
+
+        static GraphicsOpenGLBufferObject* createBufferObject();
+
+        /**
+         * Buffers keyed by the context (or context sharing group) in which
+         * they were created, so that drawing in one window does not
+         * discard the buffers used by another window.
+         */
+        std::map<void*, ContextBuffers> m_contextBuffers;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __BRAIN_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __BRAIN_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+
+} // namespace
+#endif  //__BRAIN_OPEN_G_L_SURFACE_BUFFERS_H__
@@ -871,6 +871,13 @@ BrainOpenGLVolumeObliqueSliceDrawing::drawVolumeSliceViewProjection(const Volume
 /**
  * Draw an oblique slice.
  *
+ * Unlike orthogonal slices, oblique slices are not drawn with cached
+ * textures.  Palette mapped volumes are colored from values that are
+ * interpolated at each sample, the layers are composited into one
+ * color per sample, and identification needs a quad for each sample.
+ * A texture of voxel colors sampled by OpenGL would not match this
+ * coloring.
+ *
  * @param sliceViewPlane
  *    The plane for slice drawing.
  * @param transformationMatrix
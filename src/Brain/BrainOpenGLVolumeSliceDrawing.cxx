@@ -32,6 +32,7 @@
 #include "BrainOpenGLAnnotationDrawingFixedPipeline.h"
 #include "BrainOpenGLPrimitiveDrawing.h"
 #include "BrainOpenGLViewportContent.h"
+#include "BrainOpenGLVolumeSliceTextureCache.h"
 #include "BrainordinateRegionOfInterest.h"
 #include "BrowserTabContent.h"
 #include "CaretAssert.h"
@@ -884,6 +885,13 @@ BrainOpenGLVolumeSliceDrawing::drawVolumeSliceViewProjection(const VolumeSliceDr
 /**
  * Draw an oblique slice.
  *
+ * Unlike orthogonal slices, oblique slices are not drawn with cached
+ * textures.  Palette mapped volumes are colored from values that are
+ * interpolated at each sample, the layers are composited into one
+ * color per sample, and identification needs a quad for each sample.
+ * A texture of voxel colors sampled by OpenGL would not match this
+ * coloring.
+ *
  * @param sliceViewPlane
  *    The plane for slice drawing.
  * @param transformationMatrix
@@ -2490,6 +2498,64 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSlice(const VolumeSliceViewPlaneEnu
         startCoordinateXYZ[drawBottomToTopInfo.indexIntoXYZ] -= (drawBottomToTopInfo.voxelStepSize / 2.0);
         startCoordinateXYZ[viewPlaneDimIndex] = selectedSliceCoordinate;
         
+        const uint8_t volumeDrawingOpacity = static_cast<uint8_t>(volInfo.opacity * 255.0);
+        
+        if (m_modelWholeBrain != NULL) {
+            /*
+             * After the a slice is drawn in ALL view, some layers
+             * (volume surface outline) may be drawn in lines.  As the
+             * view is rotated, lines will partially appear and disappear
+             * due to the lines having the same (extremely close) depth
+             * values as the voxel polygons.  OpenGL's Polygon Offset
+             * only works with polygons and NOT with lines or points.
+             * So, polygon offset cannot be used to move the depth
+             * values for the lines and points "a little closer" to
+             * the user.  Instead, polygon offset is used to push
+             * the underlaying slices "a little bit away" from the
+             * user.
+             *
+             * Resolves WB-414
+             */
+            const float inverseSliceIndex = numberOfVolumesToDraw - iVol;
+            const float factor  = inverseSliceIndex * 1.0 + 1.0;
+            const float units  = inverseSliceIndex * 1.0 + 1.0;
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(factor, units);
+        }
+        
+        /*
+         * When the slice's texture contains the current coloring,
+         * draw it without coloring the slice.
+         */
+        if (isOrthogonalSliceTextureDrawingAvailable(drawLeftToRightInfo.numberOfVoxels,
+                                                     drawBottomToTopInfo.numberOfVoxels)) {
+            const BrainOpenGLVolumeSliceTextureCache::SliceKey sliceKey = createSliceTextureKey(startCoordinateXYZ,
+                                                                                              rowStepXYZ,
+                                                                                              columnStepXYZ,
+                                                                                              drawLeftToRightInfo.numberOfVoxels,
+                                                                                              drawBottomToTopInfo.numberOfVoxels,
+                                                                                              volumeFile,
+                                                                                              iVol,
+                                                                                              volInfo.mapIndex,
+                                                                                              volumeDrawingOpacity);
+            GLuint textureName = 0;
+            if (m_fixedPipelineDrawing->m_volumeSliceTextureCache->getTextureForSlice(sliceKey,
+                                                                                      volumeFile->getVoxelColoringChangedCounter(volInfo.mapIndex),
+                                                                                      textureName)) {
+                if (textureName != 0) {
+                    drawOrthogonalSliceTextureQuad(sliceNormalVector,
+                                                   startCoordinateXYZ,
+                                                   rowStepXYZ,
+                                                   columnStepXYZ,
+                                                   drawLeftToRightInfo.numberOfVoxels,
+                                                   drawBottomToTopInfo.numberOfVoxels,
+                                                   textureName);
+                }
+                glDisable(GL_POLYGON_OFFSET_FILL);
+                continue;
+            }
+        }
+        
         /*
          * Stores RGBA values for each voxel.
          * Use a vector for voxel colors so no worries about memory being freed.
@@ -2538,31 +2604,6 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSlice(const VolumeSliceViewPlaneEnu
                                                                     ydim);
         }
         
-        const uint8_t volumeDrawingOpacity = static_cast<uint8_t>(volInfo.opacity * 255.0);
-        
-        if (m_modelWholeBrain != NULL) {
-            /*
-             * After the a slice is drawn in ALL view, some layers
-             * (volume surface outline) may be drawn in lines.  As the
-             * view is rotated, lines will partially appear and disappear
-             * due to the lines having the same (extremely close) depth
-             * values as the voxel polygons.  OpenGL's Polygon Offset
-             * only works with polygons and NOT with lines or points.
-             * So, polygon offset cannot be used to move the depth
-             * values for the lines and points "a little closer" to
-             * the user.  Instead, polygon offset is used to push
-             * the underlaying slices "a little bit away" from the
-             * user.
-             *
-             * Resolves WB-414
-             */
-            const float inverseSliceIndex = numberOfVolumesToDraw - iVol;
-            const float factor  = inverseSliceIndex * 1.0 + 1.0;
-            const float units  = inverseSliceIndex * 1.0 + 1.0;
-            glEnable(GL_POLYGON_OFFSET_FILL);
-            glPolygonOffset(factor, units);
-        }
-        
         /*
          * Draw the voxels in the slice.
          */
@@ -4736,6 +4777,29 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxels(const float sliceNormal
                                                          const int32_t mapIndex,
                                                          const uint8_t sliceOpacity)
 {
+    /*
+     * Identification requires that each voxel is drawn
+     * as a quad with the voxel's identification color.
+     * Otherwise, the slice is drawn as a single textured quad.
+     */
+    if (isOrthogonalSliceTextureDrawingAvailable(numberOfColumns,
+                                                 numberOfRows)) {
+        if (drawOrthogonalSliceVoxelsTexture(sliceNormalVector,
+                                             coordinate,
+                                             rowStep,
+                                             columnStep,
+                                             numberOfColumns,
+                                             numberOfRows,
+                                             sliceRGBA,
+                                             validVoxelCount,
+                                             volumeInterface,
+                                             volumeIndex,
+                                             mapIndex,
+                                             sliceOpacity)) {
+            return;
+        }
+    }
+    
     if (validVoxelCount <= 0) {
         return;
     }
@@ -4815,6 +4879,278 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxels(const float sliceNormal
     
 }
 
+/**
+ * Is drawing an orthogonal slice as a textured quad available?
+ *
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @return
+ *    True if not identifying and the slice fits in a texture, else false.
+ */
+bool
+BrainOpenGLVolumeSliceDrawing::isOrthogonalSliceTextureDrawingAvailable(const int64_t numberOfColumns,
+                                                                        const int64_t numberOfRows) const
+{
+    if (m_identificationModeFlag) {
+        return false;
+    }
+    
+    if ((numberOfColumns <= 0)
+        || (numberOfRows <= 0)) {
+        return false;
+    }
+    
+    GLint maximumTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maximumTextureSize);
+    if ((numberOfColumns > maximumTextureSize)
+        || (numberOfRows > maximumTextureSize)) {
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Create the key identifying an orthogonal slice in the texture cache.
+ *
+ * @param coordinate
+ *    Coordinate of first voxel in the slice (bottom left as begin viewed)
+ * @param rowStep
+ *    Three-dimensional step to next row.
+ * @param columnStep
+ *    Three-dimensional step to next column.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param volumeInterface
+ *    The volume being drawn.
+ * @param volumeIndex
+ *    Index of the volume being drawn.
+ * @param mapIndex
+ *    Selected map in the volume being drawn.
+ * @param sliceOpacity
+ *    Opacity from the overlay.
+ * @return
+ *    Key for the slice.
+ */
+BrainOpenGLVolumeSliceTextureCache::SliceKey
+BrainOpenGLVolumeSliceDrawing::createSliceTextureKey(const float coordinate[3],
+                                                     const float rowStep[3],
+                                                     const float columnStep[3],
+                                                     const int64_t numberOfColumns,
+                                                     const int64_t numberOfRows,
+                                                     const VolumeMappableInterface* volumeInterface,
+                                                     const int32_t volumeIndex,
+                                                     const int32_t mapIndex,
+                                                     const uint8_t sliceOpacity) const
+{
+    const int32_t browserTabIndex = m_browserTabContent->getTabNumber();
+    const DisplayGroupEnum::Enum displayGroup = m_brain->getDisplayPropertiesLabels()->getDisplayGroupForTab(browserTabIndex);
+    
+    return BrainOpenGLVolumeSliceTextureCache::SliceKey(m_fixedPipelineDrawing->getContextSharingGroupPointer(),
+                                                        volumeInterface,
+                                                        mapIndex,
+                                                        m_fixedPipelineDrawing->windowTabIndex,
+                                                        displayGroup,
+                                                        volumeIndex,
+                                                        sliceOpacity,
+                                                        coordinate,
+                                                        rowStep,
+                                                        columnStep,
+                                                        numberOfColumns,
+                                                        numberOfRows);
+}
+
+/**
+ * Draw the voxels in an orthogonal slice as a single quad
+ * containing a texture with the voxel coloring.
+ *
+ * The texture is kept by the fixed pipeline drawing between
+ * redraws along with the volume's coloring counter so that,
+ * until the coloring changes, drawOrthogonalSlice() draws the
+ * texture without coloring the slice.  Voxels that are not
+ * displayed are transparent in the texture and are removed with
+ * the alpha test so that, like voxels that are not drawn as quads,
+ * they do not affect the depth buffer.
+ *
+ * @param sliceNormalVector
+ *    Normal vector of the slice plane.
+ * @param coordinate
+ *    Coordinate of first voxel in the slice (bottom left as begin viewed)
+ * @param rowStep
+ *    Three-dimensional step to next row.
+ * @param columnStep
+ *    Three-dimensional step to next column.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param sliceRGBA
+ *    RGBA coloring for voxels in the slice.
+ * @param validVoxelCount
+ *    Number of voxels with valid coloring
+ * @param volumeInterface
+ *    The volume being drawn.
+ * @param volumeIndex
+ *    Index of the volume being drawn.
+ * @param mapIndex
+ *    Selected map in the volume being drawn.
+ * @param sliceOpacity
+ *    Opacity from the overlay.
+ * @return
+ *    True if the slice was drawn, false if the slice must
+ *    be drawn with quads (texture unavailable).
+ */
+bool
+BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxelsTexture(const float sliceNormalVector[3],
+                                                                const float coordinate[3],
+                                                                const float rowStep[3],
+                                                                const float columnStep[3],
+                                                                const int64_t numberOfColumns,
+                                                                const int64_t numberOfRows,
+                                                                const std::vector<uint8_t>& sliceRGBA,
+                                                                const int64_t validVoxelCount,
+                                                                const VolumeMappableInterface* volumeInterface,
+                                                                const int32_t volumeIndex,
+                                                                const int32_t mapIndex,
+                                                                const uint8_t sliceOpacity)
+{
+    const BrainOpenGLVolumeSliceTextureCache::SliceKey sliceKey = createSliceTextureKey(coordinate,
+                                                                                      rowStep,
+                                                                                      columnStep,
+                                                                                      numberOfColumns,
+                                                                                      numberOfRows,
+                                                                                      volumeInterface,
+                                                                                      volumeIndex,
+                                                                                      mapIndex,
+                                                                                      sliceOpacity);
+    BrainOpenGLVolumeSliceTextureCache* textureCache = m_fixedPipelineDrawing->m_volumeSliceTextureCache;
+    
+    /*
+     * Counter is read after the slice was colored since coloring
+     * may update the volume's coloring.
+     */
+    const int64_t coloringChangedCounter = volumeInterface->getVoxelColoringChangedCounter(mapIndex);
+    
+    GLuint textureName = 0;
+    if ( ! textureCache->getTextureForSlice(sliceKey,
+                                            coloringChangedCounter,
+                                            textureName)) {
+        /*
+         * Same coloring as when voxels are drawn with quads:
+         * voxels that are not displayed are transparent and
+         * displayed voxels use the overlay's opacity.  When no
+         * voxels are displayed, an empty texture is cached so
+         * that the slice is not colored again.
+         */
+        std::vector<uint8_t> textureRGBA;
+        if (validVoxelCount > 0) {
+            const int64_t numVoxelsInSlice = numberOfColumns * numberOfRows;
+            CaretAssert(static_cast<int64_t>(sliceRGBA.size()) >= (numVoxelsInSlice * 4));
+            textureRGBA.resize(numVoxelsInSlice * 4, 0);
+            for (int64_t i = 0; i < numVoxelsInSlice; i++) {
+                const int64_t offset = i * 4;
+                if (sliceRGBA[offset + 3] > 0) {
+                    textureRGBA[offset]     = sliceRGBA[offset];
+                    textureRGBA[offset + 1] = sliceRGBA[offset + 1];
+                    textureRGBA[offset + 2] = sliceRGBA[offset + 2];
+                    textureRGBA[offset + 3] = sliceOpacity;
+                }
+            }
+        }
+        
+        if ( ! textureCache->loadTextureForSlice(sliceKey,
+                                                 coloringChangedCounter,
+                                                 textureRGBA,
+                                                 textureName)) {
+            return false;
+        }
+    }
+    
+    if (textureName != 0) {
+        drawOrthogonalSliceTextureQuad(sliceNormalVector,
+                                       coordinate,
+                                       rowStep,
+                                       columnStep,
+                                       numberOfColumns,
+                                       numberOfRows,
+                                       textureName);
+    }
+    
+    return true;
+}
+
+/**
+ * Draw an orthogonal slice's texture on a single quad.
+ *
+ * @param sliceNormalVector
+ *    Normal vector of the slice plane.
+ * @param coordinate
+ *    Coordinate of first voxel in the slice (bottom left as begin viewed)
+ * @param rowStep
+ *    Three-dimensional step to next row.
+ * @param columnStep
+ *    Three-dimensional step to next column.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param textureName
+ *    OpenGL texture name containing the slice's coloring.
+ */
+void
+BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceTextureQuad(const float sliceNormalVector[3],
+                                                              const float coordinate[3],
+                                                              const float rowStep[3],
+                                                              const float columnStep[3],
+                                                              const int64_t numberOfColumns,
+                                                              const int64_t numberOfRows,
+                                                              const GLuint textureName)
+{
+    /*
+     * Corners of the slice
+     */
+    float bottomLeft[3];
+    float bottomRight[3];
+    float topRight[3];
+    float topLeft[3];
+    for (int32_t i = 0; i < 3; i++) {
+        bottomLeft[i]  = coordinate[i];
+        bottomRight[i] = coordinate[i] + (numberOfColumns * columnStep[i]);
+        topLeft[i]     = coordinate[i] + (numberOfRows * rowStep[i]);
+        topRight[i]    = bottomRight[i] + (numberOfRows * rowStep[i]);
+    }
+    
+    glPushAttrib(GL_COLOR_BUFFER_BIT
+                 | GL_ENABLE_BIT
+                 | GL_TEXTURE_BIT);
+    
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.0);
+    
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBindTexture(GL_TEXTURE_2D, textureName);
+    
+    glBegin(GL_QUADS);
+    glNormal3fv(sliceNormalVector);
+    glTexCoord2f(0.0, 0.0);
+    glVertex3fv(bottomLeft);
+    glTexCoord2f(1.0, 0.0);
+    glVertex3fv(bottomRight);
+    glTexCoord2f(1.0, 1.0);
+    glVertex3fv(topRight);
+    glTexCoord2f(0.0, 1.0);
+    glVertex3fv(topLeft);
+    glEnd();
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPopAttrib();
+}
+
 /**
  * Draw the voxels in an orthogonal slice with single quads.
  *
@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include "BrainOpenGLFixedPipeline.h"
+#include "BrainOpenGLVolumeSliceTextureCache.h"
 #include "CaretObject.h"
 #include "DisplayGroupEnum.h"
 #include "VolumeSliceProjectionTypeEnum.h"
@@ -271,6 +272,40 @@ namespace caret {
                                        const int32_t mapIndex,
                                        const uint8_t sliceOpacity);
         
+        bool isOrthogonalSliceTextureDrawingAvailable(const int64_t numberOfColumns,
+                                                      const int64_t numberOfRows) const;
+        
+        BrainOpenGLVolumeSliceTextureCache::SliceKey createSliceTextureKey(const float coordinate[3],
+                                                                           const float rowStep[3],
+                                                                           const float columnStep[3],
+                                                                           const int64_t numberOfColumns,
+                                                                           const int64_t numberOfRows,
+                                                                           const VolumeMappableInterface* volumeInterface,
+                                                                           const int32_t volumeIndex,
+                                                                           const int32_t mapIndex,
+                                                                           const uint8_t sliceOpacity) const;
+        
+        bool drawOrthogonalSliceVoxelsTexture(const float sliceNormalVector[3],
+                                              const float coordinate[3],
+                                              const float rowStep[3],
+                                              const float columnStep[3],
+                                              const int64_t numberOfColumns,
+                                              const int64_t numberOfRows,
+                                              const std::vector<uint8_t>& sliceRGBA,
+                                              const int64_t validVoxelCount,
+                                              const VolumeMappableInterface* volumeInterface,
+                                              const int32_t volumeIndex,
+                                              const int32_t mapIndex,
+                                              const uint8_t sliceOpacity);
+        
+        void drawOrthogonalSliceTextureQuad(const float sliceNormalVector[3],
+                                            const float coordinate[3],
+                                            const float rowStep[3],
+                                            const float columnStep[3],
+                                            const int64_t numberOfColumns,
+                                            const int64_t numberOfRows,
+                                            const GLuint textureName);
+        
         void drawOrthogonalSliceVoxelsSingleQuads(const float sliceNormalVector[3],
                                        const float coordinate[3],
                                        const float rowStep[3],
@@ -0,0 +1,502 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+#include "BrainOpenGLVolumeSliceTextureCache.h"
+#undef __BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+
+#include "CaretAssert.h"
+#include "CaretDataFile.h"
+#include "CaretLogger.h"
+#include "EventDataFileDelete.h"
+#include "EventGraphicsOpenGLCreateTextureName.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLTextureName.h"
+#include "VolumeMappableInterface.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::BrainOpenGLVolumeSliceTextureCache
+ * \brief Caches OpenGL textures containing the coloring of volume slices.
+ * \ingroup Brain
+ *
+ * Drawing a slice as one textured quadrilateral is much faster than
+ * drawing a quadrilateral for each voxel.  Each texture records the
+ * volume's voxel coloring counter (VolumeMappableInterface::
+ * getVoxelColoringChangedCounter()) at the time it was loaded.  While
+ * the counter is unchanged the texture is drawn without coloring the
+ * slice again.  Changes to display groups, label display, and other
+ * coloring that is applied while the slice is colored are signaled by
+ * the surface coloring invalidate event, which marks all textures so
+ * that their coloring is reloaded, keeping the texture names for reuse.
+ *
+ * Textures for a file are removed when the file is deleted.  When the
+ * number of textures reaches a limit, the least recently used texture
+ * is removed.
+ *
+ * Only orthogonal slices are cached.  Oblique slices are colored from
+ * values interpolated at each sample and composited across layers so
+ * they are not drawn from this cache.
+ */
+
+/**
+ * Constructor.
+ */
+BrainOpenGLVolumeSliceTextureCache::BrainOpenGLVolumeSliceTextureCache()
+: CaretObject()
+{
+    m_useCounter = 0;
+
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_DATA_FILE_DELETE);
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
+}
+
+/**
+ * Destructor.
+ */
+BrainOpenGLVolumeSliceTextureCache::~BrainOpenGLVolumeSliceTextureCache()
+{
+    EventManager::get()->removeAllEventsFromListener(this);
+
+    clear();
+}
+
+/**
+ * Remove all textures.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::clear()
+{
+    m_sliceTextures.clear();
+}
+
+/**
+ * Receive an event.
+ *
+ * @param event
+ *    An event for which this instance is listening.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::receiveEvent(Event* event)
+{
+    if (event->getEventType() == EventTypeEnum::EVENT_DATA_FILE_DELETE) {
+        EventDataFileDelete* deleteEvent = dynamic_cast<EventDataFileDelete*>(event);
+        CaretAssert(deleteEvent);
+
+        /*
+         * File may have been deleted by another listener so
+         * only its address is used.
+         */
+        removeTexturesForDataFile(deleteEvent->getCaretDataFile());
+    }
+    else if (event->getEventType() == EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE) {
+        for (SliceTextureMap::iterator iter = m_sliceTextures.begin();
+             iter != m_sliceTextures.end();
+             iter++) {
+            iter->second->m_coloringChangedCounter = -1;
+        }
+    }
+}
+
+/**
+ * Get the texture for a slice if the coloring in the texture is current.
+ *
+ * @param sliceKey
+ *     Identifies the slice.
+ * @param coloringChangedCounter
+ *     Current value of the volume's voxel coloring counter.  A negative
+ *     value indicates the coloring is not valid and is never current.
+ * @param textureNameOut
+ *     Output containing the OpenGL texture name, zero if no voxels
+ *     in the slice are displayed.
+ * @return
+ *     True if the texture is current and may be drawn without coloring
+ *     the slice, else false and the slice must be colored and loaded
+ *     with loadTextureForSlice().
+ */
+bool
+BrainOpenGLVolumeSliceTextureCache::getTextureForSlice(const SliceKey& sliceKey,
+                                                       const int64_t coloringChangedCounter,
+                                                       GLuint& textureNameOut)
+{
+    textureNameOut = 0;
+
+    if (coloringChangedCounter < 0) {
+        return false;
+    }
+
+    SliceTextureMap::iterator iter = m_sliceTextures.find(sliceKey);
+    if (iter == m_sliceTextures.end()) {
+        return false;
+    }
+
+    SliceTexture* sliceTexture = iter->second;
+    if (sliceTexture->m_coloringChangedCounter != coloringChangedCounter) {
+        return false;
+    }
+
+    m_useCounter++;
+    sliceTexture->m_lastUsedCounter = m_useCounter;
+
+    if (sliceTexture->m_textureName != NULL) {
+        textureNameOut = sliceTexture->m_textureName->getTextureName();
+    }
+
+    return true;
+}
+
+/**
+ * Load the coloring of a slice into its texture.  The OpenGL context
+ * identified in the key must be current.
+ *
+ * @param sliceKey
+ *     Identifies the slice.
+ * @param coloringChangedCounter
+ *     Value of the volume's voxel coloring counter when the slice was
+ *     colored.  If negative, the texture is loaded but is never current.
+ * @param textureRGBA
+ *     Coloring for the slice, 'number of columns' by 'number of rows'
+ *     RGBA values with the first row at the bottom.  Empty if no voxels
+ *     in the slice are displayed.
+ * @param textureNameOut
+ *     Output containing the OpenGL texture name, zero if no voxels
+ *     in the slice are displayed.
+ * @return
+ *     True if successful, else false.
+ */
+bool
+BrainOpenGLVolumeSliceTextureCache::loadTextureForSlice(const SliceKey& sliceKey,
+                                                        const int64_t coloringChangedCounter,
+                                                        const std::vector<uint8_t>& textureRGBA,
+                                                        GLuint& textureNameOut)
+{
+    CaretAssert(textureRGBA.empty()
+                || (static_cast<int64_t>(textureRGBA.size()) == (sliceKey.m_numberOfColumns
+                                                                 * sliceKey.m_numberOfRows
+                                                                 * 4)));
+
+    textureNameOut = 0;
+
+    SliceTexture* sliceTexture = NULL;
+    SliceTextureMap::iterator iter = m_sliceTextures.find(sliceKey);
+    if (iter != m_sliceTextures.end()) {
+        sliceTexture = iter->second;
+    }
+    else {
+        if (static_cast<int32_t>(m_sliceTextures.size()) >= s_maximumNumberOfTextures) {
+            removeLeastRecentlyUsedTexture();
+        }
+
+        sliceTexture = new SliceTexture();
+        sliceTexture->m_dataFile = dynamic_cast<const CaretDataFile*>(sliceKey.m_volumeInterface);
+        m_sliceTextures.insert(std::make_pair(sliceKey,
+                                              CaretPointer<SliceTexture>(sliceTexture)));
+    }
+
+    m_useCounter++;
+    sliceTexture->m_lastUsedCounter = m_useCounter;
+    sliceTexture->m_coloringChangedCounter = -1;
+
+    if ( ! textureRGBA.empty()) {
+        if ( ! loadTexture(sliceKey,
+                           sliceTexture,
+                           textureRGBA)) {
+            return false;
+        }
+        CaretAssert(sliceTexture->m_textureName);
+        textureNameOut = sliceTexture->m_textureName->getTextureName();
+    }
+    else if (sliceTexture->m_textureName != NULL) {
+        /*
+         * Nothing displayed so texture is not needed
+         */
+        delete sliceTexture->m_textureName;
+        sliceTexture->m_textureName = NULL;
+    }
+
+    sliceTexture->m_coloringChangedCounter = coloringChangedCounter;
+
+    return true;
+}
+
+/**
+ * Load coloring into the slice's texture, creating the texture if needed.
+ *
+ * @param sliceKey
+ *     Identifies the slice.
+ * @param sliceTexture
+ *     The slice texture.
+ * @param textureRGBA
+ *     Coloring for the slice.
+ * @return
+ *     True if the texture was loaded, else false.
+ */
+bool
+BrainOpenGLVolumeSliceTextureCache::loadTexture(const SliceKey& sliceKey,
+                                                SliceTexture* sliceTexture,
+                                                const std::vector<uint8_t>& textureRGBA)
+{
+    CaretAssert(sliceTexture);
+
+    if (sliceTexture->m_textureName == NULL) {
+        EventGraphicsOpenGLCreateTextureName createEvent;
+        EventManager::get()->sendEvent(createEvent.getPointer());
+        sliceTexture->m_textureName = createEvent.getOpenGLTextureName();
+        if (sliceTexture->m_textureName == NULL) {
+            CaretLogSevere("Failed to create texture for volume slice: "
+                           + createEvent.getErrorMessage());
+            return false;
+        }
+    }
+
+    /*
+     * Clear any previous error so that only an error from loading
+     * the texture is reported.
+     */
+    glGetError();
+
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glBindTexture(GL_TEXTURE_2D,
+                  sliceTexture->m_textureName->getTextureName());
+
+    /*
+     * Nearest filtering so that each voxel is drawn as a
+     * solid square, identical to drawing a quad for each voxel.
+     */
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glTexImage2D(GL_TEXTURE_2D,     // MUST BE GL_TEXTURE_2D
+                 0,                 // level of detail 0=base, n is nth mipmap reduction
+                 GL_RGBA,           // number of components
+                 sliceKey.m_numberOfColumns,  // width of image
+                 sliceKey.m_numberOfRows,     // height of image
+                 0,                 // border
+                 GL_RGBA,           // format of the pixel data
+                 GL_UNSIGNED_BYTE,  // data type of pixel data
+                 &textureRGBA[0]);  // pointer to image data
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPopClientAttrib();
+
+    const GLenum errorCode = glGetError();
+    if (errorCode != GL_NO_ERROR) {
+        const GLubyte* errorChars = gluErrorString(errorCode);
+        AString errorText("ERROR loading texture for volume slice");
+        if (errorChars != NULL) {
+            errorText.append(": " + AString((char*)errorChars));
+        }
+        CaretLogSevere(errorText);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Remove the texture that was used least recently.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::removeLeastRecentlyUsedTexture()
+{
+    if (m_sliceTextures.empty()) {
+        return;
+    }
+
+    SliceTextureMap::iterator oldestIter = m_sliceTextures.begin();
+    for (SliceTextureMap::iterator iter = m_sliceTextures.begin();
+         iter != m_sliceTextures.end();
+         iter++) {
+        if (iter->second->m_lastUsedCounter < oldestIter->second->m_lastUsedCounter) {
+            oldestIter = iter;
+        }
+    }
+    m_sliceTextures.erase(oldestIter);
+}
+
+/**
+ * Remove all textures for a data file.
+ *
+ * @param dataFile
+ *     The data file.  It may have been deleted so it is not dereferenced.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::removeTexturesForDataFile(const CaretDataFile* dataFile)
+{
+    if (dataFile == NULL) {
+        return;
+    }
+
+    SliceTextureMap::iterator iter = m_sliceTextures.begin();
+    while (iter != m_sliceTextures.end()) {
+        if (iter->second->m_dataFile == dataFile) {
+            m_sliceTextures.erase(iter++);
+        }
+        else {
+            iter++;
+        }
+    }
+}
+
+/**
+ * Constructor.
+ *
+ * @param openglContextPointer
+ *     OpenGL context in which the slice is drawn.
+ * @param volumeInterface
+ *     Volume that is drawn.
+ * @param mapIndex
+ *     Index of map in the volume.
+ * @param tabIndex
+ *     Index of tab in which slice is drawn.
+ * @param displayGroup
+ *     Display group selected in the tab.
+ * @param layerIndex
+ *     Index of layer in which the volume is drawn.
+ * @param opacity
+ *     Opacity of the layer.
+ * @param firstVoxelXYZ
+ *     Coordinate of the first voxel in the slice.
+ * @param rowStep
+ *     Three-dimensional step to next row.
+ * @param columnStep
+ *     Three-dimensional step to next column.
+ * @param numberOfColumns
+ *     Number of columns in the slice.
+ * @param numberOfRows
+ *     Number of rows in the slice.
+ */
+BrainOpenGLVolumeSliceTextureCache::SliceKey::SliceKey(const void* openglContextPointer,
+                                                       const VolumeMappableInterface* volumeInterface,
+                                                       const int32_t mapIndex,
+                                                       const int32_t tabIndex,
+                                                       const DisplayGroupEnum::Enum displayGroup,
+                                                       const int32_t layerIndex,
+                                                       const uint8_t opacity,
+                                                       const float firstVoxelXYZ[3],
+                                                       const float rowStep[3],
+                                                       const float columnStep[3],
+                                                       const int64_t numberOfColumns,
+                                                       const int64_t numberOfRows)
+: m_openglContextPointer(openglContextPointer),
+m_volumeInterface(volumeInterface),
+m_mapIndex(mapIndex),
+m_tabIndex(tabIndex),
+m_displayGroup(displayGroup),
+m_layerIndex(layerIndex),
+m_opacity(opacity),
+m_numberOfColumns(numberOfColumns),
+m_numberOfRows(numberOfRows)
+{
+    for (int32_t i = 0; i < 3; i++) {
+        m_firstVoxelXYZ[i] = firstVoxelXYZ[i];
+        m_rowStep[i]       = rowStep[i];
+        m_columnStep[i]    = columnStep[i];
+    }
+}
+
+/**
+ * Less than operator for ordering keys in the cache.
+ *
+ * @param rhs
+ *     Key compared to this key.
+ * @return
+ *     True if this key is ordered before the other key, else false.
+ */
+bool
+BrainOpenGLVolumeSliceTextureCache::SliceKey::operator<(const SliceKey& rhs) const
+{
+    if (m_openglContextPointer != rhs.m_openglContextPointer) {
+        return (m_openglContextPointer < rhs.m_openglContextPointer);
+    }
+    if (m_volumeInterface != rhs.m_volumeInterface) {
+        return (m_volumeInterface < rhs.m_volumeInterface);
+    }
+    if (m_mapIndex != rhs.m_mapIndex) {
+        return (m_mapIndex < rhs.m_mapIndex);
+    }
+    if (m_tabIndex != rhs.m_tabIndex) {
+        return (m_tabIndex < rhs.m_tabIndex);
+    }
+    if (m_displayGroup != rhs.m_displayGroup) {
+        return (m_displayGroup < rhs.m_displayGroup);
+    }
+    if (m_layerIndex != rhs.m_layerIndex) {
+        return (m_layerIndex < rhs.m_layerIndex);
+    }
+    if (m_opacity != rhs.m_opacity) {
+        return (m_opacity < rhs.m_opacity);
+    }
+    if (m_numberOfColumns != rhs.m_numberOfColumns) {
+        return (m_numberOfColumns < rhs.m_numberOfColumns);
+    }
+    if (m_numberOfRows != rhs.m_numberOfRows) {
+        return (m_numberOfRows < rhs.m_numberOfRows);
+    }
+
+    for (int32_t i = 0; i < 3; i++) {
+        if (m_firstVoxelXYZ[i] != rhs.m_firstVoxelXYZ[i]) {
+            return (m_firstVoxelXYZ[i] < rhs.m_firstVoxelXYZ[i]);
+        }
+        if (m_rowStep[i] != rhs.m_rowStep[i]) {
+            return (m_rowStep[i] < rhs.m_rowStep[i]);
+        }
+        if (m_columnStep[i] != rhs.m_columnStep[i]) {
+            return (m_columnStep[i] < rhs.m_columnStep[i]);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Constructor.
+ */
+BrainOpenGLVolumeSliceTextureCache::SliceTexture::SliceTexture()
+: m_textureName(NULL),
+m_dataFile(NULL),
+m_coloringChangedCounter(-1),
+m_lastUsedCounter(0)
+{
+}
+
+/**
+ * Destructor.
+ */
+BrainOpenGLVolumeSliceTextureCache::SliceTexture::~SliceTexture()
+{
+    /*
+     * Destructor of texture name requests deletion of
+     * the texture within its OpenGL context.
+     */
+    if (m_textureName != NULL) {
+        delete m_textureName;
+        m_textureName = NULL;
+    }
+}
+
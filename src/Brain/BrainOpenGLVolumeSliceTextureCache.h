@@ -0,0 +1,167 @@
+#ifndef __BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_H__
+#define __BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include "CaretObject.h"
+#include "CaretOpenGLInclude.h"
+#include "CaretPointer.h"
+#include "DisplayGroupEnum.h"
+#include "EventListenerInterface.h"
+
+namespace caret {
+
+    class CaretDataFile;
+    class GraphicsOpenGLTextureName;
+    class VolumeMappableInterface;
+
+    class BrainOpenGLVolumeSliceTextureCache : public CaretObject, public EventListenerInterface {
+
+    public:
+        /**
+         * Identifies a slice drawn as a texture.  A slice is identified
+         * by its volume and map, the tab, display group, and layer in
+         * which it is drawn, the layer's opacity, and its position and
+         * orientation in the slice plane.
+         */
+        class SliceKey {
+        public:
+            SliceKey(const void* openglContextPointer,
+                     const VolumeMappableInterface* volumeInterface,
+                     const int32_t mapIndex,
+                     const int32_t tabIndex,
+                     const DisplayGroupEnum::Enum displayGroup,
+                     const int32_t layerIndex,
+                     const uint8_t opacity,
+                     const float firstVoxelXYZ[3],
+                     const float rowStep[3],
+                     const float columnStep[3],
+                     const int64_t numberOfColumns,
+                     const int64_t numberOfRows);
+
+            bool operator<(const SliceKey& rhs) const;
+
+            const void* m_openglContextPointer;
+
+            const VolumeMappableInterface* m_volumeInterface;
+
+            int32_t m_mapIndex;
+
+            int32_t m_tabIndex;
+
+            DisplayGroupEnum::Enum m_displayGroup;
+
+            int32_t m_layerIndex;
+
+            uint8_t m_opacity;
+
+            float m_firstVoxelXYZ[3];
+
+            float m_rowStep[3];
+
+            float m_columnStep[3];
+
+            int64_t m_numberOfColumns;
+
+            int64_t m_numberOfRows;
+        };
+
+        BrainOpenGLVolumeSliceTextureCache();
+
+        virtual ~BrainOpenGLVolumeSliceTextureCache();
+
+        bool getTextureForSlice(const SliceKey& sliceKey,
+                                const int64_t coloringChangedCounter,
+                                GLuint& textureNameOut);
+
+        bool loadTextureForSlice(const SliceKey& sliceKey,
+                                 const int64_t coloringChangedCounter,
+                                 const std::vector<uint8_t>& textureRGBA,
+                                 GLuint& textureNameOut);
+
+        void clear();
+
+        virtual void receiveEvent(Event* event);
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        /** A texture and the coloring counter of the coloring loaded into it */
+        class SliceTexture {
+        public:
+            SliceTexture();
+
+            ~SliceTexture();
+
+            /**
+             * OpenGL texture name, deleted in its context when this is deleted.
+             * NULL if no voxels in the slice are displayed.
+             */
+            GraphicsOpenGLTextureName* m_textureName;
+
+            /** File containing the volume, compared by address when a file is deleted */
+            const CaretDataFile* m_dataFile;
+
+            /** Volume's coloring counter when loaded, negative if the coloring must be loaded */
+            int64_t m_coloringChangedCounter;
+
+            /** Value of the use counter when this texture was last used */
+            int64_t m_lastUsedCounter;
+        };
+
+        typedef std::map<SliceKey, CaretPointer<SliceTexture> > SliceTextureMap;
+
+        BrainOpenGLVolumeSliceTextureCache(const BrainOpenGLVolumeSliceTextureCache&);
+
+        BrainOpenGLVolumeSliceTextureCache& operator=(const BrainOpenGLVolumeSliceTextureCache&);
+
+        bool loadTexture(const SliceKey& sliceKey,
+                         SliceTexture* sliceTexture,
+                         const std::vector<uint8_t>& textureRGBA);
+
+        void removeLeastRecentlyUsedTexture();
+
+        void removeTexturesForDataFile(const CaretDataFile* dataFile);
+
+        SliceTextureMap m_sliceTextures;
+
+        /** Incremented each time a texture is requested, used to find least recently used texture */
+        int64_t m_useCounter;
+
+        static const int32_t s_maximumNumberOfTextures;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+    /*
+     * Enough for a large montage of several layers in several tabs.
+     */
+    const int32_t BrainOpenGLVolumeSliceTextureCache::s_maximumNumberOfTextures = 512;
+#endif // __BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+
+} // namespace
+#endif  //__BRAIN_OPEN_G_L_VOLUME_SLICE_TEXTURE_CACHE_H__
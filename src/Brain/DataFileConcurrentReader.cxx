@@ -0,0 +1,334 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <exception>
+#include <new>
+
+#include <QMutexLocker>
+#include <QThread>
+
+#define __DATA_FILE_CONCURRENT_READER_DECLARE__
+#include "DataFileConcurrentReader.h"
+#undef __DATA_FILE_CONCURRENT_READER_DECLARE__
+
+#include "CaretAssert.h"
+#include "CaretDataFile.h"
+#include "CaretDataFileHelper.h"
+#include "CaretException.h"
+#include "CaretMappableDataFile.h"
+#include "DataFileException.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::DataFileConcurrentReader
+ * \brief Reads independent data files using multiple threads.
+ * \ingroup Brain
+ *
+ * Files are created by the caller (in the main thread, since many
+ * files register for events in their constructor), added to the
+ * reader, and then read by a small pool of threads.  Only
+ * DataFile::readFile() is called in the threads.  The caller then
+ * takes the files, in any order, using waitForFile() and takeFile()
+ * and adds them to the Brain in the main thread.
+ *
+ * Charting delegates of mappable files register for events, so
+ * updating them is deferred while the file is read and performed
+ * in the main thread when the file is taken.
+ *
+ * Any files that are not taken, such as when reading is cancelled,
+ * are deleted by the destructor.
+ */
+
+/**
+ * Thread that reads files until there are no more files to read.
+ */
+class DataFileConcurrentReader::ReadingThread : public QThread {
+public:
+    ReadingThread(DataFileConcurrentReader* reader)
+    : m_reader(reader) { }
+
+    void run() {
+        m_reader->readFilesInThread();
+    }
+
+private:
+    DataFileConcurrentReader* m_reader;
+};
+
+/**
+ * Constructor.
+ */
+DataFileConcurrentReader::DataFileConcurrentReader()
+: CaretObject()
+{
+    m_nextFileIndex = 0;
+    m_cancelledFlag = false;
+}
+
+/**
+ * Destructor.  Stops reading (waiting for any file that is being
+ * read by a thread to finish) and deletes all files not taken.
+ */
+DataFileConcurrentReader::~DataFileConcurrentReader()
+{
+    cancel();
+    waitForThreads();
+
+    for (std::vector<FileEntry>::iterator iter = m_fileEntries.begin();
+         iter != m_fileEntries.end();
+         iter++) {
+        if (iter->m_takenFlag == false) {
+            delete iter->m_caretDataFile;
+            iter->m_caretDataFile = NULL;
+        }
+    }
+}
+
+/**
+ * Add a file for reading.  Must be called before startReading().
+ *
+ * @param caretDataFile
+ *    The file into which data is read.  The reader takes ownership
+ *    of the file until it is returned by takeFile().
+ * @param filename
+ *    Name of the file that is read.
+ * @return
+ *    Index of the file for use with waitForFile() and takeFile().
+ */
+int32_t
+DataFileConcurrentReader::addFile(CaretDataFile* caretDataFile,
+                                  const AString& filename)
+{
+    CaretAssert(caretDataFile);
+    CaretAssertMessage(m_threads.empty(),
+                       "Files must be added before reading is started.");
+
+    CaretMappableDataFile* mapFile = dynamic_cast<CaretMappableDataFile*>(caretDataFile);
+    if (mapFile != NULL) {
+        mapFile->setChartingDelegateUpdateDeferred(true);
+    }
+    
+    m_fileEntries.push_back(FileEntry(caretDataFile,
+                                      filename));
+    return (m_fileEntries.size() - 1);
+}
+
+/**
+ * @return Number of files that were added for reading.
+ */
+int32_t
+DataFileConcurrentReader::getNumberOfFiles() const
+{
+    return m_fileEntries.size();
+}
+
+/**
+ * Start the threads that read the files.  Threads read the files
+ * in the order they were added.
+ */
+void
+DataFileConcurrentReader::startReading()
+{
+    CaretAssertMessage(m_threads.empty(),
+                       "Reading has already been started.");
+
+    const int32_t numFiles = getNumberOfFiles();
+    int32_t numThreads = QThread::idealThreadCount();
+    if (numThreads > numFiles) {
+        numThreads = numFiles;
+    }
+    if (numThreads < 1) {
+        numThreads = ((numFiles > 0) ? 1 : 0);
+    }
+
+    for (int32_t i = 0; i < numThreads; i++) {
+        ReadingThread* thread = new ReadingThread(this);
+        m_threads.push_back(thread);
+        thread->start();
+    }
+}
+
+/**
+ * Wait for the file with the given index to finish reading.
+ *
+ * @param fileIndex
+ *    Index of the file.
+ * @param maximumWaitMilliseconds
+ *    Maximum time to wait, allows the caller to update progress
+ *    and check for cancellation while waiting.
+ * @return
+ *    True if the file has finished reading (successfully or not).
+ */
+bool
+DataFileConcurrentReader::waitForFile(const int32_t fileIndex,
+                                      const int32_t maximumWaitMilliseconds)
+{
+    CaretAssertVectorIndex(m_fileEntries, fileIndex);
+    CaretAssertMessage( ! m_threads.empty(),
+                       "Reading has not been started.");
+
+    QMutexLocker locker(&m_mutex);
+    if ( ! m_fileEntries[fileIndex].m_finishedFlag) {
+        if ( ! m_cancelledFlag) {
+            m_fileFinishedCondition.wait(&m_mutex,
+                                         maximumWaitMilliseconds);
+        }
+    }
+
+    return m_fileEntries[fileIndex].m_finishedFlag;
+}
+
+/**
+ * Take a file that has finished reading.
+ *
+ * @param fileIndex
+ *    Index of the file, waitForFile() must have returned true for the file.
+ * @param errorMessageOut
+ *    Contains description of error if reading the file failed.
+ * @return
+ *    The file, now owned by the caller, or NULL if reading the file failed.
+ *    If reading failed the file was deleted.
+ */
+CaretDataFile*
+DataFileConcurrentReader::takeFile(const int32_t fileIndex,
+                                   AString& errorMessageOut)
+{
+    CaretAssertVectorIndex(m_fileEntries, fileIndex);
+    errorMessageOut.clear();
+
+    CaretDataFile* caretDataFile = NULL;
+    {
+        QMutexLocker locker(&m_mutex);
+        FileEntry& entry = m_fileEntries[fileIndex];
+        CaretAssertMessage(entry.m_finishedFlag,
+                           "File has not finished reading.");
+        CaretAssertMessage( ! entry.m_takenFlag,
+                           "File has already been taken.");
+        
+        caretDataFile = entry.m_caretDataFile;
+        entry.m_caretDataFile = NULL;
+        entry.m_takenFlag = true;
+        
+        if ( ! entry.m_errorMessage.isEmpty()) {
+            errorMessageOut = entry.m_errorMessage;
+            delete caretDataFile;
+            caretDataFile = NULL;
+        }
+    }
+    
+    /*
+     * Now in the main thread, perform the charting
+     * delegate update that was deferred while reading.
+     */
+    CaretMappableDataFile* mapFile = dynamic_cast<CaretMappableDataFile*>(caretDataFile);
+    if (mapFile != NULL) {
+        mapFile->setChartingDelegateUpdateDeferred(false);
+    }
+
+    return caretDataFile;
+}
+
+/**
+ * Cancel reading.  Files that have not been started are not read
+ * but a file that is being read by a thread is read to completion.
+ */
+void
+DataFileConcurrentReader::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cancelledFlag = true;
+    m_fileFinishedCondition.wakeAll();
+}
+
+/**
+ * Wait for all of the threads to finish and delete them.
+ */
+void
+DataFileConcurrentReader::waitForThreads()
+{
+    for (std::vector<ReadingThread*>::iterator iter = m_threads.begin();
+         iter != m_threads.end();
+         iter++) {
+        ReadingThread* thread = *iter;
+        thread->wait();
+        delete thread;
+    }
+    m_threads.clear();
+}
+
+/**
+ * Called by each reading thread, reads files until all files have been
+ * read or reading is cancelled.
+ */
+void
+DataFileConcurrentReader::readFilesInThread()
+{
+    while (true) {
+        CaretDataFile* caretDataFile = NULL;
+        AString filename;
+        int32_t fileIndex = -1;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_cancelledFlag
+                || (m_nextFileIndex >= getNumberOfFiles())) {
+                return;
+            }
+            fileIndex = m_nextFileIndex;
+            m_nextFileIndex++;
+            caretDataFile = m_fileEntries[fileIndex].m_caretDataFile;
+            filename      = m_fileEntries[fileIndex].m_filename;
+        }
+
+        /*
+         * Errors are saved and reported when the file is taken so
+         * that the caller reports them in the order of the files.
+         */
+        AString errorMessage;
+        try {
+            try {
+                caretDataFile->readFile(filename);
+            }
+            catch (const std::bad_alloc&) {
+                throw DataFileException(filename,
+                                        CaretDataFileHelper::createBadAllocExceptionMessage(filename));
+            }
+        }
+        catch (const DataFileException& dfe) {
+            errorMessage = dfe.whatString();
+        }
+        catch (const CaretException& ce) {
+            errorMessage = DataFileException(filename,
+                                             ce.whatString()).whatString();
+        }
+        catch (const std::exception& e) {
+            errorMessage = DataFileException(filename,
+                                             e.what()).whatString();
+        }
+
+        QMutexLocker locker(&m_mutex);
+        m_fileEntries[fileIndex].m_errorMessage = errorMessage;
+        m_fileEntries[fileIndex].m_finishedFlag = true;
+        m_fileFinishedCondition.wakeAll();
+    }
+}
+
@@ -0,0 +1,119 @@
+#ifndef __DATA_FILE_CONCURRENT_READER_H__
+#define __DATA_FILE_CONCURRENT_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "CaretObject.h"
+
+namespace caret {
+
+    class CaretDataFile;
+
+    class DataFileConcurrentReader : public CaretObject {
+
+    public:
+        DataFileConcurrentReader();
+
+        virtual ~DataFileConcurrentReader();
+
+        int32_t addFile(CaretDataFile* caretDataFile,
+                        const AString& filename);
+
+        int32_t getNumberOfFiles() const;
+
+        void startReading();
+
+        bool waitForFile(const int32_t fileIndex,
+                         const int32_t maximumWaitMilliseconds);
+
+        CaretDataFile* takeFile(const int32_t fileIndex,
+                                AString& errorMessageOut);
+
+        void cancel();
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class ReadingThread;
+
+        /** A file that is read by one of the threads */
+        struct FileEntry {
+            FileEntry(CaretDataFile* caretDataFile,
+                      const AString& filename)
+            : m_caretDataFile(caretDataFile),
+            m_filename(filename),
+            m_finishedFlag(false),
+            m_takenFlag(false) { }
+
+            /** File that is read, always created and deleted in the main thread */
+            CaretDataFile* m_caretDataFile;
+
+            /** Name of the file */
+            AString m_filename;
+
+            /** Error message if reading failed */
+            AString m_errorMessage;
+
+            /** Reading of the file has finished (successfully or not) */
+            bool m_finishedFlag;
+
+            /** File has been given to the caller */
+            bool m_takenFlag;
+        };
+
+        DataFileConcurrentReader(const DataFileConcurrentReader&);
+
+        DataFileConcurrentReader& operator=(const DataFileConcurrentReader&);
+
+        void readFilesInThread();
+
+        void waitForThreads();
+
+        std::vector<FileEntry> m_fileEntries;
+
+        std::vector<ReadingThread*> m_threads;
+
+        /** Protects all members that are shared with the reading threads */
+        QMutex m_mutex;
+
+        /** Signaled each time a file finishes reading */
+        QWaitCondition m_fileFinishedCondition;
+
+        /** Index of next file that a thread should read */
+        int32_t m_nextFileIndex;
+
+        /** Reading has been cancelled */
+        bool m_cancelledFlag;
+
+        // ADD_NEW_MEMBERS_HERE
+    };
+
+#ifdef __DATA_FILE_CONCURRENT_READER_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __DATA_FILE_CONCURRENT_READER_DECLARE__
+
+} // namespace
+#endif  //__DATA_FILE_CONCURRENT_READER_H__
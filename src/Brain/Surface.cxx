@@ -19,6 +19,7 @@
 /*LICENSE_END*/
 
 #include "BoundingBox.h"
+#include "BrainOpenGLSurfaceBuffers.h"
 #include "BrainStructure.h"
 #include "Surface.h"
 
@@ -105,6 +106,7 @@ void
 Surface::initializeMemberSurface()
 {
     this->brainStructure = NULL;
+    m_openGLBuffers.grabNew(NULL);
 }
 
 /**
@@ -146,6 +148,17 @@ Surface::setBrainStructure(BrainStructure* brainStructure)
     this->brainStructure = brainStructure;
 }
 
-
-
-
+/**
+ * @return The OpenGL buffers that contain this surface's geometry
+ * and coloring for drawing.  The buffers are created when first
+ * requested and loaded by the OpenGL drawing code.
+ */
+BrainOpenGLSurfaceBuffers*
+Surface::getOpenGLBuffers() const
+{
+    if (m_openGLBuffers == NULL) {
+        m_openGLBuffers.grabNew(new BrainOpenGLSurfaceBuffers());
+    }
+    
+    return m_openGLBuffers;
+}
@@ -29,6 +29,7 @@
 namespace caret {
     
     class BoundingBox;
+    class BrainOpenGLSurfaceBuffers;
     class BrainStructure;
     
     /**
@@ -55,12 +56,17 @@ namespace caret {
         
         void setBrainStructure(BrainStructure* brainStructure);
         
+        BrainOpenGLSurfaceBuffers* getOpenGLBuffers() const;
+        
     private:
         void initializeMemberSurface();
         
         void copyHelperSurface(const Surface& s);
 
         BrainStructure* brainStructure;
+        
+        /** OpenGL buffers with this surface's geometry and coloring, created when first drawn */
+        mutable CaretPointer<BrainOpenGLSurfaceBuffers> m_openGLBuffers;
     };
 
 } // namespace
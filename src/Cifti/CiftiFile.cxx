@@ -20,10 +20,14 @@
 
 #include "CiftiFile.h"
 
+#include <algorithm>
+
 #include "ByteOrderEnum.h"
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
@@ -40,12 +44,24 @@ namespace
     {
         mutable NiftiIO m_nifti;//because file objects aren't stateless (current position), so reading "changes" them
         CiftiXML m_xml;//because we need to parse it to set up the dimensions anyway
+        struct ColumnTile
+        {
+            int64_t m_firstColumn, m_numColumns;
+            std::vector<float> m_data;//transposed, so each column is contiguous
+        };
+        mutable std::vector<CaretPointer<ColumnTile> > m_columnTiles;//most recently used first
+        mutable CaretMutex m_columnMutex;
+        CaretPointer<ColumnTile> readColumnTile(const int64_t& index) const;
+        void readColumnStrip(float* scratch, const int64_t& firstRow, const int64_t& numRows, const int64_t& firstColumn, const int64_t& numColumns, float* tileData) const;
+        void invalidateColumnCache();
     public:
         CiftiOnDiskImpl(const QString& filename);//read-only
         CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const bool& swapEndian,
                         const int16_t& datatype, const bool& rescale, const double& minval, const double& maxval);//make new empty file with read/write
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
+        bool allowsConcurrentReads() const { return m_nifti.isMemoryMapped(); }//reads from the mapping don't lock
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
@@ -61,6 +77,7 @@ namespace
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
         bool isInMemory() const { return true; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
@@ -99,6 +116,16 @@ namespace
     
 }
 
+void CiftiFile::ReadImplInterface::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    vector<int64_t> indexSelect(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        indexSelect[0] = firstRow + i;
+        getRow(dataOut + i * rowLength, indexSelect, false);
+    }
+}
+
 CiftiFile::ReadImplInterface::~ReadImplInterface()
 {
 }
@@ -257,6 +284,104 @@ void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
     m_readingImpl->getColumn(dataOut, index);
 }
 
+namespace
+{
+    const int64_t ROW_SUM_READ_BYTES = 32 * 1024 * 1024;//maximum size of a single read of neighboring rows
+    const int64_t ROW_SUM_GAP_BYTES = 256 * 1024;//read through gaps this small rather than starting another read
+    
+    struct RowRun
+    {//a range of rows read together, and the range of the sorted indices that it contains
+        int64_t m_firstRow, m_numRows;
+        int64_t m_firstSelected, m_endSelected;
+    };
+    
+    void addRunToSum(double* sum, const CiftiFile::ReadImplInterface* impl, const RowRun& run, const vector<int64_t>& sortedIndices,
+                     const int64_t& rowLength, vector<float>& scratch)
+    {
+        scratch.resize(run.m_numRows * rowLength);
+        impl->getRows(scratch.data(), run.m_firstRow, run.m_numRows, rowLength);
+        for (int64_t i = run.m_firstSelected; i < run.m_endSelected; ++i)
+        {
+            const float* row = scratch.data() + (sortedIndices[i] - run.m_firstRow) * rowLength;
+            for (int64_t j = 0; j < rowLength; ++j)//simple loop over contiguous memory so the compiler vectorizes it
+            {
+                sum[j] += row[j];
+            }
+        }
+    }
+}
+
+void CiftiFile::getRowSum(double* sumOut, const vector<int64_t>& rowIndices) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowSum called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowSum called on non-2D CiftiFile");
+    const int64_t rowLength = m_dims[0], numRows = m_dims[1];
+    for (int64_t j = 0; j < rowLength; ++j)
+    {
+        sumOut[j] = 0.0;
+    }
+    if (m_readingImpl == NULL) return;//matrix of zeros while waiting for setRow, same as getRow
+    vector<int64_t> sortedIndices = rowIndices;
+    sort(sortedIndices.begin(), sortedIndices.end());//read in file order, and make neighboring rows adjacent
+    const int64_t numSelected = (int64_t)sortedIndices.size();
+    if (numSelected == 0) return;
+    if (sortedIndices[0] < 0 || sortedIndices[numSelected - 1] >= numRows) throw DataFileException("getRowSum called with invalid row index");
+    const int64_t rowBytes = rowLength * sizeof(float);
+    const int64_t maxRunRows = max((int64_t)1, ROW_SUM_READ_BYTES / rowBytes);
+    const int64_t maxGapRows = ROW_SUM_GAP_BYTES / rowBytes;
+    vector<RowRun> runs;
+    RowRun curRun;
+    curRun.m_firstRow = sortedIndices[0];
+    curRun.m_numRows = 1;
+    curRun.m_firstSelected = 0;
+    for (int64_t i = 1; i < numSelected; ++i)
+    {
+        const int64_t lastRow = curRun.m_firstRow + curRun.m_numRows - 1;
+        const int64_t newNumRows = sortedIndices[i] - curRun.m_firstRow + 1;
+        if (sortedIndices[i] - lastRow - 1 > maxGapRows || newNumRows > maxRunRows)
+        {
+            curRun.m_endSelected = i;
+            runs.push_back(curRun);
+            curRun.m_firstRow = sortedIndices[i];
+            curRun.m_numRows = 1;
+            curRun.m_firstSelected = i;
+        } else {
+            curRun.m_numRows = newNumRows;//repeated index leaves this unchanged
+        }
+    }
+    curRun.m_endSelected = numSelected;
+    runs.push_back(curRun);
+    const int64_t numRuns = (int64_t)runs.size();
+    CaretLogFine("reading " + QString::number(numSelected) + " rows of cifti file in " + QString::number(numRuns) + " reads");
+    const ReadImplInterface* impl = m_readingImpl;
+    if (numRuns > 1 && impl->allowsConcurrentReads())
+    {
+#pragma omp CARET_PAR
+        {
+            vector<double> threadSum(rowLength, 0.0);
+            vector<float> scratch;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t r = 0; r < numRuns; ++r)
+            {
+                addRunToSum(threadSum.data(), impl, runs[r], sortedIndices, rowLength, scratch);
+            }
+#pragma omp critical
+            {
+                for (int64_t j = 0; j < rowLength; ++j)
+                {
+                    sumOut[j] += threadSum[j];
+                }
+            }
+        }
+    } else {//otherwise, read in file order, in case seeking is slow (compressed)
+        vector<float> scratch;
+        for (int64_t r = 0; r < numRuns; ++r)
+        {
+            addRunToSum(sumOut, impl, runs[r], sortedIndices, rowLength, scratch);
+        }
+    }
+}
+
 void CiftiFile::setCiftiXML(const CiftiXML& xml, const bool useOldMetadata)
 {
     if (xml.getNumberOfDimensions() == 0) throw DataFileException("setCiftiXML called with 0-dimensional CiftiXML");
@@ -435,6 +560,19 @@ void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
     }
 }
 
+void CiftiMemoryImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2);
+    CaretAssert(rowLength == m_array.getDimensions()[0]);
+    CaretAssert(firstRow >= 0 && numRows >= 0 && firstRow + numRows <= m_array.getDimensions()[1]);
+    const float* ref = m_array.get(2, vector<int64_t>()) + firstRow * rowLength;//rows are contiguous
+    const int64_t numElements = numRows * rowLength;
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        dataOut[i] = ref[i];
+    }
+}
+
 void CiftiMemoryImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
     float* ref = m_array.get(1, indexSelect);
@@ -663,23 +801,123 @@ void CiftiOnDiskImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect,
     m_nifti.readData(dataOut, 5, indexSelect, tolerateShortRead);//5 means 4 reserved (space and time) plus the first cifti dimension
 }
 
+void CiftiOnDiskImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
+    CaretAssert(rowLength == m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+    m_nifti.readElements(dataOut, firstRow * rowLength, numRows * rowLength);//neighboring rows are contiguous in the file, so one read
+}
+
+namespace
+{
+    const int64_t COLUMN_TILE_BYTES = 32 * 1024 * 1024;//how much memory a tile of neighboring columns uses
+    const int MAX_COLUMN_TILES = 2;//so, up to 64MB of cached columns per on-disk file
+    const int64_t COLUMN_STRIP_BYTES = 4 * 1024 * 1024;//how many bytes of whole rows to read at once while filling a tile
+    const int64_t COLUMN_STRIP_MIN_ROW_FRACTION = 2;//only read whole rows for a tile when it covers at least 1/2 of a row
+}
+
 void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
-    CaretLogFine("getColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
-    vector<int64_t> indexSelect(2);
-    indexSelect[0] = index;
     int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    for (int64_t i = 0; i < colLength; ++i)//assume if they really want getColumn on disk, they don't want their pagecache obliterated, so read it 1 element at a time
+    CaretPointer<ColumnTile> myTile;
     {
-        indexSelect[1] = i;
-        m_nifti.readData(dataOut + i, 4, indexSelect);//4 means just the 4 reserved dimensions, so 1 element of the matrix
+        CaretMutexLocker locked(&m_columnMutex);
+        for (int i = 0; i < (int)m_columnTiles.size(); ++i)
+        {
+            const ColumnTile& thisTile = *(m_columnTiles[i]);
+            if (index >= thisTile.m_firstColumn && index < thisTile.m_firstColumn + thisTile.m_numColumns)
+            {
+                myTile = m_columnTiles[i];
+                m_columnTiles.erase(m_columnTiles.begin() + i);
+                break;
+            }
+        }
+        if (myTile == NULL)
+        {//still holding the lock, so that a burst of requests for neighboring columns doesn't read the same strip several times
+            myTile = readColumnTile(index);
+        }
+        m_columnTiles.insert(m_columnTiles.begin(), myTile);
+        if ((int)m_columnTiles.size() > MAX_COLUMN_TILES) m_columnTiles.resize(MAX_COLUMN_TILES);
+    }//the tile can't be modified after it is made, and we hold a reference, so we can copy it out without the lock
+    const float* source = myTile->m_data.data() + (index - myTile->m_firstColumn) * colLength;
+    for (int64_t i = 0; i < colLength; ++i)
+    {
+        dataOut[i] = source[i];
+    }
+}
+
+CaretPointer<CiftiOnDiskImpl::ColumnTile> CiftiOnDiskImpl::readColumnTile(const int64_t& index) const
+{//read a strip of neighboring columns with at most one read per row, instead of one read per element, and keep it around for the next getColumn
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    int64_t tileWidth = COLUMN_TILE_BYTES / (colLength * sizeof(float));
+    if (tileWidth < 1) tileWidth = 1;
+    if (tileWidth > rowLength) tileWidth = rowLength;
+    CaretPointer<ColumnTile> ret(new ColumnTile());
+    ret->m_firstColumn = (index / tileWidth) * tileWidth;
+    ret->m_numColumns = min(tileWidth, rowLength - ret->m_firstColumn);
+    ret->m_data.resize(ret->m_numColumns * colLength);
+    const int64_t firstColumn = ret->m_firstColumn, numColumns = ret->m_numColumns;
+    float* tileData = ret->m_data.data();
+    CaretLogFine("reading columns " + QString::number(firstColumn) + " to " + QString::number(firstColumn + numColumns - 1) + " of on-disk cifti file");
+    //normally, read only the tile's segment of each row, one read per row - reading whole rows would touch the entire matrix for every tile
+    //when the tile covers most of a row, little is wasted by reading whole rows, so instead do one contiguous read per strip of rows,
+    //from the first tile element of the strip's first row to the last tile element of its last row
+    int64_t rowsPerStrip = 1;
+    if (numColumns * COLUMN_STRIP_MIN_ROW_FRACTION >= rowLength)
+    {
+        rowsPerStrip = COLUMN_STRIP_BYTES / (rowLength * sizeof(float));
+        if (rowsPerStrip < 1) rowsPerStrip = 1;
+        if (rowsPerStrip > colLength) rowsPerStrip = colLength;
+    }
+    const int64_t numStrips = (colLength + rowsPerStrip - 1) / rowsPerStrip;
+    if (m_nifti.isMemoryMapped())
+    {//reads don't lock, so do them in parallel
+#pragma omp CARET_PAR
+        {
+            vector<float> stripData((rowsPerStrip - 1) * rowLength + numColumns);
+#pragma omp CARET_FOR schedule(static)
+            for (int64_t strip = 0; strip < numStrips; ++strip)
+            {
+                readColumnStrip(stripData.data(), strip * rowsPerStrip, min(rowsPerStrip, colLength - strip * rowsPerStrip), firstColumn, numColumns, tileData);
+            }
+        }
+    } else {//otherwise, read in file order, in case seeking is slow (compressed)
+        vector<float> stripData((rowsPerStrip - 1) * rowLength + numColumns);
+        for (int64_t strip = 0; strip < numStrips; ++strip)
+        {
+            readColumnStrip(stripData.data(), strip * rowsPerStrip, min(rowsPerStrip, colLength - strip * rowsPerStrip), firstColumn, numColumns, tileData);
+        }
     }
+    return ret;
+}
+
+void CiftiOnDiskImpl::readColumnStrip(float* scratch, const int64_t& firstRow, const int64_t& numRows, const int64_t& firstColumn, const int64_t& numColumns, float* tileData) const
+{
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    m_nifti.readElements(scratch, firstRow * rowLength + firstColumn, (numRows - 1) * rowLength + numColumns);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        const float* rowSegment = scratch + i * rowLength;
+        for (int64_t j = 0; j < numColumns; ++j)
+        {
+            tileData[j * colLength + firstRow + i] = rowSegment[j];
+        }
+    }
+}
+
+void CiftiOnDiskImpl::invalidateColumnCache()
+{
+    CaretMutexLocker locked(&m_columnMutex);
+    m_columnTiles.clear();
 }
 
 void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
+    invalidateColumnCache();
     m_nifti.writeData(dataIn, 5, indexSelect);
 }
 
@@ -688,6 +926,7 @@ void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
     CaretLogFine("setColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
+    invalidateColumnCache();
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
     int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
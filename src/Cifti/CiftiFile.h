@@ -69,6 +69,7 @@ namespace caret
             return MultiDimIterator<int64_t>(std::vector<int64_t>(m_dims.begin() + 1, m_dims.end()));
         }
         void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
+        void getRowSum(double* sumOut, const std::vector<int64_t>& rowIndices) const;//for 2D only, sum of the rows (repeated indices count repeatedly), reads neighboring rows together
         
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true);
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true);//set xml from old implementation
@@ -92,6 +93,8 @@ namespace caret
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
             virtual bool isInMemory() const { return false; }
+            virtual void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;//2D only, contiguous rows, default is one getRow per row
+            virtual bool allowsConcurrentReads() const { return isInMemory(); }//whether reading from several threads at once is safe and worthwhile
             virtual ~ReadImplInterface();
         };
         //assume if you can write to it, you can also read from it
@@ -0,0 +1,217 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiStructureView.h"
+
+#include "CaretAssert.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+const int64_t CiftiStructureView::DEFAULT_BUFFER_BYTES = 256 * 1024 * 1024;
+
+CiftiStructureView::CiftiStructureView(const CiftiFile* ciftiIn, const int& myDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes)
+{
+    m_ciftiOut = NULL;
+    init(ciftiIn, myDir, myStruct, maxBufferBytes);
+}
+
+CiftiStructureView::CiftiStructureView(CiftiFile* ciftiInOut, const int& myDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes)
+{
+    m_ciftiOut = ciftiInOut;
+    init(ciftiInOut, myDir, myStruct, maxBufferBytes);
+}
+
+void CiftiStructureView::init(const CiftiFile* ciftiIn, const int& myDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes)
+{
+    CaretAssert(ciftiIn != NULL);
+    m_ciftiIn = ciftiIn;
+    m_dir = myDir;
+    const CiftiXML& myXML = ciftiIn->getCiftiXML();
+    if (myXML.getNumberOfDimensions() != 2) throw DataFileException("structure views are only supported on 2D cifti");
+    if (myDir != CiftiXML::ALONG_ROW && myDir != CiftiXML::ALONG_COLUMN) throw DataFileException("invalid direction for structure view");
+    if (myXML.getMappingType(myDir) != CiftiMappingType::BRAIN_MODELS) throw DataFileException("specified direction does not contain brain models");
+    const CiftiBrainModelsMap& myDenseMap = myXML.getBrainModelsMap(myDir);
+    if (myDenseMap.hasSurfaceData(myStruct))
+    {
+        m_isSurface = true;
+        m_surfaceMap = myDenseMap.getSurfaceMap(myStruct);
+        m_numNodes = myDenseMap.getSurfaceNumberOfNodes(myStruct);
+        m_ciftiIndices.resize(m_surfaceMap.size());
+        for (size_t i = 0; i < m_surfaceMap.size(); ++i)
+        {
+            m_ciftiIndices[i] = m_surfaceMap[i].m_ciftiIndex;
+        }
+    } else {
+        if (!myDenseMap.hasVolumeData(myStruct))
+        {
+            throw DataFileException("cifti file does not contain the structure '" + StructureEnum::toName(myStruct) + "' in the specified direction");
+        }
+        m_isSurface = false;
+        m_volumeMap = myDenseMap.getVolumeStructureMap(myStruct);
+        m_numNodes = -1;
+        m_ciftiIndices.resize(m_volumeMap.size());
+        for (size_t i = 0; i < m_volumeMap.size(); ++i)
+        {
+            m_ciftiIndices[i] = m_volumeMap[i].m_ciftiIndex;
+        }
+    }
+    m_rowLength = ciftiIn->getNumberOfColumns();
+    m_rowScratch.resize(m_rowLength);
+    if (myDir == CiftiXML::ALONG_COLUMN)
+    {
+        m_numMaps = ciftiIn->getNumberOfColumns();
+    } else {
+        m_numMaps = ciftiIn->getNumberOfRows();
+    }
+    int64_t elementBytes = max((int64_t)1, getNumberOfElements()) * sizeof(float);
+    m_blockMaps = max((int64_t)1, min(m_numMaps, maxBufferBytes / elementBytes));
+    m_blockStart = -1;
+    m_blockModified = false;
+}
+
+void CiftiStructureView::loadBlock(const int64_t& map) const
+{
+    CaretAssert(m_dir == CiftiXML::ALONG_COLUMN);
+    if (m_blockStart >= 0 && map >= m_blockStart && map < m_blockStart + m_blockMaps) return;
+    writeBlock();//if the block was modified, write it before replacing it
+    int64_t numElements = getNumberOfElements();
+    m_blockStart = (map / m_blockMaps) * m_blockMaps;
+    int64_t blockCount = min(m_blockMaps, m_numMaps - m_blockStart);
+    m_block.resize(blockCount * numElements);
+    for (int64_t i = 0; i < numElements; ++i)
+    {//one pass over the structure's rows fills every map in the block
+        m_ciftiIn->getRow(m_rowScratch.data(), m_ciftiIndices[i], m_ciftiOut != NULL);//tolerate short reads when writing, so new on-disk files work
+        for (int64_t j = 0; j < blockCount; ++j)
+        {
+            m_block[j * numElements + i] = m_rowScratch[m_blockStart + j];
+        }
+    }
+}
+
+void CiftiStructureView::writeBlock() const
+{
+    if (!m_blockModified) return;
+    CaretAssert(m_ciftiOut != NULL);
+    int64_t numElements = getNumberOfElements();
+    int64_t blockCount = min(m_blockMaps, m_numMaps - m_blockStart);
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        if (blockCount < m_numMaps)
+        {//only part of the row is in the block, so read-modify-write
+            m_ciftiOut->getRow(m_rowScratch.data(), m_ciftiIndices[i], true);
+        }
+        for (int64_t j = 0; j < blockCount; ++j)
+        {
+            m_rowScratch[m_blockStart + j] = m_block[j * numElements + i];
+        }
+        m_ciftiOut->setRow(m_rowScratch.data(), m_ciftiIndices[i]);
+    }
+    m_blockModified = false;
+}
+
+void CiftiStructureView::getElements(const int64_t& map, float* dataOut) const
+{
+    CaretAssert(map >= 0 && map < m_numMaps);
+    int64_t numElements = getNumberOfElements();
+    if (m_dir == CiftiXML::ALONG_COLUMN)
+    {
+        loadBlock(map);
+        memcpy(dataOut, m_block.data() + (map - m_blockStart) * numElements, numElements * sizeof(float));
+    } else {
+        m_ciftiIn->getRow(m_rowScratch.data(), map, m_ciftiOut != NULL);
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            dataOut[i] = m_rowScratch[m_ciftiIndices[i]];
+        }
+    }
+}
+
+void CiftiStructureView::setElements(const int64_t& map, const float* dataIn)
+{
+    if (m_ciftiOut == NULL) throw DataFileException("attempted to write through a read-only cifti structure view");
+    CaretAssert(map >= 0 && map < m_numMaps);
+    int64_t numElements = getNumberOfElements();
+    if (m_dir == CiftiXML::ALONG_COLUMN)
+    {
+        loadBlock(map);
+        memcpy(m_block.data() + (map - m_blockStart) * numElements, dataIn, numElements * sizeof(float));
+        m_blockModified = true;
+    } else {
+        m_ciftiOut->getRow(m_rowScratch.data(), map, true);
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            m_rowScratch[m_ciftiIndices[i]] = dataIn[i];
+        }
+        m_ciftiOut->setRow(m_rowScratch.data(), map);
+    }
+}
+
+void CiftiStructureView::getSurfaceNodeData(const int64_t& map, float* nodeDataOut) const
+{
+    if (!m_isSurface) throw DataFileException("getSurfaceNodeData called on a volume structure view");
+    int64_t numElements = getNumberOfElements();
+    vector<float> elements(numElements);
+    getElements(map, elements.data());
+    for (int64_t i = 0; i < m_numNodes; ++i)
+    {
+        nodeDataOut[i] = 0.0f;
+    }
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        nodeDataOut[m_surfaceMap[i].m_surfaceNode] = elements[i];
+    }
+}
+
+void CiftiStructureView::setSurfaceNodeData(const int64_t& map, const float* nodeDataIn)
+{
+    if (!m_isSurface) throw DataFileException("setSurfaceNodeData called on a volume structure view");
+    int64_t numElements = getNumberOfElements();
+    vector<float> elements(numElements);
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        elements[i] = nodeDataIn[m_surfaceMap[i].m_surfaceNode];
+    }
+    setElements(map, elements.data());
+}
+
+void CiftiStructureView::getSurfaceRoi(float* roiOut) const
+{
+    if (!m_isSurface) throw DataFileException("getSurfaceRoi called on a volume structure view");
+    for (int64_t i = 0; i < m_numNodes; ++i)
+    {
+        roiOut[i] = 0.0f;
+    }
+    for (size_t i = 0; i < m_surfaceMap.size(); ++i)
+    {
+        roiOut[m_surfaceMap[i].m_surfaceNode] = 1.0f;
+    }
+}
+
+void CiftiStructureView::flush()
+{
+    if (m_ciftiOut == NULL) return;
+    writeBlock();
+}
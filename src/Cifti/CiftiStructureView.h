@@ -0,0 +1,92 @@
+#ifndef __CIFTI_STRUCTURE_VIEW_H__
+#define __CIFTI_STRUCTURE_VIEW_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiBrainModelsMap.h"
+#include "StructureEnum.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret
+{
+    class CiftiFile;
+
+    ///access to the data of one structure of a 2D cifti file, one map at a time, without separating it into a metric or volume file
+    ///a "map" is one index along the other dimension, for instance one timepoint of a dtseries when the structure is along columns
+    ///when the structure is along columns, a block of maps is read (or written) in one pass over the structure's rows, to keep memory bounded
+    class CiftiStructureView
+    {
+    public:
+        ///read-only view
+        CiftiStructureView(const CiftiFile* ciftiIn, const int& myDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes = DEFAULT_BUFFER_BYTES);
+        ///writable view, the file must already have its cifti XML set, call flush() when done writing
+        CiftiStructureView(CiftiFile* ciftiInOut, const int& myDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes = DEFAULT_BUFFER_BYTES);
+
+        bool isSurface() const { return m_isSurface; }
+        int64_t getNumberOfMaps() const { return m_numMaps; }
+        int64_t getNumberOfElements() const { return (int64_t)m_ciftiIndices.size(); }
+        ///order of elements in getElements/setElements, only valid for surface structures
+        const std::vector<CiftiBrainModelsMap::SurfaceMap>& getSurfaceMap() const { return m_surfaceMap; }
+        ///order of elements in getElements/setElements, only valid for volume structures
+        const std::vector<CiftiBrainModelsMap::VolumeMap>& getVolumeMap() const { return m_volumeMap; }
+        int64_t getSurfaceNumberOfNodes() const { return m_numNodes; }
+
+        void getElements(const int64_t& map, float* dataOut) const;
+        void setElements(const int64_t& map, const float* dataIn);
+
+        ///values for every vertex of the surface, vertices not in the structure get zero
+        void getSurfaceNodeData(const int64_t& map, float* nodeDataOut) const;
+        ///only vertices in the structure are used
+        void setSurfaceNodeData(const int64_t& map, const float* nodeDataIn);
+        ///1 for vertices in the structure, 0 otherwise
+        void getSurfaceRoi(float* roiOut) const;
+
+        ///write out any modified maps that are still buffered
+        void flush();
+
+        static const int64_t DEFAULT_BUFFER_BYTES;
+    private:
+        CiftiStructureView(const CiftiStructureView&);
+        CiftiStructureView& operator=(const CiftiStructureView&);
+        void init(const CiftiFile* ciftiIn, const int& myDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes);
+        void loadBlock(const int64_t& map) const;
+        void writeBlock() const;
+
+        const CiftiFile* m_ciftiIn;
+        CiftiFile* m_ciftiOut;//NULL for read-only views
+        int m_dir;
+        bool m_isSurface;
+        int64_t m_numMaps, m_numNodes, m_rowLength;
+        std::vector<CiftiBrainModelsMap::SurfaceMap> m_surfaceMap;
+        std::vector<CiftiBrainModelsMap::VolumeMap> m_volumeMap;
+        std::vector<int64_t> m_ciftiIndices;
+        //block of maps, map-major, only used when the structure is along columns
+        int64_t m_blockMaps;
+        mutable int64_t m_blockStart;
+        mutable std::vector<float> m_block;
+        mutable bool m_blockModified;
+        mutable std::vector<float> m_rowScratch;
+    };
+}
+
+#endif //__CIFTI_STRUCTURE_VIEW_H__
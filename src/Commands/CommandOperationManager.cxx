@@ -198,6 +198,7 @@
 #include "OperationSetMapNames.h"
 #include "OperationSetStructure.h"
 #include "OperationShowScene.h"
+#include "OperationShowSceneBatch.h"
 #include "OperationSpecFileMerge.h"
 #include "OperationSpecFileRelocate.h"
 #include "OperationSurfaceClosestVertex.h"
@@ -208,7 +209,9 @@
 #include "OperationSurfaceGeodesicROIs.h"
 #include "OperationSurfaceInformation.h"
 #include "OperationSurfaceNormals.h"
+#include "OperationSurfaceResampleWeights.h"
 #include "OperationSurfaceSetCoordinates.h"
+#include "OperationSurfaceSmoothingKernels.h"
 #include "OperationSurfaceVertexAreas.h"
 #include "OperationVolumeCapturePlane.h"
 #include "OperationVolumeCopyExtensions.h"
@@ -242,7 +245,11 @@
 
 #include "CaretLogger.h"
 #include "dot_wrapper.h"
+#include "MetricSmoothingObject.h"
 #include "StructureEnum.h"
+#include "SurfaceResamplingHelper.h"
+
+#include <QDir>
 
 #include <iostream>
 #include <map>
@@ -452,6 +459,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationSetStructure()));
     if (OperationShowScene::isShowSceneCommandAvailable()) {
         this->commandOperations.push_back(new CommandParser(new AutoOperationShowScene()));
+        this->commandOperations.push_back(new CommandParser(new AutoOperationShowSceneBatch()));
     }
     this->commandOperations.push_back(new CommandParser(new AutoOperationSpecFileMerge()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSpecFileRelocate()));
@@ -463,7 +471,9 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceGeodesicROIs()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceInformation()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceNormals()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceResampleWeights()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceSetCoordinates()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceSmoothingKernels()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSurfaceVertexAreas()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationVolumeCapturePlane()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationVolumeCopyExtensions()));
@@ -556,9 +566,15 @@ void
 CommandOperationManager::runCommand(ProgramParameters& parameters)
 {
     vector<AString> globalOptionArgs;
+    globalOptionsGiven.clear();
     bool preventProvenance = getGlobalOption(parameters, "-disable-provenance", 0, globalOptionArgs);//check these BEFORE we test if we have a command switch, because they remove the switch and arguments from the ProgramParameters
+    if (preventProvenance)
+    {
+        globalOptionsGiven.push_back("-disable-provenance");
+    }
     if (getGlobalOption(parameters, "-logging", 1, globalOptionArgs))
     {
+        addGlobalOptionGiven("-logging", globalOptionArgs);
         bool valid = false;
         const LogLevelEnum::Enum level = LogLevelEnum::fromName(globalOptionArgs[0], &valid);
         if (!valid) throw CommandException("unrecognized logging level: '" + globalOptionArgs[0] + "'");
@@ -566,6 +582,7 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
     }
     if (getGlobalOption(parameters, "-simd", 1, globalOptionArgs))
     {
+        addGlobalOptionGiven("-simd", globalOptionArgs);
         bool valid = false;
         const DotSIMDEnum::Enum impl = DotSIMDEnum::fromName(globalOptionArgs[0], &valid);
         if (!valid) throw CommandException("unrecognized SIMD type: '" + globalOptionArgs[0] + "'");
@@ -575,15 +592,29 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
     }
+    if (getGlobalOption(parameters, "-resample-weight-cache", 1, globalOptionArgs))
+    {
+        addGlobalOptionGiven("-resample-weight-cache", globalOptionArgs);
+        if (!QDir(globalOptionArgs[0]).exists()) throw CommandException("resample weight cache directory '" + globalOptionArgs[0] + "' does not exist");
+        SurfaceResamplingHelper::setWeightCacheDirectory(globalOptionArgs[0]);
+    }
+    if (getGlobalOption(parameters, "-smoothing-kernel-cache", 1, globalOptionArgs))
+    {
+        addGlobalOptionGiven("-smoothing-kernel-cache", globalOptionArgs);
+        if (!QDir(globalOptionArgs[0]).exists()) throw CommandException("smoothing kernel cache directory '" + globalOptionArgs[0] + "' does not exist");
+        MetricSmoothingObject::setKernelCacheDirectory(globalOptionArgs[0]);
+    }
     int16_t ciftiDType = NIFTI_TYPE_FLOAT32;
     bool ciftiScale = false;
     double ciftiMin = -1.0, ciftiMax = -1.0;
     if (getGlobalOption(parameters, "-cifti-output-datatype", 1, globalOptionArgs))
     {
+        addGlobalOptionGiven("-cifti-output-datatype", globalOptionArgs);
         ciftiDType = stringToCiftiType(globalOptionArgs[0]);
     }
     if (getGlobalOption(parameters, "-cifti-output-range", 2, globalOptionArgs))
     {
+        addGlobalOptionGiven("-cifti-output-range", globalOptionArgs);
         ciftiScale = true;
         bool valid = false;
         ciftiMin = globalOptionArgs[0].toDouble(&valid);
@@ -714,7 +745,17 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
     {//can't tab complete a literal number
         return "";
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    OptionInfo weightCacheInfo = parseGlobalOption(parameters, "-resample-weight-cache", 1, globalOptionArgs, true);
+    if (weightCacheInfo.specified && !weightCacheInfo.complete)
+    {//directory, no special completion type for that, so glob everything
+        return "fileglob *";
+    }
+    OptionInfo kernelCacheInfo = parseGlobalOption(parameters, "-smoothing-kernel-cache", 1, globalOptionArgs, true);
+    if (kernelCacheInfo.specified && !kernelCacheInfo.complete)
+    {
+        return "fileglob *";
+    }
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -resample-weight-cache\\ -smoothing-kernel-cache";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -763,6 +804,21 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
     return ret;
 }
 
+/**
+ * @return The switches and arguments of the global options given to the
+ * command being run, for commands that start other wb_command processes.
+ */
+const vector<AString>& CommandOperationManager::getGlobalOptionsGiven() const
+{
+    return globalOptionsGiven;
+}
+
+void CommandOperationManager::addGlobalOptionGiven(const AString& optionString, const vector<AString>& arguments)
+{
+    globalOptionsGiven.push_back(optionString);
+    globalOptionsGiven.insert(globalOptionsGiven.end(), arguments.begin(), arguments.end());
+}
+
 bool CommandOperationManager::getGlobalOption(ProgramParameters& parameters, const AString& optionString, const int& numArgs, vector<AString>& arguments)
 {
     OptionInfo retval = parseGlobalOption(parameters, optionString, numArgs, arguments, false);
@@ -1076,6 +1132,14 @@ void CommandOperationManager::printGlobalOptions()
     cout << "                                        represented, mostly useful with integer" << endl;
     cout << "                                        output datatypes (see above)" << endl;
     cout << endl;
+    cout << "   -resample-weight-cache <dir>      look in <dir> for surface resampling weights" << endl;
+    cout << "                                        made by -surface-resample-weights, and" << endl;
+    cout << "                                        use them when they match the inputs" << endl;
+    cout << endl;
+    cout << "   -smoothing-kernel-cache <dir>     look in <dir> for surface smoothing kernels" << endl;
+    cout << "                                        made by -surface-smoothing-kernels, and" << endl;
+    cout << "                                        use them when they match the inputs" << endl;
+    cout << endl;
     cout << "   -logging <level>                  set the logging level, valid values are:" << endl;
     vector<LogLevelEnum::Enum> logLevels;
     LogLevelEnum::getAllEnums(logLevels);
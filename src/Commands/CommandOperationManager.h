@@ -48,6 +48,8 @@ namespace caret {
         
         std::vector<CommandOperation*> getCommandOperations();
         
+        const std::vector<AString>& getGlobalOptionsGiven() const;
+        
     private:
         CommandOperationManager();
         
@@ -79,6 +81,8 @@ namespace caret {
         
         bool getGlobalOption(ProgramParameters& parameters, const AString& optionString, const int& numArgs, std::vector<AString>& arguments);
         
+        void addGlobalOptionGiven(const AString& optionString, const std::vector<AString>& arguments);
+        
         struct OptionInfo
         {
             bool specified;
@@ -94,6 +98,8 @@ namespace caret {
     private:
         std::vector<CommandOperation*> commandOperations, deprecatedOperations;
         
+        std::vector<AString> globalOptionsGiven;//switches and arguments of the global options given to the command being run
+        
         static CommandOperationManager* singletonCommandOperationManager;
     };
     
@@ -28,12 +28,14 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 
 #include <QFile>
 #include "zlib.h"
 
 #include <algorithm>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
@@ -63,6 +65,7 @@ namespace caret
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
     {
+    protected:
         QFile m_file;
         const static int64_t CHUNK_SIZE;
     public:
@@ -76,6 +79,64 @@ namespace caret
     };
     
     const int64_t QFileImpl::CHUNK_SIZE = 1<<30;//1GiB, QT4 apparently chokes at more than 2GiB via buffer.read using int32
+    
+    //read-only, maps the entire file so that callers can get at the data without a copy or a lock
+    //if the mapping fails (32-bit address space, odd filesystems), acts exactly like QFileImpl
+    class MMapFileImpl : public QFileImpl
+    {
+        uchar* m_map;
+        int64_t m_mapSize, m_pos;
+    public:
+        MMapFileImpl() { m_map = NULL; m_mapSize = 0; m_pos = 0; }
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        const char* getMemoryMap() const { return (const char*)m_map; }
+        int64_t getMemoryMapSize() const { return m_mapSize; }
+    };
+    
+#ifdef ZLIB_VERSION
+    //gzip file made of many small gzip members (like BGZF), each with an extra header field giving its sizes
+    //standard gzip tools read it as one stream, but we can compress and decompress blocks in parallel, and seek by inflating only one block
+    class BlockZFileImpl : public CaretBinaryFile::ImplInterface
+    {
+        struct BlockInfo
+        {
+            int64_t m_fileOffset, m_memberSize, m_dataStart, m_dataSize;//member size includes header and trailer, data positions are uncompressed
+        };
+        QFileImpl m_rawFile;
+        CaretBinaryFile::OpenMode m_mode;
+        int64_t m_pos, m_totalSize;
+        std::vector<BlockInfo> m_index;
+        std::vector<char> m_cachedBlock;//the last partially read block, so small sequential reads don't inflate it repeatedly
+        int64_t m_cachedIndex;
+        std::vector<char> m_writeBuffer;
+        int64_t m_rawWritten;
+        const static int64_t BLOCK_SIZE, BATCH_BLOCKS;
+        const static int HEADER_SIZE = 24, TRAILER_SIZE = 8;
+        int64_t findBlock(const int64_t& position) const;
+        void inflateBlock(const char* member, const BlockInfo& info, char* dataOut) const;//only touches its arguments, so blocks can be inflated in parallel
+        static void deflateBlock(const char* dataIn, const int64_t& count, std::vector<char>& memberOut);
+        void flushBlocks(const bool& final);
+    public:
+        BlockZFileImpl() { m_mode = CaretBinaryFile::NONE; m_pos = 0; m_totalSize = 0; m_cachedIndex = -1; m_rawWritten = 0; }
+        static bool isBlockFile(const QString& filename);
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_pos; }
+        int64_t size();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~BlockZFileImpl();
+    };
+    
+    const int64_t BlockZFileImpl::BLOCK_SIZE = 1<<20;//1MiB uncompressed, large enough that compression ratio doesn't suffer
+    const int64_t BlockZFileImpl::BATCH_BLOCKS = 64;//how many blocks to hand to the threads at once, same as the ZFileImpl chunk size
+#endif //ZLIB_VERSION
 }
 
 CaretBinaryFile::ImplInterface::~ImplInterface()
@@ -115,18 +176,42 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
 {
     close();
     if (opmode == NONE) throw DataFileException("can't open file with NONE mode");
+    OpenMode baseMode = (OpenMode)(opmode & ~MEMORY_MAP);//mapping is just a hint, implementations only see the real mode
+    if (baseMode == NONE) throw DataFileException("can't open file with only MEMORY_MAP mode");
     if (filename.endsWith(".gz"))
     {
 #ifdef ZLIB_VERSION
-        m_impl.grabNew(new ZFileImpl());
+        if (baseMode == WRITE_TRUNCATE || (baseMode == READ && BlockZFileImpl::isBlockFile(filename)))
+        {//other gzip files can only be read serially
+            m_impl.grabNew(new BlockZFileImpl());
+        } else {
+            m_impl.grabNew(new ZFileImpl());
+        }
 #else //ZLIB_VERSION
         throw DataFileException("can't open .gz file '" + filename + "', compiled without zlib support");
 #endif //ZLIB_VERSION
     } else {
-        m_impl.grabNew(new QFileImpl());
+        if ((opmode & MEMORY_MAP) && baseMode == READ)
+        {
+            m_impl.grabNew(new MMapFileImpl());
+        } else {
+            m_impl.grabNew(new QFileImpl());
+        }
     }
-    m_impl->open(filename, opmode);
-    m_curMode = opmode;
+    m_impl->open(filename, baseMode);
+    m_curMode = baseMode;
+}
+
+const char* CaretBinaryFile::getMemoryMap() const
+{
+    if (m_impl == NULL) return NULL;
+    return m_impl->getMemoryMap();
+}
+
+int64_t CaretBinaryFile::getMemoryMapSize() const
+{
+    if (m_impl == NULL) return 0;
+    return m_impl->getMemoryMapSize();
 }
 
 void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead)
@@ -279,6 +364,322 @@ ZFileImpl::~ZFileImpl()
         CaretLogSevere("caught unknown exception type while closing a compressed file");
     }
 }
+
+bool BlockZFileImpl::isBlockFile(const QString& filename)
+{
+    QFile testFile(filename);
+    if (!testFile.open(QIODevice::ReadOnly)) return false;//let ZFileImpl generate the error
+    unsigned char header[HEADER_SIZE];
+    if (testFile.read((char*)header, HEADER_SIZE) != HEADER_SIZE) return false;
+    return (header[0] == 0x1f && header[1] == 0x8b && header[2] == 8 && (header[3] & 4) &&//gzip magic, deflate, FEXTRA
+            header[10] == 12 && header[11] == 0 && header[12] == 'W' && header[13] == 'B' && header[14] == 8 && header[15] == 0);//XLEN = 12, one subfield 'WB' of length 8
+}
+
+namespace
+{
+    uint32_t readLE32(const unsigned char* bytes)
+    {
+        return ((uint32_t)bytes[0]) | (((uint32_t)bytes[1]) << 8) | (((uint32_t)bytes[2]) << 16) | (((uint32_t)bytes[3]) << 24);
+    }
+    
+    void writeLE32(unsigned char* bytes, const uint32_t& value)
+    {
+        bytes[0] = value & 0xff;
+        bytes[1] = (value >> 8) & 0xff;
+        bytes[2] = (value >> 16) & 0xff;
+        bytes[3] = (value >> 24) & 0xff;
+    }
+}
+
+void BlockZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    switch (opmode)
+    {
+        case CaretBinaryFile::READ:
+        case CaretBinaryFile::WRITE_TRUNCATE:
+            break;
+        default:
+            throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    }
+    m_rawFile.open(filename, opmode);
+    m_mode = opmode;
+    m_pos = 0;
+    m_totalSize = 0;
+    m_rawWritten = 0;
+    if (opmode == CaretBinaryFile::READ)
+    {//read just the headers to build the block index, the data doesn't get touched
+        int64_t fileSize = m_rawFile.size(), offset = 0;
+        while (offset < fileSize)
+        {
+            unsigned char header[HEADER_SIZE];
+            m_rawFile.seek(offset);
+            m_rawFile.read(header, HEADER_SIZE, NULL);
+            if (header[0] != 0x1f || header[1] != 0x8b || header[12] != 'W' || header[13] != 'B')
+            {
+                throw DataFileException("compressed file '" + filename + "' has a gzip member without block information, it may have been modified by other software");
+            }
+            BlockInfo info;
+            info.m_fileOffset = offset;
+            info.m_memberSize = readLE32(header + 16);
+            info.m_dataStart = m_totalSize;
+            info.m_dataSize = readLE32(header + 20);
+            if (info.m_memberSize < HEADER_SIZE + TRAILER_SIZE || offset + info.m_memberSize > fileSize)
+            {
+                throw DataFileException("compressed file '" + filename + "' has invalid block information, it may be truncated");
+            }
+            m_index.push_back(info);
+            offset += info.m_memberSize;
+            m_totalSize += info.m_dataSize;
+        }
+    }
+}
+
+int64_t BlockZFileImpl::size()
+{
+    if (m_mode == CaretBinaryFile::READ) return m_totalSize;
+    return -1;
+}
+
+int64_t BlockZFileImpl::findBlock(const int64_t& position) const
+{
+    CaretAssert(position >= 0 && position < m_totalSize);
+    int64_t low = 0, high = (int64_t)m_index.size();//binary search, because the last block and empty blocks aren't full size
+    while (high - low > 1)
+    {
+        int64_t guess = (low + high) / 2;
+        if (m_index[guess].m_dataStart > position)
+        {
+            high = guess;
+        } else {
+            low = guess;
+        }
+    }
+    while (m_index[low].m_dataSize == 0) ++low;//skip empty blocks, a valid position must be in a later block
+    return low;
+}
+
+void BlockZFileImpl::inflateBlock(const char* member, const BlockInfo& info, char* dataOut) const
+{
+    z_stream myStream;
+    memset(&myStream, 0, sizeof(z_stream));
+    if (inflateInit2(&myStream, -15) != Z_OK) throw DataFileException("failed to initialize zlib");//raw deflate, we already know where the header is
+    myStream.next_in = (Bytef*)(member + HEADER_SIZE);
+    myStream.avail_in = (uInt)(info.m_memberSize - HEADER_SIZE - TRAILER_SIZE);
+    myStream.next_out = (Bytef*)dataOut;
+    myStream.avail_out = (uInt)info.m_dataSize;
+    int ret = inflate(&myStream, Z_FINISH);
+    inflateEnd(&myStream);
+    if (ret != Z_STREAM_END || myStream.avail_out != 0)
+    {
+        throw DataFileException("error decompressing block in compressed file '" + m_fileName + "'");
+    }
+    const unsigned char* trailer = (const unsigned char*)(member + info.m_memberSize - TRAILER_SIZE);
+    if (crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataOut, (uInt)info.m_dataSize) != readLE32(trailer))
+    {
+        throw DataFileException("checksum mismatch in compressed file '" + m_fileName + "'");
+    }
+}
+
+void BlockZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (m_mode != CaretBinaryFile::READ) throw DataFileException("read called on compressed file opened for writing");
+    int64_t toRead = min(count, m_totalSize - m_pos), totalRead = 0;
+    char* charOut = (char*)dataOut;
+    while (totalRead < toRead)
+    {
+        int64_t curBlock = findBlock(m_pos);
+        const BlockInfo& curInfo = m_index[curBlock];
+        int64_t blockOffset = m_pos - curInfo.m_dataStart, remaining = toRead - totalRead;
+        if (blockOffset != 0 || remaining < curInfo.m_dataSize)
+        {//partial block, go through the cache
+            if (m_cachedIndex != curBlock)
+            {
+                vector<char> member(curInfo.m_memberSize);
+                m_rawFile.seek(curInfo.m_fileOffset);
+                m_rawFile.read(member.data(), curInfo.m_memberSize, NULL);
+                m_cachedBlock.resize(curInfo.m_dataSize);
+                m_cachedIndex = -1;//in case of exception
+                inflateBlock(member.data(), curInfo, m_cachedBlock.data());
+                m_cachedIndex = curBlock;
+            }
+            int64_t toCopy = min(remaining, curInfo.m_dataSize - blockOffset);
+            memcpy(charOut + totalRead, m_cachedBlock.data() + blockOffset, toCopy);
+            totalRead += toCopy;
+            m_pos += toCopy;
+        } else {//whole blocks, read a batch of them and inflate them in parallel, straight into the output
+            int64_t endBlock = curBlock;
+            int64_t batchSize = 0;
+            while (endBlock < (int64_t)m_index.size() && endBlock - curBlock < BATCH_BLOCKS && batchSize + m_index[endBlock].m_dataSize <= remaining)
+            {
+                batchSize += m_index[endBlock].m_dataSize;
+                ++endBlock;
+            }
+            CaretAssert(endBlock > curBlock);
+            int64_t rawStart = curInfo.m_fileOffset, rawEnd = m_index[endBlock - 1].m_fileOffset + m_index[endBlock - 1].m_memberSize;
+            vector<char> members(rawEnd - rawStart);
+            m_rawFile.seek(rawStart);
+            m_rawFile.read(members.data(), rawEnd - rawStart, NULL);
+            bool failed = false;
+            AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = curBlock; i < endBlock; ++i)
+            {
+                try
+                {
+                    inflateBlock(members.data() + (m_index[i].m_fileOffset - rawStart), m_index[i], charOut + totalRead + (m_index[i].m_dataStart - m_pos));
+                } catch (CaretException& e) {
+#pragma omp critical
+                    {
+                        failed = true;
+                        errorMessage = e.whatString();
+                    }
+                }
+            }
+            if (failed) throw DataFileException(errorMessage);
+            totalRead += batchSize;
+            m_pos += batchSize;
+        }
+    }
+    if (numRead == NULL)
+    {
+        if (totalRead != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+    } else {
+        *numRead = totalRead;
+    }
+}
+
+void BlockZFileImpl::seek(const int64_t& position)
+{
+    if (m_mode == CaretBinaryFile::READ)
+    {
+        if (position > m_totalSize) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+        m_pos = position;//the block gets found on the next read
+    } else {//like gzseek, only forward seeks are allowed while writing, and they fill with zeros
+        if (position < m_pos) throw DataFileException("can't seek backwards while writing compressed file '" + m_fileName + "'");
+        m_writeBuffer.resize(m_writeBuffer.size() + (position - m_pos), 0);
+        m_pos = position;
+        flushBlocks(false);
+    }
+}
+
+void BlockZFileImpl::deflateBlock(const char* dataIn, const int64_t& count, vector<char>& memberOut)
+{
+    CaretAssert(count <= BLOCK_SIZE);
+    z_stream myStream;
+    memset(&myStream, 0, sizeof(z_stream));
+    if (deflateInit2(&myStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw DataFileException("failed to initialize zlib");
+    memberOut.resize(HEADER_SIZE + deflateBound(&myStream, (uLong)count) + TRAILER_SIZE);
+    myStream.next_in = (Bytef*)dataIn;
+    myStream.avail_in = (uInt)count;
+    myStream.next_out = (Bytef*)(memberOut.data() + HEADER_SIZE);
+    myStream.avail_out = (uInt)(memberOut.size() - HEADER_SIZE - TRAILER_SIZE);
+    int ret = deflate(&myStream, Z_FINISH);
+    int64_t compressedSize = myStream.total_out;
+    deflateEnd(&myStream);
+    if (ret != Z_STREAM_END) throw DataFileException("error while compressing data");
+    memberOut.resize(HEADER_SIZE + compressedSize + TRAILER_SIZE);
+    unsigned char* header = (unsigned char*)memberOut.data();
+    memset(header, 0, HEADER_SIZE);
+    header[0] = 0x1f;//gzip magic
+    header[1] = 0x8b;
+    header[2] = 8;//deflate
+    header[3] = 4;//FEXTRA
+    header[9] = 255;//unknown OS
+    header[10] = 12;//XLEN
+    header[12] = 'W';//subfield ID
+    header[13] = 'B';
+    header[14] = 8;//subfield length
+    writeLE32(header + 16, (uint32_t)memberOut.size());
+    writeLE32(header + 20, (uint32_t)count);
+    unsigned char* trailer = (unsigned char*)(memberOut.data() + memberOut.size() - TRAILER_SIZE);
+    writeLE32(trailer, (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataIn, (uInt)count));
+    writeLE32(trailer + 4, (uint32_t)count);//ISIZE
+}
+
+void BlockZFileImpl::flushBlocks(const bool& final)
+{//compress full batches in parallel, or everything left when closing
+    int64_t bufferSize = (int64_t)m_writeBuffer.size();
+    if (!final && bufferSize < BLOCK_SIZE * BATCH_BLOCKS) return;
+    int64_t numBlocks = bufferSize / BLOCK_SIZE;
+    if (final)
+    {
+        if (bufferSize % BLOCK_SIZE != 0 || (numBlocks == 0 && m_rawWritten == 0)) ++numBlocks;//an empty file still needs one member to be valid gzip
+    }
+    if (numBlocks == 0) return;
+    vector<vector<char> > members(numBlocks);
+    bool failed = false;
+    AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        try
+        {
+            int64_t start = i * BLOCK_SIZE;
+            deflateBlock(m_writeBuffer.data() + start, min(BLOCK_SIZE, bufferSize - start), members[i]);
+        } catch (CaretException& e) {
+#pragma omp critical
+            {
+                failed = true;
+                errorMessage = e.whatString();
+            }
+        }
+    }
+    if (failed) throw DataFileException("failed writing compressed file '" + m_fileName + "': " + errorMessage);
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        m_rawFile.write(members[i].data(), members[i].size());
+        m_rawWritten += members[i].size();
+    }
+    int64_t used = min(numBlocks * BLOCK_SIZE, bufferSize);
+    m_writeBuffer.erase(m_writeBuffer.begin(), m_writeBuffer.begin() + used);
+}
+
+void BlockZFileImpl::write(const void* dataIn, const int64_t& count)
+{
+    if (m_mode != CaretBinaryFile::WRITE_TRUNCATE) throw DataFileException("write called on compressed file opened for reading");
+    const char* charIn = (const char*)dataIn;
+    int64_t totalWritten = 0, batchBytes = BLOCK_SIZE * BATCH_BLOCKS;
+    while (totalWritten < count)
+    {//add to the buffer in batch-sized pieces, so huge writes don't double the memory use
+        int64_t toAdd = min(count - totalWritten, batchBytes - (int64_t)m_writeBuffer.size());
+        if (toAdd < 1) toAdd = count - totalWritten;//buffer is already over a batch, from seek padding
+        m_writeBuffer.insert(m_writeBuffer.end(), charIn + totalWritten, charIn + totalWritten + toAdd);
+        totalWritten += toAdd;
+        m_pos += toAdd;
+        flushBlocks(false);
+    }
+}
+
+void BlockZFileImpl::close()
+{
+    if (m_mode == CaretBinaryFile::WRITE_TRUNCATE)
+    {
+        m_mode = CaretBinaryFile::NONE;//don't try again from the destructor if this throws
+        flushBlocks(true);
+    }
+    m_mode = CaretBinaryFile::NONE;
+    m_rawFile.close();
+    m_index.clear();
+    m_writeBuffer.clear();
+    m_cachedBlock.clear();
+    m_cachedIndex = -1;
+}
+
+BlockZFileImpl::~BlockZFileImpl()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
 #endif //ZLIB_VERSION
 
 void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
@@ -374,3 +775,72 @@ void QFileImpl::write(const void* dataIn, const int64_t& count)
                          + " bytes.");
     if (total != count) throw DataFileException(msg);
 }
+
+void MMapFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    CaretAssert(opmode == CaretBinaryFile::READ);//CaretBinaryFile shouldn't give us anything else
+    QFileImpl::open(filename, opmode);
+    m_pos = 0;
+    m_mapSize = m_file.size();
+    if (m_mapSize > 0)
+    {
+        m_map = m_file.map(0, m_mapSize);
+    }
+    if (m_map == NULL)
+    {
+        CaretLogFine("unable to memory map file '" + filename + "', using normal reads");
+        m_mapSize = 0;
+    }
+}
+
+void MMapFileImpl::close()
+{
+    if (m_map != NULL)
+    {
+        m_file.unmap(m_map);//QFile::close() would also do this, but be explicit
+        m_map = NULL;
+    }
+    m_mapSize = 0;
+    m_pos = 0;
+    QFileImpl::close();
+}
+
+void MMapFileImpl::seek(const int64_t& position)
+{
+    if (m_map == NULL)
+    {
+        QFileImpl::seek(position);
+        return;
+    }
+    if (position > m_mapSize) throw DataFileException("seek failed in file '" + m_fileName + "'");//same as QFile, allow seeking to exactly the end
+    m_pos = position;
+}
+
+int64_t MMapFileImpl::pos()
+{
+    if (m_map == NULL) return QFileImpl::pos();
+    return m_pos;
+}
+
+void MMapFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (m_map == NULL)
+    {
+        QFileImpl::read(dataOut, count, numRead);
+        return;
+    }
+    int64_t total = min(count, m_mapSize - m_pos);
+    memcpy(dataOut, m_map + m_pos, total);
+    m_pos += total;
+    if (numRead == NULL)
+    {
+        if (total != count) throw DataFileException("premature end of file in '" + m_fileName + "'");
+    } else {
+        *numRead = total;
+    }
+}
+
+void MMapFileImpl::write(const void*, const int64_t&)
+{
+    throw DataFileException("write called on memory mapped file '" + m_fileName + "', which is read-only");//shouldn't happen, CaretBinaryFile checks the mode
+}
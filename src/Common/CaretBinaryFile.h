@@ -41,7 +41,9 @@ namespace caret {
             READ_WRITE = 3,//for convenience
             TRUNCATE = 4,
             WRITE_TRUNCATE = 6,//ditto
-            READ_WRITE_TRUNCATE = 7//ditto
+            READ_WRITE_TRUNCATE = 7,//ditto
+            MEMORY_MAP = 8,//only honored with plain READ on uncompressed files, falls back to normal reading if the mapping fails
+            READ_MEMORY_MAP = 9//ditto
         };
         CaretBinaryFile() { }
         ///constructor that opens file
@@ -56,6 +58,8 @@ namespace caret {
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
         int64_t size();//may return -1 if size cannot be determined efficiently
+        const char* getMemoryMap() const;//returns NULL if the file is not memory mapped, pointer is only valid until close()
+        int64_t getMemoryMapSize() const;
         class ImplInterface
         {
         protected:
@@ -69,6 +73,8 @@ namespace caret {
             virtual int64_t size() = 0;
             virtual void read(void* dataOut, const int64_t& count, int64_t* numRead) = 0;
             virtual void write(const void* dataIn, const int64_t& count) = 0;
+            virtual const char* getMemoryMap() const { return NULL; }//only the mmap implementation overrides these
+            virtual int64_t getMemoryMapSize() const { return 0; }
             virtual ~ImplInterface();
         };
     private:
@@ -22,7 +22,9 @@
 #include "CaretException.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -38,6 +40,10 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
     {
         throw CaretException("extra characters on end of expression input: '" + m_input.mid(m_position) + "'");
     }
+    int curDepth = 0;
+    m_stackDepth = 0;
+    compileNode(m_root, m_program, curDepth, m_stackDepth);
+    CaretAssert(curDepth == 1);
     CaretLogFiner("parsed '" + expression + "' as '" + toString() + "'");
 }
 
@@ -47,6 +53,247 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root->eval(variableValues);
 }
 
+namespace
+{
+    const int64_t EVAL_BLOCK_SIZE = 256;//elements per stack slot, small enough that the whole stack stays in cache
+}
+
+void CaretMathExpression::evaluateArrays(const vector<const float*>& variableArrays, float* dataOut, const int64_t& count) const
+{
+    CaretAssert(variableArrays.size() == m_varNames.size());
+    int64_t numBlocks = (count + EVAL_BLOCK_SIZE - 1) / EVAL_BLOCK_SIZE;
+    if (numBlocks < 2)
+    {
+        vector<double> stack(m_stackDepth * EVAL_BLOCK_SIZE);
+        runProgram(variableArrays, 0, count, stack.data(), dataOut);
+        return;
+    }
+#pragma omp CARET_PAR
+    {
+        vector<double> stack(m_stackDepth * EVAL_BLOCK_SIZE);//per-thread
+#pragma omp CARET_FOR schedule(static)
+        for (int64_t block = 0; block < numBlocks; ++block)
+        {
+            int64_t start = block * EVAL_BLOCK_SIZE;
+            runProgram(variableArrays, start, min(EVAL_BLOCK_SIZE, count - start), stack.data(), dataOut);
+        }
+    }
+}
+
+void CaretMathExpression::runProgram(const vector<const float*>& variableArrays, const int64_t& start, const int64_t& count, double* stack, float* dataOut) const
+{//every instruction is a simple loop over the block, so that the compiler can vectorize them
+    int depth = 0;
+    int numInstr = (int)m_program.size();
+    for (int instr = 0; instr < numInstr; ++instr)
+    {
+        const MathInstruction& myInstr = m_program[instr];
+        switch (myInstr.m_op)
+        {
+            case MathInstruction::PUSH_VAR:
+            {
+                CaretAssertVectorIndex(variableArrays, myInstr.m_varIndex);
+                const float* source = variableArrays[myInstr.m_varIndex] + start;
+                double* dest = stack + depth * EVAL_BLOCK_SIZE;
+                for (int64_t i = 0; i < count; ++i) dest[i] = source[i];
+                ++depth;
+                continue;//we don't pop anything
+            }
+            case MathInstruction::PUSH_CONST:
+            {
+                double* dest = stack + depth * EVAL_BLOCK_SIZE;
+                for (int64_t i = 0; i < count; ++i) dest[i] = myInstr.m_constVal;
+                ++depth;
+                continue;
+            }
+            case MathInstruction::NOT:
+            {
+                double* top = stack + (depth - 1) * EVAL_BLOCK_SIZE;//unary operators don't pop
+                for (int64_t i = 0; i < count; ++i) top[i] = (top[i] > 0.0) ? 0.0 : 1.0;
+                continue;
+            }
+            case MathInstruction::NEGATE:
+            {
+                double* top = stack + (depth - 1) * EVAL_BLOCK_SIZE;
+                for (int64_t i = 0; i < count; ++i) top[i] = -top[i];
+                continue;
+            }
+            case MathInstruction::FUNC:
+            {
+                double* args[3];
+                CaretAssert(myInstr.m_numArgs >= 1 && myInstr.m_numArgs <= 3);
+                for (int arg = 0; arg < myInstr.m_numArgs; ++arg)
+                {
+                    args[arg] = stack + (depth - myInstr.m_numArgs + arg) * EVAL_BLOCK_SIZE;
+                }
+                applyFunction(myInstr.m_function, myInstr.m_numArgs, args, count);
+                depth -= myInstr.m_numArgs - 1;
+                continue;
+            }
+            default:
+                break;
+        }
+        --depth;//everything else is a binary operator: pop the right argument, and put the result in place of the left argument
+        double* top = stack + (depth - 1) * EVAL_BLOCK_SIZE;
+        const double* right = stack + depth * EVAL_BLOCK_SIZE;
+        switch (myInstr.m_op)
+        {
+            case MathInstruction::ADD:
+                for (int64_t i = 0; i < count; ++i) top[i] += right[i];
+                break;
+            case MathInstruction::SUB:
+                for (int64_t i = 0; i < count; ++i) top[i] -= right[i];
+                break;
+            case MathInstruction::MULT:
+                for (int64_t i = 0; i < count; ++i) top[i] *= right[i];
+                break;
+            case MathInstruction::DIV:
+                for (int64_t i = 0; i < count; ++i) top[i] /= right[i];
+                break;
+            case MathInstruction::EQUAL:
+            case MathInstruction::NOT_EQUAL:
+            {
+                double trueVal = (myInstr.m_op == MathInstruction::EQUAL) ? 1.0 : 0.0;
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(top[i]), abs(right[i])) / 1000000;//same fudge factor as MathNode::eval
+                    bool equal = (top[i] >= right[i] - adjust) && (top[i] <= right[i] + adjust);
+                    top[i] = equal ? trueVal : 1.0 - trueVal;
+                }
+                break;
+            }
+            case MathInstruction::GREATER:
+                for (int64_t i = 0; i < count; ++i) top[i] = (top[i] > right[i] ? 1.0 : 0.0);
+                break;
+            case MathInstruction::LESS:
+                for (int64_t i = 0; i < count; ++i) top[i] = (top[i] < right[i] ? 1.0 : 0.0);
+                break;
+            case MathInstruction::GREATER_EQUAL:
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(top[i]), abs(right[i])) / 1000000;
+                    top[i] = (top[i] >= right[i] - adjust ? 1.0 : 0.0);
+                }
+                break;
+            case MathInstruction::LESS_EQUAL:
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(top[i]), abs(right[i])) / 1000000;
+                    top[i] = (top[i] <= right[i] + adjust ? 1.0 : 0.0);
+                }
+                break;
+            case MathInstruction::AND://no side effects, so evaluating both sides gives the same answer as lazy evaluation
+                for (int64_t i = 0; i < count; ++i) top[i] = ((top[i] > 0.0 && right[i] > 0.0) ? 1.0 : 0.0);
+                break;
+            case MathInstruction::OR:
+                for (int64_t i = 0; i < count; ++i) top[i] = ((top[i] > 0.0 || right[i] > 0.0) ? 1.0 : 0.0);
+                break;
+            case MathInstruction::POW:
+                for (int64_t i = 0; i < count; ++i) top[i] = pow(top[i], right[i]);
+                break;
+            default:
+                CaretAssertMessage(0, "unhandled instruction in CaretMathExpression program");
+                throw CaretException("parsing problem in CaretMathExpression");
+        }
+    }
+    CaretAssert(depth == 1);
+    for (int64_t i = 0; i < count; ++i)
+    {
+        dataOut[start + i] = (float)stack[i];
+    }
+}
+
+void CaretMathExpression::compileNode(const MathNode* node, vector<MathInstruction>& program, int& curDepth, int& maxDepth)
+{
+    int numArgs = (int)node->m_arguments.size();
+    switch (node->m_type)
+    {
+        case MathNode::VAR:
+        {
+            MathInstruction temp(MathInstruction::PUSH_VAR);
+            temp.m_varIndex = node->m_varIndex;
+            program.push_back(temp);
+            ++curDepth;
+            maxDepth = max(maxDepth, curDepth);
+            return;
+        }
+        case MathNode::CONST:
+        {
+            MathInstruction temp(MathInstruction::PUSH_CONST);
+            temp.m_constVal = node->m_constVal;
+            program.push_back(temp);
+            ++curDepth;
+            maxDepth = max(maxDepth, curDepth);
+            return;
+        }
+        case MathNode::NOT:
+        case MathNode::NEGATE:
+            CaretAssert(numArgs == 1);
+            compileNode(node->m_arguments[0], program, curDepth, maxDepth);
+            program.push_back(MathInstruction(node->m_type == MathNode::NOT ? MathInstruction::NOT : MathInstruction::NEGATE));
+            return;
+        case MathNode::FUNC:
+        {
+            CaretAssert(numArgs > 0);
+            for (int i = 0; i < numArgs; ++i)
+            {
+                compileNode(node->m_arguments[i], program, curDepth, maxDepth);
+            }
+            MathInstruction temp(MathInstruction::FUNC);
+            temp.m_function = node->m_function;
+            temp.m_numArgs = numArgs;
+            program.push_back(temp);
+            curDepth -= numArgs - 1;
+            return;
+        }
+        case MathNode::INVALID:
+            CaretAssertMessage(0, "parsing left INVALID MathNode");
+            throw CaretException("parsing problem in CaretMathExpression");
+        default://n-ary operators, evaluated left to right just like MathNode::eval
+            break;
+    }
+    CaretAssert(numArgs > 1);
+    compileNode(node->m_arguments[0], program, curDepth, maxDepth);
+    for (int i = 1; i < numArgs; ++i)
+    {
+        compileNode(node->m_arguments[i], program, curDepth, maxDepth);
+        MathInstruction::OpCode op = MathInstruction::ADD;
+        switch (node->m_type)
+        {
+            case MathNode::OR:
+                op = MathInstruction::OR;
+                break;
+            case MathNode::AND:
+                op = MathInstruction::AND;
+                break;
+            case MathNode::EQUAL:
+                op = node->m_invert[i] ? MathInstruction::NOT_EQUAL : MathInstruction::EQUAL;
+                break;
+            case MathNode::GREATERLESS:
+                if (node->m_inclusive[i])
+                {
+                    op = node->m_invert[i] ? MathInstruction::LESS_EQUAL : MathInstruction::GREATER_EQUAL;
+                } else {
+                    op = node->m_invert[i] ? MathInstruction::LESS : MathInstruction::GREATER;
+                }
+                break;
+            case MathNode::ADDSUB:
+                op = node->m_invert[i] ? MathInstruction::SUB : MathInstruction::ADD;
+                break;
+            case MathNode::MULTDIV:
+                op = node->m_invert[i] ? MathInstruction::DIV : MathInstruction::MULT;
+                break;
+            case MathNode::POW:
+                op = MathInstruction::POW;
+                break;
+            default:
+                CaretAssertMessage(0, "unhandled MathNode type in compileNode");
+                throw CaretException("parsing problem in CaretMathExpression");
+        }
+        program.push_back(MathInstruction(op));
+        --curDepth;
+    }
+}
+
 vector<AString> CaretMathExpression::getVarNames() const
 {
     vector<AString> ret(m_varNames.size());
@@ -216,166 +463,16 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
         }
         case FUNC:
         {
-            switch (m_function)//this could be (partly) moved into MathFunctionEnum, but it wouldn't strictly be an enum class then
+            int numArgs = (int)m_arguments.size();
+            CaretAssert(numArgs >= 1 && numArgs <= 3);
+            double argVals[3];
+            double* argPtrs[3] = { argVals, argVals + 1, argVals + 2 };
+            for (int i = 0; i < numArgs; ++i)
             {
-                case MathFunctionEnum::SIN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sin(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::COS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = cos(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::TAN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = tan(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ASIN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = asin(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ACOS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = acos(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ATAN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = atan(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::SINH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sinh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::COSH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = cosh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::TANH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = tanh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ASINH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = asinh(m_arguments[0].eval(values));//will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
-                    double arg = m_arguments[0]->eval(values);
-                    if (arg > 0)
-                    {
-                        ret = log(arg + sqrt(arg * arg + 1));
-                    } else {
-                        ret = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
-                    }
-                    break;
-                }
-                case MathFunctionEnum::ACOSH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = acosh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = log(arg + sqrt(arg * arg - 1));
-                    break;
-                }
-                case MathFunctionEnum::ATANH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = atanh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = 0.5 * log((1 + arg) / (1 - arg));
-                    break;
-                }
-                case MathFunctionEnum::LN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::EXP:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = exp(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::LOG:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log10(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::SQRT:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sqrt(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ABS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = abs(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::FLOOR:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = floor(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ROUND:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    double temp = m_arguments[0]->eval(values);//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
-                    if (temp > 0.0)
-                    {
-                        ret = floor(temp + 0.5);
-                    } else {
-                        ret = ceil(temp - 0.5);
-                    }
-                    break;
-                }
-                case MathFunctionEnum::CEIL:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = ceil(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ATAN2:
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = atan2(m_arguments[0]->eval(values), m_arguments[1]->eval(values));
-                    break;
-                case MathFunctionEnum::MIN:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = m_arguments[0]->eval(values);
-                    double other = m_arguments[1]->eval(values);
-                    if (ret > other) ret = other;
-                    break;
-                }
-                case MathFunctionEnum::MAX:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = m_arguments[0]->eval(values);
-                    double other = m_arguments[1]->eval(values);
-                    if (ret < other) ret = other;
-                    break;
-                }
-                case MathFunctionEnum::MOD:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    double second = m_arguments[1]->eval(values);
-                    if (second == 0.0)
-                    {
-                        ret = 0.0;
-                    } else {
-                        double first = m_arguments[0]->eval(values);
-                        ret = first - second * floor(first / second);
-                    }
-                    break;
-                }
-                case MathFunctionEnum::CLAMP:
-                {
-                    CaretAssert(m_arguments.size() == 3);
-                    ret = m_arguments[0]->eval(values);
-                    double low = m_arguments[1]->eval(values);
-                    double high = m_arguments[2]->eval(values);
-                    if (ret < low)
-                    {
-                        ret = low;
-                    }
-                    if (ret > high)
-                    {
-                        ret = high;
-                    }
-                    break;
-                }
-                case INVALID:
-                    CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
-                    throw CaretException("parsing problem in CaretMathExpression");
+                argVals[i] = m_arguments[i]->eval(values);
             }
+            applyFunction(m_function, numArgs, argPtrs, 1);//share the implementation with the compiled version
+            ret = argVals[0];
             break;
         }
         case VAR:
@@ -392,6 +489,176 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
     return ret;
 }
 
+//this could be (partly) moved into MathFunctionEnum, but it wouldn't strictly be an enum class then
+void CaretMathExpression::applyFunction(const MathFunctionEnum::Enum& function, const int& numArgs, double* const* args, const int64_t& count)
+{
+    double* ret = args[0];//result overwrites the first argument
+    switch (function)
+    {
+        case MathFunctionEnum::SIN:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = sin(ret[i]);
+            break;
+        case MathFunctionEnum::COS:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = cos(ret[i]);
+            break;
+        case MathFunctionEnum::TAN:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = tan(ret[i]);
+            break;
+        case MathFunctionEnum::ASIN:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = asin(ret[i]);
+            break;
+        case MathFunctionEnum::ACOS:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = acos(ret[i]);
+            break;
+        case MathFunctionEnum::ATAN:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = atan(ret[i]);
+            break;
+        case MathFunctionEnum::SINH:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = sinh(ret[i]);
+            break;
+        case MathFunctionEnum::COSH:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = cosh(ret[i]);
+            break;
+        case MathFunctionEnum::TANH:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = tanh(ret[i]);
+            break;
+        case MathFunctionEnum::ASINH:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i)
+            {//asinh() will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
+                double arg = ret[i];
+                if (arg > 0)
+                {
+                    ret[i] = log(arg + sqrt(arg * arg + 1));
+                } else {
+                    ret[i] = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
+                }
+            }
+            break;
+        case MathFunctionEnum::ACOSH:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i)
+            {
+                double arg = ret[i];
+                ret[i] = log(arg + sqrt(arg * arg - 1));
+            }
+            break;
+        case MathFunctionEnum::ATANH:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i)
+            {
+                double arg = ret[i];
+                ret[i] = 0.5 * log((1 + arg) / (1 - arg));
+            }
+            break;
+        case MathFunctionEnum::LN:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = log(ret[i]);
+            break;
+        case MathFunctionEnum::EXP:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = exp(ret[i]);
+            break;
+        case MathFunctionEnum::LOG:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = log10(ret[i]);
+            break;
+        case MathFunctionEnum::SQRT:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = sqrt(ret[i]);
+            break;
+        case MathFunctionEnum::ABS:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = abs(ret[i]);
+            break;
+        case MathFunctionEnum::FLOOR:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = floor(ret[i]);
+            break;
+        case MathFunctionEnum::ROUND:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i)
+            {//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
+                if (ret[i] > 0.0)
+                {
+                    ret[i] = floor(ret[i] + 0.5);
+                } else {
+                    ret[i] = ceil(ret[i] - 0.5);
+                }
+            }
+            break;
+        case MathFunctionEnum::CEIL:
+            CaretAssert(numArgs == 1);
+            for (int64_t i = 0; i < count; ++i) ret[i] = ceil(ret[i]);
+            break;
+        case MathFunctionEnum::ATAN2:
+        {
+            CaretAssert(numArgs == 2);
+            const double* other = args[1];
+            for (int64_t i = 0; i < count; ++i) ret[i] = atan2(ret[i], other[i]);
+            break;
+        }
+        case MathFunctionEnum::MIN:
+        {
+            CaretAssert(numArgs == 2);
+            const double* other = args[1];
+            for (int64_t i = 0; i < count; ++i) if (ret[i] > other[i]) ret[i] = other[i];
+            break;
+        }
+        case MathFunctionEnum::MAX:
+        {
+            CaretAssert(numArgs == 2);
+            const double* other = args[1];
+            for (int64_t i = 0; i < count; ++i) if (ret[i] < other[i]) ret[i] = other[i];
+            break;
+        }
+        case MathFunctionEnum::MOD:
+        {
+            CaretAssert(numArgs == 2);
+            const double* second = args[1];
+            for (int64_t i = 0; i < count; ++i)
+            {
+                if (second[i] == 0.0)
+                {
+                    ret[i] = 0.0;
+                } else {
+                    ret[i] = ret[i] - second[i] * floor(ret[i] / second[i]);
+                }
+            }
+            break;
+        }
+        case MathFunctionEnum::CLAMP:
+        {
+            CaretAssert(numArgs == 3);
+            const double* low = args[1], *high = args[2];
+            for (int64_t i = 0; i < count; ++i)
+            {
+                if (ret[i] < low[i])
+                {
+                    ret[i] = low[i];
+                }
+                if (ret[i] > high[i])
+                {
+                    ret[i] = high[i];
+                }
+            }
+            break;
+        }
+        case MathFunctionEnum::INVALID:
+            CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
+            throw CaretException("parsing problem in CaretMathExpression");
+    }
+}
+
 AString CaretMathExpression::MathNode::toString(const std::vector<AString>& varNames) const
 {
     AString ret = "";
@@ -63,6 +63,40 @@ class CaretMathExpression
         double eval(const std::vector<float>& values) const;
         AString toString(const std::vector<AString>& varNames) const;
     };
+    struct MathInstruction//one step of the postfix program, operates on blocks of elements on an evaluation stack
+    {
+        enum OpCode
+        {
+            PUSH_VAR,
+            PUSH_CONST,
+            ADD,
+            SUB,
+            MULT,
+            DIV,
+            EQUAL,
+            NOT_EQUAL,
+            GREATER,
+            GREATER_EQUAL,
+            LESS,
+            LESS_EQUAL,
+            AND,
+            OR,
+            NOT,
+            NEGATE,
+            POW,
+            FUNC
+        };
+        OpCode m_op;
+        MathFunctionEnum::Enum m_function;
+        double m_constVal;
+        int m_varIndex, m_numArgs;
+        MathInstruction(const OpCode& op) { m_op = op; m_function = MathFunctionEnum::INVALID; m_constVal = 0.0; m_varIndex = -1; m_numArgs = 0; }
+    };
+    std::vector<MathInstruction> m_program;//compiled from m_root after parsing
+    int m_stackDepth;
+    static void compileNode(const MathNode* node, std::vector<MathInstruction>& program, int& curDepth, int& maxDepth);
+    static void applyFunction(const MathFunctionEnum::Enum& function, const int& numArgs, double* const* args, const int64_t& count);//result goes in args[0]
+    void runProgram(const std::vector<const float*>& variableArrays, const int64_t& start, const int64_t& count, double* stack, float* dataOut) const;
     std::map<AString, int> m_varNames;
     AString m_input;
     int m_position, m_end;
@@ -86,6 +120,8 @@ public:
     static bool getNamedConstant(const AString& name, double& valueOut);
     CaretMathExpression(const AString& expression);
     double evaluate(const std::vector<float>& variableValues) const;
+    ///evaluate for many elements at once: variableArrays[i] points to count values for variable i (in getVarNames() order), results are cast to float like evaluate()
+    void evaluateArrays(const std::vector<const float*>& variableArrays, float* dataOut, const int64_t& count) const;
     std::vector<AString> getVarNames() const;
     AString toString() const;//the expression, with a lot of parentheses added
 };
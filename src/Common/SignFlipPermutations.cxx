@@ -0,0 +1,127 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SignFlipPermutations.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "FileInformation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace caret;
+using namespace std;
+
+SignFlipPermutations::SignFlipPermutations(const int& numSubjects, const int& numPermutations, const uint32_t& seed)
+{
+    if (numSubjects < 2) throw CaretException("permutation testing requires at least 2 subjects");
+    if (numPermutations < 1) throw CaretException("number of permutations must be positive");
+    m_numSubjects = numSubjects;
+    m_flips.resize(numPermutations, vector<int8_t>(numSubjects, 1));
+    mt19937 myRand(seed);
+    for (int i = 1; i < numPermutations; ++i)//first permutation stays unflipped
+    {
+        for (int j = 0; j < numSubjects; ++j)
+        {
+            m_flips[i][j] = ((myRand() & 1) ? 1 : -1);
+        }
+    }
+}
+
+SignFlipPermutations::SignFlipPermutations(const AString& flipFileName, const int& numSubjects)
+{
+    if (numSubjects < 2) throw CaretException("permutation testing requires at least 2 subjects");
+    m_numSubjects = numSubjects;
+    FileInformation textFileInfo(flipFileName);
+    if (!textFileInfo.exists())
+    {
+        throw CaretException("sign flip file '" + flipFileName + "' doesn't exist");
+    }
+    fstream flipFile(flipFileName.toLocal8Bit().constData(), fstream::in);
+    if (!flipFile.good())
+    {
+        throw CaretException("error reading sign flip file '" + flipFileName + "'");
+    }
+    string line;
+    int lineNum = 0;
+    while (getline(flipFile, line))
+    {
+        ++lineNum;
+        istringstream lineStream(line);
+        vector<int8_t> thisPerm;
+        int value;
+        while (lineStream >> value)
+        {
+            if (value != 1 && value != -1) throw CaretException("sign flip file line " + AString::number(lineNum) + " contains a value other than 1 or -1");
+            thisPerm.push_back((int8_t)value);
+        }
+        if (thisPerm.empty()) continue;//allow blank lines
+        if ((int)thisPerm.size() != numSubjects)
+        {
+            throw CaretException("sign flip file line " + AString::number(lineNum) + " has " + AString::number(thisPerm.size()) + " values, expected " + AString::number(numSubjects));
+        }
+        m_flips.push_back(thisPerm);
+    }
+    if (m_flips.empty()) throw CaretException("sign flip file '" + flipFileName + "' contains no permutations");
+}
+
+void SignFlipPermutations::oneSampleT(const vector<const float*>& subjectData, const int64_t& count, const int& permutation, float* tOut) const
+{
+    CaretAssert((int)subjectData.size() == m_numSubjects);
+    CaretAssert(permutation >= -1 && permutation < (int)m_flips.size());
+    const int8_t* flips = NULL;
+    if (permutation != -1) flips = m_flips[permutation].data();
+    const double n = m_numSubjects;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        double accum = 0.0, accumSquares = 0.0;
+        for (int j = 0; j < m_numSubjects; ++j)
+        {
+            double value = subjectData[j][i];
+            accumSquares += value * value;//flipping doesn't change the squares
+            if (flips == NULL || flips[j] > 0)
+            {
+                accum += value;
+            } else {
+                accum -= value;
+            }
+        }
+        double mean = accum / n;
+        double variance = (accumSquares - mean * accum) / (n - 1.0);
+        if (variance > 0.0)
+        {
+            tOut[i] = (float)(mean / sqrt(variance / n));
+        } else {
+            tOut[i] = 0.0f;
+        }
+    }
+}
+
+float SignFlipPermutations::correctedPValue(const vector<float>& sortedNullMax, const float& value)
+{
+    CaretAssert(!sortedNullMax.empty());
+    vector<float>::const_iterator firstAtLeast = lower_bound(sortedNullMax.begin(), sortedNullMax.end(), abs(value));
+    return (float)(sortedNullMax.end() - firstAtLeast) / sortedNullMax.size();
+}
@@ -0,0 +1,51 @@
+#ifndef __SIGN_FLIP_PERMUTATIONS_H__
+#define __SIGN_FLIP_PERMUTATIONS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+    
+    ///sign-flipping permutations for a one-sample test, and the max-statistic correction that goes with them
+    class SignFlipPermutations
+    {
+        int m_numSubjects;
+        std::vector<std::vector<int8_t> > m_flips;
+    public:
+        ///random flips, the first permutation is always the unflipped data
+        SignFlipPermutations(const int& numSubjects, const int& numPermutations, const uint32_t& seed);
+        ///read flips from a text file, one permutation per line, one +1 or -1 per subject
+        SignFlipPermutations(const AString& flipFileName, const int& numSubjects);
+        int getNumberOfPermutations() const { return (int)m_flips.size(); }
+        int getNumberOfSubjects() const { return m_numSubjects; }
+        ///one-sample t-statistic across subjects after applying the flips of a permutation, -1 means no flipping
+        void oneSampleT(const std::vector<const float*>& subjectData, const int64_t& count, const int& permutation, float* tOut) const;
+        ///fraction of the null distribution with max statistic at least as large as abs(value), nullMax must be sorted ascending
+        static float correctedPValue(const std::vector<float>& sortedNullMax, const float& value);
+    };
+    
+}
+
+#endif //__SIGN_FLIP_PERMUTATIONS_H__
@@ -106,6 +106,31 @@ void
 CaretMappableDataFile::initializeCaretMappableDataFileInstance()
 {
     m_labelDrawingProperties = std::unique_ptr<LabelDrawingProperties>(new LabelDrawingProperties());
+    m_chartingDelegateUpdateDeferred = false;
+    m_chartingDelegateUpdatePending  = false;
+    mapColoringChanged();
+}
+
+/**
+ * @return Counter that changes each time the coloring of any map in
+ * this file is updated or cleared.  Values come from a sequence shared
+ * by all files, so a counter value identifies both the file and its
+ * coloring.  Allows copies of the coloring, such as OpenGL textures,
+ * to be updated only when needed.
+ */
+int64_t
+CaretMappableDataFile::getMapColoringChangedCounter() const
+{
+    return m_mapColoringChangedCounter;
+}
+
+/**
+ * Called by subclasses when the coloring of a map is updated or cleared.
+ */
+void
+CaretMappableDataFile::mapColoringChanged()
+{
+    m_mapColoringChangedCounter = ++s_mapColoringChangedSequence;
 }
 
 
@@ -262,6 +287,10 @@ CaretMappableDataFile::isPaletteColorMappingEqualForAllMaps() const
 void
 CaretMappableDataFile::invalidateHistogramChartColoring()
 {
+    if (m_chartingDelegateUpdateDeferred) {
+        m_chartingDelegateUpdatePending = true;
+        return;
+    }
     getChartingDelegate()->getHistogramCharting()->invalidateAllColoring();
 }
 
@@ -1138,9 +1167,39 @@ CaretMappableDataFile::getChartingDelegate() const
 void
 CaretMappableDataFile::updateChartingDelegate()
 {
+    if (m_chartingDelegateUpdateDeferred) {
+        m_chartingDelegateUpdatePending = true;
+        return;
+    }
     getChartingDelegate()->updateAfterFileChanged();
 }
 
+/**
+ * Defer updates to the charting delegate.  The charting delegate
+ * (and its charts) register for events with the EventManager, which
+ * may only be done in the main thread.  While deferred, updates
+ * requested when the file is read or changed are recorded, and,
+ * when deferral is turned off, the update is performed in the
+ * calling thread.
+ *
+ * @param deferFlag
+ *     True to defer updates, false to stop deferring updates and
+ *     perform any update that was deferred.
+ */
+void
+CaretMappableDataFile::setChartingDelegateUpdateDeferred(const bool deferFlag)
+{
+    m_chartingDelegateUpdateDeferred = deferFlag;
+    
+    if ( ! m_chartingDelegateUpdateDeferred) {
+        if (m_chartingDelegateUpdatePending) {
+            m_chartingDelegateUpdatePending = false;
+            getChartingDelegate()->updateAfterFileChanged();
+            getChartingDelegate()->getHistogramCharting()->invalidateAllColoring();
+        }
+    }
+}
+
 /**
  * @return The palette normalization mode for the file.
  * The default is NORMALIZATION_SELECTED_MAP_DATA.
@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include <atomic>
 #include <memory>
 
 #include "CaretDataFile.h"
@@ -473,6 +474,10 @@ namespace caret {
         
         const ChartableTwoFileDelegate* getChartingDelegate() const;
         
+        void setChartingDelegateUpdateDeferred(const bool deferFlag);
+        
+        int64_t getMapColoringChangedCounter() const;
+        
         virtual void getDataForSelector(const MapFileDataSelector& mapFileDataSelector,
                                         std::vector<float>& dataOut) const = 0;
         
@@ -487,6 +492,8 @@ namespace caret {
         
         void updateChartingDelegate();
         
+        void mapColoringChanged();
+        
         virtual void saveFileDataToScene(const SceneAttributes* sceneAttributes,
                                          SceneClass* sceneClass);
         
@@ -500,10 +507,22 @@ namespace caret {
         std::unique_ptr<LabelDrawingProperties> m_labelDrawingProperties;
 
         mutable std::unique_ptr<ChartableTwoFileDelegate> m_chartingDelegate;
+        
+        /** Charting delegate updates are postponed (file is read in a non-main thread) */
+        bool m_chartingDelegateUpdateDeferred;
+        
+        /** A charting delegate update was postponed and must be performed */
+        bool m_chartingDelegateUpdatePending;
+        
+        /** Value from the sequence when coloring of any map was last changed */
+        int64_t m_mapColoringChangedCounter;
+        
+        /** Shared by all files so that two files never have the same coloring counter */
+        static std::atomic<int64_t> s_mapColoringChangedSequence;
     };
 
 #ifdef __CARET_MAPPABLE_DATA_FILE_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    std::atomic<int64_t> CaretMappableDataFile::s_mapColoringChangedSequence(0);
 #endif // __CARET_MAPPABLE_DATA_FILE_DECLARE__
 
 } // namespace
@@ -26,21 +26,125 @@
 #include "CaretLogger.h"
 #include "FileInformation.h"
 
+#include <algorithm>
+
 #include <QByteArray>
 
 using namespace caret;
 using namespace std;
 
 const char magic[] = "\0\0\0\0cst\0";
+const char magic2[] = "\0\0\0\0cst2";//version 2: delta+varint indices, bit packed values, zlib compressed blocks of rows
+
+/*
+ * version 2 layout, all integers little endian:
+ *   magic2, int64 dims[2], int64 rows per block, int64 block offsets[number of blocks + 1] (relative to the end of the header)
+ *   compressed blocks, cifti XML
+ * uncompressed, each row in a block is:
+ *   varint number of nonzeros, varint index deltas (gap from previous index + 1),
+ *   varint high bits of each value (value >> 30), low 30 bits of each value packed into a bitstream padded to a byte
+ * the low 30 bits hold the fiber fractions and distance, which don't compress well as varints
+ */
+namespace
+{
+    const int64_t ROWS_PER_BLOCK = 16;
+    const int LOW_BITS = 30;
+    
+    void appendVarint(QByteArray& out, uint64_t value)
+    {
+        while (value >= 128)
+        {
+            out.append((char)((value & 127) | 128));
+            value >>= 7;
+        }
+        out.append((char)value);
+    }
+    
+    uint64_t readVarint(const unsigned char*& ptr, const unsigned char* end)
+    {
+        uint64_t ret = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (ptr >= end) throw DataFileException("truncated row found in wbsparse block");
+            unsigned char byte = *ptr;
+            ++ptr;
+            ret |= ((uint64_t)(byte & 127)) << shift;
+            if ((byte & 128) == 0) return ret;
+        }
+        throw DataFileException("invalid varint found in wbsparse block");
+    }
+    
+    int64_t packedBytes(const int64_t& count)
+    {
+        return (count * LOW_BITS + 7) / 8;
+    }
+    
+    //returns a pointer to the start of the next row
+    const unsigned char* decodeRow(const unsigned char* ptr, const unsigned char* end, const int64_t& rowLength, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
+    {
+        uint64_t numNonzero = readVarint(ptr, end);
+        if (numNonzero > (uint64_t)rowLength) throw DataFileException("impossible number of nonzeros found in wbsparse block");
+        indicesOut.resize(numNonzero);
+        valuesOut.resize(numNonzero);
+        int64_t lastIndex = -1;
+        for (uint64_t i = 0; i < numNonzero; ++i)
+        {
+            uint64_t delta = readVarint(ptr, end);
+            if (delta >= (uint64_t)(rowLength - lastIndex - 1)) throw DataFileException("impossible index value found in file");
+            lastIndex += delta + 1;
+            indicesOut[i] = lastIndex;
+        }
+        for (uint64_t i = 0; i < numNonzero; ++i)
+        {
+            valuesOut[i] = readVarint(ptr, end) << LOW_BITS;
+        }
+        if (end - ptr < packedBytes(numNonzero)) throw DataFileException("truncated row found in wbsparse block");
+        uint64_t accum = 0;
+        int bits = 0;
+        const uint64_t MASK = (((uint64_t)1) << LOW_BITS) - 1;
+        for (uint64_t i = 0; i < numNonzero; ++i)
+        {
+            while (bits < LOW_BITS)
+            {
+                accum |= ((uint64_t)*ptr) << bits;
+                ++ptr;
+                bits += 8;
+            }
+            valuesOut[i] = (int64_t)((uint64_t)valuesOut[i] | (accum & MASK));
+            accum >>= LOW_BITS;
+            bits -= LOW_BITS;
+        }
+        return ptr;
+    }
+    
+    const unsigned char* skipRow(const unsigned char* ptr, const unsigned char* end)
+    {
+        uint64_t numNonzero = readVarint(ptr, end);
+        for (uint64_t i = 0; i < 2 * numNonzero; ++i)
+        {
+            readVarint(ptr, end);
+        }
+        if ((uint64_t)(end - ptr) < (uint64_t)packedBytes(numNonzero)) throw DataFileException("truncated row found in wbsparse block");
+        return ptr + packedBytes(numNonzero);
+    }
+}
+
+const int CaretSparseFile::MAX_CACHED_BLOCKS = 8;
 
 CaretSparseFile::CaretSparseFile(const AString& fileName)
 {
+    m_version = 0;
     readFile(fileName);
 }
 
 void CaretSparseFile::readFile(const AString& filename)
 {
     m_file.close();
+    m_version = 0;
+    {
+        CaretMutexLocker locked(&m_blockCacheMutex);
+        m_blockCache.clear();
+    }
     if (filename.endsWith(".gz"))
     {
         throw DataFileException("wbsparse files cannot be read while compressed");
@@ -49,9 +153,18 @@ void CaretSparseFile::readFile(const AString& filename)
     FileInformation fileInfo(filename);//useful later for file size, but create it now to reduce the amount of time between file open and size check
     char buf[8];
     m_file.read(buf, 8);
+    int version = 1;
     for (int i = 0; i < 8; ++i)
     {
-        if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
+        if (buf[i] != magic[i]) version = 0;
+    }
+    if (version == 0)
+    {
+        version = 2;
+        for (int i = 0; i < 8; ++i)
+        {
+            if (buf[i] != magic2[i]) throw DataFileException("file has the wrong magic string");
+        }
     }
     m_file.read(m_dims, 2 * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
@@ -59,21 +172,46 @@ void CaretSparseFile::readFile(const AString& filename)
         ByteSwapping::swapBytes(m_dims, 2);
     }
     if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
-    m_indexArray.resize(m_dims[1] + 1);
-    vector<int64_t> lengthArray(m_dims[1]);
-    m_file.read(lengthArray.data(), m_dims[1] * sizeof(int64_t));
-    if (ByteOrderEnum::isSystemBigEndian())
+    int64_t xml_offset = -1;
+    if (version == 1)
     {
-        ByteSwapping::swapBytes(lengthArray.data(), m_dims[1]);
-    }
-    m_indexArray[0] = 0;
-    for (int64_t i = 0; i < m_dims[1]; ++i)
-    {
-        if (lengthArray[i] > m_dims[0] || lengthArray[i] < 0) throw DataFileException("impossible value found in length array");
-        m_indexArray[i + 1] = m_indexArray[i] + lengthArray[i];
+        m_indexArray.resize(m_dims[1] + 1);
+        vector<int64_t> lengthArray(m_dims[1]);
+        m_file.read(lengthArray.data(), m_dims[1] * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(lengthArray.data(), m_dims[1]);
+        }
+        m_indexArray[0] = 0;
+        for (int64_t i = 0; i < m_dims[1]; ++i)
+        {
+            if (lengthArray[i] > m_dims[0] || lengthArray[i] < 0) throw DataFileException("impossible value found in length array");
+            m_indexArray[i + 1] = m_indexArray[i] + lengthArray[i];
+        }
+        m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+        xml_offset = m_valuesOffset + m_indexArray[m_dims[1]] * 2 * sizeof(int64_t);
+    } else {
+        m_file.read(&m_rowsPerBlock, sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(&m_rowsPerBlock, 1);
+        }
+        if (m_rowsPerBlock < 1) throw DataFileException("rows per block must be positive");
+        int64_t numBlocks = (m_dims[1] + m_rowsPerBlock - 1) / m_rowsPerBlock;
+        m_indexArray.resize(numBlocks + 1);
+        m_file.read(m_indexArray.data(), (numBlocks + 1) * sizeof(uint64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_indexArray.data(), numBlocks + 1);
+        }
+        if (m_indexArray[0] != 0) throw DataFileException("impossible value found in block offset array");
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            if (m_indexArray[i + 1] <= m_indexArray[i]) throw DataFileException("impossible value found in block offset array");
+        }
+        m_valuesOffset = 8 + 3 * sizeof(int64_t) + (numBlocks + 1) * sizeof(int64_t);
+        xml_offset = m_valuesOffset + m_indexArray[numBlocks];
     }
-    m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
-    int64_t xml_offset = m_valuesOffset + m_indexArray[m_dims[1]] * 2 * sizeof(int64_t);
     if (xml_offset >= fileInfo.size()) throw DataFileException("file is truncated");
     int64_t xml_length = fileInfo.size() - xml_offset;
     if (xml_length < 1) throw DataFileException("file is truncated");
@@ -94,36 +232,70 @@ void CaretSparseFile::readFile(const AString& filename)
     {
         throw DataFileException("cifti XML doesn't match dimensions of sparse file");
     }
+    m_version = version;
 }
 
 CaretSparseFile::~CaretSparseFile()
 {
 }
 
-void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
+CaretPointer<const CaretSparseFile::DecodedBlock> CaretSparseFile::getBlock(const int64_t& blockIndex) const
 {
-    CaretAssert(index >= 0 && index < m_dims[1]);
-    int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
-    int64_t numToRead = (end - start) * 2;
-    m_scratchArray.resize(numToRead);
-    m_file.seek(m_valuesOffset + start * sizeof(int64_t) * 2);
-    m_file.read(m_scratchArray.data(), numToRead * sizeof(int64_t));
-    if (ByteOrderEnum::isSystemBigEndian())
     {
-        ByteSwapping::swapBytes(m_scratchArray.data(), numToRead);
+        CaretMutexLocker locked(&m_blockCacheMutex);
+        for (size_t i = 0; i < m_blockCache.size(); ++i)
+        {
+            if (m_blockCache[i]->m_blockIndex == blockIndex)
+            {
+                CaretPointer<const DecodedBlock> ret = m_blockCache[i];
+                m_blockCache.erase(m_blockCache.begin() + i);
+                m_blockCache.insert(m_blockCache.begin(), ret);
+                return ret;
+            }
+        }
+    }//only the file read is serialized, decompression happens outside the locks, and two threads may occasionally decode the same block
+    int64_t compressedSize = m_indexArray[blockIndex + 1] - m_indexArray[blockIndex];
+    QByteArray compressed(compressedSize, '\0');
+    {
+        CaretMutexLocker locked(&m_fileMutex);
+        m_file.seek(m_valuesOffset + m_indexArray[blockIndex]);
+        m_file.read(compressed.data(), compressedSize);
+    }
+    CaretPointer<DecodedBlock> block(new DecodedBlock());
+    block->m_blockIndex = blockIndex;
+    block->m_bytes = qUncompress(compressed);
+    if (block->m_bytes.isEmpty()) throw DataFileException("failed to decompress block " + AString::number(blockIndex) + " of wbsparse file");
+    int64_t blockRows = min(m_rowsPerBlock, m_dims[1] - blockIndex * m_rowsPerBlock);
+    block->m_rowOffsets.resize(blockRows);
+    const unsigned char* begin = (const unsigned char*)block->m_bytes.constData();
+    const unsigned char* end = begin + block->m_bytes.size();
+    const unsigned char* ptr = begin;
+    for (int64_t i = 0; i < blockRows; ++i)
+    {
+        block->m_rowOffsets[i] = ptr - begin;
+        ptr = skipRow(ptr, end);
     }
+    CaretPointer<const DecodedBlock> ret = block;
+    CaretMutexLocker locked(&m_blockCacheMutex);
+    m_blockCache.insert(m_blockCache.begin(), ret);
+    if ((int)m_blockCache.size() > MAX_CACHED_BLOCKS) m_blockCache.pop_back();
+    return ret;
+}
+
+void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut) const
+{
+    vector<int64_t> indices, values;
+    getRowSparse(index, indices, values);
     int64_t curIndex = 0;
-    for (int64_t i = 0; i < numToRead; i += 2)
+    for (size_t i = 0; i < indices.size(); ++i)
     {
-        int64_t index = m_scratchArray[i];
-        if (index < curIndex || index >= m_dims[0]) throw DataFileException("impossible index value found in file");
-        while (curIndex < index)
+        while (curIndex < indices[i])
         {
             rowOut[curIndex] = 0;
             ++curIndex;
         }
+        rowOut[curIndex] = values[i];
         ++curIndex;
-        rowOut[index] = m_scratchArray[i + 1];
     }
     while (curIndex < m_dims[0])
     {
@@ -132,53 +304,78 @@ void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
     }
 }
 
-void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
+void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut) const
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
+    if (m_version == 2)
+    {
+        int64_t blockIndex = index / m_rowsPerBlock;
+        CaretPointer<const DecodedBlock> block = getBlock(blockIndex);
+        const unsigned char* begin = (const unsigned char*)block->m_bytes.constData();
+        decodeRow(begin + block->m_rowOffsets[index - blockIndex * m_rowsPerBlock], begin + block->m_bytes.size(), m_dims[0], indicesOut, valuesOut);
+        return;
+    }
+    if (m_version != 1) throw DataFileException("no wbsparse file has been read");
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
     int64_t numToRead = (end - start) * 2, numNonzero = end - start;
-    m_scratchArray.resize(numToRead);
-    m_file.seek(m_valuesOffset + start * sizeof(int64_t) * 2);
-    m_file.read(m_scratchArray.data(), numToRead * sizeof(int64_t));
+    vector<int64_t> scratchArray(numToRead);
+    {
+        CaretMutexLocker locked(&m_fileMutex);
+        m_file.seek(m_valuesOffset + start * sizeof(int64_t) * 2);
+        m_file.read(scratchArray.data(), numToRead * sizeof(int64_t));
+    }
     if (ByteOrderEnum::isSystemBigEndian())
     {
-        ByteSwapping::swapBytes(m_scratchArray.data(), numToRead);
+        ByteSwapping::swapBytes(scratchArray.data(), numToRead);
     }
     indicesOut.resize(numNonzero);
     valuesOut.resize(numNonzero);
     int64_t lastIndex = -1;
     for (int64_t i = 0; i < numNonzero; ++i)
     {
-        indicesOut[i] = m_scratchArray[i * 2];
-        valuesOut[i] = m_scratchArray[i * 2 + 1];
+        indicesOut[i] = scratchArray[i * 2];
+        valuesOut[i] = scratchArray[i * 2 + 1];
         if (indicesOut[i] <= lastIndex || indicesOut[i] >= m_dims[0]) throw DataFileException("impossible index value found in file");
         lastIndex = indicesOut[i];
     }
 }
 
-void CaretSparseFile::getFibersRow(const int64_t& index, FiberFractions* rowOut)
+void CaretSparseFile::getFibersRow(const int64_t& index, FiberFractions* rowOut) const
 {
-    if (m_scratchRow.size() != (size_t)m_dims[0]) m_scratchRow.resize(m_dims[0]);
-    getRow(index, (int64_t*)m_scratchRow.data());
-    for (int64_t i = 0; i < m_dims[0]; ++i)
+    vector<int64_t> indices, values;
+    getRowSparse(index, indices, values);
+    int64_t curIndex = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
     {
-        if (m_scratchRow[i] == 0)
+        while (curIndex < indices[i])
         {
-            rowOut[i].zero();
+            rowOut[curIndex].zero();
+            ++curIndex;
+        }
+        if (values[i] == 0)
+        {
+            rowOut[curIndex].zero();
         } else {
-             decodeFibers(m_scratchRow[i], rowOut[i]);
+            decodeFibers(values[i], rowOut[curIndex]);
         }
+        ++curIndex;
+    }
+    while (curIndex < m_dims[0])
+    {
+        rowOut[curIndex].zero();
+        ++curIndex;
     }
 }
 
-void CaretSparseFile::getFibersRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<FiberFractions>& valuesOut)
+void CaretSparseFile::getFibersRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<FiberFractions>& valuesOut) const
 {
-    getRowSparse(index, indicesOut, m_scratchSparseRow);
-    size_t numNonzero = m_scratchSparseRow.size();
+    vector<int64_t> scratchSparseRow;
+    getRowSparse(index, indicesOut, scratchSparseRow);
+    size_t numNonzero = scratchSparseRow.size();
     valuesOut.resize(numNonzero);
     for (size_t i = 0; i < numNonzero; ++i)
     {
-        decodeFibers(((uint64_t*)m_scratchSparseRow.data())[i], valuesOut[i]);
+        decodeFibers(((uint64_t*)scratchSparseRow.data())[i], valuesOut[i]);
     }
 }
 
@@ -206,13 +403,16 @@ void FiberFractions::zero()
     distance = 0.0f;
 }
 
-CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml)
+CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const int& formatVersion)
 {
     if (!fileName.endsWith(".trajTEMP.wbsparse"))
     {//for now (and maybe forever), this format is single-purpose
         CaretLogWarning("sparse trajectory file '" + fileName + "' should be saved ending in .trajTEMP.wbsparse");
     }
+    if (formatVersion != 1 && formatVersion != 2) throw DataFileException("unknown wbsparse format version: " + AString::number(formatVersion));
+    m_version = formatVersion;
     m_finished = false;
+    m_blockBytesWritten = 0;
     int64_t dimensions[2] = { xml.getDimensionLength(CiftiXML::ALONG_ROW), xml.getDimensionLength(CiftiXML::ALONG_COLUMN) };
     if (dimensions[0] < 1 || dimensions[1] < 1) throw DataFileException("both dimensions must be positive");
     m_xml = xml;
@@ -223,77 +423,133 @@ CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const Cift
         throw DataFileException("wbsparse files cannot be written compressed");
     }//because after we finish writing the data, we have to come back and write the lengths array
     m_file.open(fileName, CaretBinaryFile::WRITE_TRUNCATE);
-    m_file.write(magic, 8);
-    int64_t tempdims[2] = { m_dims[0], m_dims[1] };
+    m_file.write(m_version == 1 ? magic : magic2, 8);
+    int64_t tempdims[3] = { m_dims[0], m_dims[1], ROWS_PER_BLOCK };
     if (ByteOrderEnum::isSystemBigEndian())
     {
-        ByteSwapping::swapBytes(tempdims, 2);
+        ByteSwapping::swapBytes(tempdims, 3);
+    }
+    if (m_version == 1)
+    {
+        m_file.write(tempdims, 2 * sizeof(int64_t));
+        m_lengthArray.resize(m_dims[1], 0);//initialize the memory so that valgrind won't complain
+        m_file.write(m_lengthArray.data(), m_dims[1] * sizeof(uint64_t));//write it to get the file to the correct length
+        m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+    } else {
+        m_file.write(tempdims, 3 * sizeof(int64_t));
+        int64_t numBlocks = (m_dims[1] + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK;
+        m_blockOffsets.resize(numBlocks + 1, 0);
+        m_file.write(m_blockOffsets.data(), (numBlocks + 1) * sizeof(uint64_t));//placeholder, like the lengths array
+        m_blockOffsets.clear();
+        m_blockOffsets.push_back(0);
+        m_valuesOffset = 8 + 3 * sizeof(int64_t) + (numBlocks + 1) * sizeof(int64_t);
     }
-    m_file.write(tempdims, 2 * sizeof(int64_t));
-    m_lengthArray.resize(m_dims[1], 0);//initialize the memory so that valgrind won't complain
-    m_file.write(m_lengthArray.data(), m_dims[1] * sizeof(uint64_t));//write it to get the file to the correct length
     m_nextRowIndex = 0;
-    m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
 }
 
-void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
+void CaretSparseFileWriter::appendBlockRow(const int64_t* indices, const int64_t* values, const int64_t& count)
 {
-    CaretAssert(index < m_dims[1]);
-    CaretAssert(index >= m_nextRowIndex);
-    while (m_nextRowIndex < index)
+    appendVarint(m_blockBuffer, count);
+    int64_t lastIndex = -1;
+    for (int64_t i = 0; i < count; ++i)
     {
-        m_lengthArray[m_nextRowIndex] = 0;
-        ++m_nextRowIndex;
+        appendVarint(m_blockBuffer, indices[i] - lastIndex - 1);
+        lastIndex = indices[i];
     }
-    m_scratchArray.clear();
-    int64_t count = 0;
-    for (int64_t i = 0; i < m_dims[0]; ++i)
+    for (int64_t i = 0; i < count; ++i)
     {
-        if (row[i] != 0)
+        appendVarint(m_blockBuffer, ((uint64_t)values[i]) >> LOW_BITS);
+    }
+    uint64_t accum = 0;
+    int bits = 0;
+    const uint64_t MASK = (((uint64_t)1) << LOW_BITS) - 1;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        accum |= (((uint64_t)values[i]) & MASK) << bits;
+        bits += LOW_BITS;
+        while (bits >= 8)
         {
-            m_scratchArray.push_back(i);
-            m_scratchArray.push_back(row[i]);
-            ++count;
+            m_blockBuffer.append((char)(accum & 255));
+            accum >>= 8;
+            bits -= 8;
         }
     }
-    m_lengthArray[index] = count;
-    if (ByteOrderEnum::isSystemBigEndian())
+    if (bits > 0) m_blockBuffer.append((char)(accum & 255));
+    ++m_nextRowIndex;
+    if (m_nextRowIndex % ROWS_PER_BLOCK == 0 || m_nextRowIndex == m_dims[1]) flushBlock();
+}
+
+void CaretSparseFileWriter::flushBlock()
+{
+    QByteArray compressed = qCompress(m_blockBuffer);
+    m_file.write(compressed.constData(), compressed.size());
+    m_blockBytesWritten += compressed.size();
+    m_blockOffsets.push_back(m_blockBytesWritten);
+    m_blockBuffer.clear();
+}
+
+void CaretSparseFileWriter::writeRowInternal(const int64_t& index, const int64_t* indices, const int64_t* values, const int64_t& count)
+{
+    if (m_version == 1)
     {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
+        while (m_nextRowIndex < index)
+        {
+            m_lengthArray[m_nextRowIndex] = 0;
+            ++m_nextRowIndex;
+        }
+        m_lengthArray[index] = count;
+        m_scratchArray.resize(count * 2);
+        for (int64_t i = 0; i < count; ++i)
+        {
+            m_scratchArray[i * 2] = indices[i];
+            m_scratchArray[i * 2 + 1] = values[i];
+        }
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
+        }
+        m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
+        m_nextRowIndex = index + 1;
+    } else {
+        while (m_nextRowIndex < index)
+        {
+            appendBlockRow(NULL, NULL, 0);
+        }
+        appendBlockRow(indices, values, count);
     }
-    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
-    m_nextRowIndex = index + 1;
     if (m_nextRowIndex == m_dims[1]) finish();
 }
 
-void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
 {
     CaretAssert(index < m_dims[1]);
     CaretAssert(index >= m_nextRowIndex);
-    CaretAssert(indices.size() == values.size());
-    while (m_nextRowIndex < index)
+    m_scratchIndices.clear();
+    m_scratchSparseRow.clear();
+    for (int64_t i = 0; i < m_dims[0]; ++i)
     {
-        m_lengthArray[m_nextRowIndex] = 0;
-        ++m_nextRowIndex;
+        if (row[i] != 0)
+        {
+            m_scratchIndices.push_back(i);
+            m_scratchSparseRow.push_back(row[i]);
+        }
     }
-    m_scratchArray.clear();
+    writeRowInternal(index, m_scratchIndices.data(), m_scratchSparseRow.data(), m_scratchIndices.size());
+}
+
+void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+{
+    CaretAssert(index < m_dims[1]);
+    CaretAssert(index >= m_nextRowIndex);
+    CaretAssert(indices.size() == values.size());
     size_t numNonzero = indices.size();//assume no zeros
-    m_lengthArray[index] = numNonzero;
     int64_t lastIndex = -1;
     for (size_t i = 0; i < numNonzero; ++i)
     {
         if (indices[i] <= lastIndex || indices[i] >= m_dims[0]) throw DataFileException("indices must be sorted when writing sparse rows");
         lastIndex = indices[i];
-        m_scratchArray.push_back(indices[i]);
-        m_scratchArray.push_back(values[i]);
-    }
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
     }
-    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
-    m_nextRowIndex = index + 1;
-    if (m_nextRowIndex == m_dims[1]) finish();
+    writeRowInternal(index, indices.data(), values.data(), numNonzero);
 }
 
 void CaretSparseFileWriter::writeFibersRow(const int64_t& index, const FiberFractions* row)
@@ -314,31 +570,49 @@ void CaretSparseFileWriter::writeFibersRow(const int64_t& index, const FiberFrac
 void CaretSparseFileWriter::writeFibersRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<FiberFractions>& values)
 {
     size_t numNonzero = values.size();//assume no zeros
-    m_scratchSparseRow.resize(numNonzero);
+    vector<int64_t> encoded(numNonzero);//m_scratchSparseRow is used by writeRow
     for (size_t i = 0; i < numNonzero; ++i)
     {
-        encodeFibers(values[i], ((uint64_t*)m_scratchSparseRow.data())[i]);
+        encodeFibers(values[i], ((uint64_t*)encoded.data())[i]);
     }
-    writeRowSparse(index, indices, m_scratchSparseRow);
+    writeRowSparse(index, indices, encoded);
 }
 
 void CaretSparseFileWriter::finish()
 {
     if (m_finished) return;
     m_finished = true;
-    while (m_nextRowIndex < m_dims[1])
+    if (m_version == 1)
     {
-        m_lengthArray[m_nextRowIndex] = 0;
-        ++m_nextRowIndex;
+        while (m_nextRowIndex < m_dims[1])
+        {
+            m_lengthArray[m_nextRowIndex] = 0;
+            ++m_nextRowIndex;
+        }
+    } else {
+        while (m_nextRowIndex < m_dims[1])
+        {
+            appendBlockRow(NULL, NULL, 0);
+        }
     }
     QByteArray myXMLBytes = m_xml.writeXMLToQByteArray();
     m_file.write(myXMLBytes.constData(), myXMLBytes.size());
-    m_file.seek(8 + 2 * sizeof(int64_t));
-    if (ByteOrderEnum::isSystemBigEndian())
+    if (m_version == 1)
     {
-        ByteSwapping::swapBytes(m_lengthArray.data(), m_lengthArray.size());
+        m_file.seek(8 + 2 * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_lengthArray.data(), m_lengthArray.size());
+        }
+        m_file.write(m_lengthArray.data(), m_lengthArray.size() * sizeof(uint64_t));
+    } else {
+        m_file.seek(8 + 3 * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_blockOffsets.data(), m_blockOffsets.size());
+        }
+        m_file.write(m_blockOffsets.data(), m_blockOffsets.size() * sizeof(uint64_t));
     }
-    m_file.write(m_lengthArray.data(), m_lengthArray.size() * sizeof(uint64_t));
     m_file.close();
 }
 
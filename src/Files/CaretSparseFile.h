@@ -26,10 +26,14 @@
 
 #include "AString.h"
 #include "CaretBinaryFile.h"
+#include "CaretMutex.h"
+#include "CaretPointer.h"
 #include "CiftiXML.h"
 #include "DataFile.h"
 #include "DataFileException.h"
 
+#include <QByteArray>
+
 namespace caret {
     
     struct FiberFractions
@@ -40,19 +44,32 @@ namespace caret {
         void zero();
     };
     
+    ///reads both the original wbsparse format (version 1) and the block compressed format (version 2)
+    ///the row getters are thread-safe, so rows can be decoded concurrently
     class CaretSparseFile /* : public DataFile */
     {
+        struct DecodedBlock
+        {
+            int64_t m_blockIndex;
+            QByteArray m_bytes;//uncompressed block contents
+            std::vector<int64_t> m_rowOffsets;//where each row of the block starts in m_bytes
+        };
         static void decodeFibers(const uint64_t& coded, FiberFractions& decoded);//takes a uint because right shift on signed is implementation dependent
-        CaretBinaryFile m_file;
-        int64_t m_dims[2], m_valuesOffset;
-        std::vector<uint64_t> m_indexArray, m_scratchRow;
-        std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
+        CaretPointer<const DecodedBlock> getBlock(const int64_t& blockIndex) const;
+        mutable CaretBinaryFile m_file;
+        mutable CaretMutex m_fileMutex;//protects m_file
+        int m_version;
+        int64_t m_dims[2], m_valuesOffset, m_rowsPerBlock;
+        std::vector<uint64_t> m_indexArray;//version 1: row start in number of nonzeros, version 2: block start in bytes
+        mutable std::vector<CaretPointer<const DecodedBlock> > m_blockCache;//most recently used first
+        mutable CaretMutex m_blockCacheMutex;
+        static const int MAX_CACHED_BLOCKS;
         CaretSparseFile(const CaretSparseFile& rhs);
         CiftiXML m_xml;
     public:
         const int64_t* getDimensions() { return m_dims; }
 
-        CaretSparseFile() {};
+        CaretSparseFile() { m_version = 0; };
         
         virtual void readFile(const AString& filename);
         
@@ -63,13 +80,16 @@ namespace caret {
         ///get a reference to the XML data
         const CiftiXML& getCiftiXML() const { return m_xml; }
         
-        void getRow(const int64_t& index, int64_t* rowOut);
+        ///1 for the original format, 2 for the block compressed format
+        int getFormatVersion() const { return m_version; }
+        
+        void getRow(const int64_t& index, int64_t* rowOut) const;
         
-        void getRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<int64_t>& valuesOut);
+        void getRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<int64_t>& valuesOut) const;
 
-        void getFibersRow(const int64_t& index, FiberFractions* rowOut);
+        void getFibersRow(const int64_t& index, FiberFractions* rowOut) const;
         
-        void getFibersRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<FiberFractions>& valuesOut);
+        void getFibersRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<FiberFractions>& valuesOut) const;
 
         virtual ~CaretSparseFile();
     };
@@ -78,15 +98,22 @@ namespace caret {
     {
         static void encodeFibers(const FiberFractions& orig, uint64_t& coded);
         static uint32_t myclamp(const int& x);
+        void writeRowInternal(const int64_t& index, const int64_t* indices, const int64_t* values, const int64_t& count);
+        void appendBlockRow(const int64_t* indices, const int64_t* values, const int64_t& count);
+        void flushBlock();
         CaretBinaryFile m_file;
-        int64_t m_dims[2], m_valuesOffset, m_nextRowIndex;
+        int m_version;
+        int64_t m_dims[2], m_valuesOffset, m_nextRowIndex, m_blockBytesWritten;
         bool m_finished;
         std::vector<uint64_t> m_lengthArray, m_scratchRow;
-        std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
+        std::vector<int64_t> m_scratchArray, m_scratchIndices, m_scratchSparseRow;
+        std::vector<uint64_t> m_blockOffsets;
+        QByteArray m_blockBuffer;
         CaretSparseFileWriter(const CaretSparseFileWriter& rhs);
         CiftiXML m_xml;
     public:
-        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml);
+        ///version 2 delta encodes the indices, bit packs the values, and compresses blocks of rows, but older versions of workbench can't read it
+        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const int& formatVersion = 1);
         
         ~CaretSparseFileWriter();
         
@@ -19,6 +19,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -46,6 +47,12 @@ using namespace caret;
  * Internally, the file format is the same as a data series file.  When
  * a row is requested, the row is correlated with all other rows
  * producing the connectivity from that row to all other rows.
+ *
+ * The data-series is copied into one contiguous matrix with each row
+ * demeaned and scaled to unit length, so that the correlation of two
+ * rows is the dot product of their normalized rows.  A full row of
+ * connectivity is then a matrix-vector product that uses the SIMD dot
+ * product, and recently requested rows are kept in a small cache.
  */
 
 /**
@@ -61,8 +68,7 @@ m_parentDataSeriesCiftiFile(NULL),
 m_numberOfBrainordinates(-1),
 m_numberOfTimePoints(-1),
 m_validDataFlag(false),
-m_enabledAsLayer(true),
-m_cacheDataFlag(false)
+m_enabledAsLayer(true)
 {
     CaretAssert(m_parentDataSeriesFile);
 
@@ -165,30 +171,29 @@ CiftiConnectivityMatrixDenseDynamicFile::updateAfterReading(const CiftiFile* cif
     m_numberOfBrainordinates = ciftiXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN).getLength();
     m_numberOfTimePoints     = ciftiXML.getSeriesMap(CiftiXML::ALONG_ROW).getLength();
     
-    m_rowData.clear();
+    m_normalizedData.clear();
+    clearRowCache();
     
     if ((m_numberOfBrainordinates > 0)
         && (m_numberOfTimePoints > 0)) {
-        m_rowData.resize(m_numberOfBrainordinates);
-        
-        if (m_cacheDataFlag) {
-            /*
-             * Read all of the data.  Time-series type files are not
-             * too large and by caching the data, it eliminates
-             * numerous calls to read the data when correlation
-             * is performed.
-             *
-             * READ DATA FROM PARENT FILE
-             */
-            for (int32_t i = 0; i < m_numberOfBrainordinates; i++) {
-                CaretAssertVectorIndex(m_rowData, i);
-                m_rowData[i].m_data.resize(m_numberOfTimePoints);
-                m_parentDataSeriesCiftiFile->getRow(&m_rowData[i].m_data[0],
-                                                    i);
-            }
+        /*
+         * Time-series type files are not too large, and keeping a normalized
+         * copy means correlation never needs to read the parent file again.
+         *
+         * Rows are read serially since reading may access the disk.
+         */
+        const int64_t numTimePoints = m_numberOfTimePoints;
+        m_normalizedData.resize(static_cast<int64_t>(m_numberOfBrainordinates) * numTimePoints);
+        for (int32_t i = 0; i < m_numberOfBrainordinates; i++) {
+            m_parentDataSeriesCiftiFile->getRow(&m_normalizedData[i * numTimePoints],
+                                                i);
         }
         
-        preComputeRowMeanAndSumSquared();
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+            normalizeData(&m_normalizedData[iRow * numTimePoints],
+                          m_numberOfTimePoints);
+        }
         
         m_validDataFlag = true;
     }
@@ -228,6 +233,22 @@ CiftiConnectivityMatrixDenseDynamicFile::getDataForRow(float* dataOut,
                                         index);
 }
 
+/**
+ * Load the sum of the data for the given rows.
+ *
+ * @param sumOut
+ *     Output with sum of the rows' data.
+ * @param rowIndices
+ *     Indices of the rows.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getDataSumForRows(double* sumOut,
+                                                           const std::vector<int64_t>& rowIndices) const
+{
+    m_parentDataSeriesCiftiFile->getRowSum(sumOut,
+                                           rowIndices);
+}
+
 /**
  * Load PROCESSED data for the given column.
  *
@@ -268,24 +289,36 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(float* dataOut,
         return;
     }
     
-    std::vector<float> rowData(m_numberOfTimePoints);
-    m_parentDataSeriesCiftiFile->getRow(&rowData[0], index);
-    const float mean = m_rowData[index].m_mean;
-    const float ssxx = m_rowData[index].m_sqrt_ssxx;
+    CaretAssert((index >= 0) && (index < m_numberOfBrainordinates));
     
-    /*
-     * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
-     * there is almost no overhead to dynamic scheduling
-     */
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-        float coefficient = 1.0;
-        
-        if (iRow != index) {
-            coefficient = correlation(rowData, mean, ssxx, iRow, m_numberOfTimePoints);
+    {
+        CaretMutexLocker locked(&m_rowCacheMutex);
+        for (std::vector<CaretPointer<CachedRow> >::iterator iter = m_rowCache.begin();
+             iter != m_rowCache.end();
+             iter++) {
+            if ((*iter)->m_rowIndex == index) {
+                CaretPointer<CachedRow> cachedRow = *iter;
+                m_rowCache.erase(iter);
+                m_rowCache.insert(m_rowCache.begin(), cachedRow);
+                std::copy(cachedRow->m_data.begin(), cachedRow->m_data.end(), dataOut);
+                return;
+            }
         }
-        
-        dataOut[iRow] = coefficient;
+    }
+    
+    const int64_t numTimePoints = m_numberOfTimePoints;
+    correlateWithAllRows(&m_normalizedData[index * numTimePoints],
+                         dataOut);
+    dataOut[index] = 1.0;
+    
+    CaretPointer<CachedRow> newRow(new CachedRow());
+    newRow->m_rowIndex = index;
+    newRow->m_data.assign(dataOut, dataOut + m_numberOfBrainordinates);
+    
+    CaretMutexLocker locked(&m_rowCacheMutex);
+    m_rowCache.insert(m_rowCache.begin(), newRow);
+    if (static_cast<int32_t>(m_rowCache.size()) > MAX_CACHED_ROWS) {
+        m_rowCache.resize(MAX_CACHED_ROWS);
     }
 }
 
@@ -316,105 +349,82 @@ CiftiConnectivityMatrixDenseDynamicFile::processRowAverageData(std::vector<float
         return;
     }
     
-    float mean = 0.0;
-    float sumSquared = 0.0;
-    computeDataMeanAndSumSquared(&rowAverageDataInOut[0],
-                                 dataLength,
-                                 mean,
-                                 sumSquared);
+    std::vector<float> normalizedRowAverageData(rowAverageDataInOut);
+    normalizeData(&normalizedRowAverageData[0],
+                  dataLength);
     
     std::vector<float> processedRowAverageData(m_numberOfBrainordinates);
-    
-    /*
-     * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
-     * there is almost no overhead to dynamic scheduling
-     */
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-        const float coefficient = correlation(rowAverageDataInOut,
-                                              mean,
-                                              sumSquared,
-                                              iRow,
-                                              dataLength);
-        CaretAssertVectorIndex(processedRowAverageData, iRow);
-        processedRowAverageData[iRow] = coefficient;
-    }
+    correlateWithAllRows(&normalizedRowAverageData[0],
+                         &processedRowAverageData[0]);
     
     rowAverageDataInOut = processedRowAverageData;
 }
 
+/**
+ * Remove all cached rows of connectivity.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::clearRowCache()
+{
+    CaretMutexLocker locked(&m_rowCacheMutex);
+    m_rowCache.clear();
+}
 
 /**
- * Compute the mean and sum-squared for each row so that they
- * are only calculated once.
+ * Demean the data and scale it to unit length, so that the Pearson
+ * correlation of two normalized arrays is their dot product.  Data
+ * with no variance becomes all zeros (correlation of zero).
+ *
+ * @param data
+ *     Data that is normalized in place.
+ * @param dataLength
+ *     Number of items in data.
  */
 void
-CiftiConnectivityMatrixDenseDynamicFile::preComputeRowMeanAndSumSquared()
+CiftiConnectivityMatrixDenseDynamicFile::normalizeData(float* data,
+                                                       const int32_t dataLength) const
 {
-    CaretAssert(m_numberOfBrainordinates > 0);
-    CaretAssert(m_numberOfTimePoints > 0);
+    float mean = 0.0;
+    float sqrtSumSquared = 0.0;
+    computeDataMeanAndSumSquared(data,
+                                 dataLength,
+                                 mean,
+                                 sqrtSumSquared);
+    
+    const float scale = ((sqrtSumSquared > 0.0) ? (1.0 / sqrtSumSquared) : 0.0);
+    for (int32_t i = 0; i < dataLength; i++) {
+        data[i] = (data[i] - mean) * scale;
+    }
+}
 
+/**
+ * Correlate normalized data with every row, which is the product of
+ * the normalized data matrix and the normalized data.
+ *
+ * @param normalizedData
+ *     Data normalized by normalizeData(), containing one value per time point.
+ * @param dataOut
+ *     Output containing the correlation with each brainordinate.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::correlateWithAllRows(const float* normalizedData,
+                                                              float* dataOut) const
+{
+    CaretAssert(static_cast<int64_t>(m_normalizedData.size())
+                == static_cast<int64_t>(m_numberOfBrainordinates) * m_numberOfTimePoints);
+    
+    const int64_t numTimePoints = m_numberOfTimePoints;
+    const float* matrix = &m_normalizedData[0];
+    
     /*
      * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
      * there is almost no overhead to dynamic scheduling
      */
-#pragma omp CARET_PARFOR schedule(dynamic)
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
     for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-
-        CaretAssertVectorIndex(m_rowData, iRow);
-        
-        if (m_cacheDataFlag) {
-            CaretAssertVectorIndex(m_rowData[iRow].m_data, (m_numberOfTimePoints - 1));
-            computeDataMeanAndSumSquared(&m_rowData[iRow].m_data[0],
-                                         m_numberOfTimePoints,
-                                         m_rowData[iRow].m_mean,
-                                         m_rowData[iRow].m_sqrt_ssxx);
-        }
-        else {
-            std::vector<float> data(m_numberOfTimePoints);
-#pragma omp critical
-            {//TSC: this can do disk access, which is not currently thread-safe
-                m_parentDataSeriesCiftiFile->getRow(&data[0], iRow);
-            }
-            computeDataMeanAndSumSquared(&data[0],
-                                         m_numberOfTimePoints,
-                                         m_rowData[iRow].m_mean,
-                                         m_rowData[iRow].m_sqrt_ssxx);
-        }
-        
-//        double sum = 0.0;
-//        double sumSquared = 0.0;
-//        if (m_cacheDataFlag) {
-//            for (int32_t iPoint = 0; iPoint < m_numberOfTimePoints; iPoint++) {
-//                CaretAssertVectorIndex(m_rowData[iRow].m_data, iPoint);
-//                const float d = m_rowData[iRow].m_data[iPoint];
-//                sum        += d;
-//                sumSquared += (d * d);
-//            }
-//        }
-//        else {
-//            std::vector<float> data(m_numberOfTimePoints);
-//            m_parentDataSeriesCiftiFile->getRow(&data[0], iRow);
-//            for (int32_t iPoint = 0; iPoint < m_numberOfTimePoints; iPoint++) {
-//                CaretAssertVectorIndex(data, iPoint);
-//                const float d = data[iPoint];
-//                sum        += d;
-//                sumSquared += (d * d);
-//            }
-//        }
-//        
-//        const float mean       = (sum / numPointsFloat);
-//        const float ssxx = (sumSquared - (numPointsFloat * mean * mean));
-//        CaretAssert(ssxx >= 0.0);
-//        
-//        const float meanDiff = std::fabs(mean - m_rowData[iRow].m_mean);
-//        const float ssDiff   = std::fabs(std::sqrt(ssxx) - m_rowData[iRow].m_sqrt_ssxx);
-//        if ((meanDiff > 0.0001) || (ssDiff > 0.0001)) {
-//            std::cout << "Mean/SS diff" << std::endl;
-//        }
-//        
-//        m_rowData[iRow].m_mean = mean;
-//        m_rowData[iRow].m_sqrt_ssxx = std::sqrt(ssxx);
+        dataOut[iRow] = dsdot(normalizedData,
+                              matrix + iRow * numTimePoints,
+                              m_numberOfTimePoints);
     }
 }
 
@@ -459,108 +469,6 @@ CiftiConnectivityMatrixDenseDynamicFile::computeDataMeanAndSumSquared(const floa
 }
 
 
-/**
- * Correlation from https://en.wikipedia.org/wiki/Pearson_product-moment_correlation_coefficient
- *
- * @param data
- *     Data for correlation
- * @param mean
- *     Mean of data
- * @param sumSquared
- *     Sum squared of data.
- * @param otherRowIndex
- *     Index of another row
- * @param numberOfPoints
- *     Number of points int the two arrays
- * @return
- *     The correlation coefficient computed on the two arrays.
- */
-float
-CiftiConnectivityMatrixDenseDynamicFile::correlation(const std::vector<float>& data,
-                                                     const float mean,
-                                                     const float sumSquared,
-                                                     const int32_t otherRowIndex,
-                                                     const int32_t numberOfPoints) const
-{
-    const double numFloat = numberOfPoints;
-    double xySum = 0.0;
-    
-    CaretAssertVectorIndex(m_rowData, otherRowIndex);
-    const RowData& otherData = m_rowData[otherRowIndex];
-    
-    if (m_cacheDataFlag) {
-        xySum = dsdot(&data[0], &otherData.m_data[0], numberOfPoints);
-    }
-    else {
-        std::vector<float> otherDataVector(m_numberOfTimePoints);
-        m_parentDataSeriesCiftiFile->getRow(&otherDataVector[0], otherRowIndex);
-        xySum = dsdot(&data[0], &otherDataVector[0], numberOfPoints);
-    }
-    
-    const double ssxy = xySum - (numFloat * mean * otherData.m_mean);
-    
-    float correlationCoefficient = 0.0;
-    if ((sumSquared > 0.0)
-        && (otherData.m_sqrt_ssxx > 0.0)) {
-        correlationCoefficient = (ssxy / (sumSquared * otherData.m_sqrt_ssxx));
-    }
-    return correlationCoefficient;
-}
-
-/**
- * Correlation from https://en.wikipedia.org/wiki/Pearson_product-moment_correlation_coefficient
- *
- * @param rowIndex
- *     Index of a row
- * @param otherRowIndex
- *     Index of another row
- * @param numberOfPoints
- *     Number of points int the two arrays
- * @return
- *     The correlation coefficient computed on the two arrays.
- */
-float
-CiftiConnectivityMatrixDenseDynamicFile::correlation(const int32_t rowIndex,
-                                                     const int32_t otherRowIndex,
-                                                     const int32_t numberOfPoints) const
-{
-    const double numFloat = numberOfPoints;
-    double xySum = 0.0;
-    
-    CaretAssertVectorIndex(m_rowData, rowIndex);
-    CaretAssertVectorIndex(m_rowData, otherRowIndex);
-    const RowData& data = m_rowData[rowIndex];
-    const RowData& otherData = m_rowData[otherRowIndex];
-    
-    if (m_cacheDataFlag) {
-        for (int i = 0; i < numberOfPoints; i++) {
-            CaretAssertVectorIndex(data.m_data, i);
-            CaretAssertVectorIndex(otherData.m_data, i);
-            xySum += data.m_data[i] * otherData.m_data[i];
-        }
-    }
-    else {
-        std::vector<float> dataVector(m_numberOfTimePoints);
-        std::vector<float> otherDataVector(m_numberOfTimePoints);
-        m_parentDataSeriesCiftiFile->getRow(&dataVector[0], rowIndex);
-        m_parentDataSeriesCiftiFile->getRow(&otherDataVector[0], otherRowIndex);
-        
-        for (int i = 0; i < numberOfPoints; i++) {
-            CaretAssertVectorIndex(dataVector, i);
-            CaretAssertVectorIndex(otherDataVector, i);
-            xySum += dataVector[i] * otherDataVector[i];
-        }
-    }
-    
-    const double ssxy = xySum - (numFloat * data.m_mean * otherData.m_mean);
-    
-    float correlationCoefficient = 0.0;
-    if ((data.m_sqrt_ssxx > 0.0)
-        && (otherData.m_sqrt_ssxx > 0.0)) {
-        correlationCoefficient = (ssxy / (data.m_sqrt_ssxx * otherData.m_sqrt_ssxx));
-    }
-    return correlationCoefficient;
-}
 /**
  * Save subclass data to the scene.
  *
@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include "CaretMutex.h"
 #include "CaretPointer.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 
@@ -58,6 +59,8 @@ namespace caret {
         virtual void getDataForColumn(float* dataOut, const int64_t& index) const;
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
+        
+        virtual void getDataSumForRows(double* sumOut, const std::vector<int64_t>& rowIndices) const;
                 
         virtual void getProcessedDataForColumn(float* dataOut, const int64_t& index) const;
         
@@ -72,28 +75,20 @@ namespace caret {
                                                   const SceneClass* sceneClass);
         
     private:
-        class RowData {
+        class CachedRow {
         public:
-            RowData() { }
-            
-            ~RowData() { }
+            int64_t m_rowIndex;
             
             std::vector<float> m_data;
-            float m_mean;
-            float m_sqrt_ssxx;
         };
         
-        float correlation(const int32_t rowIndex,
-                          const int32_t otherRowIndex,
-                          const int32_t numberOfPoints) const;
+        void normalizeData(float* data,
+                           const int32_t dataLength) const;
         
-        float correlation(const std::vector<float>& data,
-                          const float mean,
-                          const float sumSquared,
-                          const int32_t otherRowIndex,
-                          const int32_t numberOfPoints) const;
+        void correlateWithAllRows(const float* normalizedData,
+                                  float* dataOut) const;
         
-        void preComputeRowMeanAndSumSquared();
+        void clearRowCache();
         
         void computeDataMeanAndSumSquared(const float* data,
                                           const int32_t dataLength,
@@ -108,14 +103,20 @@ namespace caret {
         
         int32_t m_numberOfTimePoints;
         
-        std::vector<RowData> m_rowData;
+        /** brainordinates x time points, each row demeaned and scaled to unit length so correlation is a dot product */
+        std::vector<float> m_normalizedData;
+        
+        /** recently correlated rows, most recently used first */
+        mutable std::vector<CaretPointer<CachedRow> > m_rowCache;
+        
+        mutable CaretMutex m_rowCacheMutex;
+        
+        static const int32_t MAX_CACHED_ROWS;
         
         bool m_validDataFlag;
         
         bool m_enabledAsLayer;
         
-        const bool m_cacheDataFlag;
-        
         CaretPointer<SceneClassAssistant> m_sceneAssistant;
         
         // ADD_NEW_MEMBERS_HERE
@@ -123,7 +124,7 @@ namespace caret {
     };
     
 #ifdef __CIFTI_CONNECTIVITY_MATRIX_DENSE_DYNAMIC_FILE_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    const int32_t CiftiConnectivityMatrixDenseDynamicFile::MAX_CACHED_ROWS = 16;
 #endif // __CIFTI_CONNECTIVITY_MATRIX_DENSE_DYNAMIC_FILE_DECLARE__
 
 } // namespace
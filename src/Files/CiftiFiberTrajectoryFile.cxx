@@ -19,6 +19,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <map>
 #include <set>
 
@@ -30,6 +31,7 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretSparseFile.h"
 #include "CiftiFiberOrientationFile.h"
 #include "CiftiMappableDataFile.h"
@@ -1389,15 +1391,22 @@ CiftiFiberTrajectoryFile::loadRowsForAveraging(const std::vector<int64_t>& rowIn
     const CiftiXML& trajXML = m_sparseFile->getCiftiXML();
     const int64_t numberOfColumns = trajXML.getDimensionLength(CiftiXML::ALONG_ROW);
     
-    std::vector<FiberFractions> fiberFractionsForRowVector(numberOfColumns);
-    FiberFractions* fiberFractionsForRow = &fiberFractionsForRowVector[0];
-    
     const int64_t numberOfRowsToLoad = static_cast<int64_t>(rowIndices.size());
     if (numberOfRowsToLoad <= 0) {
         return false;
     }
     
-    const int32_t progressUpdateInterval = 1;
+    /*
+     * Rows are decoded in parallel a chunk at a time, and then
+     * accumulated in row order so that the averages do not
+     * depend upon the number of threads.
+     */
+    const int64_t rowsPerChunk = 16;
+    std::vector<std::vector<int64_t> > chunkFiberIndices(rowsPerChunk);
+    std::vector<std::vector<FiberFractions> > chunkFiberFractions(rowsPerChunk);
+    FiberFractions zeroFiberFractions;
+    zeroFiberFractions.zero();
+    
     EventProgressUpdate progressEvent(0,
                                       numberOfRowsToLoad,
                                       0,
@@ -1416,25 +1425,50 @@ CiftiFiberTrajectoryFile::loadRowsForAveraging(const std::vector<int64_t>& rowIn
     
     bool userCancelled = false;
     
-    for (int64_t iRow = 0; iRow < numberOfRowsToLoad; iRow++) {
-        const int64_t rowIndex = rowIndices[iRow];
+    for (int64_t chunkStart = 0; chunkStart < numberOfRowsToLoad; chunkStart += rowsPerChunk) {
+        progressEvent.setProgress(chunkStart,
+                                  "");
+        EventManager::get()->sendEvent(progressEvent.getPointer());
+        if (progressEvent.isCancelled()) {
+            userCancelled = true;
+            break;
+        }
         
-        if ((iRow % progressUpdateInterval) == 0) {
-            progressEvent.setProgress(iRow,
-                                      "");
-            EventManager::get()->sendEvent(progressEvent.getPointer());
-            if (progressEvent.isCancelled()) {
-                userCancelled = true;
-                break;
+        const int64_t chunkSize = std::min(rowsPerChunk,
+                                           numberOfRowsToLoad - chunkStart);
+        AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t iChunk = 0; iChunk < chunkSize; iChunk++) {
+            try {
+                m_sparseFile->getFibersRowSparse(rowIndices[chunkStart + iChunk],
+                                                 chunkFiberIndices[iChunk],
+                                                 chunkFiberFractions[iChunk]);
+            }
+            catch (const DataFileException& dfe) {
+#pragma omp critical
+                errorMessage = dfe.whatString();
             }
         }
+        if ( ! errorMessage.isEmpty()) {
+            clearLoadedFiberOrientations();
+            throw DataFileException(errorMessage);
+        }
         
-        m_sparseFile->getFibersRow(rowIndex,
-                                   fiberFractionsForRow);
-        
-        for (int64_t iCol = 0; iCol < numberOfColumns; iCol++) {
-            FiberOrientationTrajectory* fot = m_fiberOrientationTrajectories[iCol];
-            fot->addFiberFractionsForAveraging(fiberFractionsForRow[iCol]);
+        for (int64_t iChunk = 0; iChunk < chunkSize; iChunk++) {
+            const std::vector<int64_t>& fiberIndices = chunkFiberIndices[iChunk];
+            const std::vector<FiberFractions>& fiberFractions = chunkFiberFractions[iChunk];
+            const int64_t numFibers = static_cast<int64_t>(fiberIndices.size());
+            int64_t iCol = 0;
+            for (int64_t iFiber = 0; iFiber < numFibers; iFiber++) {
+                for ( ; iCol < fiberIndices[iFiber]; iCol++) {
+                    m_fiberOrientationTrajectories[iCol]->addFiberFractionsForAveraging(zeroFiberFractions);
+                }
+                m_fiberOrientationTrajectories[iCol]->addFiberFractionsForAveraging(fiberFractions[iFiber]);
+                iCol++;
+            }
+            for ( ; iCol < numberOfColumns; iCol++) {
+                m_fiberOrientationTrajectories[iCol]->addFiberFractionsForAveraging(zeroFiberFractions);
+            }
         }
     }
     
@@ -371,22 +371,23 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
     const int64_t numIndices = static_cast<int64_t>(indices.size());
     if (numIndices > 0) {
         std::vector<double> sum(dataLength, 0.0);
-        std::vector<float>  data(dataLength);
         
-        for (std::vector<int64_t>::const_iterator iter = indices.begin();
-             iter != indices.end();
-             iter++) {
-            if (doRowsFlag) {
-                getDataForRow(&data[0], *iter);
-            }
-            else {
+        if (doRowsFlag) {
+            getDataSumForRows(&sum[0],
+                              indices);
+        }
+        else {
+            std::vector<float> data(dataLength);
+            for (std::vector<int64_t>::const_iterator iter = indices.begin();
+                 iter != indices.end();
+                 iter++) {
                 getDataForColumn(&data[0], *iter);
-            }
-            
-            for (int64_t i = 0; i < dataLength; i++) {
-                CaretAssertVectorIndex(sum, i);
-                CaretAssertVectorIndex(data, i);
-                sum[i] += data[i];
+                
+                for (int64_t i = 0; i < dataLength; i++) {
+                    CaretAssertVectorIndex(sum, i);
+                    CaretAssertVectorIndex(data, i);
+                    sum[i] += data[i];
+                }
             }
         }
 
@@ -594,6 +595,24 @@ CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int
                         index);
 }
 
+/**
+ * Load the sum of the data for the given rows.  Neighboring
+ * rows are read together, which is much faster than loading
+ * each row individually when there are many rows.
+ *
+ * @param sumOut
+ *     Output with sum of the rows' data.
+ * @param rowIndices
+ *     Indices of the rows.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::getDataSumForRows(double* sumOut,
+                                                           const std::vector<int64_t>& rowIndices) const
+{
+    m_ciftiFile->getRowSum(sumOut,
+                           rowIndices);
+}
+
 /**
  * Load PROCESSED data for the given column.
  *
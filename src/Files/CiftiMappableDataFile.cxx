@@ -2456,6 +2456,8 @@ CiftiMappableDataFile::updateScalarColoringForMap(const int32_t mapIndex,
         CaretAssert(0);
     }
     
+    mapColoringChanged();
+    
     /*
      * Force recreation of matrix so that it receives updates to coloring.
      */
@@ -2464,6 +2466,25 @@ CiftiMappableDataFile::updateScalarColoringForMap(const int32_t mapIndex,
     m_matrixGraphicsPrimitive.reset();
 }
 
+/**
+ * Get a counter that changes whenever the voxel coloring of a map changes.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @return
+ *     The counter, or negative if the map's coloring has been invalidated
+ *     and is updated when the voxel colors are next requested.
+ */
+int64_t
+CiftiMappableDataFile::getVoxelColoringChangedCounter(const int32_t mapIndex) const
+{
+    if ( ! isMapColoringValid(mapIndex)) {
+        return -1;
+    }
+    
+    return getMapColoringChangedCounter();
+}
+
 /**
  * Note that some CIFTI files can be slow to color due to the need to
  * retrieve data for the map.  This method can be used to avoid calls
@@ -6223,7 +6244,50 @@ CiftiMappableDataFile::helpLoadChartDataForSurfaceNodeAverage(const StructureEnu
     
     try {
         const int32_t numberOfNodes = static_cast<int32_t>(nodeIndices.size());
-        if (numberOfNodes > 0) {
+        if ((numberOfNodes > 0)
+            && (m_dataMappingAccessMethod == DATA_ACCESS_FILE_ROWS_OR_XML_ALONG_COLUMN)) {
+            /*
+             * Find the rows for all of the nodes so that the CIFTI file
+             * reads neighboring rows together, in file order.
+             */
+            CaretAssert(m_ciftiFile);
+            const CiftiXML& ciftiXML = m_ciftiFile->getCiftiXML();
+            const CiftiMappingType::MappingType mappingType = ciftiXML.getMappingType(CiftiXML::ALONG_COLUMN);
+            const int64_t numberOfRows = m_ciftiFile->getNumberOfRows();
+            std::vector<int64_t> rowIndices;
+            rowIndices.reserve(numberOfNodes);
+            for (int32_t i = 0; i < numberOfNodes; i++) {
+                int64_t rowIndex = -1;
+                if (mappingType == CiftiMappingType::BRAIN_MODELS) {
+                    rowIndex = ciftiXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN).getIndexForNode(nodeIndices[i],
+                                                                                                  structure);
+                }
+                else if (mappingType == CiftiMappingType::PARCELS) {
+                    rowIndex = ciftiXML.getParcelsMap(CiftiXML::ALONG_COLUMN).getIndexForNode(nodeIndices[i],
+                                                                                              structure);
+                }
+                if ((rowIndex >= 0)
+                    && (rowIndex < numberOfRows)) {
+                    rowIndices.push_back(rowIndex);
+                }
+            }
+            
+            const int64_t dataSumSize = m_ciftiFile->getNumberOfColumns();
+            if (( ! rowIndices.empty())
+                && (dataSumSize > 0)) {
+                std::vector<double> dataSum(dataSumSize);
+                m_ciftiFile->getRowSum(&dataSum[0],
+                                       rowIndices);
+                
+                const double dataAverageCount = rowIndices.size();
+                std::vector<float> dataAverage(dataSumSize);
+                for (int64_t k = 0; k < dataSumSize; k++) {
+                    dataAverage[k] = dataSum[k] / dataAverageCount;
+                }
+                chartData = helpCreateCartesianChartData(dataAverage);
+            }
+        }
+        else if (numberOfNodes > 0) {
             std::vector<double> dataSum;
             int32_t dataSumSize = 0;
             int32_t dataAverageCount = 0;
@@ -304,6 +304,8 @@ namespace caret {
                                                  const int32_t tabIndex,
                                                  uint8_t* rgbaOut) const;
         
+        virtual int64_t getVoxelColoringChangedCounter(const int32_t mapIndex) const;
+        
         int64_t getVoxelColorsForSliceInMap(const int32_t mapIndex,
                                             const int64_t firstVoxelIJK[3],
                                             const int64_t rowStepIJK[3],
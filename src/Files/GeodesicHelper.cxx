@@ -27,6 +27,7 @@
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdint.h>
@@ -215,6 +216,255 @@ void GeodesicHelper::getNodesToGeoDist(const int32_t node, const float maxdist,
     }
 }
 
+void GeodesicHelper::getNodesToGeoDist(const vector<int32_t>& nodes, const float maxdist, vector<vector<int32_t> >& nodesOut, vector<vector<float> >& distsOut, const bool smoothflag)
+{//public methods sanity check, private methods process
+    int32_t numRoots = (int32_t)nodes.size();
+    nodesOut.resize(numRoots);
+    distsOut.resize(numRoots);
+    vector<int32_t> validRoots;
+    for (int32_t i = 0; i < numRoots; ++i)
+    {
+        nodesOut[i].clear();
+        distsOut[i].clear();
+        CaretAssert(nodes[i] < numNodes && nodes[i] >= 0);
+        if (nodes[i] < numNodes && nodes[i] >= 0) validRoots.push_back(nodes[i]);
+    }
+    if (maxdist < 0.0f || validRoots.empty()) return;
+    CaretMutexLocker locked(&inUse);
+    if (m_localIndex.empty())
+    {
+        m_localIndex.resize(numNodes, -1);
+    }
+    regionWithinDist(validRoots, maxdist, smoothflag);
+    int32_t numRegion = (int32_t)m_regionNodes.size();
+    float minEdge = -1.0f, maxEdge = 0.0f;
+    int64_t numEdges = (int64_t)m_regionEdgeDist.size();
+    for (int64_t i = 0; i < numEdges; ++i)
+    {
+        float tempf = m_regionEdgeDist[i];
+        if (minEdge < 0.0f || tempf < minEdge) minEdge = tempf;
+        if (tempf > maxEdge) maxEdge = tempf;
+    }
+    maxEdge = min(maxEdge, maxdist);//longer edges can never be used
+    //Dial's algorithm: with buckets narrower than the shortest edge, everything in the lowest nonempty bucket is final, so no heap is needed
+    float bucketWidth = minEdge * 0.99f;//slightly narrower, so that rounding can't put a neighbor in the current bucket
+    int32_t numBuckets = -1;
+    if (bucketWidth > 0.0f && maxEdge / bucketWidth + 2 <= MAX_DIAL_BUCKETS && maxdist / bucketWidth <= numRegion)
+    {//also don't use buckets if scanning the empty ones would take longer than the search itself
+        numBuckets = (int32_t)(maxEdge / bucketWidth) + 2;//live distances never span more than the longest edge, so the buckets can be reused circularly
+        if ((int32_t)m_buckets.size() < numBuckets) m_buckets.resize(numBuckets);
+    }
+    if (m_regionDist.size() < m_regionNodes.size())
+    {
+        m_regionDist.resize(numRegion);
+        m_regionState.resize(numRegion, 0);
+    }
+    for (int32_t i = 0; i < numRoots; ++i)
+    {
+        if (nodes[i] < 0 || nodes[i] >= numNodes) continue;
+        regionDijkstra(m_localIndex[nodes[i]], maxdist, bucketWidth, numBuckets, nodesOut[i], distsOut[i]);
+    }
+    for (int32_t i = 0; i < numRegion; ++i)
+    {
+        m_localIndex[m_regionNodes[i]] = -1;
+    }
+}
+
+void GeodesicHelper::getNearbyNodeBlocks(const int32_t blockSize, vector<vector<int32_t> >& blocksOut, const float* roi) const
+{
+    CaretAssert(blockSize > 0);
+    blocksOut.clear();
+    vector<char> assigned(numNodes, 0);
+    vector<int32_t> queue, block;
+    for (int32_t start = 0; start < numNodes; ++start)
+    {
+        if (assigned[start] || (roi != NULL && !(roi[start] > 0.0f))) continue;
+        queue.clear();
+        block.clear();
+        queue.push_back(start);
+        assigned[start] = 1;
+        size_t queuePos = 0;
+        while (queuePos < queue.size() && (int32_t)block.size() < blockSize)
+        {//breadth first, so blocks are compact patches of surface
+            int32_t node = queue[queuePos++];
+            block.push_back(node);
+            const vector<int32_t>& neighbors = nodeNeighbors[node];
+            for (size_t j = 0; j < neighbors.size(); ++j)
+            {
+                int32_t neigh = neighbors[j];
+                if (!assigned[neigh] && (roi == NULL || roi[neigh] > 0.0f))
+                {
+                    assigned[neigh] = 1;
+                    queue.push_back(neigh);
+                }
+            }
+        }
+        for (; queuePos < queue.size(); ++queuePos)
+        {//queued but didn't fit, leave them for a later block
+            assigned[queue[queuePos]] = 0;
+        }
+        blocksOut.push_back(block);
+    }
+}
+
+void GeodesicHelper::regionWithinDist(const vector<int32_t>& roots, const float maxdist, bool smooth)
+{//multi-root version of the restricted dijkstra, only needs to find the nodes, not their parents
+    int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0;
+    const int32_t* neighbors;
+    float tempf;
+    m_active.clear();
+    m_regionNodes.clear();
+    for (i = 0; i < (int32_t)roots.size(); ++i)
+    {
+        if (marked[roots[i]] & 4) continue;//duplicate root
+        output[roots[i]] = 0.0f;
+        marked[roots[i]] |= 4;
+        changed[numChanged++] = roots[i];
+        m_heapIdent[roots[i]] = m_active.push(roots[i], 0.0f);
+    }
+    while (!m_active.isEmpty())
+    {
+        whichnode = m_active.pop();
+        m_localIndex[whichnode] = (int32_t)m_regionNodes.size();
+        m_regionNodes.push_back(whichnode);
+        marked[whichnode] |= 1;
+        for (int pass = 0; pass < (smooth ? 2 : 1); ++pass)
+        {
+            const vector<int32_t>& neighVec = (pass == 0 ? nodeNeighbors[whichnode] : nodeNeighbors2[whichnode]);
+            const float* neighDists = (pass == 0 ? distances[whichnode].data() : distances2[whichnode].data());
+            neighbors = neighVec.data();
+            numNeigh = (int32_t)neighVec.size();
+            for (j = 0; j < numNeigh; ++j)
+            {
+                whichneigh = neighbors[j];
+                if (!(marked[whichneigh] & 1))
+                {
+                    tempf = output[whichnode] + neighDists[j];
+                    if (tempf <= maxdist)
+                    {
+                        if (!(marked[whichneigh] & 4))
+                        {
+                            marked[whichneigh] |= 4;
+                            changed[numChanged++] = whichneigh;
+                            output[whichneigh] = tempf;
+                            m_heapIdent[whichneigh] = m_active.push(whichneigh, tempf);
+                        } else if (tempf < output[whichneigh]) {
+                            output[whichneigh] = tempf;
+                            m_active.changekey(m_heapIdent[whichneigh], tempf);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (i = 0; i < numChanged; ++i)
+    {
+        marked[changed[i]] = 0;
+    }
+    //every node on a path shorter than maxdist from a root is also within maxdist of that root, so edges leaving the region are never needed
+    int32_t numRegion = (int32_t)m_regionNodes.size();
+    m_regionEdgeStart.resize(numRegion + 1);
+    m_regionEdgeNode.clear();
+    m_regionEdgeDist.clear();
+    for (i = 0; i < numRegion; ++i)
+    {
+        m_regionEdgeStart[i] = (int32_t)m_regionEdgeNode.size();
+        whichnode = m_regionNodes[i];
+        for (int pass = 0; pass < (smooth ? 2 : 1); ++pass)
+        {
+            const vector<int32_t>& neighVec = (pass == 0 ? nodeNeighbors[whichnode] : nodeNeighbors2[whichnode]);
+            const float* neighDists = (pass == 0 ? distances[whichnode].data() : distances2[whichnode].data());
+            numNeigh = (int32_t)neighVec.size();
+            for (j = 0; j < numNeigh; ++j)
+            {
+                int32_t localNeigh = m_localIndex[neighVec[j]];
+                if (localNeigh != -1)
+                {
+                    m_regionEdgeNode.push_back(localNeigh);
+                    m_regionEdgeDist.push_back(neighDists[j]);
+                }
+            }
+        }
+    }
+    m_regionEdgeStart[numRegion] = (int32_t)m_regionEdgeNode.size();
+}
+
+void GeodesicHelper::regionDijkstra(const int32_t localRoot, const float maxdist, const float bucketWidth, const int32_t numBuckets, vector<int32_t>& nodes, vector<float>& dists)
+{
+    const bool useBuckets = (numBuckets > 0);
+    int64_t numQueued = 0, curBucket = 0;
+    m_regionTouched.clear();
+    m_regionDist[localRoot] = 0.0f;
+    m_regionState[localRoot] = 1;
+    m_regionTouched.push_back(localRoot);
+    if (useBuckets)
+    {
+        m_buckets[0].push_back(localRoot);
+        numQueued = 1;
+    } else {
+        m_active.clear();
+        m_heapIdent[localRoot] = m_active.push(localRoot, 0.0f);
+    }
+    while (useBuckets ? (numQueued > 0) : !m_active.isEmpty())
+    {
+        int32_t whichnode;
+        if (useBuckets)
+        {
+            vector<int32_t>& thisBucket = m_buckets[curBucket % numBuckets];
+            if (thisBucket.empty())
+            {
+                ++curBucket;
+                continue;
+            }
+            whichnode = thisBucket.back();
+            thisBucket.pop_back();
+            --numQueued;
+            if (m_regionState[whichnode] == 2) continue;//stale entry from before its distance was lowered
+        } else {
+            whichnode = m_active.pop();
+        }
+        m_regionState[whichnode] = 2;
+        float nodeDist = m_regionDist[whichnode];
+        nodes.push_back(m_regionNodes[whichnode]);
+        dists.push_back(nodeDist);
+        int32_t edgeEnd = m_regionEdgeStart[whichnode + 1];
+        for (int32_t j = m_regionEdgeStart[whichnode]; j < edgeEnd; ++j)
+        {
+            int32_t whichneigh = m_regionEdgeNode[j];
+            if (m_regionState[whichneigh] == 2) continue;
+            float tempf = nodeDist + m_regionEdgeDist[j];
+            if (tempf > maxdist) continue;
+            if (m_regionState[whichneigh] == 0)
+            {
+                m_regionState[whichneigh] = 1;
+                m_regionTouched.push_back(whichneigh);
+                m_regionDist[whichneigh] = tempf;
+                if (useBuckets)
+                {
+                    m_buckets[((int64_t)(tempf / bucketWidth)) % numBuckets].push_back(whichneigh);
+                    ++numQueued;
+                } else {
+                    m_heapIdent[whichneigh] = m_active.push(whichneigh, tempf);
+                }
+            } else if (tempf < m_regionDist[whichneigh]) {
+                m_regionDist[whichneigh] = tempf;
+                if (useBuckets)
+                {//the old entry gets skipped when it comes up, since the node will be frozen by then
+                    m_buckets[((int64_t)(tempf / bucketWidth)) % numBuckets].push_back(whichneigh);
+                    ++numQueued;
+                } else {
+                    m_active.changekey(m_heapIdent[whichneigh], tempf);
+                }
+            }
+        }
+    }
+    int32_t numTouched = (int32_t)m_regionTouched.size();
+    for (int32_t i = 0; i < numTouched; ++i)
+    {
+        m_regionState[m_regionTouched[i]] = 0;
+    }
+}
+
 void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth)
 {
     int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0;
@@ -81,6 +81,15 @@ namespace caret {
         int32_t numNodes;
         float m_avgNodeSpacing;
         float m_corrAreaSmallestFactor;
+        //scratch space for batched searches, allocated on first use
+        std::vector<int32_t> m_localIndex;//global to local node index, -1 when not in the current region
+        std::vector<int32_t> m_regionNodes;//local to global
+        std::vector<int32_t> m_regionEdgeStart, m_regionEdgeNode;//compressed neighbor lists within the region, including neighbors2 when smoothing
+        std::vector<float> m_regionEdgeDist, m_regionDist;
+        std::vector<char> m_regionState;//0 untouched, 1 has tentative distance, 2 frozen
+        std::vector<int32_t> m_regionTouched;
+        std::vector<std::vector<int32_t> > m_buckets;//circular bucket queue
+        static const int32_t MAX_DIAL_BUCKETS = 4096;//use the heap instead if the edge lengths are too spread out for this many buckets
         GeodesicHelper();//Don't allow construction without arguments
         GeodesicHelper& operator=(const GeodesicHelper& right);//can't assign
         GeodesicHelper(const GeodesicHelper&);//can't use copy constructor
@@ -89,6 +98,8 @@ namespace caret {
         void dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth);//partial surface
         int32_t dijkstra(const std::vector<int32_t>& startList, const std::vector<int32_t>& endList, const float& maxDist, bool smooth);//one path that connects lists
         void alltoall(float** out, int32_t** parents, bool smooth);//must be fully allocated
+        void regionWithinDist(const std::vector<int32_t>& roots, const float maxdist, bool smooth);//builds the compressed graph of all nodes within maxdist of any root
+        void regionDijkstra(const int32_t localRoot, const float maxdist, const float bucketWidth, const int32_t numBuckets, std::vector<int32_t>& nodes, std::vector<float>& dists);//bucket queue if numBuckets > 0, otherwise heap
         int32_t closest(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smooth);//just closest node
         int32_t closest(const int32_t& root, const char* roi, bool smooth);//just closest node
         void aStar(const int32_t root, const int32_t endpoint, bool smooth);//faster method for path
@@ -104,6 +115,12 @@ namespace caret {
         /// Get distances from root node, up to a geodesic distance cutoff, and also return their parents (root node has -1 as parent)
         void getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& neighborsOut, std::vector<float>& distsOut, std::vector<int32_t>& parentsOut, const bool smoothflag = true);
 
+        /// Get distances from each of several root nodes, up to a geodesic distance cutoff - much faster than separate calls when the roots are near each other, but output lists are NOT sorted by distance
+        void getNodesToGeoDist(const std::vector<int32_t>& nodes, const float maxdist, std::vector<std::vector<int32_t> >& neighborsOut, std::vector<std::vector<float> >& distsOut, const bool smoothflag = true);
+
+        /// Split the surface into blocks of at most blockSize nodes that are connected to each other, for use as roots in the above - if roi is given, only nodes with roi value greater than 0 are used
+        void getNearbyNodeBlocks(const int32_t blockSize, std::vector<std::vector<int32_t> >& blocksOut, const float* roi = NULL) const;
+
         /// Get distances from root node to entire surface - allocate the array first
         void getGeoFromNode(const int32_t node, float* valuesOut, const bool smoothflag = true);//MUST be already allocated to number of nodes
 
@@ -43,6 +43,7 @@ MetricFile::MetricFile()
 : GiftiTypeFile(DataFileTypeEnum::METRIC)
 {
     this->initializeMembersMetricFile();
+    this->giftiFile->setDeferExternalDataLoadingFlag(true);//columns in external binary files are read when first used
 }
 
 /**
@@ -134,7 +135,12 @@ MetricFile::validateDataArraysAfterReading()
         std::vector<int64_t> dims = gda->getDimensions();
         if (numDims == 1 || (numDims == 2 && dims[1] == 1))
         {
-            this->columnDataPointers.push_back(gda->getDataPointerFloat());
+            if (gda->isDataLoaded())
+            {
+                this->columnDataPointers.push_back(gda->getDataPointerFloat());
+            } else {
+                this->columnDataPointers.push_back(NULL);//read on first use, see getColumnDataPointer()
+            }
         } else {
             if (numDims != 2)
             {
@@ -249,11 +255,10 @@ float
 MetricFile::getValue(const int32_t nodeIndex,
                      const int32_t columnIndex) const
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
     CaretAssertMessage((nodeIndex >= 0) && (nodeIndex < this->getNumberOfNodes()), 
                        "Node Index out of range.");
     
-    return this->columnDataPointers[columnIndex][nodeIndex];
+    return this->getColumnDataPointer(columnIndex)[nodeIndex];
 }
 
 /**
@@ -271,18 +276,36 @@ MetricFile::setValue(const int32_t nodeIndex,
                      const int32_t columnIndex,
                      const float value)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
     CaretAssertMessage((nodeIndex >= 0) && (nodeIndex < this->getNumberOfNodes()), "Node Index out of range.");
     
-    this->columnDataPointers[columnIndex][nodeIndex] = value;
+    this->getColumnDataPointer(columnIndex)[nodeIndex] = value;
     setModified();
 }
 
 const float* 
 MetricFile::getValuePointerForColumn(const int32_t columnIndex) const
+{
+    return this->getColumnDataPointer(columnIndex);
+}
+
+/**
+ * Get the data for a column, reading it first if it was deferred
+ * in an external binary file.
+ *
+ * @param columnIndex
+ *     Column index.
+ * @return
+ *     Pointer to the column's data.
+ */
+float*
+MetricFile::getColumnDataPointer(const int32_t columnIndex) const
 {
     CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    return this->columnDataPointers[columnIndex];
+    float* columnData = this->columnDataPointers[columnIndex];
+    if (columnData == NULL) {//don't cache it here, const accessors may be called from several threads
+        columnData = this->giftiFile->getDataArray(columnIndex)->getDataPointerFloat();//thread safe, loads the data once
+    }
+    return columnData;
 }
 
 void MetricFile::setNumberOfNodesAndColumns(int32_t nodes, int32_t columns)
@@ -357,8 +380,7 @@ MetricFile::addMaps(const int32_t numberOfNodes,
 
 void MetricFile::setValuesForColumn(const int32_t columnIndex, const float* valuesIn)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    float* myColumn = columnDataPointers[columnIndex];
+    float* myColumn = getColumnDataPointer(columnIndex);
     int numNodes = (int)getNumberOfNodes();
     for (int i = 0; i < numNodes; ++i)
     {
@@ -369,8 +391,7 @@ void MetricFile::setValuesForColumn(const int32_t columnIndex, const float* valu
 
 void MetricFile::initializeColumn(const int32_t columnIndex, const float& value)
 {
-    CaretAssertVectorIndex(this->columnDataPointers, columnIndex);
-    float* myColumn = columnDataPointers[columnIndex];
+    float* myColumn = getColumnDataPointer(columnIndex);
     int numNodes = (int)getNumberOfNodes();
     for (int i = 0; i < numNodes; ++i)
     {
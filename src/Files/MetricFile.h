@@ -118,7 +118,9 @@ namespace caret {
                                               const SceneClass* sceneClass);
         
     private:
-        /** Points to actual data in each Gifti Data Array */
+        float* getColumnDataPointer(const int32_t columnIndex) const;
+        
+        /** Points to actual data in each Gifti Data Array, NULL if it was deferred in an external binary file when validated */
         std::vector<float*> columnDataPointers;
 
         bool m_chartingEnabledForTab[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
@@ -21,17 +21,32 @@
 #include "MetricSmoothingObject.h"
 
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "SurfaceFile.h"
 #include "MetricFile.h"
 #include "GeodesicHelper.h"
 #include "TopologyHelper.h"
 #include "CaretOMP.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace std;
 using namespace caret;
 
+AString MetricSmoothingObject::s_kernelCacheDirectory;
+
+namespace
+{
+    const char KERNEL_CACHE_MAGIC[8] = { 'w', 'b', 's', 'm', 'k', 'n', '0', '1' };//last 2 characters are the format version
+}
+
 MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
 {
     CaretAssert(mySurf != NULL);
@@ -39,14 +54,179 @@ MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const fl
     {
         throw CaretException("roi number of nodes doesn't match the surface");
     }
+    if (s_kernelCacheDirectory != "")
+    {
+        AString cacheName = getKernelCacheFileName(s_kernelCacheDirectory, mySurf, kernel, myRoi, myMethod, nodeAreas);
+        if (QFile::exists(cacheName) && readKernelCache(cacheName, mySurf->getNumberOfNodes()))
+        {
+            CaretLogFine("using precomputed smoothing kernels from '" + cacheName + "'");
+            return;
+        }
+    }
     precomputeWeights(mySurf, kernel, myRoi, myMethod, nodeAreas);
 }
 
+AString MetricSmoothingObject::precomputeKernels(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas, const AString& directory)
+{
+    CaretAssert(mySurf != NULL);
+    if (myRoi != NULL && mySurf->getNumberOfNodes() != myRoi->getNumberOfNodes())
+    {
+        throw CaretException("roi number of nodes doesn't match the surface");
+    }
+    AString ret = getKernelCacheFileName(directory, mySurf, kernel, myRoi, myMethod, nodeAreas);
+    MetricSmoothingObject temp;//don't use the constructor, it could just load the file we are replacing
+    temp.precomputeWeights(mySurf, kernel, myRoi, myMethod, nodeAreas);
+    temp.writeKernelCache(ret);
+    return ret;
+}
+
+AString MetricSmoothingObject::getKernelCacheFileName(const AString& directory, const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
+{//the name is a hash of everything the kernels depend on, so a stale file can't be picked up by accident
+    QCryptographicHash myHash(QCryptographicHash::Md5);
+    AString methodName;
+    switch (myMethod)
+    {
+        case GEO_GAUSS_AREA:
+            methodName = "GEO_GAUSS_AREA";
+            break;
+        case GEO_GAUSS_EQUAL:
+            methodName = "GEO_GAUSS_EQUAL";
+            break;
+        case GEO_GAUSS:
+            methodName = "GEO_GAUSS";
+            break;
+    }
+    myHash.addData(methodName.toUtf8());
+    myHash.addData((const char*)&kernel, sizeof(float));
+    int32_t counts[2] = { mySurf->getNumberOfNodes(), mySurf->getNumberOfTriangles() };
+    myHash.addData((const char*)counts, sizeof(counts));
+    myHash.addData((const char*)mySurf->getCoordinateData(), sizeof(float) * 3 * counts[0]);
+    for (int j = 0; j < counts[1]; ++j)
+    {
+        myHash.addData((const char*)mySurf->getTriangle(j), sizeof(int32_t) * 3);
+    }
+    if (myMethod == GEO_GAUSS_AREA)
+    {//same logic as precomputeWeights, so that giving the surface's own areas matches not giving any
+        vector<float> areasTemp;
+        const float* hashAreas = nodeAreas;
+        if (hashAreas == NULL)
+        {
+            mySurf->computeNodeAreas(areasTemp);
+            hashAreas = areasTemp.data();
+        }
+        myHash.addData((const char*)hashAreas, sizeof(float) * counts[0]);
+    }
+    if (myRoi != NULL)
+    {//only whether each vertex is in the roi matters
+        const float* roiData = myRoi->getValuePointerForColumn(0);
+        vector<char> roiMask(counts[0]);
+        for (int i = 0; i < counts[0]; ++i)
+        {
+            roiMask[i] = (roiData[i] > 0.0f) ? 1 : 0;
+        }
+        myHash.addData("roi", 3);
+        myHash.addData(roiMask.data(), counts[0]);
+    }
+    AString ret = directory;
+    if (!ret.endsWith("/")) ret += "/";
+    return ret + AString(myHash.result().toHex()) + ".wbsmooth";
+}
+
+bool MetricSmoothingObject::readKernelCache(const AString& fileName, const int32_t& numNodes)
+{
+    try
+    {
+        CaretBinaryFile myFile(fileName, CaretBinaryFile::READ_MEMORY_MAP);
+        char magic[8];
+        int32_t header[2];//byte order check, number of nodes
+        int64_t numWeights = -1;
+        myFile.read(magic, 8);
+        myFile.read(header, sizeof(header));
+        myFile.read(&numWeights, sizeof(int64_t));
+        if (memcmp(magic, KERNEL_CACHE_MAGIC, 8) != 0 || header[0] != 1)
+        {
+            CaretLogWarning("ignoring smoothing kernel file '" + fileName + "' of unknown version or byte order");
+            return false;
+        }
+        if (header[1] != numNodes || numWeights < 0)
+        {
+            CaretLogWarning("ignoring smoothing kernel file '" + fileName + "' that does not match the surface");
+            return false;
+        }
+        int64_t expectedSize = 8 + sizeof(header) + sizeof(int64_t) + sizeof(int64_t) * (numNodes + 1) + sizeof(float) * numNodes + (sizeof(int32_t) + sizeof(float)) * numWeights;
+        if (myFile.size() != expectedSize)
+        {//check before allocating anything based on the header
+            CaretLogWarning("ignoring corrupted smoothing kernel file '" + fileName + "'");
+            return false;
+        }
+        vector<int64_t> offsets(numNodes + 1);
+        vector<float> weightSums(numNodes);
+        vector<int32_t> neighbors(numWeights);
+        vector<float> weights(numWeights);
+        myFile.read(offsets.data(), sizeof(int64_t) * (numNodes + 1));
+        myFile.read(weightSums.data(), sizeof(float) * numNodes);
+        myFile.read(neighbors.data(), sizeof(int32_t) * numWeights);
+        myFile.read(weights.data(), sizeof(float) * numWeights);
+        if (offsets[0] != 0 || offsets[numNodes] != numWeights)
+        {
+            CaretLogWarning("ignoring corrupted smoothing kernel file '" + fileName + "'");
+            return false;
+        }
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            if (offsets[i + 1] < offsets[i])
+            {
+                CaretLogWarning("ignoring corrupted smoothing kernel file '" + fileName + "'");
+                return false;
+            }
+        }
+        for (int64_t i = 0; i < numWeights; ++i)
+        {
+            if (neighbors[i] < 0 || neighbors[i] >= numNodes)
+            {
+                CaretLogWarning("ignoring corrupted smoothing kernel file '" + fileName + "'");
+                return false;
+            }
+        }
+        m_rowStart.swap(offsets);//the file layout is the same as the compressed rows
+        m_rowNodes.swap(neighbors);
+        m_rowWeights.swap(weights);
+        m_weightSums.swap(weightSums);
+    } catch (CaretException& e) {
+        CaretLogWarning("failed to read smoothing kernel file '" + fileName + "': " + e.whatString());
+        return false;
+    }
+    return true;
+}
+
+void MetricSmoothingObject::writeKernelCache(const AString& fileName) const
+{
+    int32_t numNodes = getNumberOfNodes();
+    int32_t header[2] = { 1, numNodes };
+    int64_t numWeights = m_rowStart[numNodes];
+    AString tempName = fileName + ".partial";//write elsewhere and rename, so that a smoothing command running at the same time never sees a partial file
+    {
+        CaretBinaryFile myFile(tempName, CaretBinaryFile::WRITE_TRUNCATE);
+        myFile.write(KERNEL_CACHE_MAGIC, 8);
+        myFile.write(header, sizeof(header));
+        myFile.write(&numWeights, sizeof(int64_t));
+        myFile.write(m_rowStart.data(), sizeof(int64_t) * (numNodes + 1));
+        myFile.write(m_weightSums.data(), sizeof(float) * numNodes);
+        if (numWeights > 0)
+        {
+            myFile.write(m_rowNodes.data(), sizeof(int32_t) * numWeights);
+            myFile.write(m_rowWeights.data(), sizeof(float) * numWeights);
+        }
+    }
+    QFile::remove(fileName);
+    if (!QFile::rename(tempName, fileName)) throw CaretException("failed to rename '" + tempName + "' to '" + fileName + "'");
+}
+
 void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi, const bool& fixZeros) const
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +234,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != getNumberOfNodes() || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(getNumberOfNodes(), 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != getNumberOfNodes())
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +255,15 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != getNumberOfNodes()))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -112,31 +292,89 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
+    int32_t numNodes = getNumberOfNodes();
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != numNodes || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(numNodes, numCols);
     }
-    vector<float> scratch(metricIn->getNumberOfNodes());
+    const float* roiColumn = NULL;
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
-        for (int32_t i = 0; i < numCols; ++i)
+        roiColumn = roi->getValuePointerForColumn(0);
+    }
+    vector<float> scratch((int64_t)numNodes * PANEL_WIDTH);//metric files don't give out writable column pointers, so smooth a panel's worth of columns at a time
+    for (int32_t first = 0; first < numCols; first += PANEL_WIDTH)
+    {
+        int32_t blockCols = numCols - first;
+        if (blockCols > PANEL_WIDTH) blockCols = PANEL_WIDTH;
+        vector<const float*> columnsIn(blockCols);
+        vector<float*> columnsOut(blockCols);
+        for (int32_t c = 0; c < blockCols; ++c)
+        {
+            columnsIn[c] = metricIn->getValuePointerForColumn(first + c);
+            columnsOut[c] = scratch.data() + (int64_t)c * numNodes;
+        }
+        smoothColumns(columnsIn, columnsOut, roiColumn, fixZeros);
+        for (int32_t c = 0; c < blockCols; ++c)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, roi, 0, fixZeros);
+            metricOut->setValuesForColumn(first + c, columnsOut[c]);
         }
+    }
+}
+
+void MetricSmoothingObject::smoothColumn(const float* columnIn, float* columnOut, const float* roiColumn, const bool& fixZeros) const
+{
+    CaretAssert(columnIn != NULL);
+    CaretAssert(columnOut != NULL);
+    CaretAssert(columnIn != columnOut);
+    if (roiColumn != NULL)
+    {
+        smoothColumnInternal(columnOut, columnIn, roiColumn, fixZeros);
     } else {
-        for (int32_t i = 0; i < numCols; ++i)
+        smoothColumnInternal(columnOut, columnIn, fixZeros);
+    }
+}
+
+void MetricSmoothingObject::smoothColumns(const vector<const float*>& columnsIn, const vector<float*>& columnsOut, const float* roiColumn, const bool& fixZeros) const
+{
+    CaretAssert(columnsIn.size() == columnsOut.size());
+    int32_t numNodes = getNumberOfNodes();
+    int32_t numColumns = (int32_t)columnsIn.size();
+    if (numColumns == 0) return;
+    vector<float> panel((int64_t)numNodes * PANEL_WIDTH);
+    for (int32_t first = 0; first < numColumns; first += PANEL_WIDTH)
+    {
+        int32_t panelColumns = numColumns - first;
+        if (panelColumns > PANEL_WIDTH) panelColumns = PANEL_WIDTH;
+        //interleave the columns, so that each kernel entry gets the values of all of them from one cache line
+        //unused lanes and vertices outside the roi are zeroed, so the kernel loops don't need to check the roi per column
+#pragma omp CARET_PARFOR
+        for (int32_t i = 0; i < numNodes; ++i)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, fixZeros);
+            float* panelRow = panel.data() + (int64_t)i * PANEL_WIDTH;
+            int32_t c = 0;
+            if (roiColumn == NULL || roiColumn[i] > 0.0f)
+            {
+                for (; c < panelColumns; ++c)
+                {
+                    panelRow[c] = columnsIn[first + c][i];
+                }
+            }
+            for (; c < PANEL_WIDTH; ++c)
+            {
+                panelRow[c] = 0.0f;
+            }
         }
+        smoothPanel(panel.data(), panelColumns, columnsOut, first, roiColumn, fixZeros);
     }
 }
 
@@ -144,27 +382,44 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 {
     CaretAssert(metricIn != NULL);//asserts only, and only basic checks, these functions are private
     CaretAssert(metricOut != NULL);
-    CaretAssert(scratch != NULL);
     CaretAssert(whichColumn >= 0 && whichColumn < metricIn->getNumberOfColumns());
     CaretAssert(whichOutColumn >= 0 && whichOutColumn < metricOut->getNumberOfColumns());
-    const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
-    int32_t numNodes = metricIn->getNumberOfNodes();
+    smoothColumnInternal(scratch, metricIn->getValuePointerForColumn(whichColumn), fixZeros);
+    metricOut->setValuesForColumn(whichOutColumn, scratch);
+}
+
+void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const
+{
+    CaretAssert(metricIn != NULL);//asserts only, and only basic checks, these functions are private
+    CaretAssert(metricOut != NULL);
+    CaretAssert(roi != NULL);
+    CaretAssert(whichColumn >= 0 && whichColumn < metricIn->getNumberOfColumns());
+    CaretAssert(whichOutColumn >= 0 && whichOutColumn < metricOut->getNumberOfColumns());
+    CaretAssert(whichRoiColumn >= 0 && whichRoiColumn < roi->getNumberOfColumns());
+    smoothColumnInternal(scratch, metricIn->getValuePointerForColumn(whichColumn), roi->getValuePointerForColumn(whichRoiColumn), fixZeros);
+    metricOut->setValuesForColumn(whichOutColumn, scratch);
+}
+
+void MetricSmoothingObject::smoothColumnInternal(float* scratch, const float* myColumn, const bool& fixZeros) const
+{
+    CaretAssert(scratch != NULL);
+    CaretAssert(myColumn != NULL);
+    int32_t numNodes = getNumberOfNodes();
     if (fixZeros)//special case early to keep branching down
     {
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[m_rowNodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_rowWeights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,53 +438,44 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            if (m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += m_rowWeights[j] * myColumn[m_rowNodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / m_weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
         }
     }
-    metricOut->setValuesForColumn(whichOutColumn, scratch);
 }
 
-void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const
+void MetricSmoothingObject::smoothColumnInternal(float* scratch, const float* myColumn, const float* roiColumn, const bool& fixZeros) const
 {
-    CaretAssert(metricIn != NULL);//asserts only, and only basic checks, these functions are private
-    CaretAssert(metricOut != NULL);
     CaretAssert(scratch != NULL);
-    CaretAssert(roi != NULL);
-    CaretAssert(whichColumn >= 0 && whichColumn < metricIn->getNumberOfColumns());
-    CaretAssert(whichOutColumn >= 0 && whichOutColumn < metricOut->getNumberOfColumns());
-    CaretAssert(whichRoiColumn >= 0 && whichRoiColumn < roi->getNumberOfColumns());
-    const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
-    const float* roiColumn = roi->getValuePointerForColumn(whichRoiColumn);
-    int32_t numNodes = metricIn->getNumberOfNodes();
+    CaretAssert(myColumn != NULL);
+    CaretAssert(roiColumn != NULL);
+    int32_t numNodes = getNumberOfNodes();
     if (fixZeros)//special case early to keep branching down
     {
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_rowNodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_rowWeights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +494,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_rowNodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_rowWeights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -274,7 +519,78 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
             }
         }
     }
-    metricOut->setValuesForColumn(whichOutColumn, scratch);
+}
+
+void MetricSmoothingObject::smoothPanel(const float* panelIn, const int32_t& numColumns, const vector<float*>& columnsOut, const int32_t& firstColumn, const float* roiColumn, const bool& fixZeros) const
+{//panelIn is interleaved and zeroed outside the roi by smoothColumns, so skipping a value and adding zero for it give the same sums
+    CaretAssert(panelIn != NULL);
+    CaretAssert(numColumns > 0 && numColumns <= PANEL_WIDTH);
+    int32_t numNodes = getNumberOfNodes();
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if ((roiColumn == NULL || roiColumn[i] > 0.0f) && m_weightSums[i] != 0.0f)
+        {
+            float sums[PANEL_WIDTH], weightSums[PANEL_WIDTH];
+            for (int32_t c = 0; c < PANEL_WIDTH; ++c)
+            {
+                sums[c] = 0.0f;
+                weightSums[c] = 0.0f;
+            }
+            int64_t rowEnd = m_rowStart[i + 1];
+            if (fixZeros)
+            {
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
+                {
+                    float weight = m_rowWeights[j];
+                    const float* values = panelIn + (int64_t)m_rowNodes[j] * PANEL_WIDTH;
+                    for (int32_t c = 0; c < PANEL_WIDTH; ++c)//fixed length, so the compiler can vectorize across columns
+                    {
+                        float used = (values[c] != 0.0f) ? weight : 0.0f;
+                        sums[c] += used * values[c];
+                        weightSums[c] += used;
+                    }
+                }
+            } else {
+                float weightSum = m_weightSums[i];
+                if (roiColumn != NULL)
+                {//the roi is the same for all columns, so only the sum of weights needs to check it
+                    weightSum = 0.0f;
+                    for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
+                    {
+                        if (roiColumn[m_rowNodes[j]] > 0.0f) weightSum += m_rowWeights[j];
+                    }
+                }
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
+                {
+                    float weight = m_rowWeights[j];
+                    const float* values = panelIn + (int64_t)m_rowNodes[j] * PANEL_WIDTH;
+                    for (int32_t c = 0; c < PANEL_WIDTH; ++c)
+                    {
+                        sums[c] += weight * values[c];
+                    }
+                }
+                for (int32_t c = 0; c < PANEL_WIDTH; ++c)
+                {
+                    weightSums[c] = weightSum;
+                }
+            }
+            for (int32_t c = 0; c < numColumns; ++c)
+            {
+                if (weightSums[c] != 0.0f)
+                {
+                    columnsOut[firstColumn + c][i] = sums[c] / weightSums[c];
+                } else {
+                    columnsOut[firstColumn + c][i] = 0.0f;
+                }
+            }
+        } else {
+            for (int32_t c = 0; c < numColumns; ++c)
+            {
+                columnsOut[firstColumn + c][i] = 0.0f;
+            }
+        }
+    }
 }
 
 void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel)
@@ -283,29 +599,40 @@ void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf,
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
     m_weightLists.resize(numNodes);
+    vector<vector<int32_t> > sourceBlocks;//blocks of nearby nodes, so each geodesic search reuses the same small piece of the surface
+    mySurf->getGeodesicHelper()->getNearbyNodeBlocks(SOURCE_BLOCK_SIZE, sourceBlocks);
+    int numBlocks = (int)sourceBlocks.size();
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
         CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, m_weightLists[i].m_nodes, distances, true);
-            if (distances.size() < 7)
+            const vector<int32_t>& thisBlock = sourceBlocks[block];
+            myGeoHelp->getNodesToGeoDist(thisBlock, myGeoDist, blockNodes, blockDists, true);
+            for (int k = 0; k < (int)thisBlock.size(); ++k)
             {
-                m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
-                m_weightLists[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
-            }
-            int32_t numNeigh = (int32_t)distances.size();
-            m_weightLists[i].m_weights.resize(numNeigh);
-            m_weightLists[i].m_weightSum = 0.0f;
-            for (int32_t j = 0; j < numNeigh; ++j)
-            {
-                float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                m_weightLists[i].m_weights[j] = weight;
-                m_weightLists[i].m_weightSum += weight;
+                int32_t i = thisBlock[k];
+                m_weightLists[i].m_nodes.swap(blockNodes[k]);
+                vector<float>& distances = blockDists[k];
+                if (distances.size() < 7)
+                {
+                    m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
+                    m_weightLists[i].m_nodes.push_back(i);
+                    myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
+                }
+                int32_t numNeigh = (int32_t)distances.size();
+                m_weightLists[i].m_weights.resize(numNeigh);
+                m_weightLists[i].m_weightSum = 0.0f;
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
+                    m_weightLists[i].m_weights[j] = weight;
+                    m_weightLists[i].m_weightSum += weight;
+                }
             }
         }
     }
@@ -318,18 +645,25 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
     float gaussianDenom = -0.5f / myKernel / myKernel;
     m_weightLists.resize(numNodes);
     const float* myRoiColumn = theRoi->getValuePointerForColumn(0);
+    vector<vector<int32_t> > sourceBlocks;//blocks of nearby nodes, so each geodesic search reuses the same small piece of the surface
+    mySurf->getGeodesicHelper()->getNearbyNodeBlocks(SOURCE_BLOCK_SIZE, sourceBlocks, myRoiColumn);
+    int numBlocks = (int)sourceBlocks.size();
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
         CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
-        vector<int32_t> nodes;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            if (myRoiColumn[i] > 0.0f)
+            const vector<int32_t>& thisBlock = sourceBlocks[block];
+            myGeoHelp->getNodesToGeoDist(thisBlock, myGeoDist, blockNodes, blockDists, true);
+            for (int k = 0; k < (int)thisBlock.size(); ++k)
             {
-                myGeoHelp->getNodesToGeoDist(i, myGeoDist, nodes, distances, true);
+                int32_t i = thisBlock[k];
+                vector<int32_t>& nodes = blockNodes[k];
+                vector<float>& distances = blockDists[k];
                 if (distances.size() < 7)
                 {
                     nodes = myTopoHelp->getNodeNeighbors(i);
@@ -363,37 +697,48 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
     vector<WeightList> tempList;//this is used to compute scattering kernels because it is easier to normalize scattering kernels correctly, and then convert to gathering kernels
     tempList.resize(numNodes);
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, nodeAreas));//NOTE: if these are equal to the surface's areas, then it does some extra operations, but gets the same answer
+    vector<vector<int32_t> > sourceBlocks;//blocks of nearby nodes, so each geodesic search reuses the same small piece of the surface
+    GeodesicHelper(myGeoBase).getNearbyNodeBlocks(SOURCE_BLOCK_SIZE, sourceBlocks);
+    int numBlocks = (int)sourceBlocks.size();
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
         CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
-        vector<float> distances;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
-            const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
-            if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+            const vector<int32_t>& thisBlock = sourceBlocks[block];
+            myGeoHelp->getNodesToGeoDist(thisBlock, myGeoDist, blockNodes, blockDists, true);
+            for (int k = 0; k < (int)thisBlock.size(); ++k)
             {
-                tempList[i].m_nodes = tempneighbors;
-                tempList[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
-            }
-            int32_t numNeigh = (int32_t)distances.size();
-            tempList[i].m_weights.resize(numNeigh);
-            tempList[i].m_weightSum = 0.0f;
-            for (int32_t j = 0; j < numNeigh; ++j)
-            {
-                float weight = exp(distances[j] * distances[j] * gaussianDenom) * nodeAreas[tempList[i].m_nodes[j]];//exp(- dist ^ 2 / (2 * sigma ^ 2)) * area
-                tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
-                tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
-            }
-            float myFactor = nodeAreas[i] / tempList[i].m_weightSum;//make each scattering kernel sum to the area of the node it scatters from
-            for (int32_t j = 0; j < numNeigh; ++j)
-            {
-                tempList[i].m_weights[j] *= myFactor;
+                int32_t i = thisBlock[k];
+                tempList[i].m_nodes.swap(blockNodes[k]);
+                vector<float>& distances = blockDists[k];
+                const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+                if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+                {
+                    tempList[i].m_nodes = tempneighbors;
+                    tempList[i].m_nodes.push_back(i);
+                    myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
+                }
+                int32_t numNeigh = (int32_t)distances.size();
+                tempList[i].m_weights.resize(numNeigh);
+                tempList[i].m_weightSum = 0.0f;
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    float weight = exp(distances[j] * distances[j] * gaussianDenom) * nodeAreas[tempList[i].m_nodes[j]];//exp(- dist ^ 2 / (2 * sigma ^ 2)) * area
+                    tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
+                    tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
+                }
+                float myFactor = nodeAreas[i] / tempList[i].m_weightSum;//make each scattering kernel sum to the area of the node it scatters from
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    tempList[i].m_weights[j] *= myFactor;
+                }
+                tempList[i].m_weightSum = nodeAreas[i];
             }
-            tempList[i].m_weightSum = nodeAreas[i];
         }
     }
     m_weightLists.resize(numNodes);//now convert it to gathering kernels
@@ -427,18 +772,25 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
     tempList.resize(numNodes);
     const float* myRoiColumn = theRoi->getValuePointerForColumn(0);
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, nodeAreas));//NOTE: if these are equal to the surface's areas, then it does some extra operations, but gets the same answer
+    vector<vector<int32_t> > sourceBlocks;//blocks of nearby nodes, so each geodesic search reuses the same small piece of the surface
+    GeodesicHelper(myGeoBase).getNearbyNodeBlocks(SOURCE_BLOCK_SIZE, sourceBlocks, myRoiColumn);//we don't need to scatter from things outside the ROI
+    int numBlocks = (int)sourceBlocks.size();
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
         CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
-        vector<float> distances;
-        vector<int32_t> nodes;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            if (myRoiColumn[i] > 0.0f)//we don't need to scatter from things outside the ROI
+            const vector<int32_t>& thisBlock = sourceBlocks[block];
+            myGeoHelp->getNodesToGeoDist(thisBlock, myGeoDist, blockNodes, blockDists, true);
+            for (int k = 0; k < (int)thisBlock.size(); ++k)
             {
-                myGeoHelp->getNodesToGeoDist(i, myGeoDist, nodes, distances, true);
+                int32_t i = thisBlock[k];
+                vector<int32_t>& nodes = blockNodes[k];
+                vector<float>& distances = blockDists[k];
                 const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
                 if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
                 {
@@ -497,37 +849,48 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
     float gaussianDenom = -0.5f / myKernel / myKernel;
     vector<WeightList> tempList;//this is used to compute scattering kernels because it is easier to normalize scattering kernels correctly, and then convert to gathering kernels
     tempList.resize(numNodes);
+    vector<vector<int32_t> > sourceBlocks;//blocks of nearby nodes, so each geodesic search reuses the same small piece of the surface
+    mySurf->getGeodesicHelper()->getNearbyNodeBlocks(SOURCE_BLOCK_SIZE, sourceBlocks);
+    int numBlocks = (int)sourceBlocks.size();
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
         CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
-            const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
-            if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
-            {
-                tempList[i].m_nodes = tempneighbors;
-                tempList[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
-            }
-            int32_t numNeigh = (int32_t)distances.size();
-            tempList[i].m_weights.resize(numNeigh);
-            tempList[i].m_weightSum = 0.0f;
-            for (int32_t j = 0; j < numNeigh; ++j)
-            {
-                float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
-                tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
-            }
-            float myFactor = 1.0f / tempList[i].m_weightSum;//make each scattering kernel sum to 1
-            for (int32_t j = 0; j < numNeigh; ++j)
+            const vector<int32_t>& thisBlock = sourceBlocks[block];
+            myGeoHelp->getNodesToGeoDist(thisBlock, myGeoDist, blockNodes, blockDists, true);
+            for (int k = 0; k < (int)thisBlock.size(); ++k)
             {
-                tempList[i].m_weights[j] *= myFactor;
+                int32_t i = thisBlock[k];
+                tempList[i].m_nodes.swap(blockNodes[k]);
+                vector<float>& distances = blockDists[k];
+                const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+                if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
+                {
+                    tempList[i].m_nodes = tempneighbors;
+                    tempList[i].m_nodes.push_back(i);
+                    myGeoHelp->getGeoToTheseNodes(i, tempList[i].m_nodes, distances, true);
+                }
+                int32_t numNeigh = (int32_t)distances.size();
+                tempList[i].m_weights.resize(numNeigh);
+                tempList[i].m_weightSum = 0.0f;
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
+                    tempList[i].m_weights[j] = weight;//we multiply by area so that a node scattering to a dense region on one side and a sparse region on the other
+                    tempList[i].m_weightSum += weight;//gives similar areal influence to each direction rather than giving a more influence on the dense region (simply because nodes are more numerous)
+                }
+                float myFactor = 1.0f / tempList[i].m_weightSum;//make each scattering kernel sum to 1
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    tempList[i].m_weights[j] *= myFactor;
+                }
+                tempList[i].m_weightSum = 1.0f;
             }
-            tempList[i].m_weightSum = 1.0f;
         }
     }
     m_weightLists.resize(numNodes);//now convert it to gathering kernels
@@ -560,18 +923,25 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
     vector<WeightList> tempList;//this is used to compute scattering kernels because it is easier to normalize scattering kernels correctly, and then convert to gathering kernels
     tempList.resize(numNodes);
     const float* myRoiColumn = theRoi->getValuePointerForColumn(0);
+    vector<vector<int32_t> > sourceBlocks;//blocks of nearby nodes, so each geodesic search reuses the same small piece of the surface
+    mySurf->getGeodesicHelper()->getNearbyNodeBlocks(SOURCE_BLOCK_SIZE, sourceBlocks, myRoiColumn);//we don't need to scatter from things outside the ROI
+    int numBlocks = (int)sourceBlocks.size();
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
         CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
-        vector<float> distances;
-        vector<int32_t> nodes;
+        vector<vector<int32_t> > blockNodes;
+        vector<vector<float> > blockDists;
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
+        for (int block = 0; block < numBlocks; ++block)
         {
-            if (myRoiColumn[i] > 0.0f)//we don't need to scatter from things outside the ROI
+            const vector<int32_t>& thisBlock = sourceBlocks[block];
+            myGeoHelp->getNodesToGeoDist(thisBlock, myGeoDist, blockNodes, blockDists, true);
+            for (int k = 0; k < (int)thisBlock.size(); ++k)
             {
-                myGeoHelp->getNodesToGeoDist(i, myGeoDist, nodes, distances, true);
+                int32_t i = thisBlock[k];
+                vector<int32_t>& nodes = blockNodes[k];
+                vector<float>& distances = blockDists[k];
                 const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
                 if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
                 {
@@ -671,4 +1041,28 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
                 throw CaretException("unknown smoothing method specified");
         };
     }
+    packWeightLists();
+}
+
+void MetricSmoothingObject::packWeightLists()
+{//put all kernels in a few contiguous arrays, to save memory and so that neighboring vertices' kernels are adjacent
+    int32_t numNodes = (int32_t)m_weightLists.size();
+    m_rowStart.resize(numNodes + 1);
+    m_weightSums.resize(numNodes);
+    m_rowStart[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        CaretAssert(m_weightLists[i].m_nodes.size() == m_weightLists[i].m_weights.size());
+        m_rowStart[i + 1] = m_rowStart[i] + (int64_t)m_weightLists[i].m_nodes.size();
+        m_weightSums[i] = m_weightLists[i].m_weightSum;
+    }
+    m_rowNodes.resize(m_rowStart[numNodes]);
+    m_rowWeights.resize(m_rowStart[numNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        copy(m_weightLists[i].m_nodes.begin(), m_weightLists[i].m_nodes.end(), m_rowNodes.begin() + m_rowStart[i]);
+        copy(m_weightLists[i].m_weights.begin(), m_weightLists[i].m_weights.end(), m_rowWeights.begin() + m_rowStart[i]);
+    }
+    vector<WeightList>().swap(m_weightLists);//actually free the per-vertex lists
 }
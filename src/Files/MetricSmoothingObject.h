@@ -30,6 +30,8 @@
 //NOTE: for a static ROI, it is (sometimes much) more efficient to use it in the constructor, and provide no ROI (NULL) to the functions, using both an ROI in constructor and in method
 //      will result in the effective ROI being the logical AND of the two (intersection).
 
+#include "AString.h"
+
 #include "stdint.h"
 #include "stddef.h"
 #include <vector>
@@ -52,16 +54,42 @@ namespace caret {
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///smooth one column of per-vertex values, for data that is not in a metric file, arrays must be the size of the surface and must not overlap
+        void smoothColumn(const float* columnIn, float* columnOut, const float* roiColumn = NULL, const bool& fixZeros = false) const;
+        ///smooth many columns of per-vertex values with the same roi, much faster than one column at a time, arrays must be the size of the surface and outputs must not overlap anything
+        void smoothColumns(const std::vector<const float*>& columnsIn, const std::vector<float*>& columnsOut, const float* roiColumn = NULL, const bool& fixZeros = false) const;
+        int32_t getNumberOfNodes() const { return (int32_t)m_weightSums.size(); }
+        
+        ///directory to look in for kernels saved by precomputeKernels, empty disables
+        static void setKernelCacheDirectory(const AString& directory) { s_kernelCacheDirectory = directory; }
+        static const AString& getKernelCacheDirectory() { return s_kernelCacheDirectory; }
+        
+        ///compute the kernels the constructor would, and save them in the directory under a name derived from the arguments, returns the file name
+        static AString precomputeKernels(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas, const AString& directory);
     private:
+        static AString s_kernelCacheDirectory;
+        static AString getKernelCacheFileName(const AString& directory, const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas);
+        bool readKernelCache(const AString& fileName, const int32_t& numNodes);
+        void writeKernelCache(const AString& fileName) const;
         struct WeightList
         {
             std::vector<int32_t> m_nodes;
             std::vector<float> m_weights;
             float m_weightSum;
         };
-        std::vector<WeightList> m_weightLists;
+        std::vector<WeightList> m_weightLists;//only used while computing the kernels, packWeightLists() moves them into the compressed rows below
+        std::vector<int64_t> m_rowStart;//kernel of node i is m_rowNodes/m_rowWeights from m_rowStart[i] to m_rowStart[i + 1]
+        std::vector<int32_t> m_rowNodes;
+        std::vector<float> m_rowWeights;
+        std::vector<float> m_weightSums;
+        static const int32_t SOURCE_BLOCK_SIZE = 32;//number of nearby nodes to compute geodesic distances from in one batch
+        static const int32_t PANEL_WIDTH = 16;//number of columns smoothed in one pass over the kernels, one cache line of floats per node
+        void packWeightLists();
+        void smoothPanel(const float* panelIn, const int32_t& numColumns, const std::vector<float*>& columnsOut, const int32_t& firstColumn, const float* roiColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
+        void smoothColumnInternal(float* scratch, const float* myColumn, const bool& fixZeros) const;
+        void smoothColumnInternal(float* scratch, const float* myColumn, const float* roiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
         void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel);
         void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
@@ -69,7 +97,7 @@ namespace caret {
         void precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas);
         void precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel);
         void precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
-        MetricSmoothingObject();
+        MetricSmoothingObject() { }
     };
     
 }
@@ -54,7 +54,9 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include "TopologyHelper.h"
 #include "VolumeSpace.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
@@ -85,10 +87,12 @@ namespace
         std::vector<TriInfo> m_tris;
         std::vector<QuadInfo> m_quads;
         PolyInfo(const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t node, const bool& thinColumn = false);//surfaces MUST be in node correspondence, otherwise SEVERE strangeness, possible crashes
-        PolyInfo() {};
+        PolyInfo() { computeBounds(); };
         int isInside(const float* xyz);//0 for no, 2 for yes, 1 for if only half the triangulations (between the two triangulations of one of the quad faces)
     private:
+        float m_boundsMin[3], m_boundsMax[3];//padded bounding box of all faces, a +z ray from a point outside it in x or y, or above it, can't hit anything
         void addTri(const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t* myTri, const int rootIndex, const bool& thinColumn);//adds the tri for each surface, plus the quad
+        void computeBounds();
     };
     
     void PolyInfo::addTri(const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t* myTri, const int rootIndex, const bool& thinColumn)
@@ -123,8 +127,43 @@ namespace
         }
     }
 
+    void PolyInfo::computeBounds()
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            m_boundsMin[i] = numeric_limits<float>::max();
+            m_boundsMax[i] = -numeric_limits<float>::max();
+        }
+        int numTris = (int)m_tris.size(), numQuads = (int)m_quads.size();
+        for (int t = 0; t < numTris + numQuads * 2; ++t)
+        {//the first two triangles of a quad use all 4 of its vertices
+            const TriInfo& thisTri = (t < numTris ? m_tris[t] : m_quads[(t - numTris) / 2].m_tris[0][(t - numTris) % 2]);
+            for (int j = 0; j < 3; ++j)
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    m_boundsMin[i] = min(m_boundsMin[i], thisTri.m_xyz[j][i]);
+                    m_boundsMax[i] = max(m_boundsMax[i], thisTri.m_xyz[j][i]);
+                }
+            }
+        }
+        if (numTris + numQuads == 0) return;
+        for (int i = 0; i < 3; ++i)
+        {//pad so that rounding in the plane equations can never make the early out disagree with the exact tests
+            float pad = (m_boundsMax[i] - m_boundsMin[i]) * 0.001f + 1e-5f * max(fabs(m_boundsMin[i]), fabs(m_boundsMax[i])) + 1e-6f;
+            m_boundsMin[i] -= pad;
+            m_boundsMax[i] += pad;
+        }
+    }
+
     int PolyInfo::isInside(const float* xyz)
     {
+        if (xyz[0] < m_boundsMin[0] || xyz[0] > m_boundsMax[0] ||
+            xyz[1] < m_boundsMin[1] || xyz[1] > m_boundsMax[1] ||
+            xyz[2] >= m_boundsMax[2])
+        {//most subsamples of a voxel near the edge of the polyhedron's bounding box miss it entirely
+            return 0;
+        }
         int i, temp, numQuads = (int)m_quads.size();
         bool toggle = false;
         for (i = 0; i < numQuads; ++i)
@@ -162,6 +201,7 @@ namespace
                 }
             }
         }
+        computeBounds();
     }
 
     QuadInfo::QuadInfo(const float* xyz1, const float* xyz2, const float* xyz3, const float* xyz4)
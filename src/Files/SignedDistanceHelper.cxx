@@ -45,129 +45,173 @@ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FO
 DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
-#include "BoundingBox.h"
-#include "CaretHeap.h"
+#include "MathFunctions.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace std;
 using namespace caret;
 
-float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+namespace
 {
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    struct BinIsLeft
+    {//same bin computation as the SAH binning, so the partition matches the evaluated split
+        const float* m_centroids;
+        int m_axis, m_split, m_numBins;
+        float m_binMin, m_binScale;
+        BinIsLeft(const float* centroids, const int axis, const float binMin, const float binScale, const int split, const int numBins)
+        {
+            m_centroids = centroids;
+            m_axis = axis;
+            m_binMin = binMin;
+            m_binScale = binScale;
+            m_split = split;
+            m_numBins = numBins;
+        }
+        bool operator()(const int32_t tri) const
+        {
+            return min(m_numBins - 1, (int)((m_centroids[tri * 3 + m_axis] - m_binMin) * m_binScale)) <= m_split;
+        }
+    };
+    
+    inline float boxDistSquared(const float minCoord[3], const float maxCoord[3], const float point[3])
+    {//written without branches on the axis so it vectorizes
+        float ret = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float below = max(minCoord[i] - point[i], 0.0f);
+            float above = max(point[i] - maxCoord[i], 0.0f);
+            float outside = below + above;//at most one is nonzero
+            ret += outside * outside;
+        }
+        return ret;
+    }
+    
+    //same logic as Oct::rayIntersects and Oct::lineSegmentIntersects
+    bool lineIntersectsBox(const float minCoord[3], const float maxCoord[3], const float start[3], const float end[3], const bool isRay)
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        float curlow = 1.0f, curhigh = -1.0f;
+        bool first = true;
+        for (int i = 0; i < 3; ++i)
         {
-            if (curOct->m_leaf)
+            float direction = end[i] - start[i];
+            if (direction != 0.0f)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
+                float templow, temphigh;
+                if (direction > 0.0f)
                 {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
+                    templow = (minCoord[i] - start[i]) / direction;//compute the range of t over which this line lies between the planes for this axis
+                    temphigh = (maxCoord[i] - start[i]) / direction;
+                } else {
+                    templow = (maxCoord[i] - start[i]) / direction;
+                    temphigh = (minCoord[i] - start[i]) / direction;
                 }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
+                if (first)
                 {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
+                    first = false;
+                    curlow = templow;
+                    curhigh = temphigh;
+                } else {
+                    if (templow > curlow) curlow = templow;//intersect the ranges
+                    if (temphigh < curhigh) curhigh = temphigh;
                 }
+                if (curhigh < curlow || curhigh < 0.0f) return false;//if intersection is null or has no positive range, false
+                if (!isRay && curlow > 1.0f) return false;//segment also needs some range less than 1
+            } else {
+                if (start[i] < minCoord[i] || start[i] > maxCoord[i]) return false;
             }
         }
+        return true;
     }
-    while (numChanged)
-    {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//need to do this before computeSign
-    }
-    return bestTriDist * computeSign(coord, bestInfo, myWinding);
 }
 
-void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
-{
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+float SignedDistanceHelper::closestTriangle(const float coord[3], ClosestPointInfo& bestInfo)
+{//caller must hold the mutex
+    const vector<SignedDistanceHelperBase::BvhNode>& myNodes = m_base->m_bvhNodes;
+    const vector<int32_t>& myTris = m_base->m_bvhTriangles;
+    CaretAssert(!myNodes.empty());
+    ClosestPointInfo tempInfo;
+    float bestTriDist, bestDistSqr;
+    if (m_lastTriangle >= 0)
+    {//start with a bound from the previous answer, so most of the tree gets pruned right away
+        bestTriDist = unsignedDistToTri(coord, m_lastTriangle, bestInfo);
+    } else {
+        bestTriDist = unsignedDistToTri(coord, myTris[0], bestInfo);
+    }
+    bestDistSqr = bestTriDist * bestTriDist;
+    m_nodeStack.clear();
+    m_nodeStack.push_back(0);
+    while (!m_nodeStack.empty())
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        const SignedDistanceHelperBase::BvhNode& curNode = myNodes[m_nodeStack.back()];
+        m_nodeStack.pop_back();
+        if (boxDistSquared(curNode.m_min, curNode.m_max, coord) >= bestDistSqr) continue;//bound may have improved since it was pushed
+        if (curNode.m_count > 0)
         {
-            if (curOct->m_leaf)
+            int32_t end = curNode.m_start + curNode.m_count;
+            for (int32_t i = curNode.m_start; i < end; ++i)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
+                float tempf = unsignedDistToTri(coord, myTris[i], tempInfo);
+                if (tempf < bestTriDist)
                 {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
+                    bestInfo = tempInfo;
+                    bestTriDist = tempf;
+                    bestDistSqr = tempf * tempf;
                 }
             }
+        } else {
+            const SignedDistanceHelperBase::BvhNode* children = myNodes.data() + curNode.m_start;
+            float childDist[2];
+            for (int c = 0; c < 2; ++c)
+            {
+                childDist[c] = boxDistSquared(children[c].m_min, children[c].m_max, coord);
+            }
+            int nearChild = (childDist[1] < childDist[0]) ? 1 : 0;
+            if (childDist[1 - nearChild] < bestDistSqr) m_nodeStack.push_back(curNode.m_start + 1 - nearChild);//far child first, so the near one is popped next
+            if (childDist[nearChild] < bestDistSqr) m_nodeStack.push_back(curNode.m_start + nearChild);
         }
     }
-    while (numChanged)
+    m_lastTriangle = bestInfo.triangle;
+    return bestTriDist;
+}
+
+float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+{
+    CaretMutexLocker locked(&m_mutex);
+    if (m_base->m_bvhNodes.empty()) return 0.0f;//no triangles, nothing to compute a distance to
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestTriangle(coord, bestInfo);
+    return bestTriDist * computeSign(coord, bestInfo, myWinding);
+}
+
+void SignedDistanceHelper::dist(const float* coords, const int64_t numCoords, float* distOut, WindingLogic myWinding)
+{
+    CaretMutexLocker locked(&m_mutex);
+    if (m_base->m_bvhNodes.empty())
     {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//clean up
+        for (int64_t i = 0; i < numCoords; ++i) distOut[i] = 0.0f;
+        return;
     }
+    ClosestPointInfo bestInfo;
+    for (int64_t i = 0; i < numCoords; ++i)
+    {//each closest triangle gives the starting bound for the next point
+        const float* thisCoord = coords + i * 3;
+        float bestTriDist = closestTriangle(thisCoord, bestInfo);
+        distOut[i] = bestTriDist * computeSign(thisCoord, bestInfo, myWinding);
+    }
+}
+
+void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
+{
+    CaretMutexLocker locked(&m_mutex);
+    CaretAssert(!m_base->m_bvhNodes.empty());
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestTriangle(coord, bestInfo);
     baryInfoOut.triangle = bestInfo.triangle;
     baryInfoOut.point = bestInfo.tempPoint;
     baryInfoOut.absDistance = bestTriDist;
@@ -252,68 +296,49 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
         case NEGATIVE:
         case NONZERO:
             {
-                int numChanged = 0;
                 float positiveZ[3] = {0, 0, 1};
                 Vector3D point2 = point + positiveZ;
                 int crossCount = 0;
-                vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                myStack.push_back(m_base->m_indexRoot);
-                while (!myStack.empty())
+                const vector<SignedDistanceHelperBase::BvhNode>& myNodes = m_base->m_bvhNodes;
+                const vector<int32_t>& myTris = m_base->m_bvhTriangles;
+                m_nodeStack.clear();
+                m_nodeStack.push_back(0);
+                while (!m_nodeStack.empty())
                 {
-                    Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
-                    myStack.pop_back();
-                    if (curOct->m_leaf)
+                    const SignedDistanceHelperBase::BvhNode& curNode = myNodes[m_nodeStack.back()];
+                    m_nodeStack.pop_back();
+                    if (!lineIntersectsBox(curNode.m_min, curNode.m_max, coord, point2, true)) continue;
+                    if (curNode.m_count > 0)
                     {
-                        vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                        int numTris = (int)myVecRef.size();
-                        for (int i = 0; i < numTris; ++i)
+                        int32_t end = curNode.m_start + curNode.m_count;
+                        for (int32_t i = curNode.m_start; i < end; ++i)
                         {
-                            if (m_triMarked[myVecRef[i]] != 1)
+                            const int32_t* myTileNodes = m_base->getTriangle(myTris[i]);
+                            Vector3D verts[3];
+                            verts[0] = m_base->getCoordinate(myTileNodes[0]);
+                            verts[1] = m_base->getCoordinate(myTileNodes[1]);
+                            verts[2] = m_base->getCoordinate(myTileNodes[2]);
+                            Vector3D triNormal;
+                            MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                            float factor = triNormal[2];//equivalent to dot product with positiveZ
+                            if (factor != 0.0f)
                             {
-                                m_triMarked[myVecRef[i]] = 1;
-                                m_triMarkChanged[numChanged++] = myVecRef[i];
-                                const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                Vector3D verts[3];
-                                verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                Vector3D triNormal;
-                                MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                float factor = triNormal[2];//equivalent to dot product with positiveZ
-                                if (factor != 0.0f)
+                                if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
                                 {
-                                    if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
+                                    if (triNormal[2] < 0.0f)
                                     {
-                                        if (triNormal[2] < 0.0f)
-                                        {
-                                            ++crossCount;
-                                        } else {
-                                            --crossCount;
-                                        }
+                                        ++crossCount;
+                                    } else {
+                                        --crossCount;
                                     }
                                 }
                             }
                         }
                     } else {
-                        for (int ci = 0; ci < 2; ++ci)
-                        {
-                            for (int cj = 0; cj < 2; ++cj)
-                            {
-                                for (int ck = 0; ck < 2; ++ck)
-                                {
-                                    if (curOct->m_children[ci][cj][ck]->rayIntersects(coord, point2))
-                                    {
-                                        myStack.push_back(curOct->m_children[ci][cj][ck]);
-                                    }
-                                }
-                            }
-                        }
+                        m_nodeStack.push_back(curNode.m_start);
+                        m_nodeStack.push_back(curNode.m_start + 1);
                     }
                 }
-                while (numChanged)
-                {
-                    m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                }
                 switch (myWinding)
                 {
                     case EVEN_ODD:
@@ -339,7 +364,6 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                 case 0://node
                     {
                         int curSign = 0;
-                        int numChanged = 0;
                         const vector<int>& myTiles = m_base->m_topoHelp->getNodeTiles(myInfo.node1);
                         bool first = true;
                         float bestNorm = 0;
@@ -382,71 +406,53 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                         {
                             midAxis = 2;
                         }
-                        vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                        myStack.push_back(m_base->m_indexRoot);
-                        while (!myStack.empty())
+                        const vector<SignedDistanceHelperBase::BvhNode>& myNodes = m_base->m_bvhNodes;
+                        const vector<int32_t>& myTris = m_base->m_bvhTriangles;
+                        m_nodeStack.clear();
+                        m_nodeStack.push_back(0);
+                        while (!m_nodeStack.empty())
                         {
-                            Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
-                            myStack.pop_back();
-                            if (curOct->m_leaf)
+                            const SignedDistanceHelperBase::BvhNode& curNode = myNodes[m_nodeStack.back()];
+                            m_nodeStack.pop_back();
+                            if (!lineIntersectsBox(curNode.m_min, curNode.m_max, coord, bestCent, false)) continue;
+                            if (curNode.m_count > 0)
                             {
-                                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                                int numTris = (int)myVecRef.size();
-                                for (int i = 0; i < numTris; ++i)
+                                int32_t end = curNode.m_start + curNode.m_count;
+                                for (int32_t i = curNode.m_start; i < end; ++i)
                                 {
-                                    if (m_triMarked[myVecRef[i]] != 1)
+                                    const int32_t* myTileNodes = m_base->getTriangle(myTris[i]);
+                                    Vector3D verts[3];
+                                    verts[0] = m_base->getCoordinate(myTileNodes[0]);
+                                    verts[1] = m_base->getCoordinate(myTileNodes[1]);
+                                    verts[2] = m_base->getCoordinate(myTileNodes[2]);
+                                    Vector3D triNormal;
+                                    MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                                    float factor = triNormal.dot(segNormal);
+                                    if (factor == 0.0f)
                                     {
-                                        m_triMarked[myVecRef[i]] = 1;
-                                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                                        const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                        Vector3D verts[3];
-                                        verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                        verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                        verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                        Vector3D triNormal;
-                                        MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                        float factor = triNormal.dot(segNormal);
-                                        if (factor == 0.0f)
-                                        {
-                                            continue;//skip triangles parallel to the line segment
-                                        }
-                                        float intersectDist = triNormal.dot(point - verts[0]) / factor;
-                                        if (intersectDist > 0.0f && intersectDist < bestDist)
-                                        {
-                                            Vector3D inPlane = point - intersectDist * segNormal;
-                                            if (pointInTri(verts, inPlane, majAxis, midAxis))
-                                            {
-                                                bestDist = intersectDist;
-                                                if (triNormal.dot(mySeg) > 0.0f)
-                                                {
-                                                    curSign = 1;
-                                                } else {
-                                                    curSign = -1;
-                                                }
-                                            }
-                                        }
+                                        continue;//skip triangles parallel to the line segment
                                     }
-                                }
-                            } else {
-                                for (int ci = 0; ci < 2; ++ci)
-                                {
-                                    for (int cj = 0; cj < 2; ++cj)
+                                    float intersectDist = triNormal.dot(point - verts[0]) / factor;
+                                    if (intersectDist > 0.0f && intersectDist < bestDist)
                                     {
-                                        for (int ck = 0; ck < 2; ++ck)
+                                        Vector3D inPlane = point - intersectDist * segNormal;
+                                        if (pointInTri(verts, inPlane, majAxis, midAxis))
                                         {
-                                            if (curOct->m_children[ci][cj][ck]->lineSegmentIntersects(coord, bestCent))
+                                            bestDist = intersectDist;
+                                            if (triNormal.dot(mySeg) > 0.0f)
                                             {
-                                                myStack.push_back(curOct->m_children[ci][cj][ck]);
+                                                curSign = 1;
+                                            } else {
+                                                curSign = -1;
                                             }
                                         }
                                     }
                                 }
+                            } else {
+                                m_nodeStack.push_back(curNode.m_start);
+                                m_nodeStack.push_back(curNode.m_start + 1);
                             }
                         }
-                        while (numChanged)
-                        {
-                            m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                        }
                         return curSign;
                     }
                     break;
@@ -713,24 +719,12 @@ float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t tria
 SignedDistanceHelper::SignedDistanceHelper(CaretPointer<SignedDistanceHelperBase> myBase)
 {
     m_base = myBase;
-    int32_t numTris = m_base->m_numTris;
-    m_triMarked = CaretArray<int>(numTris);
-    m_triMarkChanged = CaretArray<int>(numTris);
-    for (int32_t i = 0; i < numTris; ++i)
-    {
-        m_triMarked[i] = 0;
-    }
+    m_lastTriangle = -1;
 }
 
 SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
 {
     m_topoHelp = mySurf->getTopologyHelper();
-    const float* myBB = mySurf->getBoundingBox()->getBounds();
-    Vector3D minCoord, maxCoord;
-    minCoord[0] = myBB[0]; maxCoord[0] = myBB[1];
-    minCoord[1] = myBB[2]; maxCoord[1] = myBB[3];
-    minCoord[2] = myBB[4]; maxCoord[2] = myBB[5];
-    m_indexRoot.grabNew(new Oct<TriVector>(minCoord, maxCoord));
     const float* myCoordData = mySurf->getCoordinateData();
     m_numNodes = mySurf->getNumberOfNodes();
     int32_t numNodes3 = m_numNodes * 3;
@@ -748,105 +742,187 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
         m_triangleList[i3] = thisTri[0];
         m_triangleList[i3 + 1] = thisTri[1];
         m_triangleList[i3 + 2] = thisTri[2];
-        maxCoord = minCoord = myCoordData + thisTri[0] * 3;//set both to the coordinates of the first node in the triangle
-        for (int j = 1; j < 3; ++j)
+    }
+    buildBvh();
+}
+
+void SignedDistanceHelperBase::setNodeBounds(BvhNode& node, const vector<float>& triBounds) const
+{//triBounds is min xyz, max xyz for each triangle
+    for (int i = 0; i < 3; ++i)
+    {
+        node.m_min[i] = numeric_limits<float>::max();
+        node.m_max[i] = -numeric_limits<float>::max();
+    }
+    int32_t end = node.m_start + node.m_count;
+    for (int32_t t = node.m_start; t < end; ++t)
+    {
+        const float* thisBounds = triBounds.data() + m_bvhTriangles[t] * 6;
+        for (int i = 0; i < 3; ++i)
         {
-            int32_t thisNode3 = thisTri[j] * 3;
-            if (myCoordData[thisNode3] < minCoord[0]) minCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] < minCoord[1]) minCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] < minCoord[2]) minCoord[2] = myCoordData[thisNode3 + 2];
-            if (myCoordData[thisNode3] > maxCoord[0]) maxCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] > maxCoord[1]) maxCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] > maxCoord[2]) maxCoord[2] = myCoordData[thisNode3 + 2];
+            node.m_min[i] = min(node.m_min[i], thisBounds[i]);
+            node.m_max[i] = max(node.m_max[i], thisBounds[i + 3]);
         }
-        addTriangle(m_indexRoot, i, minCoord, maxCoord);//use bounding box for now as an easy test to capture any chance of the triangle intersecting the Oct
     }
 }
 
-void SignedDistanceHelperBase::addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3])
-{
-    if (thisOct->m_leaf)
+void SignedDistanceHelperBase::buildBvh()
+{//top-down build, splitting on binned triangle centroids with the surface area heuristic
+    m_bvhNodes.clear();
+    m_bvhTriangles.resize(m_numTris);
+    if (m_numTris == 0) return;
+    vector<float> triBounds(m_numTris * 6), centroids(m_numTris * 3);
+    for (int32_t t = 0; t < m_numTris; ++t)
     {
-        thisOct->m_data.m_triList->push_back(triangle);
-        int numTris = (int)thisOct->m_data.m_triList->size();
-        if (numTris >= NUM_TRIS_TO_TEST && numTris % NUM_TRIS_TEST_INCR == NUM_TRIS_TO_TEST % NUM_TRIS_TEST_INCR)//the second modulus should const out
+        m_bvhTriangles[t] = t;
+        const int32_t* thisTri = getTriangle(t);
+        float* thisBounds = triBounds.data() + t * 6;
+        for (int i = 0; i < 3; ++i)
+        {
+            thisBounds[i] = thisBounds[i + 3] = getCoordinate(thisTri[0])[i];
+        }
+        for (int j = 1; j < 3; ++j)
         {
-            Vector3D tempMinCoord, tempMaxCoord;
-            const float* myCoordData = m_coordList.data();
-            int totalSize = 0;
-            int numSplit = 0;
-            for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
+            const float* thisCoord = getCoordinate(thisTri[j]);
+            for (int i = 0; i < 3; ++i)
             {
-                const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                for (int j = 1; j < 3; ++j)
+                thisBounds[i] = min(thisBounds[i], thisCoord[i]);
+                thisBounds[i + 3] = max(thisBounds[i + 3], thisCoord[i]);
+            }
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            centroids[t * 3 + i] = (thisBounds[i] + thisBounds[i + 3]) * 0.5f;
+        }
+    }
+    m_bvhNodes.reserve(2 * ((m_numTris + MAX_LEAF_TRIS - 1) / MAX_LEAF_TRIS) + 1);//rough guess, leaves are often fuller than this
+    BvhNode root;
+    root.m_start = 0;
+    root.m_count = m_numTris;
+    setNodeBounds(root, triBounds);
+    m_bvhNodes.push_back(root);
+    vector<int32_t> toSplit(1, 0);//explicit stack, a degenerate surface could make deep trees
+    while (!toSplit.empty())
+    {
+        int32_t nodeIndex = toSplit.back();
+        toSplit.pop_back();
+        BvhNode thisNode = m_bvhNodes[nodeIndex];//copy, pushing children can reallocate
+        if (thisNode.m_count <= MAX_LEAF_TRIS) continue;
+        int32_t end = thisNode.m_start + thisNode.m_count;
+        float centMin[3], centMax[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            centMin[i] = numeric_limits<float>::max();
+            centMax[i] = -numeric_limits<float>::max();
+        }
+        for (int32_t t = thisNode.m_start; t < end; ++t)
+        {
+            const float* thisCent = centroids.data() + m_bvhTriangles[t] * 3;
+            for (int i = 0; i < 3; ++i)
+            {
+                centMin[i] = min(centMin[i], thisCent[i]);
+                centMax[i] = max(centMax[i], thisCent[i]);
+            }
+        }
+        int bestAxis = -1, bestSplit = -1;
+        float bestCost = numeric_limits<float>::max();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float extent = centMax[axis] - centMin[axis];
+            if (!(extent > 0.0f)) continue;
+            float binScale = NUM_SAH_BINS / extent;
+            int32_t binCount[NUM_SAH_BINS];
+            float binMin[NUM_SAH_BINS][3], binMax[NUM_SAH_BINS][3];
+            for (int b = 0; b < NUM_SAH_BINS; ++b)
+            {
+                binCount[b] = 0;
+                for (int i = 0; i < 3; ++i)
                 {
-                    int32_t thisNode3 = tempTri[j] * 3;
-                    if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                    if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
+                    binMin[b][i] = numeric_limits<float>::max();
+                    binMax[b][i] = -numeric_limits<float>::max();
                 }
-                int minOct[3], maxOct[3];
-                thisOct->containingChild(tempMinCoord, minOct);
-                thisOct->containingChild(tempMaxCoord, maxOct);
-                int splitSize = 8;
-                if (minOct[0] == maxOct[0]) splitSize >>= 1;
-                if (minOct[1] == maxOct[1]) splitSize >>= 1;
-                if (minOct[2] == maxOct[2]) splitSize >>= 1;
-                totalSize += splitSize;
-                if (splitSize != 8) ++numSplit;
             }
-            if (numSplit > 0 && totalSize < 3.0f * numTris)//don't split if all triangles end up in all child octs, and try to balance speedup with memory usage
+            for (int32_t t = thisNode.m_start; t < end; ++t)
             {
-                thisOct->makeChildren();//do the split
-                for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
+                int32_t tri = m_bvhTriangles[t];
+                int b = min(NUM_SAH_BINS - 1, (int)((centroids[tri * 3 + axis] - centMin[axis]) * binScale));
+                ++binCount[b];
+                const float* thisBounds = triBounds.data() + tri * 6;
+                for (int i = 0; i < 3; ++i)
                 {
-                    const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                    tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                    for (int j = 1; j < 3; ++j)
-                    {
-                        int32_t thisNode3 = tempTri[j] * 3;
-                        if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                        if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                    }
-                    for (int ci = 0; ci < 2; ++ci)
-                    {
-                        for (int cj = 0; cj < 2; ++cj)
-                        {
-                            for (int ck = 0; ck < 2; ++ck)
-                            {
-                                if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(tempMinCoord, tempMaxCoord))
-                                {
-                                    addTriangle(thisOct->m_children[ci][cj][ck], (*(thisOct->m_data.m_triList))[i], tempMinCoord, tempMaxCoord);
-                                }
-                            }
-                        }
-                    }
+                    binMin[b][i] = min(binMin[b][i], thisBounds[i]);
+                    binMax[b][i] = max(binMax[b][i], thisBounds[i + 3]);
                 }
-                thisOct->m_data.freeData();//and free up some memory
             }
-        }
-    } else {
-        for (int ci = 0; ci < 2; ++ci)
-        {
-            for (int cj = 0; cj < 2; ++cj)
+            float rightArea[NUM_SAH_BINS];
+            int32_t rightCount[NUM_SAH_BINS];
+            float accumMin[3], accumMax[3];
+            int32_t accumCount = 0;
+            for (int i = 0; i < 3; ++i)
             {
-                for (int ck = 0; ck < 2; ++ck)
+                accumMin[i] = numeric_limits<float>::max();
+                accumMax[i] = -numeric_limits<float>::max();
+            }
+            for (int b = NUM_SAH_BINS - 1; b > 0; --b)
+            {//rightArea[b] covers bins b through the end
+                accumCount += binCount[b];
+                for (int i = 0; i < 3; ++i)
                 {
-                    if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(minCoord, maxCoord))
-                    {
-                        addTriangle(thisOct->m_children[ci][cj][ck], triangle, minCoord, maxCoord);
-                    }
+                    accumMin[i] = min(accumMin[i], binMin[b][i]);
+                    accumMax[i] = max(accumMax[i], binMax[b][i]);
+                }
+                float d[3] = { accumMax[0] - accumMin[0], accumMax[1] - accumMin[1], accumMax[2] - accumMin[2] };
+                rightArea[b] = (accumCount > 0) ? d[0] * d[1] + d[1] * d[2] + d[2] * d[0] : 0.0f;//half surface area, the factor doesn't matter
+                rightCount[b] = accumCount;
+            }
+            accumCount = 0;
+            for (int i = 0; i < 3; ++i)
+            {
+                accumMin[i] = numeric_limits<float>::max();
+                accumMax[i] = -numeric_limits<float>::max();
+            }
+            for (int b = 0; b < NUM_SAH_BINS - 1; ++b)
+            {//split between bin b and b + 1
+                accumCount += binCount[b];
+                for (int i = 0; i < 3; ++i)
+                {
+                    accumMin[i] = min(accumMin[i], binMin[b][i]);
+                    accumMax[i] = max(accumMax[i], binMax[b][i]);
+                }
+                if (accumCount == 0 || rightCount[b + 1] == 0) continue;
+                float d[3] = { accumMax[0] - accumMin[0], accumMax[1] - accumMin[1], accumMax[2] - accumMin[2] };
+                float cost = accumCount * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]) + rightCount[b + 1] * rightArea[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
                 }
             }
         }
+        if (bestAxis == -1) continue;//all centroids are the same, can't separate them
+        float nodeDims[3] = { thisNode.m_max[0] - thisNode.m_min[0], thisNode.m_max[1] - thisNode.m_min[1], thisNode.m_max[2] - thisNode.m_min[2] };
+        float leafCost = thisNode.m_count * (nodeDims[0] * nodeDims[1] + nodeDims[1] * nodeDims[2] + nodeDims[2] * nodeDims[0]);
+        if (bestCost >= leafCost && thisNode.m_count <= MAX_FORCED_LEAF_TRIS) continue;
+        float binScale = NUM_SAH_BINS / (centMax[bestAxis] - centMin[bestAxis]);
+        float splitMin = centMin[bestAxis];
+        int32_t* middle = partition(m_bvhTriangles.data() + thisNode.m_start, m_bvhTriangles.data() + end,
+                                    BinIsLeft(centroids.data(), bestAxis, splitMin, binScale, bestSplit, NUM_SAH_BINS));
+        int32_t leftCount = (int32_t)(middle - m_bvhTriangles.data()) - thisNode.m_start;
+        CaretAssert(leftCount > 0 && leftCount < thisNode.m_count);//same bin computation as above, so both sides have triangles
+        BvhNode children[2];
+        children[0].m_start = thisNode.m_start;
+        children[0].m_count = leftCount;
+        children[1].m_start = thisNode.m_start + leftCount;
+        children[1].m_count = thisNode.m_count - leftCount;
+        int32_t firstChild = (int32_t)m_bvhNodes.size();
+        for (int c = 0; c < 2; ++c)
+        {
+            setNodeBounds(children[c], triBounds);
+            m_bvhNodes.push_back(children[c]);
+            toSplit.push_back(firstChild + c);
+        }
+        m_bvhNodes[nodeIndex].m_start = firstChild;
+        m_bvhNodes[nodeIndex].m_count = 0;
     }
 }
 
@@ -24,7 +24,8 @@
 #include "Vector3D.h"
 #include "CaretMutex.h"
 #include "CaretPointer.h"
-#include "OctTree.h"
+
+#include "stdint.h"
 #include <vector>
 
 namespace caret {
@@ -34,29 +35,24 @@ namespace caret {
     
     class SignedDistanceHelperBase
     {
-        struct TriVector
-        {//specifically so we can cleanly deallocate the vector from non-leaf nodes when they split
-            std::vector<int32_t>* m_triList;
-            TriVector() { m_triList = new std::vector<int32_t>(); }
-            ~TriVector() { freeData(); }
-            void freeData()
-            {
-                if (m_triList != NULL)
-                {
-                    delete m_triList;
-                    m_triList = NULL;
-                }
-            }
+        struct BvhNode
+        {//flat bounding volume hierarchy node, the two children of an internal node are stored next to each other
+            float m_min[3], m_max[3];
+            int32_t m_start;//internal node: index of first child, leaf: index of first triangle in m_bvhTriangles
+            int32_t m_count;//number of triangles in a leaf, 0 for internal nodes
         };
-        static const int NUM_TRIS_TO_TEST = 50;//test for whether to split leaf at this number
-        static const int NUM_TRIS_TEST_INCR = 50;//and again at further multiples of this
-        CaretPointer<Oct<TriVector> > m_indexRoot;
+        static const int MAX_LEAF_TRIS = 4;//split nodes with more triangles than this when it lowers the surface area heuristic cost
+        static const int MAX_FORCED_LEAF_TRIS = 32;//always split above this if the triangles can be separated
+        static const int NUM_SAH_BINS = 16;
+        std::vector<BvhNode> m_bvhNodes;//root is element 0, empty if the surface has no triangles
+        std::vector<int32_t> m_bvhTriangles;//each triangle is in exactly one leaf, so queries don't need to mark visited triangles
         int32_t m_numTris, m_numNodes;
         std::vector<float> m_coordList;//make a copy of what we need from SurfaceFile so that if the SurfaceFile gets destroyed, we don't crash
         std::vector<int32_t> m_triangleList;
         CaretPointer<TopologyHelper> m_topoHelp;
         SignedDistanceHelperBase();
-        void addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3]);
+        void buildBvh();
+        void setNodeBounds(BvhNode& node, const std::vector<float>& triBounds) const;
         const float* getCoordinate(const int32_t nodeIndex) const;//make these public? probably don't want them to be widely used, that is what SurfaceFile is for (but we don't want to store a SurfaceFile pointer)
         const int32_t* getTriangle(const int32_t tileIndex) const;
     public:
@@ -94,8 +90,8 @@ namespace caret {
     private:
         CaretMutex m_mutex;
         CaretPointer<SignedDistanceHelperBase> m_base;
-        CaretArray<int> m_triMarked;
-        CaretArray<int> m_triMarkChanged;
+        std::vector<int32_t> m_nodeStack;//scratch space for traversing the hierarchy
+        int32_t m_lastTriangle;//closest triangle of the previous query, consecutive queries are usually close together, so it gives a good starting bound
         SignedDistanceHelper();
         struct ClosestPointInfo
         {
@@ -103,6 +99,7 @@ namespace caret {
             int32_t node1, node2, triangle;
             Vector3D tempPoint;
         };
+        float closestTriangle(const float coord[3], ClosestPointInfo& bestInfo);
         float unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo);
         int computeSign(const float coord[3], ClosestPointInfo myInfo, WindingLogic myWinding);
         bool pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis);
@@ -112,6 +109,9 @@ namespace caret {
         ///return the signed distance value at the point
         float dist(const float coord[3], WindingLogic myWinding);
         
+        ///signed distance for many points (xyz triples), faster than separate calls when consecutive points are near each other
+        void dist(const float* coords, const int64_t numCoords, float* distOut, WindingLogic myWinding);
+        
         ///find the closest point ON the surface, and return information about it
         ///will never have negative barycentric weights, or a point outside the triangle
         void barycentricWeights(const float coordIn[3], BarycentricInfo& baryInfoOut);
@@ -57,6 +57,13 @@ SurfaceFile::SurfaceFile()
 {
     m_skipSanityCheck = false;//NOTE: this is NOT in the initializeMembersSurfaceFile method, because that method gets used at the top of the validate function,
                               //which is used by setNumberOfNodesAndTriangles, which temporarily puts it the triangles into an invalid state, which is why this flag exists
+    m_geometryChangedCounter = 0;//not in initializeMembersSurfaceFile either, the counters must never go backwards
+    m_nodeColoringChangedCounter = 0;
+    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
+        m_surfaceNodeColoringChangedCounters[i] = 0;
+        m_surfaceMontageNodeColoringChangedCounters[i] = 0;
+        m_wholeBrainNodeColoringChangedCounters[i] = 0;
+    }
     this->initializeMembersSurfaceFile();
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
 }
@@ -71,6 +78,13 @@ SurfaceFile::SurfaceFile(const SurfaceFile& sf)
 : GiftiTypeFile(sf), EventListenerInterface()
 {
     m_skipSanityCheck = false;//see above
+    m_geometryChangedCounter = 0;
+    m_nodeColoringChangedCounter = 0;
+    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
+        m_surfaceNodeColoringChangedCounters[i] = 0;
+        m_surfaceMontageNodeColoringChangedCounters[i] = 0;
+        m_wholeBrainNodeColoringChangedCounters[i] = 0;
+    }
     this->initializeMembersSurfaceFile();
     this->copyHelperSurfaceFile(sf);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
@@ -525,6 +539,7 @@ SurfaceFile::initializeMembersSurfaceFile()
     m_geoHelperIndex = 0;
     m_topoHelperIndex = 0;
     m_normalsComputed = false;
+    m_geometryChangedCounter++;
 }
 
 /**
@@ -577,6 +592,7 @@ SurfaceFile::computeNormals()
         return;
     }
     m_normalsComputed = true;
+    m_geometryChangedCounter++;
     int32_t numCoords = this->getNumberOfNodes();
     if (numCoords > 0) {
         this->normalVectors.resize(numCoords * 3);
@@ -858,6 +874,7 @@ CaretPointer<SignedDistanceHelper> SurfaceFile::getSignedDistanceHelper() const
 
 void SurfaceFile::invalidateHelpers()
 {
+    m_geometryChangedCounter++;
     if (m_geoBase != NULL)
     {
         CaretMutexLocker myLock(&m_geoHelperMutex);//make this function threadsafe
@@ -988,6 +1005,7 @@ SurfaceFile::applyMatrix(const Matrix4x4& matrix)
             matrix.multiplyPoint3(&coordinatePointer[i*3]);
         }
     }
+    m_geometryChangedCounter++;
     
     computeNormals();
     
@@ -1343,6 +1361,8 @@ SurfaceFile::getNodesSpacingStatistics(FastStatistics& statsOut) const
 void
 SurfaceFile::invalidateNodeColoringForBrowserTabs()
 {
+    m_nodeColoringChangedCounter++;
+    
     /*
      * Free memory since could have many tabs and many surfaces equals lots of memory
      */
@@ -1350,9 +1370,48 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
         this->surfaceNodeColoringForBrowserTabs[i].clear();
         this->surfaceMontageNodeColoringForBrowserTabs[i].clear();
         this->wholeBrainNodeColoringForBrowserTabs[i].clear();
+        m_surfaceNodeColoringChangedCounters[i] = m_nodeColoringChangedCounter;
+        m_surfaceMontageNodeColoringChangedCounters[i] = m_nodeColoringChangedCounter;
+        m_wholeBrainNodeColoringChangedCounters[i] = m_nodeColoringChangedCounter;
     }    
 }
 
+/**
+ * Get the counter for the browser tab coloring containing the given
+ * node coloring.  It changes each time that tab's coloring is set or
+ * invalidated, but not when other tabs' coloring changes.  Allows copies
+ * of the coloring, such as OpenGL buffers, to be updated only when needed.
+ *
+ * @param nodeColoringRGBA
+ *    Node coloring from one of the get...NodeColoringRgbaForBrowserTab()
+ *    methods.
+ * @return
+ *    Counter for the tab's coloring.  If the coloring does not belong to
+ *    this surface, the counter for coloring in any tab.
+ */
+int64_t
+SurfaceFile::getNodeColoringChangedCounter(const float* nodeColoringRGBA) const
+{
+    if (nodeColoringRGBA != NULL) {
+        for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
+            if (( ! this->surfaceNodeColoringForBrowserTabs[i].empty())
+                && (&this->surfaceNodeColoringForBrowserTabs[i][0] == nodeColoringRGBA)) {
+                return m_surfaceNodeColoringChangedCounters[i];
+            }
+            if (( ! this->surfaceMontageNodeColoringForBrowserTabs[i].empty())
+                && (&this->surfaceMontageNodeColoringForBrowserTabs[i][0] == nodeColoringRGBA)) {
+                return m_surfaceMontageNodeColoringChangedCounters[i];
+            }
+            if (( ! this->wholeBrainNodeColoringForBrowserTabs[i].empty())
+                && (&this->wholeBrainNodeColoringForBrowserTabs[i][0] == nodeColoringRGBA)) {
+                return m_wholeBrainNodeColoringChangedCounters[i];
+            }
+        }
+    }
+    
+    return m_nodeColoringChangedCounter;
+}
+
 /**
  * Allocate node coloring for a single surface in a browser tab.
  * @param browserTabIndex
@@ -1479,6 +1538,8 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    m_nodeColoringChangedCounter++;
+    m_surfaceNodeColoringChangedCounters[browserTabIndex] = m_nodeColoringChangedCounter;
 }
 
 /**
@@ -1526,6 +1587,8 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    m_nodeColoringChangedCounter++;
+    m_surfaceMontageNodeColoringChangedCounters[browserTabIndex] = m_nodeColoringChangedCounter;
 }
 
 
@@ -1573,6 +1636,8 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    m_nodeColoringChangedCounter++;
+    m_wholeBrainNodeColoringChangedCounters[browserTabIndex] = m_nodeColoringChangedCounter;
 }
 
 /**
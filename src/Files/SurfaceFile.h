@@ -176,6 +176,15 @@ namespace caret {
 
         void invalidateNormals();
         
+        /**
+         * @return Counter that changes each time the coordinates, normal
+         * vectors, or triangles change.  Allows copies of the geometry,
+         * such as OpenGL buffers, to be updated only when needed.
+         */
+        int64_t getGeometryChangedCounter() const { return m_geometryChangedCounter; }
+        
+        int64_t getNodeColoringChangedCounter(const float* nodeColoringRGBA) const;
+        
         void translateToCenterOfMass();
         
         void flipNormals();
@@ -262,6 +271,19 @@ namespace caret {
         
         bool m_skipSanityCheck;
 
+        /** Incremented when coordinates, normal vectors, or triangles change */
+        int64_t m_geometryChangedCounter;
+        
+        /** Incremented when node coloring for any browser tab is set or invalidated */
+        int64_t m_nodeColoringChangedCounter;
+        
+        /** Value of m_nodeColoringChangedCounter when each tab's coloring was last set or invalidated */
+        int64_t m_surfaceNodeColoringChangedCounters[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
+        
+        int64_t m_surfaceMontageNodeColoringChangedCounters[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
+        
+        int64_t m_wholeBrainNodeColoringChangedCounters[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
+
         ///topology base for surface
         mutable CaretPointer<TopologyHelperBase> m_topoBase;
         
@@ -26,7 +26,9 @@
 #include "SurfaceResamplingHelper.h"
 
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "GeodesicHelper.h"
 #include "SignedDistanceHelper.h"
@@ -34,16 +36,43 @@
 #include "TopologyHelper.h"
 #include "Vector3D.h"
 
+#include <QCryptographicHash>
+#include <QFile>
+
+#include <cstring>
 #include <set>
 #include <map>
 
 using namespace std;
 using namespace caret;
 
+AString SurfaceResamplingHelper::s_weightCacheDirectory;
+
+namespace
+{
+    const char WEIGHT_CACHE_MAGIC[8] = { 'w', 'b', 'r', 's', 'w', 't', '0', '1' };//last 2 characters are the format version
+}
+
 SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                                  const float* currentAreas, const float* newAreas, const float* currentRoi)
 {
     if (!checkSphere(currentSphere) || !checkSphere(newSphere)) throw CaretException("input surfaces to SurfaceResamplingHelper must be spheres");
+    if (s_weightCacheDirectory != "")
+    {
+        AString cacheName = getWeightCacheFileName(s_weightCacheDirectory, myMethod, currentSphere, newSphere, currentAreas, newAreas);
+        if (QFile::exists(cacheName) && readWeightCache(cacheName, currentSphere->getNumberOfNodes(), newSphere->getNumberOfNodes()))
+        {
+            CaretLogFine("using precomputed resampling weights from '" + cacheName + "'");
+            if (currentRoi != NULL) applyRoi(currentRoi);
+            return;
+        }
+    }
+    computeWeights(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi);
+}
+
+void SurfaceResamplingHelper::computeWeights(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                             const float* currentAreas, const float* newAreas, const float* currentRoi)
+{
     SurfaceFile currentSphereMod, newSphereMod;
     changeRadius(100.0f, currentSphere, &currentSphereMod);
     changeRadius(100.0f, newSphere, &newSphereMod);
@@ -60,6 +89,164 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
     }
 }
 
+AString SurfaceResamplingHelper::precomputeWeights(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                                   const float* currentAreas, const float* newAreas, const AString& directory)
+{
+    if (!checkSphere(currentSphere) || !checkSphere(newSphere)) throw CaretException("input surfaces to SurfaceResamplingHelper must be spheres");
+    AString ret = getWeightCacheFileName(directory, myMethod, currentSphere, newSphere, currentAreas, newAreas);
+    SurfaceResamplingHelper temp;
+    temp.computeWeights(myMethod, currentSphere, newSphere, currentAreas, newAreas, NULL);//the roi gets applied after loading, so the weights can be shared between differently masked inputs
+    temp.writeWeightCache(ret, currentSphere->getNumberOfNodes());
+    return ret;
+}
+
+AString SurfaceResamplingHelper::getWeightCacheFileName(const AString& directory, const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere,
+                                                        const SurfaceFile* newSphere, const float* currentAreas, const float* newAreas)
+{//the name is a hash of everything the roi-independent weights depend on, so a stale file can't be picked up by accident
+    QCryptographicHash myHash(QCryptographicHash::Md5);
+    myHash.addData(SurfaceResamplingMethodEnum::toName(myMethod).toUtf8());
+    const SurfaceFile* spheres[2] = { currentSphere, newSphere };
+    for (int i = 0; i < 2; ++i)
+    {
+        int32_t counts[2] = { spheres[i]->getNumberOfNodes(), spheres[i]->getNumberOfTriangles() };
+        myHash.addData((const char*)counts, sizeof(counts));
+        myHash.addData((const char*)spheres[i]->getCoordinateData(), sizeof(float) * 3 * counts[0]);
+        for (int j = 0; j < counts[1]; ++j)
+        {
+            myHash.addData((const char*)spheres[i]->getTriangle(j), sizeof(int32_t) * 3);
+        }
+    }
+    switch (myMethod)
+    {
+        case SurfaceResamplingMethodEnum::ADAP_BARY_AREA:
+            if (currentAreas == NULL || newAreas == NULL) throw CaretException("ADAP_BARY_AREA method requires area surfaces");
+            myHash.addData((const char*)currentAreas, sizeof(float) * currentSphere->getNumberOfNodes());
+            myHash.addData((const char*)newAreas, sizeof(float) * newSphere->getNumberOfNodes());
+            break;
+        case SurfaceResamplingMethodEnum::BARYCENTRIC:
+            break;
+    }
+    AString ret = directory;
+    if (!ret.endsWith("/")) ret += "/";
+    return ret + AString(myHash.result().toHex()) + ".wbresample";
+}
+
+bool SurfaceResamplingHelper::readWeightCache(const AString& fileName, const int& numCurrentNodes, const int& numNewNodes)
+{
+    try
+    {
+        CaretBinaryFile myFile(fileName, CaretBinaryFile::READ_MEMORY_MAP);
+        char magic[8];
+        int32_t header[3];//byte order check, current nodes, new nodes
+        int64_t numWeights = -1;
+        myFile.read(magic, 8);
+        myFile.read(header, sizeof(header));
+        myFile.read(&numWeights, sizeof(int64_t));
+        if (memcmp(magic, WEIGHT_CACHE_MAGIC, 8) != 0 || header[0] != 1)
+        {
+            CaretLogWarning("ignoring resampling weight file '" + fileName + "' of unknown version or byte order");
+            return false;
+        }
+        if (header[1] != numCurrentNodes || header[2] != numNewNodes || numWeights < 0)
+        {
+            CaretLogWarning("ignoring resampling weight file '" + fileName + "' that does not match the spheres");
+            return false;
+        }
+        int64_t fileSize = myFile.size();
+        int64_t expectedSize = 8 + sizeof(header) + sizeof(int64_t) + sizeof(int64_t) * (numNewNodes + 1) + sizeof(WeightElem) * numWeights;
+        if (numWeights > fileSize / (int64_t)sizeof(WeightElem) || fileSize != expectedSize)
+        {//check before allocating anything based on the header
+            CaretLogWarning("ignoring corrupted resampling weight file '" + fileName + "'");
+            return false;
+        }
+        vector<int64_t> offsets(numNewNodes + 1);
+        myFile.read(offsets.data(), sizeof(int64_t) * (numNewNodes + 1));
+        CaretArray<WeightElem> storage(numWeights);
+        myFile.read(storage.getArray(), sizeof(WeightElem) * numWeights);
+        CaretArray<WeightElem*> weights(numNewNodes + 1);
+        for (int i = 0; i <= numNewNodes; ++i)
+        {
+            if (offsets[i] < 0 || offsets[i] > numWeights || (i > 0 && offsets[i] < offsets[i - 1]))
+            {
+                CaretLogWarning("ignoring corrupted resampling weight file '" + fileName + "'");
+                return false;
+            }
+            weights[i] = storage + offsets[i];
+        }
+        for (int64_t i = 0; i < numWeights; ++i)
+        {
+            if (storage[i].node < 0 || storage[i].node >= numCurrentNodes)
+            {
+                CaretLogWarning("ignoring corrupted resampling weight file '" + fileName + "'");
+                return false;
+            }
+        }
+        m_storagechunk = storage;
+        m_weights = weights;
+    } catch (CaretException& e) {
+        CaretLogWarning("failed to read resampling weight file '" + fileName + "': " + e.whatString());
+        return false;
+    }
+    return true;
+}
+
+void SurfaceResamplingHelper::writeWeightCache(const AString& fileName, const int& numCurrentNodes) const
+{
+    int numNewNodes = (int)m_weights.size() - 1;
+    CaretAssert(numNewNodes > 0);
+    int64_t numWeights = m_weights[numNewNodes] - m_weights[0];
+    int32_t header[3] = { 1, numCurrentNodes, numNewNodes };
+    vector<int64_t> offsets(numNewNodes + 1);
+    for (int i = 0; i <= numNewNodes; ++i)
+    {
+        offsets[i] = m_weights[i] - m_weights[0];
+    }
+    AString tempName = fileName + ".partial";//write elsewhere and rename, so that a resample running at the same time never sees a partial file
+    {
+        CaretBinaryFile myFile(tempName, CaretBinaryFile::WRITE_TRUNCATE);
+        myFile.write(WEIGHT_CACHE_MAGIC, 8);
+        myFile.write(header, sizeof(header));
+        myFile.write(&numWeights, sizeof(int64_t));
+        myFile.write(offsets.data(), sizeof(int64_t) * (numNewNodes + 1));
+        myFile.write(m_storagechunk.getArray(), sizeof(WeightElem) * numWeights);
+    }
+    QFile::remove(fileName);
+    if (!QFile::rename(tempName, fileName)) throw CaretException("failed to rename '" + tempName + "' to '" + fileName + "'");
+}
+
+void SurfaceResamplingHelper::applyRoi(const float* currentRoi)
+{//same as what the compute functions do with an roi: drop weights from vertices outside it, and renormalize the rest
+    int numNodes = (int)m_weights.size() - 1;
+    CaretArray<WeightElem> newStorage(m_weights[numNodes] - m_weights[0]);
+    CaretArray<WeightElem*> newWeights(numNodes + 1);
+    int64_t curpos = 0;
+    for (int i = 0; i < numNodes; ++i)
+    {
+        newWeights[i] = newStorage + curpos;
+        double weightsum = 0.0;
+        WeightElem* end = m_weights[i + 1];
+        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        {
+            if (currentRoi[elem->node] > 0.0f)
+            {
+                newStorage[curpos] = *elem;
+                weightsum += elem->weight;
+                ++curpos;
+            }
+        }
+        if (weightsum != 0.0)
+        {
+            for (WeightElem* elem = newWeights[i]; elem != newStorage + curpos; ++elem)
+            {
+                elem->weight /= weightsum;
+            }
+        }
+    }
+    newWeights[numNodes] = newStorage + curpos;
+    m_storagechunk = newStorage;
+    m_weights = newWeights;
+}
+
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
 {
     int numNodes = (int)m_weights.size() - 1;
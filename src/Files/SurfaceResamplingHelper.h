@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include "AString.h"
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
 
@@ -48,6 +49,14 @@ namespace caret {
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
         static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
         void compactWeights(const std::vector<std::map<int, float> >& weights);
+        void computeWeights(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                            const float* currentAreas, const float* newAreas, const float* currentRoi);
+        static AString s_weightCacheDirectory;
+        static AString getWeightCacheFileName(const AString& directory, const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                              const float* currentAreas, const float* newAreas);
+        bool readWeightCache(const AString& fileName, const int& numCurrentNodes, const int& numNewNodes);
+        void writeWeightCache(const AString& fileName, const int& numCurrentNodes) const;
+        void applyRoi(const float* currentRoi);
     public:
         SurfaceResamplingHelper() { }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
@@ -65,6 +74,13 @@ namespace caret {
         ///get the ROI of nodes that have data within the input ROI
         void getResampleValidROI(float* output) const;
         
+        ///set a directory to look in for weights made by precomputeWeights, empty string disables
+        static void setWeightCacheDirectory(const AString& directory) { s_weightCacheDirectory = directory; }
+        static const AString& getWeightCacheDirectory() { return s_weightCacheDirectory; }
+        ///compute the roi-independent weights and save them in the given directory, named by a hash of the spheres, method and areas - returns the file name
+        static AString precomputeWeights(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                         const float* currentAreas, const float* newAreas, const AString& directory);
+        
         ///resample a cut surface - not something you will apply multiple times, so static method
         static void resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut);
     };
@@ -694,6 +694,7 @@ void VolumeFile::validateMembers()
     if (s_voxelColoringEnabled) {
         m_voxelColorizer.grabNew(new VolumeFileVoxelColorizer(this));
     }
+    mapColoringChanged();
     if (m_classNameHierarchy == NULL) {
         m_classNameHierarchy.grabNew(new GroupAndNameHierarchyModel());
     }
@@ -1456,10 +1457,29 @@ VolumeFile::updateScalarColoringForMap(const int32_t mapIndex,
                                               palette,
                                               this,
                                               mapIndex);
+    mapColoringChanged();
     
     invalidateHistogramChartColoring();
 }
 
+/**
+ * Get a counter that changes whenever the voxel coloring of a map changes.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @return
+ *     The counter, or negative if voxel coloring is not enabled.
+ */
+int64_t
+VolumeFile::getVoxelColoringChangedCounter(const int32_t /*mapIndex*/) const
+{
+    if (s_voxelColoringEnabled == false) {
+        return -1;
+    }
+    
+    return getMapColoringChangedCounter();
+}
+
 /**
  * Get the voxel RGBA coloring for a map.
  * Does nothing if coloring is not enabled and output colors are undefined
@@ -1748,6 +1768,7 @@ VolumeFile::clearVoxelColoringForMap(const int64_t mapIndex)
     CaretAssert(m_voxelColorizer);
     
     m_voxelColorizer->clearVoxelColoringForMap(mapIndex);
+    mapColoringChanged();
     
     if (isMappedWithLabelTable()) {
         m_forceUpdateOfGroupAndNameHierarchy = true;
@@ -290,6 +290,8 @@ namespace caret {
         void updateScalarColoringForMap(const int32_t mapIndex,
                                      const PaletteFile* paletteFile);
         
+        virtual int64_t getVoxelColoringChangedCounter(const int32_t mapIndex) const;
+        
         virtual int64_t getVoxelColorsForSliceInMap(const int32_t mapIndex,
                                             const int64_t firstVoxelIJK[3],
                                             const int64_t rowStepIJK[3],
@@ -0,0 +1,271 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeResamplePlan.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "FloatMatrix.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t FRAME_BLOCK = 16;//number of frames that share one pass over the plan
+}
+
+VolumeResamplePlan::VolumeResamplePlan(const VolumeSpace& inSpace, const VolumeFile* warpfield, const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod)
+{
+    vector<int64_t> warpDims;
+    warpfield->getDimensions(warpDims);
+    if (warpDims[3] != 3 || warpDims[4] != 1) throw CaretException("provided warpfield volume has wrong number of subvolumes or components");
+    m_inSpace = inSpace;
+    m_outSpace.setSpace(refDims, refSform);
+    m_method = myMethod;
+    int64_t numOut = refDims[0] * refDims[1] * refDims[2];
+    vector<Vector3D> inCoords(numOut);
+    vector<char> inCoordValid(numOut);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t k = 0; k < refDims[2]; ++k)
+    {
+        for (int64_t j = 0; j < refDims[1]; ++j)
+        {
+            for (int64_t i = 0; i < refDims[0]; ++i)
+            {
+                int64_t outIndex = i + refDims[0] * (j + refDims[1] * k);
+                Vector3D outCoord, displacement;
+                m_outSpace.indexToSpace(i, j, k, outCoord);
+                bool validDisplacement = false;
+                displacement[0] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, &validDisplacement, 0);
+                if (validDisplacement)
+                {
+                    displacement[1] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 1);
+                    displacement[2] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 2);
+                    inCoords[outIndex] = outCoord + displacement;
+                    inCoordValid[outIndex] = 1;
+                } else {
+                    inCoordValid[outIndex] = 0;
+                }
+            }
+        }
+    }
+    setup(inCoords, inCoordValid);
+}
+
+VolumeResamplePlan::VolumeResamplePlan(const VolumeSpace& inSpace, const FloatMatrix& myAffine, const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod)
+{
+    int64_t affRows, affColumns;
+    myAffine.getDimensions(affRows, affColumns);
+    if (affRows < 3 || affRows > 4 || affColumns != 4) throw CaretException("input matrix is not an affine matrix");
+    FloatMatrix targetToSource = myAffine;
+    targetToSource.resize(4, 4);
+    targetToSource[3][0] = 0.0f;
+    targetToSource[3][1] = 0.0f;
+    targetToSource[3][2] = 0.0f;
+    targetToSource[3][3] = 1.0f;
+    targetToSource = targetToSource.inverse();
+    m_inSpace = inSpace;
+    m_outSpace.setSpace(refDims, refSform);
+    m_method = myMethod;
+    Vector3D xvec, yvec, zvec, offset;
+    xvec[0] = targetToSource[0][0]; xvec[1] = targetToSource[1][0]; xvec[2] = targetToSource[2][0];
+    yvec[0] = targetToSource[0][1]; yvec[1] = targetToSource[1][1]; yvec[2] = targetToSource[2][1];
+    zvec[0] = targetToSource[0][2]; zvec[1] = targetToSource[1][2]; zvec[2] = targetToSource[2][2];
+    offset[0] = targetToSource[0][3]; offset[1] = targetToSource[1][3]; offset[2] = targetToSource[2][3];
+    int64_t numOut = refDims[0] * refDims[1] * refDims[2];
+    vector<Vector3D> inCoords(numOut);
+    vector<char> inCoordValid(numOut, 1);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t k = 0; k < refDims[2]; ++k)
+    {
+        for (int64_t j = 0; j < refDims[1]; ++j)
+        {
+            for (int64_t i = 0; i < refDims[0]; ++i)
+            {
+                Vector3D outCoord;
+                m_outSpace.indexToSpace(i, j, k, outCoord);
+                inCoords[i + refDims[0] * (j + refDims[1] * k)] = xvec * outCoord[0] + yvec * outCoord[1] + zvec * outCoord[2] + offset;
+            }
+        }
+    }
+    setup(inCoords, inCoordValid);
+}
+
+void VolumeResamplePlan::setup(const vector<Vector3D>& inCoords, const vector<char>& inCoordValid)
+{
+    const int64_t* inDims = m_inSpace.getDims();
+    if (inDims[0] == 1 || inDims[1] == 1 || inDims[2] == 1)
+    {
+        m_method = VolumeFile::ENCLOSING_VOXEL;//same as VolumeFile::interpolateValue, trilinear and cubic need adjacent slices
+    }
+    int64_t numOut = (int64_t)inCoords.size();
+    CaretAssert((int64_t)inCoordValid.size() == numOut);
+    switch (m_method)
+    {
+        case VolumeFile::CUBIC:
+            m_coords = inCoords;//cubic samples a deconvolved frame, so just keep the coordinates
+            m_coordValid = inCoordValid;
+            break;
+        case VolumeFile::TRILINEAR:
+            m_baseIndex.resize(numOut);
+            m_weights.resize(numOut * 3);
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+            for (int64_t v = 0; v < numOut; ++v)
+            {
+                m_baseIndex[v] = -1;
+                if (!inCoordValid[v]) continue;
+                float index[3];
+                m_inSpace.spaceToIndex(inCoords[v][0], inCoords[v][1], inCoords[v][2], index);
+                int64_t low[3];
+                bool valid = true;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    low[axis] = (int64_t)floor(index[axis]);
+                    if (low[axis] < 0 || low[axis] + 1 >= inDims[axis]) valid = false;
+                }
+                if (!valid) continue;
+                m_baseIndex[v] = low[0] + inDims[0] * (low[1] + inDims[1] * low[2]);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    m_weights[v * 3 + axis] = index[axis] - low[axis];
+                }
+            }
+            break;
+        case VolumeFile::ENCLOSING_VOXEL:
+            m_baseIndex.resize(numOut);
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+            for (int64_t v = 0; v < numOut; ++v)
+            {
+                m_baseIndex[v] = -1;
+                if (!inCoordValid[v]) continue;
+                int64_t index[3];
+                m_inSpace.enclosingVoxel(inCoords[v][0], inCoords[v][1], inCoords[v][2], index);
+                if (m_inSpace.indexValid(index))
+                {
+                    m_baseIndex[v] = index[0] + inDims[0] * (index[1] + inDims[1] * index[2]);
+                }
+            }
+            break;
+    }
+}
+
+void VolumeResamplePlan::resample(const VolumeFile* inVol, VolumeFile* outVol) const
+{
+    if (!inVol->getVolumeSpace().matches(m_inSpace)) throw CaretException("volume does not match the volume space of the resampling plan");
+    const int64_t* outSpaceDims = m_outSpace.getDims();
+    vector<int64_t> outDims = inVol->getOriginalDimensions();
+    CaretAssert(outDims.size() >= 3);
+    outDims[0] = outSpaceDims[0];
+    outDims[1] = outSpaceDims[1];
+    outDims[2] = outSpaceDims[2];
+    int64_t numMaps = inVol->getNumberOfMaps(), numComponents = inVol->getNumberOfComponents();
+    outVol->reinitialize(outDims, m_outSpace.getSform(), numComponents, inVol->getType());
+    int64_t numOut = outSpaceDims[0] * outSpaceDims[1] * outSpaceDims[2];
+    if (m_method == VolumeFile::CUBIC)
+    {
+        vector<float> outFrame(numOut);
+        for (int64_t c = 0; c < numComponents; ++c)
+        {
+            for (int64_t b = 0; b < numMaps; ++b)
+            {
+                inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+                for (int64_t v = 0; v < numOut; ++v)
+                {
+                    if (m_coordValid[v])
+                    {
+                        outFrame[v] = inVol->interpolateValue(m_coords[v][0], m_coords[v][1], m_coords[v][2], VolumeFile::CUBIC, NULL, b, c);
+                    } else {
+                        outFrame[v] = VolumeFile::INVALID_INTERP_VALUE;
+                    }
+                }
+                outVol->setFrame(outFrame.data(), b, c);
+                inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
+            }
+        }
+        return;
+    }
+    const int64_t* inDims = m_inSpace.getDims();
+    const int64_t jStride = inDims[0], kStride = inDims[0] * inDims[1];
+    vector<float> outFrames(min(FRAME_BLOCK, numMaps) * numOut);
+    vector<const float*> inFrames(FRAME_BLOCK);
+    for (int64_t c = 0; c < numComponents; ++c)
+    {
+        for (int64_t bStart = 0; bStart < numMaps; bStart += FRAME_BLOCK)
+        {//each output voxel reads its stencil once and applies it to a block of frames
+            int64_t blockCount = min(FRAME_BLOCK, numMaps - bStart);
+            for (int64_t f = 0; f < blockCount; ++f)
+            {
+                inFrames[f] = inVol->getFrame(bStart + f, c);
+            }
+            if (m_method == VolumeFile::TRILINEAR)
+            {
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+                for (int64_t v = 0; v < numOut; ++v)
+                {
+                    int64_t base = m_baseIndex[v];
+                    if (base < 0)
+                    {
+                        for (int64_t f = 0; f < blockCount; ++f)
+                        {
+                            outFrames[f * numOut + v] = VolumeFile::INVALID_INTERP_VALUE;
+                        }
+                        continue;
+                    }
+                    float xhighWeight = m_weights[v * 3], xlowWeight = 1.0f - xhighWeight;
+                    float yhighWeight = m_weights[v * 3 + 1], ylowWeight = 1.0f - yhighWeight;
+                    float zhighWeight = m_weights[v * 3 + 2], zlowWeight = 1.0f - zhighWeight;
+                    for (int64_t f = 0; f < blockCount; ++f)
+                    {//same order of operations as VolumeFile::interpolateValue
+                        const float* frame = inFrames[f] + base;
+                        float xinterp[2][2];
+                        xinterp[0][0] = xlowWeight * frame[0] + xhighWeight * frame[1];
+                        xinterp[1][0] = xlowWeight * frame[jStride] + xhighWeight * frame[jStride + 1];
+                        xinterp[0][1] = xlowWeight * frame[kStride] + xhighWeight * frame[kStride + 1];
+                        xinterp[1][1] = xlowWeight * frame[jStride + kStride] + xhighWeight * frame[jStride + kStride + 1];
+                        float yinterp[2];
+                        yinterp[0] = ylowWeight * xinterp[0][0] + yhighWeight * xinterp[1][0];
+                        yinterp[1] = ylowWeight * xinterp[0][1] + yhighWeight * xinterp[1][1];
+                        outFrames[f * numOut + v] = zlowWeight * yinterp[0] + zhighWeight * yinterp[1];
+                    }
+                }
+            } else {
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+                for (int64_t v = 0; v < numOut; ++v)
+                {
+                    int64_t base = m_baseIndex[v];
+                    for (int64_t f = 0; f < blockCount; ++f)
+                    {
+                        outFrames[f * numOut + v] = (base < 0 ? VolumeFile::INVALID_INTERP_VALUE : inFrames[f][base]);
+                    }
+                }
+            }
+            for (int64_t f = 0; f < blockCount; ++f)
+            {
+                outVol->setFrame(outFrames.data() + f * numOut, bStart + f, c);
+            }
+        }
+    }
+}
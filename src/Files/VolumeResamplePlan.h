@@ -0,0 +1,57 @@
+#ifndef __VOLUME_RESAMPLE_PLAN_H__
+#define __VOLUME_RESAMPLE_PLAN_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Vector3D.h"
+#include "VolumeFile.h"
+#include "VolumeSpace.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    class FloatMatrix;
+
+    ///precomputes where each output voxel samples the input volume, so that a warpfield or affine only needs to be evaluated once for all frames
+    class VolumeResamplePlan
+    {
+        VolumeSpace m_inSpace, m_outSpace;
+        VolumeFile::InterpType m_method;
+        std::vector<int64_t> m_baseIndex;//per output voxel, offset within an input frame of the enclosing voxel or the low corner of the trilinear stencil, -1 if invalid
+        std::vector<float> m_weights;//per output voxel, high weights along i, j, k for trilinear
+        std::vector<Vector3D> m_coords;//per output voxel, input coordinate for cubic
+        std::vector<char> m_coordValid;
+        void setup(const std::vector<Vector3D>& inCoords, const std::vector<char>& inCoordValid);
+    public:
+        VolumeResamplePlan() { }
+        ///warpfield convention is the same as AlgorithmVolumeWarpfieldResample
+        VolumeResamplePlan(const VolumeSpace& inSpace, const VolumeFile* warpfield, const int64_t refDims[3], const std::vector<std::vector<float> >& refSform, const VolumeFile::InterpType& myMethod);
+        ///affine convention is the same as AlgorithmVolumeAffineResample
+        VolumeResamplePlan(const VolumeSpace& inSpace, const FloatMatrix& myAffine, const int64_t refDims[3], const std::vector<std::vector<float> >& refSform, const VolumeFile::InterpType& myMethod);
+        ///reinitializes outVol to the reference space, and resamples all frames and components of inVol, which must be in the planned input space
+        void resample(const VolumeFile* inVol, VolumeFile* outVol) const;
+    };
+
+}
+
+#endif //__VOLUME_RESAMPLE_PLAN_H__
@@ -287,6 +287,20 @@ namespace caret {
                                                     const int32_t tabIndex,
                                                     uint8_t* rgbaOut) const = 0;
         
+        /**
+         * Get a counter that changes whenever the voxel coloring of a map
+         * changes, so that copies of the coloring (such as OpenGL textures)
+         * are recreated only when needed.  The coloring of a slice also
+         * depends upon the tab, display group, and label selections.
+         *
+         * @param mapIndex
+         *     Index of map.
+         * @return
+         *     The counter, or negative if the map's coloring is not valid
+         *     and must be updated by getting the voxel colors.
+         */
+        virtual int64_t getVoxelColoringChangedCounter(const int32_t mapIndex) const = 0;
+        
         /**
          * Get voxel coloring for a set of voxels.
          *
@@ -149,6 +149,12 @@ GiftiDataArray::operator=(const GiftiDataArray& nda)
 void 
 GiftiDataArray::copyHelperGiftiDataArray(const GiftiDataArray& nda)
 {
+    //
+    // Copies never share a deferred external file: the mapping would outlive
+    // the original and could be invalidated by rewriting the file, so load
+    // first (this also settles the data type and order copied below)
+    //
+    nda.ensureDataLoaded();
     this->paletteColorMapping = NULL;
     if (nda.paletteColorMapping != NULL) {
         this->paletteColorMapping = new PaletteColorMapping(*nda.paletteColorMapping);
@@ -169,6 +175,11 @@ GiftiDataArray::copyHelperGiftiDataArray(const GiftiDataArray& nda)
    dataTypeSize = nda.dataTypeSize;
    endian = nda.endian;
    dimensions = nda.dimensions;
+   {
+      CaretMutexLocker locked(&m_deferredExternalDataMutex);
+      m_deferredExternalData.grabNew(NULL);
+      m_dataLoaded.store(true, std::memory_order_release);
+   }
    allocateData();
    data = nda.data;
    metaData = nda.metaData;
@@ -248,6 +259,7 @@ GiftiDataArray::getDataTypeAppropriateForIntent(const NiftiIntentEnum::Enum inte
 void 
 GiftiDataArray::addRows(const int32_t numRowsToAdd)
 {
+   ensureDataLoaded();
    dimensions[0] += numRowsToAdd;
    allocateData();
 }
@@ -258,6 +270,7 @@ GiftiDataArray::addRows(const int32_t numRowsToAdd)
 void 
 GiftiDataArray::deleteRows(const std::vector<int32_t>& rowsToDeleteIn)
 {
+   ensureDataLoaded();
    if (rowsToDeleteIn.empty()) {
       return;
    }
@@ -300,6 +313,7 @@ GiftiDataArray::deleteRows(const std::vector<int32_t>& rowsToDeleteIn)
 void 
 GiftiDataArray::setDimensions(const std::vector<int64_t> dimensionsIn)
 {
+   ensureDataLoaded();
    dimensions = dimensionsIn;
    if (dimensions.size() == 1) {
       dimensions.push_back(1);
@@ -407,6 +421,11 @@ GiftiDataArray::clear()
    dataTypeSize = sizeof(float);
    metaData.clear();
    nonWrittenMetaData.clear();
+   {
+      CaretMutexLocker locked(&m_deferredExternalDataMutex);
+      m_deferredExternalData.grabNew(NULL);
+      m_dataLoaded.store(true, std::memory_order_release);
+   }
    dimensions.clear();
    setDimensions(dimensions);
    externalFileName = "";
@@ -540,6 +559,7 @@ GiftiDataArray::remapIntValues(const std::vector<int32_t>& remappingTable)
    if (remappingTable.isEmpty()) {
       return;
    }
+   ensureDataLoaded();
    if (dataType != NiftiDataType::NIFTI_TYPE_INT32) {
       return;
    }
@@ -558,6 +578,7 @@ GiftiDataArray::remapIntValues(const std::vector<int32_t>& remappingTable)
  */
 void 
 GiftiDataArray::transferLabelIndices(const std::map<int32_t,int32_t>& indexConverter) {
+    ensureDataLoaded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_INT32) {
         int64_t num = this->getTotalNumberOfElements();
         for (int i = 0; i < num; i++) {
@@ -651,152 +672,53 @@ GiftiDataArray::readFromText(const AString text,
             }
             break;
           case GiftiEncodingEnum::BASE64_BINARY:
+          case GiftiEncodingEnum::GZIP_BASE64_BINARY:
             {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               const uint64_t numDecoded =
-                     Base64::decode((const unsigned char*)(text.toStdString().c_str()),
-                                                data.size(),
-                                                &data[0]);
-               if (numDecoded != data.size()) {
-                  std::ostringstream str;
-                  str << "Decoding of Base64 Binary data failed.\n"
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                      << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Is byte swapping needed ?
-               //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
-               }
+               const QByteArray textBytes = text.toLatin1();
+               m_textDecoder.grabNew(new TextDecoder(requiredDataType));
+               decodeTextChunk(textBytes.constData(),
+                               textBytes.size());
+               finishDecodingBinary();
             }
             break;
-          case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+          case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
             {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               unsigned char* dataBuffer = new unsigned char[data.size()];
-               //const char* textChars = text.toLatin1().constData();
-               const uint64_t numDecoded =
-                     Base64::decode((unsigned char*)text.toStdString().c_str(),
-                                                data.size(),
-                                                dataBuffer);
-               if (numDecoded == 0) {
-                   std::ostringstream str;
-                   str << "Decoding of GZip Base64 Binary data failed."
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                   throw GiftiException(AString::fromStdString(str.str()));
+               const GiftiExternalDataFile externalFile(externalFileNameForReading);
+               if (data.empty() == false) {
+                  externalFile.read(externalFileOffsetForReading,
+                                    data.size(),
+                                    &data[0]);
                }
                
-               
                //
-               // Uncompress the data using VTK's algorithm
-               // 
-                DataCompressZLib compressor;
-                const uint64_t uncompressedDataLength = 
-                                   compressor.uncompressData(dataBuffer,
-                                                          numDecoded,
-                                                          (unsigned char*)&data[0],
-                                                          data.size());
-               if (uncompressedDataLength != data.size()) {
-                  std::ostringstream str;
-                  str << "Decompression of Binary data failed.\n"
-                   << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Free memory
-               //
-               delete[] dataBuffer;
-               
-               //
-               // Is byte swapping needed ? 
+               // Is byte swapping needed ?
                //
                if (endian != getSystemEndian()) {
                   byteSwapData(getSystemEndian());
                }
             }
             break;
-          case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
-            {
-               if (externalFileNameForReading.length() <= 0) {
-                  throw GiftiException("External file name is empty.");
-               }
-               
-                std::ifstream extBinFile(externalFileNameForReading.toStdString().c_str(),
-                                         std::ifstream::in | std::ifstream::binary);
-                if (extBinFile.good() == false) {
-                        throw GiftiException("Error opening \""
-                                            + externalFileNameForReading
-                                            + "\"");
-                }
-                else {
-                  //
-                  // Move to the offset of the data
-                  //
-                  extBinFile.seekg(externalFileOffsetForReading, std::ios::beg);
-                  if (extBinFile.good() == false) {
-                        throw GiftiException("Error seeking to \""
-                                             + AString::number(externalFileOffsetForReading)
-                                             + "\" in \""
-                                             + externalFileNameForReading
-                                             + "\"");
-                  }
-                    
-                  //
-                  // Set the number of bytes that must be read
-                  //
-                    std::streamsize numberOfBytesToRead = 0;
-                  char* pointerToForReadingData = NULL;
-                  switch (dataType) {
-                     case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
-                        numberOfBytesToRead = numElements * sizeof(float);
-                        pointerToForReadingData = (char*)dataPointerFloat;
-                        break;
-                     case NiftiDataTypeEnum::NIFTI_TYPE_INT32:
-                        numberOfBytesToRead = numElements * sizeof(int32_t);
-                        pointerToForReadingData = (char*)dataPointerInt;
-                        break;
-                     case NiftiDataTypeEnum::NIFTI_TYPE_UINT8:
-                        numberOfBytesToRead = numElements * sizeof(uint8_t);
-                        pointerToForReadingData = (char*)dataPointerUByte;
-                        break;
-                      default:
-                          throw GiftiException("DataType " + NiftiDataTypeEnum::toName(dataType) + " not supported in GIFTI");
-                  }
-               
-                  //
-                  // Read the data
-                  //
-                  extBinFile.read((char*)pointerToForReadingData,
-                                    numberOfBytesToRead);
-                  if(extBinFile.good() == false) {
-                     throw GiftiException("Tried to read "
-                                         + AString::number((int64_t)numberOfBytesToRead)
-                                         + " from "
-                                         + externalFileOffsetForReading
-                                         + " but failed");
-                  }
-                  
-                  //
-                  // Is byte swapping needed ?
-                  //
-                  if (endian != getSystemEndian()) {
-                     byteSwapData(getSystemEndian());
-                  }
-               }
-            }
-            break;
       }
    
+      convertAfterReading(requiredDataType,
+                          arraySubscriptingOrderForReading);
+   } // If NOT metadata only
+   
+   setModified();
+}
+
+/**
+ * Convert the data type and indexing order of data that was just read.
+ *
+ * @param requiredDataType
+ *    Data type the array had before reading.
+ * @param arraySubscriptingOrderForReading
+ *    Indexing order of the data that was read.
+ */
+void
+GiftiDataArray::convertAfterReading(const NiftiDataTypeEnum::Enum requiredDataType,
+                                    const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading)
+{
       //
       // Check if data type needs to be converted
       //
@@ -812,11 +734,348 @@ GiftiDataArray::readFromText(const AString text,
        if (arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
            convertArrayIndexingOrder();
        }
-   } // If NOT metadata only
+}
+
+/**
+ * Read the data from an external binary file.  When loading is deferred,
+ * the data array only records where its data is, and the data is read
+ * (byte swapped and converted) the first time it is needed, so data
+ * arrays that are never used are never read.
+ *
+ * @param externalFile
+ *    The memory mapped external file, may be shared by many data arrays.
+ * @param externalFileOffsetForReading
+ *    Offset of the data in the external file.
+ * @param dataEndianForReading
+ *    Endian of the data in the file.
+ * @param arraySubscriptingOrderForReading
+ *    Indexing order of the data in the file.
+ * @param dataTypeForReading
+ *    Data type of the data in the file.
+ * @param dimensionsForReading
+ *    Dimensions of the data.
+ * @param deferLoadingData
+ *    If true, do not read the data until it is needed.
+ */
+void
+GiftiDataArray::readFromExternalFile(const CaretPointer<GiftiExternalDataFile>& externalFile,
+                                     const int64_t externalFileOffsetForReading,
+                                     const GiftiEndianEnum::Enum dataEndianForReading,
+                                     const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                     const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                     const std::vector<int64_t>& dimensionsForReading,
+                                     const bool deferLoadingData)
+{
+   CaretAssert(externalFile != NULL);
+   if (dimensionsForReading.size() == 0) {
+      throw GiftiException("Data array has no dimensions.");
+   }
+   const NiftiDataTypeEnum::Enum requiredDataType = dataType;
+   encoding = GiftiEncodingEnum::EXTERNAL_FILE_BINARY;
+   
+   if (deferLoadingData == false) {
+      {
+         CaretMutexLocker locked(&m_deferredExternalDataMutex);
+         m_deferredExternalData.grabNew(NULL);
+         m_dataLoaded.store(true, std::memory_order_release);
+      }
+      dataType = dataTypeForReading;
+      endian   = dataEndianForReading;
+      arraySubscriptingOrder = arraySubscriptingOrderForReading;
+      setDimensions(dimensionsForReading);
+      if (data.empty() == false) {
+         externalFile->read(externalFileOffsetForReading,
+                            data.size(),
+                            &data[0]);
+      }
+      if (endian != getSystemEndian()) {
+         byteSwapData(getSystemEndian());
+      }
+      convertAfterReading(requiredDataType,
+                          arraySubscriptingOrderForReading);
+      setModified();
+      return;
+   }
    
+   if ((arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER)
+       && (dimensionsForReading.size() > 2)) {
+      throw GiftiException("Row/Column Major order conversion unavailable for arrays "
+                           "with dimensions greater than two.");
+   }
+   
+   DeferredExternalData* deferred = new DeferredExternalData();
+   deferred->externalFile = externalFile;
+   deferred->offset = externalFileOffsetForReading;
+   deferred->endian = dataEndianForReading;
+   deferred->arraySubscriptingOrder = arraySubscriptingOrderForReading;
+   deferred->dataTypeInFile = dataTypeForReading;
+   deferred->requiredDataType = requiredDataType;
+   {
+      CaretMutexLocker locked(&m_deferredExternalDataMutex);
+      m_deferredExternalData.grabNew(deferred);
+      m_dataLoaded.store(false, std::memory_order_release);
+   }
+   
+   //
+   // Set up the array as it will be after loading, but without allocating the data
+   //
+   dataType = dataTypeForReading;
+   if ((requiredDataType != dataTypeForReading)
+       && (intent != NiftiIntentEnum::NIFTI_INTENT_POINTSET)) {
+      dataType = requiredDataType;
+   }
+   endian = getSystemEndian();
+   arraySubscriptingOrder = GiftiArrayIndexingOrderEnum::ROW_MAJOR_ORDER;
+   dimensions = dimensionsForReading;
+   if (dimensions.size() == 1) {
+      dimensions.push_back(1);
+   }
+   std::vector<uint8_t>().swap(data);
+   updateDataPointers();
    setModified();
 }
 
+/**
+ * Read the data that was deferred by readFromExternalFile().  The data is
+ * read into a temporary data array and then swapped into this data array,
+ * so that the lock is only needed here, and conversion uses the normal
+ * code path.
+ */
+void
+GiftiDataArray::loadDeferredExternalData() const
+{
+   CaretMutexLocker locked(&m_deferredExternalDataMutex);
+   if (m_dataLoaded.load(std::memory_order_relaxed)) {
+      return; // loaded by another thread while waiting for the lock
+   }
+   CaretAssert(m_deferredExternalData != NULL);
+   const DeferredExternalData& deferred = *m_deferredExternalData;
+   
+   GiftiDataArray loaded(intent);
+   loaded.dataType = deferred.requiredDataType;
+   loaded.readFromExternalFile(deferred.externalFile,
+                               deferred.offset,
+                               deferred.endian,
+                               deferred.arraySubscriptingOrder,
+                               deferred.dataTypeInFile,
+                               dimensions,
+                               false);
+   
+   //
+   // Data has not been changed, so modified status and statistics are not affected
+   //
+   GiftiDataArray* me = const_cast<GiftiDataArray*>(this);
+   me->data.swap(loaded.data);
+   me->dataType = loaded.dataType;
+   me->dataTypeSize = loaded.dataTypeSize;
+   me->endian = loaded.endian;
+   me->arraySubscriptingOrder = loaded.arraySubscriptingOrder;
+   me->updateDataPointers();
+   me->m_deferredExternalData.grabNew(NULL);
+   m_dataLoaded.store(true, std::memory_order_release); // publishes the data to threads that check without the lock
+}
+
+/**
+ * Start decoding BASE64_BINARY or GZIP_BASE64_BINARY data incrementally,
+ * so that the text of the data array never needs to be stored.
+ * Sets up the array in the same way as readFromText().
+ */
+void
+GiftiDataArray::startDecodingText(const GiftiEndianEnum::Enum dataEndianForReading,
+                                  const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                  const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                  const std::vector<int64_t>& dimensionsForReading,
+                                  const GiftiEncodingEnum::Enum encodingForReading)
+{
+    if ((encodingForReading != GiftiEncodingEnum::BASE64_BINARY)
+        && (encodingForReading != GiftiEncodingEnum::GZIP_BASE64_BINARY)) {
+        throw GiftiException("Incremental decoding is only available for base64 encodings.");
+    }
+    m_textDecoder.grabNew(new TextDecoder(dataType));
+    dataType = dataTypeForReading;
+    encoding = encodingForReading;
+    endian   = dataEndianForReading;
+    arraySubscriptingOrder = arraySubscriptingOrderForReading;
+    setDimensions(dimensionsForReading);
+    if (dimensionsForReading.size() == 0) {
+        m_textDecoder.grabNew(NULL);
+        throw GiftiException("Data array has no dimensions.");
+    }
+}
+
+namespace {
+    const uint8_t BASE64_SKIP = 64;
+    const uint8_t BASE64_PAD = 65;
+    const uint8_t BASE64_INVALID = 66;
+    
+    struct Base64Table {
+        uint8_t values[256];
+        Base64Table() {
+            for (int i = 0; i < 256; i++) {
+                values[i] = BASE64_INVALID;
+            }
+            const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; i++) {
+                values[(uint8_t)alphabet[i]] = i;
+            }
+            values[(uint8_t)'='] = BASE64_PAD;
+            values[(uint8_t)' '] = BASE64_SKIP;
+            values[(uint8_t)'\t'] = BASE64_SKIP;
+            values[(uint8_t)'\n'] = BASE64_SKIP;
+            values[(uint8_t)'\r'] = BASE64_SKIP;
+        }
+    };
+    
+    const Base64Table base64Table;
+}
+
+/**
+ * Decode the next piece of the data text.  The text may be split
+ * anywhere, including in the middle of a base64 quad.  Uncompressed
+ * data is decoded directly into the array.
+ *
+ * @param text
+ *    Text to decode (does not need to be null terminated).
+ * @param length
+ *    Number of characters in text.
+ */
+void
+GiftiDataArray::decodeTextChunk(const char* text,
+                                const int64_t length)
+{
+    CaretAssert(m_textDecoder != NULL);
+    TextDecoder& decoder = *m_textDecoder;
+    const bool compressedFlag = (encoding == GiftiEncodingEnum::GZIP_BASE64_BINARY);
+    uint8_t* output = NULL;
+    int64_t outputSize = 0;
+    if (compressedFlag) {
+        decoder.compressedData.resize(decoder.bytesDecoded + (length / 4 + 1) * 3);
+        output = &decoder.compressedData[0];
+        outputSize = decoder.compressedData.size();
+    }
+    else {
+        output = data.empty() ? NULL : &data[0];
+        outputSize = data.size();
+    }
+    for (int64_t i = 0; i < length; i++) {
+        const uint8_t value = base64Table.values[(uint8_t)text[i]];
+        if (value == BASE64_SKIP) {
+            continue;
+        }
+        if (value == BASE64_INVALID) {
+            throw GiftiException("Invalid character found in base64 data.");
+        }
+        if (value == BASE64_PAD) {
+            decoder.paddingCount++;
+            decoder.quad[decoder.quadCount] = 0;
+        }
+        else {
+            if (decoder.paddingCount > 0) {
+                throw GiftiException("Base64 data continues after padding.");
+            }
+            decoder.quad[decoder.quadCount] = value;
+        }
+        decoder.quadCount++;
+        if (decoder.quadCount == 4) {
+            const int numBytes = 3 - decoder.paddingCount;
+            if (numBytes < 1) {
+                throw GiftiException("Too much padding found in base64 data.");
+            }
+            if (decoder.bytesDecoded + numBytes > outputSize) {
+                throw GiftiException("Base64 data is longer than the dimensions of the data array.");
+            }
+            const uint8_t bytes[3] = {
+                static_cast<uint8_t>((decoder.quad[0] << 2) | (decoder.quad[1] >> 4)),
+                static_cast<uint8_t>((decoder.quad[1] << 4) | (decoder.quad[2] >> 2)),
+                static_cast<uint8_t>((decoder.quad[2] << 6) | decoder.quad[3])
+            };
+            for (int j = 0; j < numBytes; j++) {
+                output[decoder.bytesDecoded + j] = bytes[j];
+            }
+            decoder.bytesDecoded += numBytes;
+            decoder.quadCount = 0;
+        }
+    }
+    if (compressedFlag) {
+        decoder.compressedData.resize(decoder.bytesDecoded);
+    }
+}
+
+/**
+ * Decompress the decoded text (if needed), verify its length, and byte swap it.
+ */
+void
+GiftiDataArray::finishDecodingBinary()
+{
+    CaretAssert(m_textDecoder != NULL);
+    TextDecoder& decoder = *m_textDecoder;
+    if (decoder.quadCount == 1) {
+        throw GiftiException("Base64 data ends in the middle of a group of four characters.");
+    }
+    if (decoder.quadCount > 1) {
+        /*
+         * Tolerate base64 data that is missing its padding
+         */
+        decodeTextChunk("==",
+                        4 - decoder.quadCount);
+    }
+    if (encoding == GiftiEncodingEnum::GZIP_BASE64_BINARY) {
+        if (decoder.bytesDecoded == 0) {
+            std::ostringstream str;
+            str << "Decoding of GZip Base64 Binary data failed."
+            << "Decoded " << AString::number(decoder.bytesDecoded).toStdString() << " bytes but should be "
+            << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
+            throw GiftiException(AString::fromStdString(str.str()));
+        }
+        DataCompressZLib compressor;
+        const uint64_t uncompressedDataLength =
+        compressor.uncompressData(&decoder.compressedData[0],
+                                  decoder.bytesDecoded,
+                                  (unsigned char*)&data[0],
+                                  data.size());
+        if (uncompressedDataLength != data.size()) {
+            std::ostringstream str;
+            str << "Decompression of Binary data failed.\n"
+            << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
+            << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
+            throw GiftiException(AString::fromStdString(str.str()));
+        }
+    }
+    else {
+        if (decoder.bytesDecoded != static_cast<int64_t>(data.size())) {
+            std::ostringstream str;
+            str << "Decoding of Base64 Binary data failed.\n"
+            << "Decoded " << AString::number(decoder.bytesDecoded).toStdString() << " bytes but should be "
+            << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
+            throw GiftiException(AString::fromStdString(str.str()));
+        }
+    }
+    m_textDecoder.grabNew(NULL);
+    
+    //
+    // Is byte swapping needed ?
+    //
+    if (endian != getSystemEndian()) {
+        byteSwapData(getSystemEndian());
+    }
+}
+
+/**
+ * Finish incremental decoding: decompress, byte swap, and convert the
+ * data type and indexing order.  Only touches this data array, so
+ * different data arrays may be finished in parallel.
+ */
+void
+GiftiDataArray::finishDecodingText()
+{
+    CaretAssert(m_textDecoder != NULL);
+    const NiftiDataTypeEnum::Enum requiredDataType = m_textDecoder->requiredDataType;
+    finishDecodingBinary();
+    convertAfterReading(requiredDataType,
+                        arraySubscriptingOrder);
+    setModified();
+}
+
 /**
  * convert array indexing order of data.
  */
@@ -1015,6 +1274,7 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
                            GiftiEncodingEnum::Enum encodingForWriting) 
                                                
 {
+    ensureDataLoaded();
     this->encoding = encodingForWriting;
     
     //
@@ -1265,6 +1525,7 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
 void 
 GiftiDataArray::convertToDataType(const NiftiDataTypeEnum::Enum newDataType)
 {
+   ensureDataLoaded();
    if (newDataType != dataType) {      
       //
       // make a copy of myself
@@ -1433,6 +1694,7 @@ GiftiDataArray::isModified() const
 void 
 GiftiDataArray::getMinMaxValues(int& minValue, int& maxValue) const
 {
+   ensureDataLoaded();
    if (minMaxIntValuesValid == false) {
       minValueInt = std::numeric_limits<int32_t>::max();
       minValueInt = std::numeric_limits<int32_t>::min();
@@ -1460,6 +1722,7 @@ void
 GiftiDataArray::getMinMaxValuesFloat(float& minValue,
                           float& maxValue) const
 {
+    ensureDataLoaded();
     if (minMaxFloatValuesValid == false) {
         minValueFloat =  std::numeric_limits<float>::max();
         maxValueFloat = -std::numeric_limits<float>::max();
@@ -1482,6 +1745,7 @@ GiftiDataArray::getMinMaxValuesFloat(float& minValue,
 void 
 GiftiDataArray::zeroize()
 {
+   ensureDataLoaded();
    if (data.empty() == false) {
       std::fill(data.begin(), data.end(), 0);
    }
@@ -1523,6 +1787,7 @@ GiftiDataArray::getDataOffset(const int32_t indices[]) const
 float 
 GiftiDataArray::getDataFloat32(const int32_t indices[]) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    return dataPointerFloat[offset];
 }
@@ -1533,6 +1798,7 @@ GiftiDataArray::getDataFloat32(const int32_t indices[]) const
 const float* 
 GiftiDataArray::getDataFloat32Pointer(const int32_t indices[]) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    return &dataPointerFloat[offset];
 }
@@ -1543,6 +1809,7 @@ GiftiDataArray::getDataFloat32Pointer(const int32_t indices[]) const
 int32_t 
 GiftiDataArray::getDataInt32(const int32_t indices[]) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    return dataPointerInt[offset];
 }
@@ -1553,6 +1820,7 @@ GiftiDataArray::getDataInt32(const int32_t indices[]) const
 const int32_t* 
 GiftiDataArray::getDataInt32Pointer(const int32_t indices[]) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    return &dataPointerInt[offset];
 }
@@ -1563,6 +1831,7 @@ GiftiDataArray::getDataInt32Pointer(const int32_t indices[]) const
 uint8_t 
 GiftiDataArray::getDataUInt8(const int32_t indices[]) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    return dataPointerUByte[offset];
 }
@@ -1573,6 +1842,7 @@ GiftiDataArray::getDataUInt8(const int32_t indices[]) const
 const uint8_t*
 GiftiDataArray::getDataUInt8Pointer(const int32_t indices[]) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    return &dataPointerUByte[offset];
 }
@@ -1583,6 +1853,7 @@ GiftiDataArray::getDataUInt8Pointer(const int32_t indices[]) const
 void 
 GiftiDataArray::setDataFloat32(const int32_t indices[], const float dataValue) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    dataPointerFloat[offset] = dataValue;
 }
@@ -1593,6 +1864,7 @@ GiftiDataArray::setDataFloat32(const int32_t indices[], const float dataValue) c
 void 
 GiftiDataArray::setDataInt32(const int32_t indices[], const int32_t dataValue) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    dataPointerInt[offset] = dataValue;
 }
@@ -1603,6 +1875,7 @@ GiftiDataArray::setDataInt32(const int32_t indices[], const int32_t dataValue) c
 void 
 GiftiDataArray::setDataUInt8(const int32_t indices[], const uint8_t dataValue) const
 {
+   ensureDataLoaded();
    const int64_t offset = getDataOffset(indices);
    dataPointerUByte[offset] = dataValue;
 }      
@@ -1702,6 +1975,7 @@ GiftiDataArray::getPaletteColorMapping() const
 const DescriptiveStatistics* 
 GiftiDataArray::getDescriptiveStatistics() const
 {
+    ensureDataLoaded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
         if (this->descriptiveStatistics == NULL) {
             this->descriptiveStatistics = new DescriptiveStatistics();
@@ -1714,6 +1988,7 @@ GiftiDataArray::getDescriptiveStatistics() const
 
 const FastStatistics* GiftiDataArray::getFastStatistics() const
 {
+    ensureDataLoaded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
         if (m_fastStatistics == NULL) {
             m_fastStatistics.grabNew(new FastStatistics());
@@ -1725,6 +2000,7 @@ const FastStatistics* GiftiDataArray::getFastStatistics() const
 
 const Histogram* GiftiDataArray::getHistogram(const int32_t numberOfBuckets) const
 {
+    ensureDataLoaded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
         bool updateHistogramFlag = false;
         if (m_histogram == NULL) {
@@ -1765,6 +2041,7 @@ GiftiDataArray::getDescriptiveStatistics(const float mostPositiveValueInclusive,
                                                       const float mostNegativeValueInclusive,
                                                       const bool includeZeroValues) const
 {
+    ensureDataLoaded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
         if (this->descriptiveStatisticsLimitedValues == NULL) {
             this->descriptiveStatisticsLimitedValues = new DescriptiveStatistics();
@@ -1787,6 +2064,7 @@ const Histogram* GiftiDataArray::getHistogram(const int32_t numberOfBuckets,
                                               const float mostNegativeValueInclusive,
                                               const bool includeZeroValues) const
 {
+    ensureDataLoaded();
     if (this->getDataType() == NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32) {
         bool updateHistogramFlag = false;
         if (m_histogramLimitedValues == NULL)
@@ -22,6 +22,7 @@
  */
 /*LICENSE_END*/
 
+#include <atomic>
 #include <map>
 #include <ostream>
 #include <AString.h>
@@ -29,6 +30,7 @@
 
 #include <stdint.h>
 
+#include "CaretMutex.h"
 #include "CaretObject.h"
 #include "CaretPointer.h"
 #include "DescriptiveStatistics.h"
@@ -36,6 +38,7 @@
 #include "GiftiArrayIndexingOrderEnum.h"
 #include "GiftiEncodingEnum.h"
 #include "GiftiEndianEnum.h"
+#include "GiftiExternalDataFile.h"
 #include "GiftiLabelTable.h"
 #include "GiftiMetaData.h"
 #include "Histogram.h"
@@ -95,7 +98,7 @@ namespace caret {
         std::vector<int64_t> getDimensions() const { return dimensions; }
         
         /// current size of the data (in bytes)
-        int64_t getDataSizeInBytes() const { return data.size(); }
+        int64_t getDataSizeInBytes() const { ensureDataLoaded(); return data.size(); }
         
         /// get a dimension
         int32_t getDimension(const int32_t dimIndex) const { return dimensions[dimIndex]; }
@@ -123,6 +126,38 @@ namespace caret {
                           const int64_t externalFileOffsetForReading,
                           const bool isReadOnlyMetaData);
         
+        // start decoding base64 (optionally zlib compressed) data incrementally, as the XML parser delivers it
+        void startDecodingText(const GiftiEndianEnum::Enum dataEndianForReading,
+                               const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                               const NiftiDataTypeEnum::Enum dataTypeForReading,
+                               const std::vector<int64_t>& dimensionsForReading,
+                               const GiftiEncodingEnum::Enum encodingForReading);
+        
+        // decode the next piece of the data text, the text may be split anywhere
+        void decodeTextChunk(const char* text,
+                             const int64_t length);
+        
+        // finish decoding (decompress, byte swap, convert), may be called on different arrays in parallel
+        void finishDecodingText();
+        
+        /// true after startDecodingText, until finishDecodingText
+        bool isDecodingText() const { return (m_textDecoder != NULL); }
+        
+        // read the data from an external binary file, or if deferred, only record where it is
+        void readFromExternalFile(const CaretPointer<GiftiExternalDataFile>& externalFile,
+                                  const int64_t externalFileOffsetForReading,
+                                  const GiftiEndianEnum::Enum dataEndianForReading,
+                                  const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                  const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                  const std::vector<int64_t>& dimensionsForReading,
+                                  const bool deferLoadingData);
+        
+        /// false while the data is still deferred in an external binary file
+        bool isDataLoaded() const { return m_dataLoaded.load(std::memory_order_acquire); }
+        
+        /// read the data now if it is deferred in an external binary file (thread safe)
+        void ensureDataLoaded() const { if (!m_dataLoaded.load(std::memory_order_acquire)) loadDeferredExternalData(); }
+        
         // write the data as XML
         void writeAsXML(std::ostream& stream, 
                         std::ostream* externalBinaryOutputStream,
@@ -208,22 +243,22 @@ namespace caret {
         void setArraySubscriptingOrder(const GiftiArrayIndexingOrderEnum::Enum aso) { arraySubscriptingOrder = aso; }
         
         /// get pointer for floating point data (valid only if data type is FLOAT)
-        float* getDataPointerFloat() { return dataPointerFloat; }
+        float* getDataPointerFloat() { ensureDataLoaded(); return dataPointerFloat; }
         
         /// get pointer for floating point data (const method) (valid only if data type is FLOAT)
-        const float* getDataPointerFloat() const { return dataPointerFloat; }
+        const float* getDataPointerFloat() const { ensureDataLoaded(); return dataPointerFloat; }
         
         /// get pointer for integer data (valid only if data type is INT)
-        int32_t* getDataPointerInt() { return dataPointerInt; }
+        int32_t* getDataPointerInt() { ensureDataLoaded(); return dataPointerInt; }
         
         /// get pointer for integer data (const method) (valid only if data type is INT)
-        const int32_t* getDataPointerInt() const { return dataPointerInt; }
+        const int32_t* getDataPointerInt() const { ensureDataLoaded(); return dataPointerInt; }
         
         /// get pointer for unsigned byte data (valid only if data type is UBYTE)
-        uint8_t* getDataPointerUByte() { return dataPointerUByte; }
+        uint8_t* getDataPointerUByte() { ensureDataLoaded(); return dataPointerUByte; }
         
         /// get pointer for unsigned byte data (const method) (valid only if data type is UBYTE)
-        const uint8_t* getDataPointerUByte() const { return dataPointerUByte; }
+        const uint8_t* getDataPointerUByte() const { ensureDataLoaded(); return dataPointerUByte; }
         
         // set all elements of array to zero
         void zeroize();
@@ -324,6 +359,54 @@ namespace caret {
         /// convert array indexing order of data
         void convertArrayIndexingOrder();
         
+        // decompress and byte swap the decoded text
+        void finishDecodingBinary();
+        
+        // convert data type and indexing order after reading
+        void convertAfterReading(const NiftiDataTypeEnum::Enum requiredDataType,
+                                 const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading);
+        
+        /// state of incremental base64 decoding
+        struct TextDecoder {
+            TextDecoder(const NiftiDataTypeEnum::Enum requiredDataTypeIn) {
+                requiredDataType = requiredDataTypeIn;
+                bytesDecoded = 0;
+                quadCount = 0;
+                paddingCount = 0;
+            }
+            NiftiDataTypeEnum::Enum requiredDataType;
+            std::vector<uint8_t> compressedData;//only used for GZIP_BASE64_BINARY
+            int64_t bytesDecoded;
+            uint8_t quad[4];
+            int quadCount;
+            int paddingCount;
+        };
+        
+        /// text decoding in progress, DO NOT COPY
+        CaretPointer<TextDecoder> m_textDecoder;
+        
+        // read the deferred data from the external binary file
+        void loadDeferredExternalData() const;
+        
+        /// where to find data that has not been read from an external binary file
+        struct DeferredExternalData {
+            CaretPointer<GiftiExternalDataFile> externalFile;
+            int64_t offset;
+            GiftiEndianEnum::Enum endian;
+            GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrder;
+            NiftiDataTypeEnum::Enum dataTypeInFile;
+            NiftiDataTypeEnum::Enum requiredDataType;
+        };
+        
+        /// deferred external data, NULL once the data is loaded, only accessed with the mutex held (DO NOT COPY, copies load the data instead)
+        CaretPointer<DeferredExternalData> m_deferredExternalData;
+        
+        /// false while m_deferredExternalData is set, stored with release after the loaded data is in place, so the data is visible to any thread that reads true
+        mutable std::atomic<bool> m_dataLoaded;
+        
+        /// serializes loading of deferred data (DO NOT COPY)
+        mutable CaretMutex m_deferredExternalDataMutex;
+        
         /// the data
         std::vector<uint8_t> data;
         
@@ -0,0 +1,143 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstring>
+
+#include "DataFileException.h"
+#include "GiftiException.h"
+#include "GiftiExternalDataFile.h"
+
+using namespace caret;
+
+/**
+ * \class GiftiExternalDataFile
+ * \brief Memory mapped external binary file of GIFTI data arrays.
+ *
+ * All data arrays stored in the same external file share one instance,
+ * so the file is opened and mapped only once, and data arrays may copy
+ * their data out of it when (and if) the data is first needed.
+ *
+ * The mapping stays valid if the file is replaced: GiftiFileWriter
+ * removes existing external files before writing new ones, so the old
+ * contents live on until the mapping is closed.  Rewriting the file in
+ * place is not safe, read() checks for truncation before copying.
+ */
+
+/**
+ * Constructor.
+ *
+ * @param filename
+ *    Name of the external binary file.
+ * @throws GiftiException
+ *    If the file cannot be opened.
+ */
+GiftiExternalDataFile::GiftiExternalDataFile(const AString& filename)
+{
+    m_filename = filename;
+    m_memoryMap = NULL;
+    m_fileSize = 0;
+    if (filename.isEmpty()) {
+        throw GiftiException("External file name is empty.");
+    }
+    try {
+        m_file.open(filename, CaretBinaryFile::READ_MEMORY_MAP);
+        m_memoryMap = m_file.getMemoryMap();
+        if (m_memoryMap != NULL) {
+            m_fileSize = m_file.getMemoryMapSize();
+        }
+        else {
+            m_fileSize = m_file.size();
+        }
+    }
+    catch (const DataFileException& e) {
+        throw GiftiException("Error opening \""
+                             + filename
+                             + "\": "
+                             + e.whatString());
+    }
+}
+
+/**
+ * Copy bytes from the file.  May be called from multiple threads.
+ *
+ * @param offset
+ *    Offset of the first byte in the file.
+ * @param numberOfBytes
+ *    Number of bytes to copy.
+ * @param dataOut
+ *    Output, must have room for numberOfBytes.
+ * @throws GiftiException
+ *    If the requested bytes are not in the file.
+ */
+void
+GiftiExternalDataFile::read(const int64_t offset,
+                            const int64_t numberOfBytes,
+                            void* dataOut) const
+{
+    if ((offset < 0)
+        || (numberOfBytes < 0)
+        || ((m_fileSize >= 0) && (offset + numberOfBytes > m_fileSize))) {
+        throw GiftiException("Tried to read "
+                             + AString::number(numberOfBytes)
+                             + " bytes from offset "
+                             + AString::number(offset)
+                             + " in \""
+                             + m_filename
+                             + "\" which contains "
+                             + AString::number(m_fileSize)
+                             + " bytes");
+    }
+    if (numberOfBytes == 0) {
+        return;
+    }
+
+    if (m_memoryMap != NULL) {
+        //
+        // Touching mapped pages past the end of a file that was truncated
+        // in place would raise SIGBUS, so check the open file's current size
+        //
+        int64_t currentSize = -1;
+        {
+            CaretMutexLocker locked(&m_fileMutex);
+            try {
+                currentSize = m_file.size();
+            }
+            catch (const DataFileException& e) {
+                throw GiftiException(e.whatString());
+            }
+        }
+        if ((currentSize >= 0) && (offset + numberOfBytes > currentSize)) {
+            throw GiftiException("External file \""
+                                 + m_filename
+                                 + "\" was truncated after it was opened");
+        }
+        memcpy(dataOut, m_memoryMap + offset, numberOfBytes);
+        return;
+    }
+
+    CaretMutexLocker locked(&m_fileMutex);
+    try {
+        m_file.seek(offset);
+        m_file.read(dataOut, numberOfBytes);
+    }
+    catch (const DataFileException& e) {
+        throw GiftiException(e.whatString());
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef __GIFTI_EXTERNAL_DATA_FILE_H__
+#define __GIFTI_EXTERNAL_DATA_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+#include "AString.h"
+#include "CaretBinaryFile.h"
+#include "CaretMutex.h"
+
+namespace caret {
+
+    /// Read-only, memory mapped access to the external binary file of GIFTI data arrays
+    class GiftiExternalDataFile {
+
+    public:
+        // open and memory map the file
+        GiftiExternalDataFile(const AString& filename);
+
+        // copy bytes from the file (thread safe)
+        void read(const int64_t offset,
+                  const int64_t numberOfBytes,
+                  void* dataOut) const;
+
+        /// get name of the file
+        const AString& getFileName() const { return m_filename; }
+
+        /// true if the file is memory mapped (otherwise reads use seek/read)
+        bool isMemoryMapped() const { return (m_memoryMap != NULL); }
+
+    private:
+        GiftiExternalDataFile(const GiftiExternalDataFile&);
+
+        GiftiExternalDataFile& operator=(const GiftiExternalDataFile&);
+
+        /// name of the file
+        AString m_filename;
+
+        /// the file, mutable since reads without a mapping move the file position
+        mutable CaretBinaryFile m_file;
+
+        /// protects the file position when not memory mapped
+        mutable CaretMutex m_fileMutex;
+
+        /// the memory map, NULL if mapping failed
+        const char* m_memoryMap;
+
+        /// size of the file in bytes
+        int64_t m_fileSize;
+    };
+
+} // namespace
+
+#endif // __GIFTI_EXTERNAL_DATA_FILE_H__
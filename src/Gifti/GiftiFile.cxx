@@ -56,6 +56,7 @@ GiftiFile::GiftiFile(const AString& descriptiveName,
     this->defaultExtension = defaultExtension;
    numberOfNodesForSparseNodeIndexFile = 0;
     this->encodingForWriting = GiftiFile::defaultEncodingForWriting;
+    this->deferExternalDataLoading = false;
 }
 
 /**
@@ -71,6 +72,7 @@ GiftiFile::GiftiFile()
     numberOfNodesForSparseNodeIndexFile = 0;
     this->defaultExtension = ".gii";
     this->encodingForWriting = GiftiFile::defaultEncodingForWriting;
+    this->deferExternalDataLoading = false;
 }
 
 /**
@@ -118,6 +120,7 @@ GiftiFile::copyHelperGiftiFile(const GiftiFile& nndf)
       addDataArray(new GiftiDataArray(*nndf.dataArrays[i]));
    }
     this->encodingForWriting = nndf.encodingForWriting;
+    this->deferExternalDataLoading = nndf.deferExternalDataLoading;
 }
       
 /**
@@ -902,6 +905,15 @@ GiftiFile::writeFile(const AString& filename)
             //}
         }
         
+        //
+        // Data arrays may still be deferred in external binary files
+        // that the writer is about to replace, so read them first
+        //
+        int numberOfDataArrays = this->getNumberOfDataArrays();
+        for (int i = 0; i < numberOfDataArrays; i++) {
+            this->getDataArray(i)->ensureDataLoaded();
+        }
+        
         //
         // Create a GIFTI Data Array File Writer
         //
@@ -911,7 +923,6 @@ GiftiFile::writeFile(const AString& filename)
         //
         // Start writing the file
         //
-        int numberOfDataArrays = this->getNumberOfDataArrays();
         giftiFileWriter.start(numberOfDataArrays,
                               &this->metaData,
                               &this->labelTable);
@@ -186,6 +186,12 @@ class GiftiFile : public DataFile {
     
     bool getReadMetaDataOnlyFlag() const { return false; }
     
+    /// @return True if data arrays in external binary files are not read until their data is used.
+    bool getDeferExternalDataLoadingFlag() const { return this->deferExternalDataLoading; }
+    
+    /// set data arrays in external binary files to be read when their data is first used
+    void setDeferExternalDataLoadingFlag(const bool deferFlag) { this->deferExternalDataLoading = deferFlag; }
+    
     /** @return The encoding used to write the file. */
     GiftiEncodingEnum::Enum getEncodingForWriting() const { return this->encodingForWriting; }
     
@@ -224,6 +230,9 @@ class GiftiFile : public DataFile {
       
       GiftiEncodingEnum::Enum encodingForWriting;
     
+      /// read data arrays in external binary files only when their data is used
+      bool deferExternalDataLoading;
+    
       /// the default data type
       NiftiDataTypeEnum::Enum defaultDataType;
       
@@ -18,9 +18,11 @@
  */
 /*LICENSE_END*/
 
+#include <cstring>
 #include <sstream>
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FileInformation.h"
 #include "GiftiEndianEnum.h"
 #include "GiftiLabel.h"
@@ -138,6 +140,25 @@ GiftiFileSaxReader::startElement(const AString& namespaceURI,
          }
          else if (qName == GiftiXmlElements::TAG_DATA) {
             this->state = STATE_DATA_ARRAY_DATA;
+            
+            /*
+             * Base64 data is decoded as the characters arrive,
+             * rather than accumulating the text of the element
+             */
+            if (((encodingForReadingArrayData == GiftiEncodingEnum::BASE64_BINARY)
+                 || (encodingForReadingArrayData == GiftiEncodingEnum::GZIP_BASE64_BINARY))
+                && (this->giftiFile->getReadMetaDataOnlyFlag() == false)) {
+                try {
+                    dataArray->startDecodingText(this->endianForReadingArrayData,
+                                                 arraySubscriptingOrderForReadingArrayData,
+                                                 dataTypeForReadingArrayData,
+                                                 dimensionsForReadingArrayData,
+                                                 encodingForReadingArrayData);
+                }
+                catch (const GiftiException& e) {
+                    throw XmlSaxParserException(e.whatString());
+                }
+            }
          }
          else if (qName == GiftiXmlElements::TAG_COORDINATE_TRANSFORMATION_MATRIX) {
             this->state = STATE_DATA_ARRAY_MATRIX;
@@ -515,7 +536,35 @@ GiftiFileSaxReader::processArrayData()
     this->dataArrayDataHasBeenRead = true;
 
     CaretAssert(dataArray);
+    if (dataArray->isDecodingText()) {
+        /*
+         * Decompression and conversion are done for all
+         * data arrays in parallel at the end of the document
+         */
+        this->dataArraysToFinish.push_back(dataArray);
+        return;
+    }
     try {
+        if ((this->encodingForReadingArrayData == GiftiEncodingEnum::EXTERNAL_FILE_BINARY)
+            && (this->giftiFile->getReadMetaDataOnlyFlag() == false)) {
+            /*
+             * Each external file is opened and memory mapped once,
+             * data arrays copy their data out of the mapping, possibly
+             * not until the data is used
+             */
+            CaretPointer<GiftiExternalDataFile>& externalFile = this->externalDataFiles[this->externalFileNameForReadingData];
+            if (externalFile == NULL) {
+                externalFile.grabNew(new GiftiExternalDataFile(this->externalFileNameForReadingData));
+            }
+            dataArray->readFromExternalFile(externalFile,
+                                            externalFileOffsetForReadingData,
+                                            this->endianForReadingArrayData,
+                                            arraySubscriptingOrderForReadingArrayData,
+                                            dataTypeForReadingArrayData,
+                                            dimensionsForReadingArrayData,
+                                            this->giftiFile->getDeferExternalDataLoadingFlag());
+            return;
+        }
         dataArray->readFromText(elementText,
                                 this->endianForReadingArrayData,
                                 arraySubscriptingOrderForReadingArrayData,
@@ -543,6 +592,17 @@ GiftiFileSaxReader::characters(const char* ch)
     else if (this->labelTableSaxReader != NULL) {
         this->labelTableSaxReader->characters(ch);
     }
+    else if ((this->state == STATE_DATA_ARRAY_DATA)
+             && (dataArray != NULL)
+             && dataArray->isDecodingText()) {
+        try {
+            dataArray->decodeTextChunk(ch,
+                                       strlen(ch));
+        }
+        catch (const GiftiException& e) {
+            throw XmlSaxParserException(e.whatString());
+        }
+    }
     else {
         elementText += ch;
     }
@@ -594,5 +654,25 @@ GiftiFileSaxReader::startDocument()
 void 
 GiftiFileSaxReader::endDocument()
 {
+    /*
+     * Decompress and convert the data arrays in parallel
+     * (for metric files, there is one data array per map)
+     */
+    const int64_t numArrays = static_cast<int64_t>(this->dataArraysToFinish.size());
+    AString finishErrorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numArrays; i++) {
+        try {
+            this->dataArraysToFinish[i]->finishDecodingText();
+        }
+        catch (const GiftiException& e) {
+#pragma omp critical
+            finishErrorMessage = e.whatString();
+        }
+    }
+    this->dataArraysToFinish.clear();
+    if (finishErrorMessage.isEmpty() == false) {
+        throw XmlSaxParserException(finishErrorMessage);
+    }
 }
 
@@ -22,7 +22,9 @@
  */
 /*LICENSE_END*/
 
+#include <map>
 #include <stack>
+#include <vector>
 #include <AString.h>
 #include <stdint.h>
 
@@ -30,6 +32,7 @@
 #include "GiftiArrayIndexingOrderEnum.h"
 #include "GiftiEndianEnum.h"
 #include "GiftiEncodingEnum.h"
+#include "GiftiExternalDataFile.h"
 #include "NiftiEnums.h"
 #include "XmlSaxParserException.h"
 #include "XmlSaxParserHandlerInterface.h"
@@ -162,6 +165,12 @@ namespace caret {
         
         /// tracks if data has been read since external binary may not have DATA tag
         bool dataArrayDataHasBeenRead;
+        
+        /// data arrays whose text has been decoded, but still need to be decompressed and converted (owned by the GIFTI file)
+        std::vector<GiftiDataArray*> dataArraysToFinish;
+        
+        /// external binary files opened while reading, shared by the data arrays stored in them
+        std::map<AString, CaretPointer<GiftiExternalDataFile> > externalDataFiles;
     };
 
 } // namespace
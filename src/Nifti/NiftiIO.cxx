@@ -27,7 +27,7 @@ using namespace caret;
 
 void NiftiIO::openRead(const QString& filename)
 {
-    m_file.open(filename);
+    m_file.open(filename, CaretBinaryFile::READ_MEMORY_MAP);//uncompressed files get mapped, so that readData doesn't need the mutex
     m_header.read(m_file);
     if (m_header.getDataType() == DT_BINARY)
     {
@@ -108,3 +108,27 @@ int NiftiIO::numBytesPerElem()
             throw DataFileException("internal error, report what you did to the developers");
     }
 }
+
+void NiftiIO::swapRaw(char* data, const int64_t& numElems)
+{
+    switch (numBytesPerElem())//swapping only depends on the element size, components get swapped individually
+    {
+        case 1:
+            break;
+        case 2:
+            ByteSwapping::swapArray((uint16_t*)data, numElems);
+            break;
+        case 4:
+            ByteSwapping::swapArray((uint32_t*)data, numElems);
+            break;
+        case 8:
+            ByteSwapping::swapArray((uint64_t*)data, numElems);
+            break;
+        case 16:
+            ByteSwapping::swapArray((long double*)data, numElems);
+            break;
+        default:
+            CaretAssert(0);
+            throw DataFileException("internal error, report what you did to the developers");
+    }
+}
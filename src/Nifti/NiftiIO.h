@@ -45,8 +45,11 @@ namespace caret
         std::vector<char> m_scratch;//scratch memory for byteswapping, type conversion, etc
         CaretMutex m_mutex;//protect multithreaded calls from each other
         int numBytesPerElem();//for resizing scratch
+        void swapRaw(char* data, const int64_t& numElems);//byteswap raw file data in place, according to the datatype
+        template<typename T>
+        void convertReadRaw(T* dataOut, const char* in, const int64_t& numElems);//in must already be native byte order
         template<typename TO, typename FROM>
-        void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
+        void convertRead(TO* out, const FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
         void convertWrite(TO* out, const FROM* in, const int64_t& count);//for writing to file
         template<typename TO, typename FROM>
@@ -55,6 +58,7 @@ namespace caret
         void openRead(const QString& filename);
         void writeNew(const QString& filename, const NiftiHeader& header, const int& version = 1, const bool& withRead = false, const bool& swapEndian = false);
         QString getFilename() const { return m_file.getFilename(); }
+        bool isMemoryMapped() const { return m_file.getMemoryMap() != NULL; }//if true, reads don't lock, so concurrent reads are worthwhile
         void overrideDimensions(const std::vector<int64_t>& newDims) { m_dims = newDims; }//HACK: deal with reading/writing CIFTI-1's broken headers
         void close();
         const NiftiHeader& getHeader() const { return m_header; }
@@ -66,6 +70,9 @@ namespace caret
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        //read a contiguous range of the data array by flat element index (counting components separately), for reading part of a row
+        template<typename T>
+        void readElements(T* dataOut, const int64_t& firstElement, const int64_t& numElements, const bool& tolerateShortRead = false);
     };
     
     template<typename T>
@@ -86,55 +93,85 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        readElements(dataOut, numSkip, numElems, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readElements(T* dataOut, const int64_t& firstElement, const int64_t& numElements, const bool& tolerateShortRead)
+    {
+        CaretAssert(firstElement >= 0 && numElements >= 0);
+        const int64_t numBytes = numElements * numBytesPerElem();
+        const int64_t byteOffset = firstElement * numBytesPerElem() + m_header.getDataOffset();
+        const char* mapped = m_file.getMemoryMap();
+        if (mapped != NULL && byteOffset + numBytes <= m_file.getMemoryMapSize())
+        {//lock-free path: the mapping is read-only and shared, so we never modify it, and we don't touch m_scratch
+            const char* source = mapped + byteOffset;
+            if (m_header.isSwapped() || (size_t)source % numBytesPerElem() != 0)
+            {//need a private copy to swap in, or to get aligned elements
+                std::vector<char> localScratch(source, source + numBytes);
+                if (m_header.isSwapped()) swapRaw(localScratch.data(), numElements);
+                convertReadRaw(dataOut, localScratch.data(), numElements);
+            } else {
+                convertReadRaw(dataOut, source, numElements);//only one copy, straight from the page cache into the output
+            }
+            return;
+        }//otherwise, fall through to the normal file reading, which also deals with short reads
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done converting, because we use an internal variable for scratch space
         //we can't guarantee that the output memory is enough to use as scratch space, as we might be doing a narrowing conversion
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
-        m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        m_scratch.resize(numBytes);
+        m_file.seek(byteOffset);
         int64_t numRead = 0;
         m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
         if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
         {
             throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
         }
+        if (m_header.isSwapped()) swapRaw(m_scratch.data(), numElements);
+        convertReadRaw(dataOut, m_scratch.data(), numElements);
+    }
+    
+    template<typename T>
+    void NiftiIO::convertReadRaw(T* dataOut, const char* in, const int64_t& numElems)
+    {
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
             case NIFTI_TYPE_RGB24://handled by components
-                convertRead(dataOut, (uint8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const uint8_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT8:
-                convertRead(dataOut, (int8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const int8_t*)in, numElems);
                 break;
             case NIFTI_TYPE_UINT16:
-                convertRead(dataOut, (uint16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const uint16_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT16:
-                convertRead(dataOut, (int16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const int16_t*)in, numElems);
                 break;
             case NIFTI_TYPE_UINT32:
-                convertRead(dataOut, (uint32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const uint32_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT32:
-                convertRead(dataOut, (int32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const int32_t*)in, numElems);
                 break;
             case NIFTI_TYPE_UINT64:
-                convertRead(dataOut, (uint64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const uint64_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT64:
-                convertRead(dataOut, (int64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const int64_t*)in, numElems);
                 break;
             case NIFTI_TYPE_FLOAT32:
             case NIFTI_TYPE_COMPLEX64://components
-                convertRead(dataOut, (float*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const float*)in, numElems);
                 break;
             case NIFTI_TYPE_FLOAT64:
             case NIFTI_TYPE_COMPLEX128:
-                convertRead(dataOut, (double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const double*)in, numElems);
                 break;
             case NIFTI_TYPE_FLOAT128:
             case NIFTI_TYPE_COMPLEX256:
-                convertRead(dataOut, (long double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (const long double*)in, numElems);
                 break;
             default:
                 CaretAssert(0);
@@ -211,12 +248,8 @@ namespace caret
     }
     
     template<typename TO, typename FROM>
-    void NiftiIO::convertRead(TO* out, FROM* in, const int64_t& count)
+    void NiftiIO::convertRead(TO* out, const FROM* in, const int64_t& count)
     {
-        if (m_header.isSwapped())
-        {
-            ByteSwapping::swapArray(in, count);
-        }
         double mult, offset;
         bool doScale = m_header.getDataScaling(mult, offset);
         if (std::numeric_limits<TO>::is_integer)//do round to nearest when integer output type
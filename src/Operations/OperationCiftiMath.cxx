@@ -24,10 +24,12 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "CiftiXML.h"
 #include "MultiDimIterator.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
@@ -235,7 +237,7 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
+    const int64_t rowLength = outDims[0];
     vector<vector<float> > inputRows(numVars);
     vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
     for (int v = 0; v < numVars; ++v)
@@ -243,49 +245,75 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
         inputRows[v].resize(varCiftiFiles[v]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
         loadedRow[v].resize(varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions() - 1, -1);//we always load a full row, so ignore first dim
     }
-    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    //evaluate several output rows in parallel, but don't let the batch get too big for huge rows (dconn)
+    int batchSize = (int)min((int64_t)64, (int64_t)(1<<24) / (rowLength * (numVars + 1)));
+    if (batchSize < 1) batchSize = 1;
+    vector<vector<vector<float> > > batchInputs(batchSize, vector<vector<float> >(numVars, vector<float>(rowLength)));
+    vector<vector<float> > batchOutputs(batchSize, vector<float>(rowLength));
+    vector<vector<int64_t> > batchIndices(batchSize);
+    MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end()));
+    while (!iter.atEnd())
     {
-        for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
+        int batchUsed = 0;
+        for (; batchUsed < batchSize && !iter.atEnd(); ++batchUsed, ++iter)
         {
-            bool needToLoad = false;
-            for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
+            for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
             {
-                int64_t indexNeeded = -1;
-                if (selectInfo[v][dim + 1] == -1)
+                bool needToLoad = false;
+                for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
                 {
-                    CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
-                    indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
-                } else {
-                    indexNeeded = selectInfo[v][dim + 1];
+                    int64_t indexNeeded = -1;
+                    if (selectInfo[v][dim + 1] == -1)
+                    {
+                        CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
+                        indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
+                    } else {
+                        indexNeeded = selectInfo[v][dim + 1];
+                    }
+                    if (indexNeeded != loadedRow[v][dim])
+                    {
+                        needToLoad = true;
+                        loadedRow[v][dim] = indexNeeded;
+                    }
                 }
-                if (indexNeeded != loadedRow[v][dim])
+                if (needToLoad)
                 {
-                    needToLoad = true;
-                    loadedRow[v][dim] = indexNeeded;
+                    varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                }
+                vector<float>& batchRow = batchInputs[batchUsed][v];
+                if (selectInfo[v][0] == -1)//now we check for select along row
+                {
+                    batchRow = inputRows[v];
+                } else {
+                    batchRow.assign(rowLength, inputRows[v][selectInfo[v][0]]);
                 }
             }
-            if (needToLoad)
-            {
-                varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
-            }
+            batchIndices[batchUsed] = *iter;
         }
-        for (int j = 0; j < outDims[0]; ++j)
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int b = 0; b < batchUsed; ++b)
         {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            vector<const float*> rowPointers(numVars);
+            for (int v = 0; v < numVars; ++v)
             {
-                if (selectInfo[v][0] == -1)
-                {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
-                }
+                rowPointers[v] = batchInputs[b][v].data();
             }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
+            float* scratchRow = batchOutputs[b].data();
+            myExpr.evaluateArrays(rowPointers, scratchRow, rowLength);
+            if (nanfix)
             {
-                scratchRow[j] = nanfixval;
+                for (int64_t j = 0; j < rowLength; ++j)
+                {
+                    if (scratchRow[j] != scratchRow[j])
+                    {
+                        scratchRow[j] = nanfixval;
+                    }
+                }
             }
         }
-        myCiftiOut->setRow(scratchRow.data(), *iter);
+        for (int b = 0; b < batchUsed; ++b)
+        {
+            myCiftiOut->setRow(batchOutputs[b].data(), batchIndices[b]);
+        }
     }
 }
@@ -22,6 +22,7 @@
 #include "OperationException.h"
 
 #include "CaretAssert.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 
@@ -140,7 +141,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
+    int64_t curCol = 0;
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -150,7 +151,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         int numColumnOpts = (int)columnOpts.size();
         if (numColumnOpts > 0)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
             if (doLoop)
             {
                 for (int j = 0; j < numColumnOpts; ++j)
@@ -256,53 +256,107 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     }
     ciftiOut->setCiftiXML(outXML);
     int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    //resolve the column selections once, rather than once per row
+    vector<vector<int64_t> > inputColumns(numInputs);//empty means use the entire row
+    vector<int64_t> outColStart(numInputs);
+    curCol = 0;
+    for (int i = 0; i < numInputs; ++i)
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
+        const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+        const CiftiXML& thisXML = ciftiIn->getCiftiXML();
+        const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
+        int numColumnOpts = (int)columnOpts.size();
+        outColStart[i] = curCol;
+        if (numColumnOpts > 0)
         {
-            const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            for (int j = 0; j < numColumnOpts; ++j)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
+                OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
+                if (upToOpt->m_present)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
+                    int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                    bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                    if (reverse)
                     {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
+                        for (int c = finalColumn; c >= initialColumn; --c)
                         {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
+                            inputColumns[i].push_back(c);
+                        }
+                    } else {
+                        for (int c = initialColumn; c <= finalColumn; ++c)
+                        {
+                            inputColumns[i].push_back(c);
+                        }
+                    }
+                } else {
+                    inputColumns[i].push_back(initialColumn);
+                }
+            }
+            curCol += (int64_t)inputColumns[i].size();
+        } else {
+            curCol += ciftiIn->getDimensions()[0];
+        }
+    }
+    CaretAssert(curCol == numOutColumns);
+    //stream the rows in blocks: each input is read sequentially by its own thread into one block buffer,
+    //while the previous block is written out sequentially from the other buffer
+    const int64_t BLOCK_BYTES = 64 * 1024 * 1024;
+    int64_t blockRows = max(int64_t(1), min(numRows, BLOCK_BYTES / int64_t(numOutColumns * sizeof(float))));
+    vector<float> blockBuffers[2];
+    blockBuffers[0].resize(blockRows * numOutColumns);
+    if (blockRows < numRows) blockBuffers[1].resize(blockRows * numOutColumns);
+    int64_t numBlocks = (numRows + blockRows - 1) / blockRows;
+    for (int64_t block = 0; block <= numBlocks; ++block)//one extra iteration to write the last block
+    {
+        AString errorMessage;
+        bool hadError = false;
+#pragma omp CARET_PARFOR schedule(dynamic, 1)
+        for (int task = 0; task <= numInputs; ++task)
+        {
+            try
+            {
+                if (task == numInputs)
+                {//writer, for the previous block
+                    if (block == 0) continue;
+                    const int64_t writeStart = (block - 1) * blockRows, writeEnd = min(numRows, writeStart + blockRows);
+                    const float* writeBuffer = blockBuffers[(block - 1) % 2].data();
+                    for (int64_t row = writeStart; row < writeEnd; ++row)
+                    {
+                        ciftiOut->setRow(writeBuffer + (row - writeStart) * numOutColumns, row);
+                    }
+                } else {//reader for one input, for this block
+                    if (block == numBlocks) continue;
+                    const int64_t readStart = block * blockRows, readEnd = min(numRows, readStart + blockRows);
+                    float* readBuffer = blockBuffers[block % 2].data();
+                    const CiftiFile* ciftiIn = myInputs[task]->getCifti(1);
+                    const vector<int64_t>& thisColumns = inputColumns[task];
+                    vector<float> scratchRow;
+                    if (!thisColumns.empty()) scratchRow.resize(ciftiIn->getDimensions()[0]);
+                    for (int64_t row = readStart; row < readEnd; ++row)
+                    {
+                        float* outRow = readBuffer + (row - readStart) * numOutColumns + outColStart[task];
+                        if (thisColumns.empty())
+                        {
+                            ciftiIn->getRow(outRow, row);
                         } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
+                            ciftiIn->getRow(scratchRow.data(), row);
+                            int64_t numSelected = (int64_t)thisColumns.size();
+                            for (int64_t c = 0; c < numSelected; ++c)
                             {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
+                                outRow[c] = scratchRow[thisColumns[c]];
                             }
                         }
-                    } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
                     }
                 }
-            } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
+            } catch (CaretException& e) {
+#pragma omp critical
+                {
+                    if (!hadError) errorMessage = e.whatString();
+                    hadError = true;
+                }
             }
         }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
+        if (hadError) throw OperationException(errorMessage);
     }
 }
@@ -48,7 +48,10 @@ OperationParameters* OperationGiftiConvert::getParameters()
     
     ret->setHelpText(
         AString("The value of <gifti-encoding> must be one of the following:\n\n") +
-        "ASCII\nBASE64_BINARY\nGZIP_BASE64_BINARY\nEXTERNAL_FILE_BINARY"
+        "ASCII\nBASE64_BINARY\nGZIP_BASE64_BINARY\nEXTERNAL_FILE_BINARY\n\n" +
+        "EXTERNAL_FILE_BINARY writes the data to <output-gifti-file>.data, next to the XML file, which must be kept with it.  " +
+        "Metric files in this encoding are memory mapped when read, and each column is only read when it is first used, " +
+        "which is much faster for large files when only a few columns are needed."
     );
     return ret;
 }
@@ -21,6 +21,7 @@
 
 #include <cstdio>
 #include <fstream>
+#include <new>
 
 #ifdef HAVE_GLEW
 #include <GL/glew.h>
@@ -107,7 +108,7 @@ OperationShowScene::getParameters()
 
     ret->addIntegerParameter(5, "image-height", "height of output image(s)");
     
-    const QString windowSizeSwitch("-use-window-size");
+    const QString windowSizeSwitch(getUseWindowSizeSwitch());
     ret->createOptionalParameter(6, windowSizeSwitch, "Override image size with window size");
     
     ret->createOptionalParameter(7, "-no-scene-colors", "Do not use background and foreground colors in scene");
@@ -161,6 +162,46 @@ OperationShowScene::getParameters()
     return ret;
 }
 
+/**
+ * @return Switch for the option that overrides image size with window size
+ */
+AString
+OperationShowScene::getUseWindowSizeSwitch()
+{
+    return "-use-window-size";
+}
+
+/**
+ * Constructor.  The Mesa context is not created until it is needed.
+ */
+OperationShowScene::OffscreenContext::OffscreenContext()
+: m_mesaContext(NULL),
+m_brainOpenGL(NULL)
+{
+}
+
+/**
+ * Destructor.
+ */
+OperationShowScene::OffscreenContext::~OffscreenContext()
+{
+#ifdef HAVE_OSMESA
+    /*
+     * OpenGL must be destroyed prior to OSMesa, otherwise, errors
+     * will occur as the OpenGL context is invalid when things such as
+     * display lists or buffers are deleted.
+     */
+    if (m_brainOpenGL != NULL) {
+        delete m_brainOpenGL;
+        m_brainOpenGL = NULL;
+    }
+    if (m_mesaContext != NULL) {
+        OSMesaDestroyContext(static_cast<OSMesaContext>(m_mesaContext));
+        m_mesaContext = NULL;
+    }
+#endif // HAVE_OSMESA
+}
+
 /**
  * Use Parameters and perform operation
  */
@@ -172,7 +213,91 @@ OperationShowScene::useParameters(OperationParameters* /*myParams*/,
     throw OperationException("Show scene command not available due to this software version "
                              "not being built with the Mesa OffScreen Library");
 }
+
+void
+OperationShowScene::showScene(const AString& /*sceneFileName*/,
+                              const AString& /*sceneNameOrNumber*/,
+                              const AString& /*imageFileName*/,
+                              const int32_t /*userImageWidth*/,
+                              const int32_t /*userImageHeight*/,
+                              const bool /*useWindowSizeForImageSizeFlag*/,
+                              const bool /*doNotUseSceneColorsFlag*/,
+                              const MapYokingGroupEnum::Enum /*mapYokingGroup*/,
+                              const int32_t /*mapYokingMapIndex*/,
+                              OffscreenContext& /*offscreenContext*/)
+{
+    throw OperationException("Show scene command not available due to this software version "
+                             "not being built with the Mesa OffScreen Library");
+}
+
+void
+OperationShowScene::OffscreenContext::makeCurrent(const int32_t /*imageWidth*/,
+                                                  const int32_t /*imageHeight*/)
+{
+    throw OperationException("Show scene command not available due to this software version "
+                             "not being built with the Mesa OffScreen Library");
+}
 #else // HAVE_OSMESA
+/**
+ * Make the context current for rendering an image of the given size,
+ * creating the Mesa context and the OpenGL rendering if needed.
+ *
+ * @param imageWidth
+ *     Width of the image.
+ * @param imageHeight
+ *     Height of the image.
+ */
+void
+OperationShowScene::OffscreenContext::makeCurrent(const int32_t imageWidth,
+                                                  const int32_t imageHeight)
+{
+    //
+    // Create the Mesa Context
+    //
+    if (m_mesaContext == NULL) {
+        const int depthBits = 16;
+        const int stencilBits = 0;
+        const int accumBits = 0;
+        OSMesaContext mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
+                                                           depthBits,
+                                                           stencilBits,
+                                                           accumBits,
+                                                           NULL);
+        if (mesaContext == 0) {
+            throw OperationException("Creating Mesa Context failed.");
+        }
+        m_mesaContext = mesaContext;
+    }
+    
+    //
+    // Allocate image buffer
+    //
+    const int64_t imageBufferSize = static_cast<int64_t>(imageWidth) * imageHeight * 4 * sizeof(unsigned char);
+    try {
+        m_imageBuffer.resize(imageBufferSize);
+    }
+    catch (const std::bad_alloc&) {
+        throw OperationException("Allocating image buffer size="
+                                 + QString::number(imageBufferSize)
+                                 + " failed.");
+    }
+    
+    //
+    // Assign buffer to Mesa Context and make current
+    //
+    if (OSMesaMakeCurrent(static_cast<OSMesaContext>(m_mesaContext),
+                          &m_imageBuffer[0],
+                          GL_UNSIGNED_BYTE,
+                          imageWidth,
+                          imageHeight) == 0) {
+        throw OperationException("Assigning buffer to context and make current failed.");
+    }
+    
+    if (m_brainOpenGL == NULL) {
+        m_brainOpenGL = createBrainOpenGL();
+    }
+}
+
 void
 OperationShowScene::useParameters(OperationParameters* myParams,
                                   ProgressObject* myProgObj)
@@ -184,8 +309,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     const int32_t userImageWidth  = myParams->getInteger(4);
     const int32_t userImageHeight = myParams->getInteger(5);
     
-    OptionalParameter* useWindowSizeParam = myParams->getOptionalParameter(6);
-    const bool useWindowSizeForImageSizeFlag = useWindowSizeParam->m_present;
+    const bool useWindowSizeForImageSizeFlag = myParams->getOptionalParameter(6)->m_present;
     
     const bool doNotUseSceneColorsFlag = myParams->getOptionalParameter(7)->m_present;
     
@@ -211,6 +335,59 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         mapYokingMapIndex--;
     }
     
+    OffscreenContext offscreenContext;
+    showScene(sceneFileName,
+              sceneNameOrNumber,
+              imageFileName,
+              userImageWidth,
+              userImageHeight,
+              useWindowSizeForImageSizeFlag,
+              doNotUseSceneColorsFlag,
+              mapYokingGroup,
+              mapYokingMapIndex,
+              offscreenContext);
+}
+
+/**
+ * Restore a scene and render the content of its browser windows
+ * into image file(s).
+ *
+ * @param sceneFileName
+ *     Absolute name of scene file.
+ * @param sceneNameOrNumber
+ *     Name or number (starting at one) of the scene.
+ * @param imageFileName
+ *     Absolute name of the image file, an index is inserted into the
+ *     name if there is more than one window.
+ * @param userImageWidth
+ *     Width of the image.
+ * @param userImageHeight
+ *     Height of the image.
+ * @param useWindowSizeForImageSizeFlag
+ *     If true, use the window size from the scene, when available.
+ * @param doNotUseSceneColorsFlag
+ *     If true, do not use background and foreground colors in the scene.
+ * @param mapYokingGroup
+ *     Map yoking group for overriding the selected map index.
+ * @param mapYokingMapIndex
+ *     Selected map index (starting at zero) for the map yoking group.
+ * @param offscreenContext
+ *     Offscreen context used for rendering, may be reused for other scenes.
+ *     Files loaded for the previous scene that are also in this scene
+ *     are not read again.
+ */
+void
+OperationShowScene::showScene(const AString& sceneFileName,
+                              const AString& sceneNameOrNumber,
+                              const AString& imageFileName,
+                              const int32_t userImageWidth,
+                              const int32_t userImageHeight,
+                              const bool useWindowSizeForImageSizeFlag,
+                              const bool doNotUseSceneColorsFlag,
+                              const MapYokingGroupEnum::Enum mapYokingGroup,
+                              const int32_t mapYokingMapIndex,
+                              OffscreenContext& offscreenContext)
+{
     if ( ! useWindowSizeForImageSizeFlag) {
         if ((userImageWidth <= 0)
             || (userImageHeight <= 0)) {
@@ -332,7 +509,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     if ((imageWidth <= 0)
                         || (imageHeight <= 0)) {
                         const QString msg("Option "
-                                          + useWindowSizeParam->m_optionSwitch
+                                          + getUseWindowSizeSwitch()
                                           + " is used but window size not found in scene and width="
                                           + QString::number(imageWidth)
                                           + " height="
@@ -344,7 +521,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     
                     if ( ! missingWindowMessageHasBeenDisplayed) {
                         const QString msg("Option \""
-                                          + useWindowSizeParam->m_optionSwitch
+                                          + getUseWindowSizeSwitch()
                                           + "\" is used but window size not found in scene.\n"
                                           "   Scene was created prior to implementation of this option.\n"
                                           "   Image size will be width="
@@ -383,49 +560,16 @@ OperationShowScene::useParameters(OperationParameters* myParams,
             const int windowWidth  = windowViewport[2];
             const int windowHeight = windowViewport[3];
             
-            //
-            // Create the Mesa Context
-            //
-            const int depthBits = 16;
-            const int stencilBits = 0;
-            const int accumBits = 0;
-            OSMesaContext mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
-                                                               depthBits,
-                                                               stencilBits,
-                                                               accumBits,
-                                                               NULL);
-            if (mesaContext == 0) {
-                throw ("Creating Mesa Context failed.");
-            }
-            
-            //
-            // Allocate image buffer
-            //
-            const int32_t imageBufferSize =imageWidth * imageHeight * 4 * sizeof(unsigned char);
-            unsigned char* imageBuffer = new unsigned char[imageBufferSize];
-            if (imageBuffer == 0) {
-                throw OperationException("Allocating image buffer size="
-                                         + QString::number(imageBufferSize)
-                                         + " failed.");
-            }
-            
-            //
-            // Assign buffer to Mesa Context and make current
-            //
-            if (OSMesaMakeCurrent(mesaContext,
-                                  imageBuffer,
-                                  GL_UNSIGNED_BYTE,
-                                  imageWidth,
-                                  imageHeight) == 0) {
-                throw OperationException("Assigning buffer to context and make current failed.");
-            }
+            offscreenContext.makeCurrent(imageWidth,
+                                         imageHeight);
+            BrainOpenGLFixedPipeline* brainOpenGL = offscreenContext.m_brainOpenGL;
+            void* mesaContext = offscreenContext.m_mesaContext;
+            const unsigned char* imageBuffer = &offscreenContext.m_imageBuffer[0];
             
             /*
              * If tile tabs was saved to the scene, restore it as the scenes tile tabs configuration
              */
             if (restoreToTabTiles) {
-                CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-                
                 const AString tileTabsConfigString = browserClass->getStringValue("m_sceneTileTabsConfiguration");
                 if ( ! tileTabsConfigString.isEmpty()) {
                     TileTabsConfiguration tileTabsConfiguration;
@@ -510,8 +654,6 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                 }
             }
             else {
-                CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-                
                 /*
                  * Restore toolbar
                  */
@@ -557,12 +699,6 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     
                 }
             }
-            
-            /*
-             * Free image memory and Mesa context
-             */
-            delete[] imageBuffer;
-            OSMesaDestroyContext(mesaContext);
         }
     }
 
@@ -22,15 +22,50 @@
 /*LICENSE_END*/
 
 
+#include <vector>
+
 #include "AbstractOperation.h"
+#include "MapYokingGroupEnum.h"
 
 namespace caret {
 
     class BrainOpenGLFixedPipeline;
+    class SceneClass;
     
     class OperationShowScene : public AbstractOperation {
 
     public:
+        /**
+         * Offscreen Mesa context, image buffer, and OpenGL rendering that
+         * are created when first needed and reused for all images that
+         * are rendered with the context.
+         */
+        class OffscreenContext {
+        public:
+            OffscreenContext();
+            
+            ~OffscreenContext();
+            
+        private:
+            OffscreenContext(const OffscreenContext&);
+            
+            OffscreenContext& operator=(const OffscreenContext&);
+            
+            void makeCurrent(const int32_t imageWidth,
+                             const int32_t imageHeight);
+            
+            /** The OSMesaContext */
+            void* m_mesaContext;
+            
+            /** Image buffer that is rendered into */
+            std::vector<unsigned char> m_imageBuffer;
+            
+            /** OpenGL rendering, must be deleted before the Mesa context */
+            BrainOpenGLFixedPipeline* m_brainOpenGL;
+            
+            friend class OperationShowScene;
+        };
+        
         static OperationParameters* getParameters();
 
         static void useParameters(OperationParameters* myParams, 
@@ -42,6 +77,19 @@ namespace caret {
 
         static bool isShowSceneCommandAvailable();
         
+        static AString getUseWindowSizeSwitch();
+        
+        static void showScene(const AString& sceneFileName,
+                              const AString& sceneNameOrNumber,
+                              const AString& imageFileName,
+                              const int32_t userImageWidth,
+                              const int32_t userImageHeight,
+                              const bool useWindowSizeForImageSizeFlag,
+                              const bool doNotUseSceneColorsFlag,
+                              const MapYokingGroupEnum::Enum mapYokingGroup,
+                              const int32_t mapYokingMapIndex,
+                              OffscreenContext& offscreenContext);
+        
     private:
         static BrainOpenGLFixedPipeline* createBrainOpenGL();
         
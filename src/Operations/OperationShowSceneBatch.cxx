@@ -0,0 +1,429 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CommandOperationManager.h"
+#include "FileInformation.h"
+#include "OperationException.h"
+#include "OperationShowScene.h"
+#include "OperationShowSceneBatch.h"
+
+using namespace caret;
+
+/**
+ * \class caret::OperationShowSceneBatch
+ * \brief Offscreen rendering of many scenes to image files
+ *
+ * Renders a list of scenes using one Offscreen Mesa context so that
+ * the context is created once and data files that are shared by
+ * consecutive scenes are read only once.  Independent ranges of the
+ * list may be rendered by worker processes, each with its own context.
+ */
+
+namespace
+{//hidden namespace just to make sure things don't collide
+    /**
+     * Split a line of the job file into fields separated by whitespace.
+     * A field containing whitespace may be enclosed in double quotes.
+     *
+     * @return False if a double quote is not terminated.
+     */
+    bool splitJobLine(const std::string& line,
+                      std::vector<AString>& fieldsOut)
+    {
+        fieldsOut.clear();
+        const size_t lineLength = line.size();
+        size_t pos = 0;
+        while (pos < lineLength) {
+            while ((pos < lineLength)
+                   && isspace(static_cast<unsigned char>(line[pos]))) {
+                pos++;
+            }
+            if (pos >= lineLength) {
+                break;
+            }
+            std::string field;
+            if (line[pos] == '"') {
+                const size_t closeQuote = line.find('"', pos + 1);
+                if (closeQuote == std::string::npos) {
+                    return false;
+                }
+                field = line.substr(pos + 1, closeQuote - pos - 1);
+                pos = closeQuote + 1;
+            }
+            else {
+                const size_t fieldStart = pos;
+                while ((pos < lineLength)
+                       && ( ! isspace(static_cast<unsigned char>(line[pos])))) {
+                    pos++;
+                }
+                field = line.substr(fieldStart, pos - fieldStart);
+            }
+            fieldsOut.push_back(AString::fromLocal8Bit(field.c_str()));
+        }
+        return true;
+    }
+}
+
+/**
+ * @return Command line switch
+ */
+AString
+OperationShowSceneBatch::getCommandSwitch()
+{
+    return "-show-scene-batch";
+}
+
+/**
+ * @return Short description of operation
+ */
+AString
+OperationShowSceneBatch::getShortDescription()
+{
+    return ("OFFSCREEN RENDERING OF MANY SCENES TO IMAGE FILES");
+}
+
+/**
+ * @return Parameters for operation
+ */
+OperationParameters*
+OperationShowSceneBatch::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+
+    ret->addStringParameter(1, "job-file", "text file listing the scenes to render, one per line");
+
+    ret->createOptionalParameter(2, OperationShowScene::getUseWindowSizeSwitch(), "Override image size with window size");
+
+    ret->createOptionalParameter(3, "-no-scene-colors", "Do not use background and foreground colors in scene");
+
+    OptionalParameter* rangeOpt = ret->createOptionalParameter(4, "-job-range", "render only a range of the jobs");
+    rangeOpt->addIntegerParameter(1, "first", "number (starting at one) of the first job to render");
+    rangeOpt->addIntegerParameter(2, "last", "number of the last job to render");
+
+    OptionalParameter* parallelOpt = ret->createOptionalParameter(5, "-parallel", "render using multiple worker processes");
+    parallelOpt->addIntegerParameter(1, "num-processes", "number of worker processes");
+
+    AString helpText("Render many scenes into image files, reusing the offscreen "
+                     "rendering context.  Data files that are used by consecutive "
+                     "scenes, such as template surfaces, are read only once, so jobs "
+                     "that use the same files should be listed together.\n"
+                     "\n"
+                     "Each line of the job file describes one job with the same "
+                     "values as the " + OperationShowScene::getCommandSwitch()
+                     + " command:\n"
+                     "\n"
+                     "    <scene-file> <scene-name-or-number> <image-file-name> <image-width> <image-height>\n"
+                     "\n"
+                     "Values are separated by whitespace and a value containing "
+                     "whitespace, such as a scene name, must be enclosed in double "
+                     "quotes.  Empty lines and lines beginning with \"#\" are ignored.  "
+                     "Relative file names are relative to the current directory.  "
+                     "As with " + OperationShowScene::getCommandSwitch()
+                     + ", an index is inserted into the image name when a scene "
+                     "contains more than one window.\n"
+                     "\n"
+                     "A job that fails does not stop the remaining jobs, but the "
+                     "command reports an error after all jobs have been attempted.\n"
+                     "\n"
+                     "With -parallel, the jobs are divided into consecutive ranges "
+                     "that are rendered by separate worker processes, each with its "
+                     "own rendering context and loaded files.\n");
+
+    ret->setHelpText(helpText);
+
+    return ret;
+}
+
+/**
+ * Use Parameters and perform operation
+ */
+void
+OperationShowSceneBatch::useParameters(OperationParameters* myParams,
+                                       ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    const AString jobFileName = FileInformation(myParams->getString(1)).getAbsoluteFilePath();
+    const bool useWindowSizeForImageSizeFlag = myParams->getOptionalParameter(2)->m_present;
+    const bool doNotUseSceneColorsFlag = myParams->getOptionalParameter(3)->m_present;
+
+    if ( ! OperationShowScene::isShowSceneCommandAvailable()) {
+        throw OperationException("Show scene command not available due to this software version "
+                                 "not being built with the Mesa OffScreen Library");
+    }
+
+    std::vector<Job> jobs;
+    readJobFile(jobFileName,
+                jobs);
+    const int32_t numJobs = static_cast<int32_t>(jobs.size());
+    if (numJobs <= 0) {
+        throw OperationException("Job file contains no jobs.");
+    }
+
+    int32_t firstJobIndex = 0;
+    int32_t lastJobIndex  = numJobs - 1;
+    OptionalParameter* rangeOpt = myParams->getOptionalParameter(4);
+    if (rangeOpt->m_present) {
+        firstJobIndex = rangeOpt->getInteger(1) - 1;
+        lastJobIndex  = rangeOpt->getInteger(2) - 1;
+        if ((firstJobIndex < 0)
+            || (lastJobIndex >= numJobs)
+            || (firstJobIndex > lastJobIndex)) {
+            throw OperationException("Job range is invalid, job file contains "
+                                     + AString::number(numJobs)
+                                     + " jobs.");
+        }
+    }
+
+    OptionalParameter* parallelOpt = myParams->getOptionalParameter(5);
+    if (parallelOpt->m_present) {
+        const int32_t numberOfProcesses = parallelOpt->getInteger(1);
+        if (numberOfProcesses < 1) {
+            throw OperationException("Number of worker processes must be one or greater.");
+        }
+        if ((numberOfProcesses > 1)
+            && (lastJobIndex > firstJobIndex)) {
+            std::vector<AString> sharedArguments;
+            if (useWindowSizeForImageSizeFlag) {
+                sharedArguments.push_back(OperationShowScene::getUseWindowSizeSwitch());
+            }
+            if (doNotUseSceneColorsFlag) {
+                sharedArguments.push_back("-no-scene-colors");
+            }
+            runJobsInWorkerProcesses(jobFileName,
+                                     firstJobIndex,
+                                     lastJobIndex,
+                                     numberOfProcesses,
+                                     sharedArguments);
+            return;
+        }
+    }
+
+    /*
+     * The context, and the files loaded by the previous scene, are
+     * reused for each job.
+     */
+    OperationShowScene::OffscreenContext offscreenContext;
+
+    int32_t numberOfFailedJobs = 0;
+    for (int32_t iJob = firstJobIndex; iJob <= lastJobIndex; iJob++) {
+        const Job& job = jobs[iJob];
+        try {
+            OperationShowScene::showScene(job.m_sceneFileName,
+                                          job.m_sceneNameOrNumber,
+                                          job.m_imageFileName,
+                                          job.m_imageWidth,
+                                          job.m_imageHeight,
+                                          useWindowSizeForImageSizeFlag,
+                                          doNotUseSceneColorsFlag,
+                                          MapYokingGroupEnum::MAP_YOKING_GROUP_OFF,
+                                          -1,
+                                          offscreenContext);
+        }
+        catch (const CaretException& e) {
+            numberOfFailedJobs++;
+            std::cerr << "ERROR rendering job on line "
+                      << job.m_lineNumber
+                      << " of "
+                      << qPrintable(jobFileName)
+                      << ": "
+                      << qPrintable(e.whatString())
+                      << std::endl;
+        }
+    }
+
+    if (numberOfFailedJobs > 0) {
+        throw OperationException(AString::number(numberOfFailedJobs)
+                                 + " of "
+                                 + AString::number(lastJobIndex - firstJobIndex + 1)
+                                 + " jobs failed.");
+    }
+}
+
+/**
+ * Read the job file.
+ *
+ * @param jobFileName
+ *     Name of the job file.
+ * @param jobsOut
+ *     Output containing the jobs.
+ */
+void
+OperationShowSceneBatch::readJobFile(const AString& jobFileName,
+                                     std::vector<Job>& jobsOut)
+{
+    jobsOut.clear();
+
+    std::ifstream jobFile(jobFileName.toLocal8Bit().constData());
+    if ( ! jobFile.good()) {
+        throw OperationException("error reading job file: "
+                                 + jobFileName);
+    }
+
+    std::string line;
+    int32_t lineNumber = 0;
+    std::vector<AString> fields;
+    while (std::getline(jobFile, line)) {
+        lineNumber++;
+        if ( ! splitJobLine(line,
+                            fields)) {
+            throw OperationException("Unterminated quote on line "
+                                     + AString::number(lineNumber)
+                                     + " of job file.");
+        }
+        if (fields.empty()) {
+            continue;
+        }
+        if (fields[0].startsWith("#")) {
+            continue;
+        }
+        if (fields.size() != 5) {
+            throw OperationException("Line "
+                                     + AString::number(lineNumber)
+                                     + " of job file contains "
+                                     + AString::number(fields.size())
+                                     + " values but must contain 5.");
+        }
+
+        Job job;
+        job.m_lineNumber = lineNumber;
+        job.m_sceneFileName = FileInformation(fields[0]).getAbsoluteFilePath();
+        job.m_sceneNameOrNumber = fields[1];
+        job.m_imageFileName = FileInformation(fields[2]).getAbsoluteFilePath();
+        bool widthValid  = false;
+        bool heightValid = false;
+        job.m_imageWidth  = fields[3].toInt(&widthValid);
+        job.m_imageHeight = fields[4].toInt(&heightValid);
+        if (( ! widthValid)
+            || ( ! heightValid)) {
+            throw OperationException("Invalid image size on line "
+                                     + AString::number(lineNumber)
+                                     + " of job file.");
+        }
+
+        jobsOut.push_back(job);
+    }
+}
+
+/**
+ * Divide the jobs into consecutive ranges and run each range in
+ * a worker process.
+ *
+ * @param jobFileName
+ *     Name of the job file.
+ * @param firstJobIndex
+ *     Index of first job.
+ * @param lastJobIndex
+ *     Index of last job.
+ * @param numberOfProcesses
+ *     Number of worker processes.
+ * @param sharedArguments
+ *     Options that are passed to every worker process.  The global
+ *     options given to this process are also passed.
+ */
+void
+OperationShowSceneBatch::runJobsInWorkerProcesses(const AString& jobFileName,
+                                                  const int32_t firstJobIndex,
+                                                  const int32_t lastJobIndex,
+                                                  const int32_t numberOfProcesses,
+                                                  const std::vector<AString>& sharedArguments)
+{
+    const int32_t numJobs = lastJobIndex - firstJobIndex + 1;
+    int32_t numWorkers = numberOfProcesses;
+    if (numWorkers > numJobs) {
+        numWorkers = numJobs;
+    }
+
+    const AString programName = QCoreApplication::applicationFilePath();
+
+    /*
+     * Workers run with the same global options (logging level,
+     * provenance, etc.) as this process
+     */
+    const std::vector<AString>& globalOptions = CommandOperationManager::getCommandOperationManager()->getGlobalOptionsGiven();
+
+    /*
+     * Consecutive ranges keep jobs that share files in the same process
+     */
+    std::vector<QProcess*> workers;
+    std::vector<AString> workerRanges;
+    for (int32_t iWorker = 0; iWorker < numWorkers; iWorker++) {
+        const int32_t workerFirst = firstJobIndex + (static_cast<int64_t>(numJobs) * iWorker) / numWorkers;
+        const int32_t workerLast  = firstJobIndex + (static_cast<int64_t>(numJobs) * (iWorker + 1)) / numWorkers - 1;
+
+        QStringList arguments;
+        for (std::vector<AString>::const_iterator iter = globalOptions.begin();
+             iter != globalOptions.end();
+             iter++) {
+            arguments << *iter;
+        }
+        arguments << getCommandSwitch()
+                  << jobFileName
+                  << "-job-range"
+                  << AString::number(workerFirst + 1)
+                  << AString::number(workerLast + 1);
+        for (std::vector<AString>::const_iterator iter = sharedArguments.begin();
+             iter != sharedArguments.end();
+             iter++) {
+            arguments << *iter;
+        }
+
+        QProcess* process = new QProcess();
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->start(programName,
+                       arguments);
+        workers.push_back(process);
+        workerRanges.push_back(AString::number(workerFirst + 1)
+                               + "-"
+                               + AString::number(workerLast + 1));
+    }
+
+    AString errorMessage;
+    for (int32_t iWorker = 0; iWorker < numWorkers; iWorker++) {
+        QProcess* process = workers[iWorker];
+        bool successFlag = false;
+        if (process->waitForStarted(-1)) {
+            if (process->waitForFinished(-1)) {
+                successFlag = ((process->exitStatus() == QProcess::NormalExit)
+                               && (process->exitCode() == 0));
+            }
+        }
+        if ( ! successFlag) {
+            errorMessage += ("Worker process for jobs "
+                             + workerRanges[iWorker]
+                             + " failed.\n");
+        }
+        delete process;
+    }
+
+    if ( ! errorMessage.isEmpty()) {
+        throw OperationException(errorMessage);
+    }
+}
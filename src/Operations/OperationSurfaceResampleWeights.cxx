@@ -0,0 +1,136 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationSurfaceResampleWeights.h"
+#include "OperationException.h"
+
+#include "CaretLogger.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingHelper.h"
+#include "SurfaceResamplingMethodEnum.h"
+
+#include <QDir>
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+AString OperationSurfaceResampleWeights::getCommandSwitch()
+{
+    return "-surface-resample-weights";
+}
+
+AString OperationSurfaceResampleWeights::getShortDescription()
+{
+    return "PRECOMPUTE SURFACE RESAMPLING WEIGHTS";
+}
+
+OperationParameters* OperationSurfaceResampleWeights::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addSurfaceParameter(1, "current-sphere", "a sphere surface with the mesh that the data is currently on");
+    
+    ret->addSurfaceParameter(2, "new-sphere", "a sphere surface that is in register with <current-sphere> and has the desired output mesh");
+    
+    ret->addStringParameter(3, "method", "the method name");
+    
+    ret->addStringParameter(4, "cache-directory", "the directory to save the weights in");
+    
+    OptionalParameter* areaSurfsOpt = ret->createOptionalParameter(5, "-area-surfs", "specify surfaces to do vertex area correction based on");
+    areaSurfsOpt->addSurfaceParameter(1, "current-area", "a relevant anatomical surface with <current-sphere> mesh");
+    areaSurfsOpt->addSurfaceParameter(2, "new-area", "a relevant anatomical surface with <new-sphere> mesh");
+    
+    OptionalParameter* areaMetricsOpt = ret->createOptionalParameter(6, "-area-metrics", "specify vertex area metrics to do area correction based on");
+    areaMetricsOpt->addMetricParameter(1, "current-area", "a metric file with vertex areas for <current-sphere> mesh");
+    areaMetricsOpt->addMetricParameter(2, "new-area", "a metric file with vertex areas for <new-sphere> mesh");
+    
+    AString myHelpText =
+        AString("Computes the weights that surface resampling commands (-metric-resample, -label-resample, -cifti-resample, etc) would use, ") +
+        "and saves them in <cache-directory> under a name derived from the spheres, method and vertex areas.  " +
+        "When the global option '-resample-weight-cache <cache-directory>' is given to a resampling command, and it finds a matching file in the directory, " +
+        "it loads the weights instead of computing them.  " +
+        "The weights are saved without any roi, rois given to the resampling commands are applied after loading.\n\n" +
+        "The options and their meaning are the same as for -metric-resample, and must match the ones given to the resampling command in order to be used.  " +
+        "If ADAP_BARY_AREA is used, exactly one of -area-surfs or -area-metrics must be specified.\n\n" +
+        "The <method> argument must be one of the following:\n\n";
+    
+    vector<SurfaceResamplingMethodEnum::Enum> allEnums;
+    SurfaceResamplingMethodEnum::getAllEnums(allEnums);
+    for (int i = 0; i < (int)allEnums.size(); ++i)
+    {
+        myHelpText += SurfaceResamplingMethodEnum::toName(allEnums[i]) + "\n";
+    }
+    
+    ret->setHelpText(myHelpText);
+    return ret;
+}
+
+void OperationSurfaceResampleWeights::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    SurfaceFile* curSphere = myParams->getSurface(1);
+    SurfaceFile* newSphere = myParams->getSurface(2);
+    bool ok = false;
+    SurfaceResamplingMethodEnum::Enum myMethod = SurfaceResamplingMethodEnum::fromName(myParams->getString(3), &ok);
+    if (!ok)
+    {
+        throw OperationException("invalid method name");
+    }
+    AString cacheDir = myParams->getString(4);
+    if (!QDir(cacheDir).exists()) throw OperationException("cache directory '" + cacheDir + "' does not exist");
+    vector<float> curAreas, newAreas;
+    OptionalParameter* areaSurfsOpt = myParams->getOptionalParameter(5);
+    if (areaSurfsOpt->m_present)
+    {
+        SurfaceFile* curAreaSurf = areaSurfsOpt->getSurface(1);
+        SurfaceFile* newAreaSurf = areaSurfsOpt->getSurface(2);
+        curAreaSurf->computeNodeAreas(curAreas);
+        newAreaSurf->computeNodeAreas(newAreas);
+    }
+    OptionalParameter* areaMetricsOpt = myParams->getOptionalParameter(6);
+    if (areaMetricsOpt->m_present)
+    {
+        if (areaSurfsOpt->m_present)
+        {
+            throw OperationException("only one of -area-surfs and -area-metrics can be specified");
+        }
+        MetricFile* curAreaMetric = areaMetricsOpt->getMetric(1);
+        MetricFile* newAreaMetric = areaMetricsOpt->getMetric(2);
+        curAreas = vector<float>(curAreaMetric->getValuePointerForColumn(0), curAreaMetric->getValuePointerForColumn(0) + curAreaMetric->getNumberOfNodes());
+        newAreas = vector<float>(newAreaMetric->getValuePointerForColumn(0), newAreaMetric->getValuePointerForColumn(0) + newAreaMetric->getNumberOfNodes());
+    }
+    const float* curAreaData = NULL, *newAreaData = NULL;
+    switch (myMethod)
+    {
+        case SurfaceResamplingMethodEnum::BARYCENTRIC:
+            if (areaSurfsOpt->m_present || areaMetricsOpt->m_present) CaretLogInfo("This method does not use area correction, area options are not needed");
+            break;
+        default:
+            if (curAreas.empty() || newAreas.empty()) throw OperationException("specified method does area correction, but no vertex area data given");
+            if (curSphere->getNumberOfNodes() != (int)curAreas.size()) throw OperationException("current vertex area data has different number of nodes than current sphere");
+            if (newSphere->getNumberOfNodes() != (int)newAreas.size()) throw OperationException("new vertex area data has different number of nodes than new sphere");
+            curAreaData = curAreas.data();
+            newAreaData = newAreas.data();
+    }
+    AString fileName = SurfaceResamplingHelper::precomputeWeights(myMethod, curSphere, newSphere, curAreaData, newAreaData, cacheDir);
+    CaretLogInfo("wrote resampling weights to '" + fileName + "'");
+}
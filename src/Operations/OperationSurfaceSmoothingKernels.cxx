@@ -0,0 +1,127 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationSurfaceSmoothingKernels.h"
+#include "OperationException.h"
+
+#include "CaretLogger.h"
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceFile.h"
+
+#include <QDir>
+
+using namespace caret;
+using namespace std;
+
+AString OperationSurfaceSmoothingKernels::getCommandSwitch()
+{
+    return "-surface-smoothing-kernels";
+}
+
+AString OperationSurfaceSmoothingKernels::getShortDescription()
+{
+    return "PRECOMPUTE SURFACE SMOOTHING KERNELS";
+}
+
+OperationParameters* OperationSurfaceSmoothingKernels::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addSurfaceParameter(1, "surface", "the surface to smooth on");
+    
+    ret->addDoubleParameter(2, "smoothing-kernel", "the sigma for the gaussian kernel function, in mm");
+    
+    ret->addStringParameter(3, "cache-directory", "the directory to save the kernels in");
+    
+    OptionalParameter* roiOption = ret->createOptionalParameter(4, "-roi", "compute kernels for smoothing within a region of interest");
+    roiOption->addMetricParameter(1, "roi-metric", "the roi to smooth within, as a metric");
+    
+    OptionalParameter* corrAreaOpt = ret->createOptionalParameter(5, "-corrected-areas", "vertex areas to use instead of computing them from the surface");
+    corrAreaOpt->addMetricParameter(1, "area-metric", "the corrected vertex areas, as a metric");
+    
+    OptionalParameter* methodSelect = ret->createOptionalParameter(6, "-method", "select smoothing method, default GEO_GAUSS_AREA");
+    methodSelect->addStringParameter(1, "method", "the name of the smoothing method");
+    
+    ret->setHelpText(
+        AString("Computes the smoothing kernels that -metric-smoothing or -cifti-smoothing would use, ") +
+        "and saves them in <cache-directory> under a name derived from the surface, kernel size, method, vertex areas and roi.  " +
+        "When the global option '-smoothing-kernel-cache <cache-directory>' is given to a smoothing command, and it finds a matching file in the directory, " +
+        "it loads the kernels instead of computing them.  " +
+        "This saves most of the time when smoothing many inputs on the same surface with the same settings.\n\n" +
+        "The options and their meaning are the same as for -metric-smoothing, and must match the ones given to the smoothing command in order to be used.  " +
+        "For -metric-smoothing, use -roi here only if -roi is used there without -match-columns.  " +
+        "-cifti-smoothing always smooths within the vertices the cifti file uses, with the GEO_GAUSS_AREA method, " +
+        "so to precompute for it, use -roi with the roi metric that -cifti-separate outputs for the structure, " +
+        "and -corrected-areas with the same vertex areas, if any.\n\n" +
+        "Valid values for <method> are GEO_GAUSS_AREA, GEO_GAUSS_EQUAL, and GEO_GAUSS, see -metric-smoothing for details."
+    );
+    return ret;
+}
+
+void OperationSurfaceSmoothingKernels::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    SurfaceFile* mySurf = myParams->getSurface(1);
+    double myKernel = myParams->getDouble(2);
+    if (myKernel <= 0.0)
+    {
+        throw OperationException("invalid kernel size");
+    }
+    AString cacheDir = myParams->getString(3);
+    if (!QDir(cacheDir).exists()) throw OperationException("cache directory '" + cacheDir + "' does not exist");
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    MetricFile* myRoi = NULL;
+    OptionalParameter* roiOption = myParams->getOptionalParameter(4);
+    if (roiOption->m_present)
+    {
+        myRoi = roiOption->getMetric(1);
+        if (myRoi->getNumberOfNodes() != numNodes) throw OperationException("roi metric does not match surface in number of vertices");
+    }
+    const float* areaData = NULL;
+    OptionalParameter* corrAreaOpt = myParams->getOptionalParameter(5);
+    if (corrAreaOpt->m_present)
+    {
+        MetricFile* corrAreaMetric = corrAreaOpt->getMetric(1);
+        if (corrAreaMetric->getNumberOfNodes() != numNodes) throw OperationException("corrected vertex areas metric does not match surface in number of vertices");
+        areaData = corrAreaMetric->getValuePointerForColumn(0);
+    }
+    MetricSmoothingObject::Method myMethod = MetricSmoothingObject::GEO_GAUSS_AREA;
+    OptionalParameter* methodSelect = myParams->getOptionalParameter(6);
+    if (methodSelect->m_present)
+    {
+        AString methodName = methodSelect->getString(1);
+        if (methodName == "GEO_GAUSS_AREA")
+        {
+            myMethod = MetricSmoothingObject::GEO_GAUSS_AREA;
+        } else if (methodName == "GEO_GAUSS_EQUAL") {
+            myMethod = MetricSmoothingObject::GEO_GAUSS_EQUAL;
+        } else if (methodName == "GEO_GAUSS") {
+            myMethod = MetricSmoothingObject::GEO_GAUSS;
+        } else {
+            throw OperationException("unknown smoothing method name");
+        }
+    }
+    if (myMethod != MetricSmoothingObject::GEO_GAUSS_AREA && areaData != NULL)
+    {
+        CaretLogInfo("This method does not use vertex areas, -corrected-areas is not needed");
+    }
+    AString fileName = MetricSmoothingObject::precomputeKernels(mySurf, myKernel, myRoi, myMethod, areaData, cacheDir);
+    CaretLogInfo("wrote smoothing kernels to '" + fileName + "'");
+}
@@ -21,8 +21,11 @@
 #include "OperationWbsparseMergeDense.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "CaretSparseFile.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -46,6 +49,8 @@ OperationParameters* OperationWbsparseMergeDense::getParameters()
     ParameterComponent* wbsparseOpt = ret->createRepeatableParameter(3, "-wbsparse", "specify an input wbsparse file");
     wbsparseOpt->addStringParameter(1, "wbsparse-in", "a wbsparse file to merge");
     
+    ret->createOptionalParameter(4, "-compressed", "write the block compressed (version 2) wbsparse format, which older versions of workbench can't read");
+    
     ret->setHelpText(
         AString("The input wbsparse files must have matching mappings along the direction not specified, and the mapping along the specified direction must be brain models.")
     );
@@ -67,6 +72,11 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
     }
     AString outputName = myParams->getString(2);
     const vector<ParameterComponent*>& myInstances = *(myParams->getRepeatableParameterInstances(3));
+    int formatVersion = 1;
+    if (myParams->getOptionalParameter(4)->m_present)
+    {
+        formatVersion = 2;
+    }
     vector<CaretPointer<CaretSparseFile> > wbsparseList;
     int numCifti = (int)myInstances.size();
     for (int i = 0; i < numCifti; ++i)
@@ -152,88 +162,115 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
     int numOutModels = (int)sourceWbsparse.size();
     CaretAssert(numOutModels == (int)newDenseMap.getModelInfo().size());
     int64_t outColSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    CaretSparseFileWriter myWriter(outputName, outXML);
+    CaretSparseFileWriter myWriter(outputName, outXML, formatVersion);
     vector<CiftiBrainModelsMap::ModelInfo> outModelInfo = newDenseMap.getModelInfo();
+    const int64_t CHUNK_ROWS = 64;//rows are decoded in parallel a chunk at a time, and written in order
+    vector<vector<int64_t> > chunkIndices(CHUNK_ROWS), chunkValues(CHUNK_ROWS);
+    AString errorMessage;
     switch (myDir)
     {
         case CiftiXML::ALONG_ROW:
         {
-            for (int64_t i = 0; i < outColSize; ++i)
+            vector<int64_t> modelStart(numOutModels), modelEnd(numOutModels);
+            for (int j = 0; j < numOutModels; ++j)//we could just do the entire row for each file, but doing it by structure could allow structure selection in the future
             {
-                int64_t curOffset = 0;
-                vector<int64_t> outIndices, outValues, inIndices, inValues;
-                int loaded = -1;
-                for (int j = 0; j < numOutModels; ++j)//we could just do the entire row for each file, but doing it by structure could allow structure selection in the future
+                const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
+                const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
+                const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
+                int64_t startIndex = -1, endIndex = -1;
+                switch (myInfo.m_type)
                 {
-                    const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
-                    const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
-                    const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
-                    int64_t startIndex = -1, endIndex = -1;
-                    switch (myInfo.m_type)
+                    case CiftiBrainModelsMap::SURFACE:
                     {
-                        case CiftiBrainModelsMap::SURFACE:
+                        vector<CiftiBrainModelsMap::SurfaceMap> tempMap = thisDenseMap.getSurfaceMap(myInfo.m_structure);
+                        if (tempMap.size() > 0)
                         {
-                            vector<CiftiBrainModelsMap::SurfaceMap> tempMap = thisDenseMap.getSurfaceMap(myInfo.m_structure);
-                            if (tempMap.size() > 0)
-                            {
-                                startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
-                                endIndex = startIndex + tempMap.size();
-                            } else {
-                                startIndex = 0;
-                                endIndex = 0;
-                            }
-                            break;
-                        }
-                        case CiftiBrainModelsMap::VOXELS:
-                        {
-                            vector<CiftiBrainModelsMap::VolumeMap> tempMap = thisDenseMap.getVolumeStructureMap(myInfo.m_structure);
-                            if (tempMap.size() > 0)
-                            {
-                                startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
-                                endIndex = startIndex + tempMap.size();
-                            } else {
-                                startIndex = 0;
-                                endIndex = 0;
-                            }
-                            break;
+                            startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
+                            endIndex = startIndex + tempMap.size();
+                        } else {
+                            startIndex = 0;
+                            endIndex = 0;
                         }
-                        default:
-                            CaretAssert(false);
-                            break;
+                        break;
                     }
-                    if (endIndex > startIndex)
+                    case CiftiBrainModelsMap::VOXELS:
                     {
-                        if (loaded != sourceWbsparse[j])
+                        vector<CiftiBrainModelsMap::VolumeMap> tempMap = thisDenseMap.getVolumeStructureMap(myInfo.m_structure);
+                        if (tempMap.size() > 0)
                         {
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(i, inIndices, inValues);
-                            loaded = sourceWbsparse[j];
+                            startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
+                            endIndex = startIndex + tempMap.size();
+                        } else {
+                            startIndex = 0;
+                            endIndex = 0;
                         }
-                        int64_t numSparse = (int64_t)inIndices.size();
-                        for (int64_t k = 0; k < numSparse; ++k)
+                        break;
+                    }
+                    default:
+                        CaretAssert(false);
+                        break;
+                }
+                modelStart[j] = startIndex;
+                modelEnd[j] = endIndex;
+            }
+            for (int64_t chunkStart = 0; chunkStart < outColSize; chunkStart += CHUNK_ROWS)
+            {
+                int64_t chunkSize = min(CHUNK_ROWS, outColSize - chunkStart);
+#pragma omp CARET_PARFOR schedule(dynamic)
+                for (int64_t r = 0; r < chunkSize; ++r)
+                {
+                    try
+                    {
+                        int64_t i = chunkStart + r;
+                        int64_t curOffset = 0;
+                        vector<int64_t>& outIndices = chunkIndices[r], &outValues = chunkValues[r];
+                        vector<int64_t> inIndices, inValues;
+                        outIndices.clear();
+                        outValues.clear();
+                        int loaded = -1;
+                        for (int j = 0; j < numOutModels; ++j)
                         {
-                            if (inIndices[k] >= startIndex && inIndices[k] < endIndex)
+                            int64_t startIndex = modelStart[j], endIndex = modelEnd[j];
+                            if (endIndex > startIndex)
                             {
-                                outIndices.push_back(inIndices[k] + curOffset);
-                                outValues.push_back(inValues[k]);
+                                if (loaded != sourceWbsparse[j])
+                                {
+                                    wbsparseList[sourceWbsparse[j]]->getRowSparse(i, inIndices, inValues);
+                                    loaded = sourceWbsparse[j];
+                                }
+                                int64_t numSparse = (int64_t)inIndices.size();
+                                for (int64_t k = 0; k < numSparse; ++k)
+                                {
+                                    if (inIndices[k] >= startIndex && inIndices[k] < endIndex)
+                                    {
+                                        outIndices.push_back(inIndices[k] + curOffset);
+                                        outValues.push_back(inValues[k]);
+                                    }
+                                }
+                                curOffset += endIndex - startIndex;
                             }
                         }
-                        curOffset += endIndex - startIndex;
+                    } catch (CaretException& e) {
+#pragma omp critical
+                        errorMessage = e.whatString();
                     }
                 }
-                myWriter.writeRowSparse(i, outIndices, outValues);
-                outIndices.clear();//reset for next row
-                outValues.clear();
+                if (errorMessage != "") throw OperationException(errorMessage);
+                for (int64_t r = 0; r < chunkSize; ++r)
+                {
+                    myWriter.writeRowSparse(chunkStart + r, chunkIndices[r], chunkValues[r]);
+                }
             }
             break;
         }
         case CiftiXML::ALONG_COLUMN:
         {
-            vector<int64_t> inIndices, inValues;
             for (int j = 0; j < numOutModels; ++j)
             {
                 const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
                 const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
                 const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
+                vector<int64_t> inRows, outRows;//rows of the input file, and where they go in the output
                 switch (myInfo.m_type)
                 {
                     case CiftiBrainModelsMap::SURFACE:
@@ -244,8 +281,8 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
                         for (int64_t k = 0; k < mapSize; ++k)
                         {
                             CaretAssert(tempMap[k].m_surfaceNode == outMap[k].m_surfaceNode);
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(tempMap[k].m_ciftiIndex, inIndices, inValues);
-                            myWriter.writeRowSparse(outMap[k].m_ciftiIndex, inIndices, inValues);
+                            inRows.push_back(tempMap[k].m_ciftiIndex);
+                            outRows.push_back(outMap[k].m_ciftiIndex);
                         }
                         break;
                     }
@@ -259,8 +296,8 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
                             CaretAssert(tempMap[k].m_ijk[0] == outMap[k].m_ijk[0]);
                             CaretAssert(tempMap[k].m_ijk[1] == outMap[k].m_ijk[1]);
                             CaretAssert(tempMap[k].m_ijk[2] == outMap[k].m_ijk[2]);
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(tempMap[k].m_ciftiIndex, inIndices, inValues);
-                            myWriter.writeRowSparse(outMap[k].m_ciftiIndex, inIndices, inValues);
+                            inRows.push_back(tempMap[k].m_ciftiIndex);
+                            outRows.push_back(outMap[k].m_ciftiIndex);
                         }
                         break;
                     }
@@ -268,6 +305,28 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
                         CaretAssert(false);
                         break;
                 }
+                const CaretSparseFile* thisFile = wbsparseList[sourceWbsparse[j]];
+                int64_t numRows = (int64_t)inRows.size();
+                for (int64_t chunkStart = 0; chunkStart < numRows; chunkStart += CHUNK_ROWS)
+                {
+                    int64_t chunkSize = min(CHUNK_ROWS, numRows - chunkStart);
+#pragma omp CARET_PARFOR schedule(dynamic)
+                    for (int64_t r = 0; r < chunkSize; ++r)
+                    {
+                        try
+                        {
+                            thisFile->getRowSparse(inRows[chunkStart + r], chunkIndices[r], chunkValues[r]);
+                        } catch (CaretException& e) {
+#pragma omp critical
+                            errorMessage = e.whatString();
+                        }
+                    }
+                    if (errorMessage != "") throw OperationException(errorMessage);
+                    for (int64_t r = 0; r < chunkSize; ++r)
+                    {
+                        myWriter.writeRowSparse(outRows[chunkStart + r], chunkIndices[r], chunkValues[r]);
+                    }
+                }
             }
             break;
         }
@@ -0,0 +1,98 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiColumnTest.h"
+
+#include "CiftiFile.h"
+#include "CiftiScalarsMap.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiColumnTest::CiftiColumnTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void CiftiColumnTest::execute()
+{
+    //big enough that a column tile is narrower than a row: the first tile covers most of a row and is read as whole-row strips,
+    //the second covers less than half of a row and is read as one segment per row
+    const int64_t ROW_LENGTH = 600, NUM_ROWS = 20000;
+    CiftiScalarsMap rowMap, colMap;
+    rowMap.setLength(ROW_LENGTH);
+    colMap.setLength(NUM_ROWS);
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_ROW, rowMap);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, colMap);
+    AString fileName = QDir::tempPath() + "/wb_cifti_column_test.dscalar.nii";
+    vector<float> row(ROW_LENGTH);
+    {
+        CiftiFile writer;
+        writer.setWritingFile(fileName);
+        writer.setCiftiXML(myXML);
+        for (int64_t i = 0; i < NUM_ROWS; ++i)
+        {
+            for (int64_t j = 0; j < ROW_LENGTH; ++j)
+            {
+                row[j] = i * ROW_LENGTH + j;//exact in float, and different everywhere
+            }
+            writer.setRow(row.data(), i);
+        }
+        writer.close();
+    }
+    {
+        CiftiFile reader(fileName);//on-disk reading
+        vector<int64_t> columns;//tiles are 419 columns wide for this column length, so check both sides of each tile edge
+        columns.push_back(ROW_LENGTH - 1);
+        columns.push_back(0);
+        columns.push_back(1);
+        columns.push_back(418);
+        columns.push_back(419);
+        columns.push_back(ROW_LENGTH / 2);
+        vector<vector<float> > expected(columns.size(), vector<float>(NUM_ROWS));
+        for (int64_t i = 0; i < NUM_ROWS; ++i)
+        {
+            reader.getRow(row.data(), i);
+            for (size_t c = 0; c < columns.size(); ++c)
+            {
+                expected[c][i] = row[columns[c]];
+            }
+        }
+        vector<float> column(NUM_ROWS);
+        for (int pass = 0; pass < 2 && !failed(); ++pass)//second pass comes from the cached tiles
+        {
+            for (size_t c = 0; c < columns.size() && !failed(); ++c)
+            {
+                reader.getColumn(column.data(), columns[c]);
+                if (column != expected[c])
+                {
+                    setFailed("on-disk getColumn " + AString::number(columns[c]) + " does not match getRow");
+                }
+            }
+        }
+    }
+    QFile::remove(fileName);
+}
@@ -35,6 +35,8 @@ void CiftiFileTest::execute()
     if(this->failed()) return;
     testCiftiReadWriteOnDisk();
     if(this->failed()) return;
+    testCiftiRowSum();
+    if(this->failed()) return;
 }
 
 void CiftiFileTest::testObjectCreateDestroy()
@@ -199,3 +201,55 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
     delete [] testRow;
 }
 
+void CiftiFileTest::testCiftiRowSum()
+{
+    std::cout << "Testing Cifti row sum." << std::endl;
+
+    CiftiFile reader(this->m_default_path + "/cifti/DenseTimeSeries.dtseries.nii");
+
+    std::vector <int64_t> dim = reader.getDimensions();
+    if (dim.size() != 2)
+    {
+        setFailed("input file must have 2 dimensions");
+        return;
+    }
+    int64_t rowSize = dim[0];
+    int64_t columnSize = dim[1];
+
+    //unsorted, with neighboring rows, a repeated row, and rows far apart
+    std::vector<int64_t> indices;
+    indices.push_back(columnSize - 1);
+    indices.push_back(2);
+    indices.push_back(0);
+    indices.push_back(1);
+    indices.push_back(2);
+    indices.push_back(columnSize / 2);
+
+    std::vector<double> expected(rowSize, 0.0);
+    std::vector<float> row(rowSize);
+    for(size_t i = 0;i<indices.size();i++)
+    {
+        reader.getRow(row.data(),indices[i]);
+        for(int64_t j=0;j<rowSize;j++)
+        {
+            expected[j] += row[j];
+        }
+    }
+
+    std::vector<double> sum(rowSize);
+    for(int pass = 0;pass<2;pass++)
+    {
+        reader.getRowSum(sum.data(),indices);
+        for(int64_t j=0;j<rowSize;j++)
+        {
+            if((sum[j]>(expected[j]+0.0001))||
+                    (sum[j]<(expected[j]-0.0001)))
+            {
+                setFailed("Row sum differs from sum of individual rows at element " + AString::number(j) + ".");
+                return;
+            }
+        }
+        reader.convertToInMemory();//second pass uses in-memory data
+    }
+    std::cout << "Cifti row sum matches sum of individual rows." << std::endl;
+}
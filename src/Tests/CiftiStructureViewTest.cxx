@@ -0,0 +1,266 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiStructureViewTest.h"
+
+#include "CiftiBrainModelsMap.h"
+#include "CiftiFile.h"
+#include "CiftiScalarsMap.h"
+#include "CiftiStructureView.h"
+#include "VolumeSpace.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiStructureViewTest::CiftiStructureViewTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t NUM_MAPS = 7;
+    
+    float testValue(const int64_t& ciftiIndex, const int64_t& map)
+    {
+        return ciftiIndex * NUM_MAPS + map + 1;//exact in float, nonzero, and different everywhere
+    }
+    
+    CiftiBrainModelsMap makeDenseMap()
+    {
+        CiftiBrainModelsMap ret;
+        int64_t dims[3] = { 4, 4, 4 };
+        float sform[12] = { 2.0f, 0.0f, 0.0f, -4.0f,
+                            0.0f, 2.0f, 0.0f, -4.0f,
+                            0.0f, 0.0f, 2.0f, -4.0f };
+        ret.setVolumeSpace(VolumeSpace(dims, sform));
+        vector<float> leftRoi(100, 1.0f);
+        for (int i = 0; i < 100; i += 3) leftRoi[i] = 0.0f;
+        ret.addSurfaceModel(100, StructureEnum::CORTEX_LEFT, leftRoi.data());
+        vector<int64_t> thalamusVoxels;
+        for (int64_t k = 0; k < 4; ++k)
+        {
+            thalamusVoxels.push_back(k);
+            thalamusVoxels.push_back(3 - k);
+            thalamusVoxels.push_back(1);
+        }
+        ret.addVolumeModel(StructureEnum::THALAMUS_LEFT, thalamusVoxels);
+        vector<int64_t> rightNodes;//not in vertex order, the view must not assume it is
+        for (int64_t i = 0; i < 80; i += 2) rightNodes.push_back(79 - i);
+        for (int64_t i = 0; i < 80; i += 4) rightNodes.push_back(i);
+        ret.addSurfaceModel(80, StructureEnum::CORTEX_RIGHT, rightNodes);
+        return ret;
+    }
+    
+    CiftiXML makeXML(const int& denseDir)
+    {
+        CiftiScalarsMap scalarMap;
+        scalarMap.setLength(NUM_MAPS);
+        CiftiXML ret;
+        ret.setNumberOfDimensions(2);
+        ret.setMap(denseDir, makeDenseMap());
+        ret.setMap(1 - denseDir, scalarMap);
+        return ret;
+    }
+    
+    void checkReadView(TestInterface* theTest, const CiftiFile& myCifti, const int& denseDir, const StructureEnum::Enum& myStruct, const int64_t& maxBufferBytes)
+    {
+        const AString condition = StructureEnum::toName(myStruct) + (denseDir == CiftiXML::ALONG_COLUMN ? " along columns" : " along rows")
+                                  + ", buffer of " + AString::number(maxBufferBytes) + " bytes";
+        const CiftiBrainModelsMap& myDenseMap = myCifti.getCiftiXML().getBrainModelsMap(denseDir);
+        CiftiStructureView myView(&myCifti, denseDir, myStruct, maxBufferBytes);
+        if (myView.getNumberOfMaps() != NUM_MAPS)
+        {
+            theTest->setFailed(condition + ", wrong number of maps");
+            return;
+        }
+        vector<int64_t> ciftiIndices;
+        if (myDenseMap.hasSurfaceData(myStruct))
+        {
+            vector<CiftiBrainModelsMap::SurfaceMap> expected = myDenseMap.getSurfaceMap(myStruct);
+            const vector<CiftiBrainModelsMap::SurfaceMap>& viewMap = myView.getSurfaceMap();
+            if (!myView.isSurface() || viewMap.size() != expected.size() || myView.getNumberOfElements() != (int64_t)expected.size() ||
+                myView.getSurfaceNumberOfNodes() != myDenseMap.getSurfaceNumberOfNodes(myStruct))
+            {
+                theTest->setFailed(condition + ", surface map has the wrong size");
+                return;
+            }
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                if (viewMap[i].m_ciftiIndex != expected[i].m_ciftiIndex || viewMap[i].m_surfaceNode != expected[i].m_surfaceNode)
+                {
+                    theTest->setFailed(condition + ", surface map differs from getSurfaceMap at element " + AString::number(i));
+                    return;
+                }
+                ciftiIndices.push_back(expected[i].m_ciftiIndex);
+            }
+        } else {
+            vector<CiftiBrainModelsMap::VolumeMap> expected = myDenseMap.getVolumeStructureMap(myStruct);
+            const vector<CiftiBrainModelsMap::VolumeMap>& viewMap = myView.getVolumeMap();
+            if (myView.isSurface() || viewMap.size() != expected.size() || myView.getNumberOfElements() != (int64_t)expected.size())
+            {
+                theTest->setFailed(condition + ", volume map has the wrong size");
+                return;
+            }
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                if (viewMap[i].m_ciftiIndex != expected[i].m_ciftiIndex || viewMap[i].m_ijk[0] != expected[i].m_ijk[0] ||
+                    viewMap[i].m_ijk[1] != expected[i].m_ijk[1] || viewMap[i].m_ijk[2] != expected[i].m_ijk[2])
+                {
+                    theTest->setFailed(condition + ", volume map differs from getVolumeStructureMap at element " + AString::number(i));
+                    return;
+                }
+                ciftiIndices.push_back(expected[i].m_ciftiIndex);
+            }
+        }
+        vector<float> elements(ciftiIndices.size());
+        const int64_t mapOrder[NUM_MAPS] = { 6, 0, 3, 4, 1, 5, 2 };//jump between blocks, and back into earlier ones
+        for (int64_t m = 0; m < NUM_MAPS; ++m)
+        {
+            const int64_t map = mapOrder[m];
+            myView.getElements(map, elements.data());
+            for (size_t i = 0; i < ciftiIndices.size(); ++i)
+            {
+                if (elements[i] != testValue(ciftiIndices[i], map))
+                {
+                    theTest->setFailed(condition + ", getElements has the wrong value for element " + AString::number(i) + " of map " + AString::number(map));
+                    return;
+                }
+            }
+            if (myView.isSurface())
+            {
+                const vector<CiftiBrainModelsMap::SurfaceMap>& viewMap = myView.getSurfaceMap();
+                const int64_t numNodes = myView.getSurfaceNumberOfNodes();
+                vector<float> nodeData(numNodes), expected(numNodes, 0.0f);
+                for (size_t i = 0; i < viewMap.size(); ++i)
+                {
+                    expected[viewMap[i].m_surfaceNode] = testValue(viewMap[i].m_ciftiIndex, map);
+                }
+                myView.getSurfaceNodeData(map, nodeData.data());
+                if (nodeData != expected)
+                {
+                    theTest->setFailed(condition + ", getSurfaceNodeData has the wrong values for map " + AString::number(map));
+                    return;
+                }
+            }
+        }
+        if (myView.isSurface())
+        {
+            const int64_t numNodes = myView.getSurfaceNumberOfNodes();
+            const vector<int64_t> nodeList = myDenseMap.getNodeList(myStruct);
+            vector<float> roi(numNodes), expected(numNodes, 0.0f);
+            for (size_t i = 0; i < nodeList.size(); ++i)
+            {
+                expected[nodeList[i]] = 1.0f;
+            }
+            myView.getSurfaceRoi(roi.data());
+            if (roi != expected)
+            {
+                theTest->setFailed(condition + ", getSurfaceRoi does not match the structure's vertex list");
+                return;
+            }
+        }
+    }
+    
+    void checkWriteViews(TestInterface* theTest, const CiftiFile& myCifti, const int& denseDir, const int64_t& maxBufferBytes)
+    {//copy every structure through writable views, the result must match the original everywhere
+        const AString condition = AString(denseDir == CiftiXML::ALONG_COLUMN ? "along columns" : "along rows") + ", buffer of " + AString::number(maxBufferBytes) + " bytes";
+        const CiftiXML& myXML = myCifti.getCiftiXML();
+        CiftiFile outCifti;
+        outCifti.setCiftiXML(myXML);
+        vector<StructureEnum::Enum> structList = myXML.getBrainModelsMap(denseDir).getSurfaceStructureList();
+        for (size_t s = 0; s < structList.size(); ++s)
+        {//surfaces go through vertex data
+            CiftiStructureView inView(&myCifti, denseDir, structList[s], maxBufferBytes);
+            CiftiStructureView outView(&outCifti, denseDir, structList[s], maxBufferBytes);
+            vector<float> nodeData(inView.getSurfaceNumberOfNodes());
+            for (int64_t map = NUM_MAPS - 1; map >= 0; --map)
+            {
+                inView.getSurfaceNodeData(map, nodeData.data());
+                outView.setSurfaceNodeData(map, nodeData.data());
+            }
+            outView.flush();
+        }
+        structList = myXML.getBrainModelsMap(denseDir).getVolumeStructureList();
+        for (size_t s = 0; s < structList.size(); ++s)
+        {
+            CiftiStructureView inView(&myCifti, denseDir, structList[s], maxBufferBytes);
+            CiftiStructureView outView(&outCifti, denseDir, structList[s], maxBufferBytes);
+            vector<float> elements(inView.getNumberOfElements());
+            for (int64_t map = 0; map < NUM_MAPS; ++map)
+            {
+                inView.getElements(map, elements.data());
+                outView.setElements(map, elements.data());
+            }
+            outView.flush();
+        }
+        const int64_t rowLength = myCifti.getNumberOfColumns(), numRows = myCifti.getNumberOfRows();
+        vector<float> expected(rowLength), row(rowLength);
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            myCifti.getRow(expected.data(), i);
+            outCifti.getRow(row.data(), i);
+            if (row != expected)
+            {
+                theTest->setFailed(condition + ", writing through structure views changed row " + AString::number(i));
+                return;
+            }
+        }
+    }
+}
+
+void CiftiStructureViewTest::execute()
+{
+    const int denseDirs[2] = { CiftiXML::ALONG_COLUMN, CiftiXML::ALONG_ROW };
+    for (int d = 0; d < 2 && !failed(); ++d)
+    {
+        const int denseDir = denseDirs[d];
+        CiftiFile myCifti;
+        myCifti.setCiftiXML(makeXML(denseDir));
+        const int64_t rowLength = myCifti.getNumberOfColumns(), numRows = myCifti.getNumberOfRows();
+        vector<float> row(rowLength);
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            for (int64_t j = 0; j < rowLength; ++j)
+            {
+                if (denseDir == CiftiXML::ALONG_COLUMN)
+                {
+                    row[j] = testValue(i, j);
+                } else {
+                    row[j] = testValue(j, i);
+                }
+            }
+            myCifti.setRow(row.data(), i);
+        }
+        const CiftiBrainModelsMap& myDenseMap = myCifti.getCiftiXML().getBrainModelsMap(denseDir);
+        vector<StructureEnum::Enum> structList = myDenseMap.getSurfaceStructureList();
+        vector<StructureEnum::Enum> volStructList = myDenseMap.getVolumeStructureList();
+        structList.insert(structList.end(), volStructList.begin(), volStructList.end());
+        const int64_t bufferSizes[2] = { CiftiStructureView::DEFAULT_BUFFER_BYTES, 3 * 80 * sizeof(float) };//the small buffer splits the maps into blocks for every structure
+        for (int b = 0; b < 2 && !failed(); ++b)
+        {
+            for (size_t s = 0; s < structList.size() && !failed(); ++s)
+            {
+                checkReadView(this, myCifti, denseDir, structList[s], bufferSizes[b]);
+            }
+            if (!failed()) checkWriteViews(this, myCifti, denseDir, bufferSizes[b]);
+        }
+    }
+}
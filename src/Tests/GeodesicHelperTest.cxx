@@ -21,8 +21,12 @@
 
 #include "GeodesicHelper.h"
 #include "SurfaceFile.h"
+#include "TopologyHelper.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <map>
 
 using namespace caret;
 using namespace std;
@@ -49,6 +53,74 @@ namespace
             }
         }
     }
+    
+    void checkSameDistances(GeodesicHelperTest* theTest, const AString& condition, const vector<int32_t>& firstNodes, const vector<float>& firstDists,
+                            const vector<int32_t>& secondNodes, const vector<float>& secondDists)
+    {//batched searches don't sort their output by distance, so compare as maps
+        if (firstNodes.size() != secondNodes.size())
+        {
+            theTest->setFailed(condition + ", found different size node lists");
+            return;
+        }
+        map<int32_t, float> firstMap;
+        for (size_t i = 0; i < firstNodes.size(); ++i)
+        {
+            firstMap[firstNodes[i]] = firstDists[i];
+        }
+        for (size_t i = 0; i < secondNodes.size(); ++i)
+        {
+            map<int32_t, float>::const_iterator iter = firstMap.find(secondNodes[i]);
+            if (iter == firstMap.end())
+            {
+                theTest->setFailed(condition + ", found extra node " + AString::number(secondNodes[i]));
+                return;
+            }
+            if (abs(iter->second - secondDists[i]) > 0.0001f * max(1.0f, iter->second))
+            {
+                theTest->setFailed(condition + ", found different distance for node " + AString::number(secondNodes[i]));
+                return;
+            }
+        }
+    }
+    
+    void checkBatches(GeodesicHelperTest* theTest, const AString& condition, CaretPointer<GeodesicHelper> myHelp, const int32_t mustInclude)
+    {//batches bigger than the blocks smoothing uses, with and without the smoothing neighbors, optionally only the block containing mustInclude
+        const int32_t BATCH_SIZE = 40;
+        const int TEST_BATCHES = 5;
+        const float MAX_GEO_DIST = 20.0f;
+        vector<vector<int32_t> > blocks;
+        myHelp->getNearbyNodeBlocks(BATCH_SIZE, blocks);
+        if (mustInclude >= 0)
+        {
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                if (find(blocks[i].begin(), blocks[i].end(), mustInclude) != blocks[i].end())
+                {
+                    blocks = vector<vector<int32_t> >(1, blocks[i]);
+                    break;
+                }
+            }
+        }
+        vector<int32_t> singleNodes;
+        vector<float> singleDists;
+        vector<vector<int32_t> > batchNodes;
+        vector<vector<float> > batchDists;
+        for (int smooth = 0; smooth < 2; ++smooth)
+        {
+            const AString smoothName = (smooth ? "smoothflag true" : "smoothflag false");
+            for (int i = 0; !theTest->failed() && i < TEST_BATCHES; ++i)
+            {
+                const vector<int32_t>& batchRoots = blocks[rand() % blocks.size()];
+                myHelp->getNodesToGeoDist(batchRoots, MAX_GEO_DIST, batchNodes, batchDists, smooth != 0);
+                for (size_t j = 0; !theTest->failed() && j < batchRoots.size(); ++j)
+                {
+                    myHelp->getNodesToGeoDist(batchRoots[j], MAX_GEO_DIST, singleNodes, singleDists, smooth != 0);
+                    checkSameDistances(theTest, "Comparing single to batched of " + AString::number(batchRoots.size()) + ", " + condition + smoothName + ", getNodesToGeoDist",
+                                       singleNodes, singleDists, batchNodes[j], batchDists[j]);
+                }
+            }
+        }
+    }
 }
 
 void GeodesicHelperTest::execute()
@@ -96,4 +168,15 @@ void GeodesicHelperTest::execute()
         checkNodeLists(this, "Comparing normal to quarter areas, getPathFollowingData", nodesNorm, nodesQuarter);
         checkNodeLists(this, "Comparing normal to quad areas, getPathFollowingData", nodesNorm, nodesQuad);
     }
+    if (failed()) return;
+    checkBatches(this, "", normalHelp, -1);
+    if (failed()) return;
+    //move one vertex almost onto its neighbor, so the shortest edge is far too short for the Dial buckets to span the longest edge, and the batch falls back to the heap
+    SurfaceFile squishedSurf = mySurf;
+    int32_t squishNode = rand() % numNodes;
+    int32_t squishNeighbor = mySurf.getTopologyHelper()->getNodeNeighbors(squishNode)[0];
+    const float* neighborCoord = mySurf.getCoordinate(squishNeighbor);
+    squishedSurf.setCoordinate(squishNode, neighborCoord[0] + 0.0001f, neighborCoord[1], neighborCoord[2]);
+    CaretPointer<GeodesicHelper> squishedHelp = squishedSurf.getGeodesicHelper();
+    checkBatches(this, "with a very short edge, ", squishedHelp, squishNode);//only batches whose region has the short edge take the heap
 }
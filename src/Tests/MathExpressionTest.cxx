@@ -55,4 +55,39 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    testArrays();
+}
+
+void MathExpressionTest::testArrays()
+{//the compiled array evaluation must give the same answers as the tree evaluation, including comparisons, logic and multi-argument functions
+    CaretMathExpression myExpr("(a >= b) * max(a, -b) + (a != 0 || !b) - mod(a, 2.5) / clamp(b, -1, 1) + atan2(a, b) ^ 2");
+    vector<AString> varNames = myExpr.getVarNames();
+    if (varNames.size() != 2)
+    {
+        setFailed("incorrect number of variables found in array expression");
+        return;
+    }
+    const int64_t count = 1000;//more than one block, and not a multiple of the block size
+    vector<float> first(count), second(count), result(count);
+    for (int64_t i = 0; i < count; ++i)
+    {
+        first[i] = (i % 37) * 0.25f - 4.0f;
+        second[i] = (i % 11) * 0.5f - 2.5f;
+    }
+    vector<const float*> arrays(2);
+    arrays[0] = first.data();
+    arrays[1] = second.data();
+    myExpr.evaluateArrays(arrays, result.data(), count);
+    vector<float> vars(2);
+    for (int64_t i = 0; i < count; ++i)
+    {
+        vars[0] = first[i];
+        vars[1] = second[i];
+        float expected = (float)myExpr.evaluate(vars);
+        if (!(result[i] == expected) && !(result[i] != result[i] && expected != expected))//allow matching NaNs
+        {
+            setFailed("array evaluation differs at element " + AString::number(i) + ", expected " + AString::number(expected) + ", got " + AString::number(result[i]));
+            return;
+        }
+    }
 }
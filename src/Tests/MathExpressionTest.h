@@ -29,6 +29,8 @@ namespace caret {
    public:
       MathExpressionTest(const AString& identifier);
       virtual void execute();
+   private:
+      void testArrays();
    };
 
 }
@@ -0,0 +1,164 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "MetricSmoothingTest.h"
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceFile.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+MetricSmoothingTest::MetricSmoothingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void MetricSmoothingTest::execute()
+{
+    testPanels();
+    if (failed()) return;
+    testKernelCache();
+}
+
+void MetricSmoothingTest::testPanels()
+{//smoothColumns interleaves columns into panels, it should give the same answers as smoothing each column alone
+    SurfaceFile mySurf;
+    AlgorithmSurfaceCreateSphere(NULL, 2562, &mySurf);
+    const int32_t numNodes = mySurf.getNumberOfNodes();
+    const int32_t NUM_COLUMNS = 37;//two full panels of 16, and a partial one
+    MetricSmoothingObject mySmooth(&mySurf, 8.0f);
+    srand(1);
+    vector<vector<float> > inData(NUM_COLUMNS, vector<float>(numNodes)), panelOut(NUM_COLUMNS, vector<float>(numNodes));
+    vector<const float*> columnsIn(NUM_COLUMNS);
+    vector<float*> columnsOut(NUM_COLUMNS);
+    for (int32_t c = 0; c < NUM_COLUMNS; ++c)
+    {
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            inData[c][i] = ((rand() % 4 == 0) ? 0.0f : (float)(rand() % 1000) / 100.0f - 5.0f);//some zeros for fixZeros
+        }
+        columnsIn[c] = inData[c].data();
+        columnsOut[c] = panelOut[c].data();
+    }
+    vector<float> roi(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        roi[i] = (mySurf.getCoordinate(i)[2] > -30.0f ? 1.0f : 0.0f);//cut off part of the sphere, so some kernels are masked
+    }
+    vector<float> columnOut(numNodes);
+    for (int useRoi = 0; useRoi < 2; ++useRoi)
+    {
+        for (int fixZeros = 0; fixZeros < 2; ++fixZeros)
+        {
+            const float* roiColumn = (useRoi ? roi.data() : NULL);
+            const AString caseName = AString(useRoi ? "with" : "without") + " roi, " + (fixZeros ? "with" : "without") + " fixZeros";
+            mySmooth.smoothColumns(columnsIn, columnsOut, roiColumn, fixZeros != 0);
+            for (int32_t c = 0; c < NUM_COLUMNS; ++c)
+            {
+                mySmooth.smoothColumn(columnsIn[c], columnOut.data(), roiColumn, fixZeros != 0);
+                for (int32_t i = 0; i < numNodes; ++i)
+                {//same summation order, allow only for the compiler contracting multiply-adds differently
+                    if (abs(columnOut[i] - panelOut[c][i]) > 1e-6f * (1.0f + abs(columnOut[i])))
+                    {
+                        setFailed("smoothColumns " + caseName + " differs from smoothColumn at column " + AString::number(c) + ", vertex " + AString::number(i) +
+                                  ": " + AString::number(panelOut[c][i]) + " vs " + AString::number(columnOut[i]));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void MetricSmoothingTest::testKernelCache()
+{//kernels written by precomputeKernels should be used by the constructor, and give the same results as computing them
+    SurfaceFile mySurf, otherSurf;
+    AlgorithmSurfaceCreateSphere(NULL, 642, &mySurf);
+    AlgorithmSurfaceCreateSphere(NULL, 2562, &otherSurf);
+    const float KERNEL = 10.0f;
+    QDir tempDir(QDir::tempPath());
+    const AString cacheDir = QDir::tempPath() + "/wb_smoothing_kernel_test", otherCacheDir = QDir::tempPath() + "/wb_smoothing_kernel_test_other";
+    tempDir.mkpath(cacheDir);
+    tempDir.mkpath(otherCacheDir);
+    const AString previousCacheDir = MetricSmoothingObject::getKernelCacheDirectory();
+    AString kernelFile = MetricSmoothingObject::precomputeKernels(&mySurf, KERNEL, NULL, MetricSmoothingObject::GEO_GAUSS_AREA, NULL, cacheDir);
+    AString otherKernelFile = MetricSmoothingObject::precomputeKernels(&otherSurf, KERNEL, NULL, MetricSmoothingObject::GEO_GAUSS_AREA, NULL, otherCacheDir);
+    if (!QFile::exists(kernelFile))
+    {
+        setFailed("precomputeKernels did not write '" + kernelFile + "'");
+    }
+    const int32_t numNodes = mySurf.getNumberOfNodes(), otherNumNodes = otherSurf.getNumberOfNodes();
+    vector<float> inData(otherNumNodes), computedOut(otherNumNodes), cachedOut(otherNumNodes);
+    srand(2);
+    for (int32_t i = 0; i < otherNumNodes; ++i)
+    {
+        inData[i] = (float)(rand() % 1000) / 100.0f - 5.0f;
+    }
+    if (!failed())
+    {
+        MetricSmoothingObject::setKernelCacheDirectory("");
+        MetricSmoothingObject computed(&mySurf, KERNEL);
+        MetricSmoothingObject::setKernelCacheDirectory(cacheDir);
+        MetricSmoothingObject cached(&mySurf, KERNEL);
+        computed.smoothColumn(inData.data(), computedOut.data());
+        cached.smoothColumn(inData.data(), cachedOut.data());
+        for (int32_t i = 0; i < numNodes; ++i)
+        {//same kernels, same arithmetic
+            if (computedOut[i] != cachedOut[i])
+            {
+                setFailed("smoothing with kernels read from the cache differs from computed kernels at vertex " + AString::number(i));
+                break;
+            }
+        }
+    }
+    if (!failed())
+    {//put this surface's kernels where the other surface's kernels belong, they must be rejected, not used
+        QFile::remove(otherKernelFile);
+        QFile::copy(kernelFile, otherKernelFile);
+        MetricSmoothingObject::setKernelCacheDirectory("");
+        MetricSmoothingObject computed(&otherSurf, KERNEL);
+        MetricSmoothingObject::setKernelCacheDirectory(otherCacheDir);
+        MetricSmoothingObject mismatched(&otherSurf, KERNEL);
+        if (mismatched.getNumberOfNodes() != otherNumNodes)
+        {
+            setFailed("kernels for a " + AString::number(numNodes) + " vertex surface were used for a " + AString::number(otherNumNodes) + " vertex surface");
+        } else {
+            computed.smoothColumn(inData.data(), computedOut.data());
+            mismatched.smoothColumn(inData.data(), cachedOut.data());
+            if (computedOut != cachedOut)
+            {
+                setFailed("smoothing after rejecting mismatched cached kernels differs from computed kernels");
+            }
+        }
+    }
+    MetricSmoothingObject::setKernelCacheDirectory(previousCacheDir);
+    QFile::remove(kernelFile);
+    QFile::remove(otherKernelFile);
+    tempDir.rmdir(cacheDir);
+    tempDir.rmdir(otherCacheDir);
+}
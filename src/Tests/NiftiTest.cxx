@@ -20,9 +20,11 @@
 
 #include "NiftiTest.h"
 
+#include "CaretBinaryFile.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace std;
@@ -38,6 +40,8 @@ void NiftiFileTest::execute()
     if(this->failed()) return;
     testNiftiReadWrite();
     if(this->failed()) return;
+    testBlockGzip();
+    if(this->failed()) return;
 }
 
 void NiftiFileTest::testNiftiReadWrite()
@@ -90,6 +94,52 @@ void NiftiFileTest::testNiftiReadWrite()
     std::cout << "Reading and writing of Nifti was successful for all frames." << std::endl;
 }
 
+void NiftiFileTest::testBlockGzip()
+{
+    std::cout << "Testing block-compressed gzip reader/writer." << std::endl;
+    AString outFile = this->m_default_path + "/nifti/BlockGzipTestOut.bin.gz";
+    const int64_t dataSize = 5 * 1000 * 1000 + 17;//several blocks, last one partial
+    vector<int32_t> data(dataSize);
+    for (int64_t i = 0; i < dataSize; ++i)
+    {
+        data[i] = (int32_t)((i * 7919) % 1000);//compressible, but not trivially
+    }
+    {
+        CaretBinaryFile writer(outFile, CaretBinaryFile::WRITE_TRUNCATE);
+        int64_t written = 0, piece = 12345;
+        while (written < dataSize)
+        {//odd write sizes, to cross block boundaries
+            int64_t toWrite = min(piece, dataSize - written);
+            writer.write(data.data() + written, toWrite * sizeof(int32_t));
+            written += toWrite;
+            piece *= 3;
+        }
+        writer.close();
+    }
+    CaretBinaryFile reader(outFile, CaretBinaryFile::READ);
+    vector<int32_t> readBack(dataSize);
+    reader.read(readBack.data(), dataSize * sizeof(int32_t));
+    if (readBack != data)
+    {
+        setFailed("block-compressed gzip sequential read does not match what was written");
+        return;
+    }
+    const int64_t positions[] = { dataSize - 1, 0, 262144, 262143, 3000000, 17 };//across and inside blocks, backwards
+    for (int i = 0; i < (int)(sizeof(positions) / sizeof(int64_t)); ++i)
+    {
+        int64_t count = min((int64_t)100, dataSize - positions[i]);
+        vector<int32_t> chunk(count);
+        reader.seek(positions[i] * sizeof(int32_t));
+        reader.read(chunk.data(), count * sizeof(int32_t));
+        if (!equal(chunk.begin(), chunk.end(), data.begin() + positions[i]))
+        {
+            setFailed("block-compressed gzip seek and read does not match what was written, at element " + AString::number(positions[i]));
+            return;
+        }
+    }
+    std::cout << "Block-compressed gzip reading and writing was successful." << std::endl;
+}
+
 //Tests for reading and writing Nifti Headers
 
 NiftiHeaderTest::NiftiHeaderTest(const AString &identifier) : TestInterface(identifier)
@@ -32,6 +32,7 @@ public:
     NiftiFileTest(const AString& identifier);
     virtual void execute();
     void testNiftiReadWrite();
+    void testBlockGzip();
 };
 
 class NiftiHeaderTest : public TestInterface
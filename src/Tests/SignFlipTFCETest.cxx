@@ -0,0 +1,121 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SignFlipTFCETest.h"
+
+#include "AlgorithmVolumeTFCE.h"
+#include "FloatMatrix.h"
+#include "SignFlipPermutations.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SignFlipTFCETest::SignFlipTFCETest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void SignFlipTFCETest::execute()
+{
+    const int NUM_SUBJECTS = 4;
+    const int64_t DIM = 6;
+    vector<int64_t> dims(4, DIM);
+    dims[3] = NUM_SUBJECTS;
+    VolumeFile subjects(dims, FloatMatrix::identity(4).getMatrix());
+    vector<float> frame(DIM * DIM * DIM);
+    for (int s = 0; s < NUM_SUBJECTS; ++s)
+    {//zero background, and a 2x2x2 blob that is positive in every subject
+        for (int64_t k = 0; k < DIM; ++k)
+        {
+            for (int64_t j = 0; j < DIM; ++j)
+            {
+                for (int64_t i = 0; i < DIM; ++i)
+                {
+                    bool inBlob = (i >= 2 && i < 4 && j >= 2 && j < 4 && k >= 2 && k < 4);
+                    frame[subjects.getIndex(i, j, k)] = (inBlob ? 10.0f + 0.5f * s : 0.0f);
+                }
+            }
+        }
+        subjects.setFrame(frame.data(), s);
+    }
+    //unflipped, all flipped (same maximum by symmetry), and two balanced flips (t near zero)
+    AString flipFileName = QDir::tempPath() + "/wb_sign_flip_tfce_test.txt";
+    {
+        ofstream flipFile(flipFileName.toLocal8Bit().constData());
+        flipFile << "1 1 1 1\n-1 -1 -1 -1\n1 -1 1 -1\n-1 1 1 -1\n";
+    }
+    SignFlipPermutations myPerms(flipFileName, NUM_SUBJECTS);
+    QFile::remove(flipFileName);
+    if (myPerms.getNumberOfPermutations() != 4)
+    {
+        setFailed("flip file should contain 4 permutations, read " + AString::number(myPerms.getNumberOfPermutations()));
+        return;
+    }
+    VolumeFile tfceOut, pValueOut;
+    vector<float> nullDist;
+    AlgorithmVolumeTFCE(NULL, &subjects, &tfceOut, &pValueOut, myPerms, &nullDist);
+    if (nullDist.size() != 4)
+    {
+        setFailed("null distribution should have 4 entries, has " + AString::number(nullDist.size()));
+        return;
+    }
+    if (!(nullDist[0] > 0.0f) || nullDist[1] != nullDist[0])
+    {
+        setFailed("unflipped and all-flipped permutations should have the same, positive, maximum");
+    }
+    if (!(nullDist[2] < nullDist[0]) || !(nullDist[3] < nullDist[0]))
+    {
+        setFailed("balanced flips should have a smaller maximum than the unflipped data");
+    }
+    const float* tfce = tfceOut.getFrame();
+    const float* pvals = pValueOut.getFrame();
+    const int64_t blobVoxel = tfceOut.getIndex(2, 3, 2), backgroundVoxel = tfceOut.getIndex(0, 0, 0);
+    if (tfce[blobVoxel] != nullDist[0])
+    {
+        setFailed("blob TFCE should equal the maximum of the unflipped permutation");
+    }
+    if (pvals[blobVoxel] != 0.5f)
+    {
+        setFailed("blob p-value should be 0.5 (2 of 4 permutations reach it), got " + AString::number(pvals[blobVoxel]));
+    }
+    if (pvals[backgroundVoxel] != 1.0f)
+    {
+        setFailed("background p-value should be 1, got " + AString::number(pvals[backgroundVoxel]));
+    }
+    for (int64_t i = 0; i < (int64_t)frame.size() && !failed(); ++i)
+    {
+        int count = 0;
+        for (int perm = 0; perm < 4; ++perm)
+        {
+            if (nullDist[perm] >= abs(tfce[i])) ++count;
+        }
+        if (pvals[i] != count / 4.0f)
+        {
+            setFailed("p-value at voxel " + AString::number(i) + " is not the fraction of permutation maximums at least as large as its TFCE value");
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SparseFileTest.h"
+
+#include "CaretSparseFile.h"
+#include "CiftiScalarsMap.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SparseFileTest::SparseFileTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void SparseFileTest::execute()
+{
+    testRoundTrip(1);
+    if (failed()) return;
+    testRoundTrip(2);
+}
+
+void SparseFileTest::testRoundTrip(const int& formatVersion)
+{
+    const int64_t ROW_LENGTH = 200, NUM_ROWS = 53;//not a multiple of the rows per block in version 2
+    CiftiScalarsMap rowMap, colMap;
+    rowMap.setLength(ROW_LENGTH);
+    colMap.setLength(NUM_ROWS);
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_ROW, rowMap);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, colMap);
+    vector<vector<int64_t> > indices(NUM_ROWS), values(NUM_ROWS);
+    for (int64_t row = 0; row < NUM_ROWS; ++row)
+    {
+        if (row % 7 == 3) continue;//leave some rows empty, and skip them while writing
+        for (int64_t i = 0; i < ROW_LENGTH; ++i)
+        {
+            if (rand() % 4 != 0) continue;
+            indices[row].push_back(i);
+            int64_t value = ((int64_t)rand() << 20) ^ rand();//values wider than the 30 bits that version 2 bit packs
+            if (value == 0) value = 1;
+            values[row].push_back(value);
+        }
+    }
+    AString fileName = QDir::tempPath() + "/wb_sparse_test_v" + AString::number(formatVersion) + ".trajTEMP.wbsparse";
+    {
+        CaretSparseFileWriter myWriter(fileName, myXML, formatVersion);
+        for (int64_t row = 0; row < NUM_ROWS; ++row)
+        {
+            if (indices[row].empty()) continue;
+            myWriter.writeRowSparse(row, indices[row], values[row]);
+        }
+        myWriter.finish();
+    }
+    {
+        CaretSparseFile myFile(fileName);
+        if (myFile.getFormatVersion() != formatVersion)
+        {
+            setFailed("wrote wbsparse version " + AString::number(formatVersion) + ", but read back version " + AString::number(myFile.getFormatVersion()));
+        }
+        if (myFile.getDimensions()[0] != ROW_LENGTH || myFile.getDimensions()[1] != NUM_ROWS)
+        {
+            setFailed("wbsparse version " + AString::number(formatVersion) + " dimensions changed on round trip");
+        }
+        vector<int64_t> fullRow(ROW_LENGTH), indicesIn, valuesIn;
+        for (int64_t row = NUM_ROWS - 1; row >= 0 && !failed(); --row)//read backwards, so that version 2 doesn't just walk the blocks in order
+        {
+            myFile.getRowSparse(row, indicesIn, valuesIn);
+            if (indicesIn != indices[row] || valuesIn != values[row])
+            {
+                setFailed("wbsparse version " + AString::number(formatVersion) + " sparse row " + AString::number(row) + " does not match what was written");
+            }
+            myFile.getRow(row, fullRow.data());
+            size_t next = 0;
+            for (int64_t i = 0; i < ROW_LENGTH; ++i)
+            {
+                int64_t expected = 0;
+                if (next < indices[row].size() && indices[row][next] == i)
+                {
+                    expected = values[row][next];
+                    ++next;
+                }
+                if (fullRow[i] != expected)
+                {
+                    setFailed("wbsparse version " + AString::number(formatVersion) + " row " + AString::number(row) + " does not match what was written");
+                    break;
+                }
+            }
+        }
+    }
+    QFile::remove(fileName);
+}
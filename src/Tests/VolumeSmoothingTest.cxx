@@ -0,0 +1,178 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeSmoothingTest.h"
+
+#include "AlgorithmVolumeSmoothing.h"
+#include "FloatMatrix.h"
+#include "VolumeFile.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    ///the orthogonal smoothing as the previous implementation did it: per-voxel 1D passes along i, j, then k,
+    ///carrying weighted sums of the used values and of the weights, and dividing only at the end
+    void referenceSmoothFrame(const float* inFrame, const float* roiFrame, const int64_t dims[3], const vector<float> weights[3], const bool& fixZeros, float* outFrame)
+    {
+        const int64_t frameSize = dims[0] * dims[1] * dims[2];
+        const int64_t strides[3] = { 1, dims[0], dims[0] * dims[1] };
+        vector<float> sums(frameSize), weightSums(frameSize), sums2(frameSize), weightSums2(frameSize);
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            bool used = (roiFrame == NULL || roiFrame[v] > 0.0f) && (!fixZeros || inFrame[v] != 0.0f);
+            sums[v] = (used ? inFrame[v] : 0.0f);
+            weightSums[v] = (used ? 1.0f : 0.0f);
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const int range = ((int)weights[axis].size() - 1) / 2;
+            for (int64_t k = 0; k < dims[2]; ++k)
+            {
+                for (int64_t j = 0; j < dims[1]; ++j)
+                {
+                    for (int64_t i = 0; i < dims[0]; ++i)
+                    {
+                        const int64_t index[3] = { i, j, k };
+                        const int64_t curInd = i + j * strides[1] + k * strides[2];
+                        int64_t kernMin = index[axis] - range, kernMax = index[axis] + range + 1;
+                        if (kernMin < 0) kernMin = 0;
+                        if (kernMax > dims[axis]) kernMax = dims[axis];
+                        float sum = 0.0f, weightSum = 0.0f;
+                        for (int64_t kern = kernMin; kern < kernMax; ++kern)
+                        {
+                            const int64_t thisInd = curInd + (kern - index[axis]) * strides[axis];
+                            const float weight = weights[axis][kern - index[axis] + range];
+                            sum += weight * sums[thisInd];
+                            weightSum += weight * weightSums[thisInd];
+                        }
+                        sums2[curInd] = sum;
+                        weightSums2[curInd] = weightSum;
+                    }
+                }
+            }
+            sums.swap(sums2);
+            weightSums.swap(weightSums2);
+        }
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            if ((roiFrame == NULL || roiFrame[v] > 0.0f) && weightSums[v] != 0.0f)
+            {
+                outFrame[v] = sums[v] / weightSums[v];
+            } else {
+                outFrame[v] = 0.0f;
+            }
+        }
+    }
+}
+
+VolumeSmoothingTest::VolumeSmoothingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void VolumeSmoothingTest::execute()
+{
+    testCase(false, false);
+    if (failed()) return;
+    testCase(false, true);
+    if (failed()) return;
+    testCase(true, false);
+    if (failed()) return;
+    testCase(true, true);
+}
+
+void VolumeSmoothingTest::testCase(const bool& useRoi, const bool& fixZeros)
+{
+    const int64_t dims[3] = { 13, 11, 9 };
+    const int64_t NUM_FRAMES = 5;
+    const float spacing[3] = { 2.0f, 2.5f, 3.0f }, KERNEL = 2.5f;//unequal spacing, so each axis has its own kernel
+    vector<int64_t> volDims(dims, dims + 3);
+    volDims.push_back(NUM_FRAMES);
+    FloatMatrix sform = FloatMatrix::identity(4);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        sform[axis][axis] = spacing[axis];
+    }
+    VolumeFile inVol(volDims, sform.getMatrix()), roiVol;
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<float> frame(frameSize);
+    srand(1);
+    for (int64_t f = 0; f < NUM_FRAMES; ++f)
+    {
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            frame[v] = ((rand() % 5 == 0) ? 0.0f : (float)(rand() % 1000) / 100.0f - 5.0f);//some zeros for -fix-zeros
+        }
+        inVol.setFrame(frame.data(), f);
+    }
+    const float* roiFrame = NULL;
+    if (useRoi)
+    {
+        vector<int64_t> roiDims(dims, dims + 3);
+        roiVol.reinitialize(roiDims, sform.getMatrix());
+        for (int64_t k = 0; k < dims[2]; ++k)
+        {
+            for (int64_t j = 0; j < dims[1]; ++j)
+            {
+                for (int64_t i = 0; i < dims[0]; ++i)
+                {//a blob that doesn't touch the edges, so the bounding box is smaller than the volume, with a hole in it
+                    bool inRoi = (i >= 2 && i < 10 && j >= 1 && j < 9 && k >= 2 && k < 7 && !(i == 5 && j == 4));
+                    frame[roiVol.getIndex(i, j, k)] = (inRoi ? 1.0f : 0.0f);
+                }
+            }
+        }
+        roiVol.setFrame(frame.data());
+        roiFrame = roiVol.getFrame();
+    }
+    vector<float> weights[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        int range = (int)floor(KERNEL * 3.0f / spacing[axis]);
+        weights[axis].resize(2 * range + 1);
+        for (int t = 0; t < 2 * range + 1; ++t)
+        {
+            float tempf = spacing[axis] * (t - range) / KERNEL;
+            weights[axis][t] = exp(-tempf * tempf / 2.0f);
+        }
+    }
+    VolumeFile outVol;
+    AlgorithmVolumeSmoothing(NULL, &inVol, KERNEL, &outVol, (useRoi ? &roiVol : NULL), fixZeros);
+    const AString caseName = AString(useRoi ? "with" : "without") + " roi, " + (fixZeros ? "with" : "without") + " -fix-zeros";
+    vector<float> expected(frameSize);
+    for (int64_t f = 0; f < NUM_FRAMES; ++f)
+    {
+        referenceSmoothFrame(inVol.getFrame(f), roiFrame, dims, weights, fixZeros, expected.data());
+        const float* outFrame = outVol.getFrame(f);
+        for (int64_t v = 0; v < frameSize; ++v)
+        {//the summation order is the same, allow only for the compiler contracting multiply-adds differently
+            if (abs(outFrame[v] - expected[v]) > 1e-5f * (1.0f + abs(expected[v])))
+            {
+                setFailed("separable volume smoothing " + caseName + " differs from the reference at frame " + AString::number(f) + ", voxel " + AString::number(v) +
+                          ": " + AString::number(outFrame[v]) + " vs " + AString::number(expected[v]));
+                return;
+            }
+        }
+    }
+}